@@ -0,0 +1,193 @@
+/******************************************************************************
+* File Name:   app_bas_adc.c
+*
+* Description: This file implements the ADC voltage source of the battery measurement
+*                           pipeline, converting each batch through DMA
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bas_adc.h"
+#include "cyhal.h"
+#include <stdio.h>
+
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <semphr.h>
+
+/* Only BAS_SOURCE=ADC builds touch the ADC, boards without a battery divider
+ * keep the demo level */
+#if defined(APP_BAS_MEAS_ADC) && APP_BAS_MEAS_ADC
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static cyhal_adc_t         app_bas_adc;
+static cyhal_adc_channel_t app_bas_adc_chan;
+
+/* Given by the ADC interrupt once the whole batch is in memory */
+static SemaphoreHandle_t   app_bas_adc_done;
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+static StaticSemaphore_t   app_bas_adc_done_buf;
+#endif
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bas_adc_event_cb
+ *
+ * Function Description:
+ * @brief  ADC interrupt, raised once per batch when the DMA has moved the
+ *         last result
+ *
+ * @param callback_arg  Unused
+ * @param event         ADC event
+ *
+ * @return void
+ */
+static void app_bas_adc_event_cb(void *callback_arg, cyhal_adc_event_t event)
+{
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    (void)callback_arg;
+
+    if (0 != (event & CYHAL_ADC_ASYNC_READ_COMPLETE))
+    {
+        xSemaphoreGiveFromISR(app_bas_adc_done, &higher_priority_task_woken);
+        portYIELD_FROM_ISR(higher_priority_task_woken);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bas_adc_init
+ *
+ * Function Description:
+ * @brief  Initializes the ADC channel on APP_BAS_ADC_PIN for DMA transfers
+ *         of a batch at a time
+ *
+ * @return bool  false if the ADC is unusable
+ */
+static bool app_bas_adc_init(void)
+{
+    const cyhal_adc_channel_config_t chan_cfg =
+    {
+        .enable_averaging   = false,
+        .min_acquisition_ns = APP_BAS_ADC_ACQUISITION_NS,
+        .enabled            = true,
+    };
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+    app_bas_adc_done = xSemaphoreCreateBinaryStatic(&app_bas_adc_done_buf);
+#else
+    app_bas_adc_done = xSemaphoreCreateBinary();
+#endif
+    if (NULL == app_bas_adc_done)
+    {
+        return false;
+    }
+
+    if ((CY_RSLT_SUCCESS != cyhal_adc_init(&app_bas_adc, APP_BAS_ADC_PIN, NULL)) ||
+        (CY_RSLT_SUCCESS != cyhal_adc_channel_init_diff(&app_bas_adc_chan, &app_bas_adc,
+                                                        APP_BAS_ADC_PIN, CYHAL_ADC_VNEG,
+                                                        &chan_cfg)))
+    {
+        printf("Battery ADC init failed\r\n");
+        return false;
+    }
+
+    /* Without DMA the HAL moves each result in its interrupt, still correct
+     * but the CPU wakes once per sample */
+    if (CY_RSLT_SUCCESS != cyhal_adc_set_async_mode(&app_bas_adc, CYHAL_ASYNC_DMA,
+                                                    CYHAL_DMA_PRIORITY_DEFAULT))
+    {
+        printf("Battery ADC without DMA\r\n");
+    }
+    cyhal_adc_register_callback(&app_bas_adc, app_bas_adc_event_cb, NULL);
+    cyhal_adc_enable_event(&app_bas_adc, CYHAL_ADC_ASYNC_READ_COMPLETE,
+                           CYHAL_ISR_PRIORITY_DEFAULT, true);
+    return true;
+}
+
+/**
+ * Function Name:
+ * app_bas_adc_read
+ *
+ * Function Description:
+ * @brief  Converts a batch and blocks the calling task until the DMA has
+ *         moved it, then scales the pin voltages by the battery divider
+ *
+ * @param p_uv      Destination, battery voltages in uV
+ * @param count     Samples to convert
+ *
+ * @return uint16_t  count, 0 if the batch failed or timed out
+ */
+static uint16_t app_bas_adc_read(int32_t *p_uv, uint16_t count)
+{
+    uint16_t i;
+
+    (void)xSemaphoreTake(app_bas_adc_done, 0);
+    if (CY_RSLT_SUCCESS != cyhal_adc_read_async_uv(&app_bas_adc, count, p_uv))
+    {
+        return 0;
+    }
+    if (pdTRUE != xSemaphoreTake(app_bas_adc_done, pdMS_TO_TICKS(APP_BAS_ADC_TIMEOUT_MS)))
+    {
+        (void)cyhal_adc_read_async_abort(&app_bas_adc);
+        return 0;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        p_uv[i] = (p_uv[i] * APP_BAS_ADC_DIVIDER_NUM) / APP_BAS_ADC_DIVIDER_DEN;
+    }
+    return count;
+}
+
+const app_bas_meas_source_t app_bas_adc_source =
+{
+    .init = app_bas_adc_init,
+    .read = app_bas_adc_read,
+};
+
+#endif
+
+
+/* [] END OF FILE */
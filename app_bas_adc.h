@@ -0,0 +1,94 @@
+/******************************************************************************
+* File Name:   app_bas_adc.h
+*
+* Description: This file contains the declarations of the ADC voltage source of the
+*                           battery measurement pipeline
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BAS_ADC_H__
+#define __APP_BAS_ADC_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bas_meas.h"
+#include "cybsp.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Pin sensing the battery, through a divider
+ */
+#ifndef APP_BAS_ADC_PIN
+#define APP_BAS_ADC_PIN                         (CYBSP_A0)
+#endif
+
+/**
+ * @brief Battery divider, battery voltage = pin voltage * NUM / DEN
+ */
+#ifndef APP_BAS_ADC_DIVIDER_NUM
+#define APP_BAS_ADC_DIVIDER_NUM                 (2)
+#endif
+#ifndef APP_BAS_ADC_DIVIDER_DEN
+#define APP_BAS_ADC_DIVIDER_DEN                 (1)
+#endif
+
+/**
+ * @brief Shortest acquisition time of a sample. The divider output
+ *        impedance needs longer than the ADC default.
+ */
+#ifndef APP_BAS_ADC_ACQUISITION_NS
+#define APP_BAS_ADC_ACQUISITION_NS              (10000u)
+#endif
+
+/**
+ * @brief Longest time a batch may take before it is abandoned
+ */
+#ifndef APP_BAS_ADC_TIMEOUT_MS
+#define APP_BAS_ADC_TIMEOUT_MS                  (50u)
+#endif
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+extern const app_bas_meas_source_t app_bas_adc_source;
+
+#endif      /*__APP_BAS_ADC_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,289 @@
+/******************************************************************************
+* File Name:   app_bas_meas.c
+*
+* Description: This file implements the battery measurement pipeline: batch median,
+*                           fixed-point IIR filter and interpolated OCV lookup
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bas_meas.h"
+#include <stddef.h>
+#include <string.h>
+
+/*******************************************************************************
+*        Types
+*******************************************************************************/
+typedef struct
+{
+    uint16_t mv;
+    uint8_t  pct;
+} app_bas_meas_ocv_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static const app_bas_meas_ocv_t app_bas_meas_ocv[] = { APP_BAS_MEAS_OCV_TABLE };
+
+#define APP_BAS_MEAS_OCV_NUM    (sizeof(app_bas_meas_ocv) / sizeof(app_bas_meas_ocv[0]))
+
+/* Only the BAS task runs the pipeline, nothing here is locked. The module
+ * has no RTOS or HAL dependency so that it builds on a host as well. */
+static const app_bas_meas_source_t *app_bas_meas_src;
+static app_bas_meas_stats_t         app_bas_meas_stats;
+static bool                         app_bas_meas_primed;
+static int32_t                      app_bas_meas_batch[APP_BAS_MEAS_BATCH];
+
+/* Recorded trace replayed by app_bas_meas_trace_source */
+static const int32_t *app_bas_meas_trace;
+static uint32_t       app_bas_meas_trace_len;
+static uint32_t       app_bas_meas_trace_pos;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bas_meas_init
+ *
+ * Function Description:
+ * @brief  Selects and prepares the voltage source and clears the filter
+ *
+ * @param p_source  Voltage source
+ *
+ * @return bool  false if the source failed to initialize
+ */
+bool app_bas_meas_init(const app_bas_meas_source_t *p_source)
+{
+    memset(&app_bas_meas_stats, 0, sizeof(app_bas_meas_stats));
+    app_bas_meas_stats.level = 100u;
+    app_bas_meas_primed      = false;
+    app_bas_meas_src         = p_source;
+
+    return (NULL == p_source->init) || p_source->init();
+}
+
+/**
+ * Function Name:
+ * app_bas_meas_sample
+ *
+ * Function Description:
+ * @brief  Reads one batch from the source and runs it through the pipeline
+ *
+ * @return uint8_t  State of Charge in percent, the previous one if the
+ *                  source delivered nothing
+ */
+uint8_t app_bas_meas_sample(void)
+{
+    uint16_t count = 0;
+
+    if (NULL != app_bas_meas_src)
+    {
+        count = app_bas_meas_src->read(app_bas_meas_batch, APP_BAS_MEAS_BATCH);
+    }
+    if (0 == count)
+    {
+        app_bas_meas_stats.failed++;
+        return app_bas_meas_stats.level;
+    }
+    return app_bas_meas_process(app_bas_meas_batch, count);
+}
+
+/**
+ * Function Name:
+ * app_bas_meas_process
+ *
+ * Function Description:
+ * @brief  Takes the median of a batch, feeds it to the IIR filter and maps
+ *         the filtered voltage to State of Charge. Integer only, the CM33
+ *         build runs without the FPU.
+ *
+ * @param p_uv      Battery voltages in uV, sorted in place
+ * @param count     Number of voltages, at least 1
+ *
+ * @return uint8_t  State of Charge in percent
+ */
+uint8_t app_bas_meas_process(int32_t *p_uv, uint16_t count)
+{
+    uint16_t i;
+    uint16_t j;
+    int32_t  value;
+    int32_t  median;
+
+    /* Insertion sort, the batch is short */
+    for (i = 1; i < count; i++)
+    {
+        value = p_uv[i];
+        for (j = i; (j > 0) && (p_uv[j - 1] > value); j--)
+        {
+            p_uv[j] = p_uv[j - 1];
+        }
+        p_uv[j] = value;
+    }
+    median = p_uv[count / 2u];
+    if (0 == (count & 1u))
+    {
+        median = (int32_t)(((int64_t)median + p_uv[(count / 2u) - 1u]) / 2);
+    }
+
+    if (!app_bas_meas_primed)
+    {
+        /* Seed the filter so it does not ramp up from 0 V */
+        app_bas_meas_stats.filtered_uv = median;
+        app_bas_meas_primed = true;
+    }
+#if APP_BAS_MEAS_IIR_SHIFT
+    app_bas_meas_stats.filtered_uv += (median - app_bas_meas_stats.filtered_uv +
+                                       (1 << (APP_BAS_MEAS_IIR_SHIFT - 1u))) >>
+                                      APP_BAS_MEAS_IIR_SHIFT;
+#else
+    app_bas_meas_stats.filtered_uv = median;
+#endif
+
+    app_bas_meas_stats.batches++;
+    app_bas_meas_stats.median_uv = median;
+    app_bas_meas_stats.level     = app_bas_meas_ocv_to_pct(app_bas_meas_stats.filtered_uv);
+    return app_bas_meas_stats.level;
+}
+
+/**
+ * Function Name:
+ * app_bas_meas_ocv_to_pct
+ *
+ * Function Description:
+ * @brief  Maps a voltage to State of Charge, interpolating linearly between
+ *         the points of APP_BAS_MEAS_OCV_TABLE and rounding to the nearest
+ *         percent
+ *
+ * @param uv    Battery voltage in uV
+ *
+ * @return uint8_t  State of Charge in percent, clamped to the table ends
+ */
+uint8_t app_bas_meas_ocv_to_pct(int32_t uv)
+{
+    uint32_t i;
+    int32_t  lo_uv;
+    int32_t  span_uv;
+    int32_t  pct;
+
+    if (uv >= (int32_t)app_bas_meas_ocv[0].mv * 1000)
+    {
+        return app_bas_meas_ocv[0].pct;
+    }
+    for (i = 1; i < APP_BAS_MEAS_OCV_NUM; i++)
+    {
+        lo_uv = (int32_t)app_bas_meas_ocv[i].mv * 1000;
+        if (uv >= lo_uv)
+        {
+            span_uv = ((int32_t)app_bas_meas_ocv[i - 1u].mv * 1000) - lo_uv;
+            pct     = ((uv - lo_uv) * (app_bas_meas_ocv[i - 1u].pct - app_bas_meas_ocv[i].pct) +
+                       (span_uv / 2)) / span_uv;
+            return (uint8_t)(app_bas_meas_ocv[i].pct + pct);
+        }
+    }
+    return app_bas_meas_ocv[APP_BAS_MEAS_OCV_NUM - 1u].pct;
+}
+
+/**
+ * Function Name:
+ * app_bas_meas_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the pipeline counters
+ *
+ * @param p_stats   Destination
+ *
+ * @return void
+ */
+void app_bas_meas_get_stats(app_bas_meas_stats_t *p_stats)
+{
+    *p_stats = app_bas_meas_stats;
+}
+
+/**
+ * Function Name:
+ * app_bas_meas_trace_set
+ *
+ * Function Description:
+ * @brief  Sets the recorded voltages app_bas_meas_trace_source replays
+ *
+ * @param p_uv      Battery voltages in uV, kept by reference
+ * @param count     Number of voltages
+ *
+ * @return void
+ */
+void app_bas_meas_trace_set(const int32_t *p_uv, uint32_t count)
+{
+    app_bas_meas_trace     = p_uv;
+    app_bas_meas_trace_len = count;
+    app_bas_meas_trace_pos = 0;
+}
+
+/**
+ * Function Name:
+ * app_bas_meas_trace_read
+ *
+ * Function Description:
+ * @brief  Read function of the trace source
+ *
+ * @param p_uv      Destination
+ * @param count     Voltages wanted
+ *
+ * @return uint16_t  Voltages copied, 0 at the end of the trace
+ */
+static uint16_t app_bas_meas_trace_read(int32_t *p_uv, uint16_t count)
+{
+    uint32_t left = app_bas_meas_trace_len - app_bas_meas_trace_pos;
+
+    count = (left < count) ? (uint16_t)left : count;
+    if (0 != count)
+    {
+        memcpy(p_uv, &app_bas_meas_trace[app_bas_meas_trace_pos], count * sizeof(*p_uv));
+        app_bas_meas_trace_pos += count;
+    }
+    return count;
+}
+
+const app_bas_meas_source_t app_bas_meas_trace_source =
+{
+    .init = NULL,
+    .read = app_bas_meas_trace_read,
+};
+
+
+/* [] END OF FILE */
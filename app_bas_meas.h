@@ -0,0 +1,126 @@
+/******************************************************************************
+* File Name:   app_bas_meas.h
+*
+* Description: This file contains the declarations of the battery measurement pipeline
+*                           that filters voltage samples and maps them to State of Charge
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BAS_MEAS_H__
+#define __APP_BAS_MEAS_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Samples per batch. The source converts them in one go, through DMA
+ *        on the device, and the batch median rejects dips under radio load.
+ */
+#ifndef APP_BAS_MEAS_BATCH
+#define APP_BAS_MEAS_BATCH                      (16u)
+#endif
+
+/**
+ * @brief IIR filter across batches, y += (x - y) / 2^shift. 0 disables it.
+ */
+#ifndef APP_BAS_MEAS_IIR_SHIFT
+#define APP_BAS_MEAS_IIR_SHIFT                  (3u)
+#endif
+
+/**
+ * @brief Open circuit voltage curve, { mV, percent } pairs by falling
+ *        voltage. The default is a typical 1S Li-ion/LiPo cell at rest;
+ *        define it for the actual cell.
+ */
+#ifndef APP_BAS_MEAS_OCV_TABLE
+#define APP_BAS_MEAS_OCV_TABLE \
+    { 4200u, 100u }, { 4150u, 95u }, { 4110u, 90u }, { 4080u, 85u }, \
+    { 4020u,  80u }, { 3980u, 75u }, { 3950u, 70u }, { 3910u, 65u }, \
+    { 3870u,  60u }, { 3850u, 55u }, { 3840u, 50u }, { 3820u, 45u }, \
+    { 3800u,  40u }, { 3790u, 35u }, { 3770u, 30u }, { 3750u, 25u }, \
+    { 3730u,  20u }, { 3710u, 15u }, { 3690u, 10u }, { 3610u,  5u }, \
+    { 3270u,   0u }
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Voltage source of the pipeline: the ADC on the device, a recorded
+ *        trace on a host
+ */
+typedef struct
+{
+    /* Prepares the source, false if it is unusable */
+    bool     (*init)(void);
+    /* Fills p_uv with up to count battery voltages in uV, returns how many */
+    uint16_t (*read)(int32_t *p_uv, uint16_t count);
+} app_bas_meas_source_t;
+
+/**
+ * @brief Pipeline counters
+ */
+typedef struct
+{
+    uint32_t batches;
+    uint32_t failed;                            /* Batches the source did not deliver */
+    int32_t  median_uv;                         /* Median of the last batch */
+    int32_t  filtered_uv;                       /* IIR output */
+    uint8_t  level;                             /* State of Charge in percent */
+} app_bas_meas_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+bool    app_bas_meas_init        (const app_bas_meas_source_t *p_source);
+uint8_t app_bas_meas_sample      (void);
+uint8_t app_bas_meas_process     (int32_t *p_uv, uint16_t count);
+uint8_t app_bas_meas_ocv_to_pct  (int32_t uv);
+void    app_bas_meas_get_stats   (app_bas_meas_stats_t *p_stats);
+void    app_bas_meas_trace_set   (const int32_t *p_uv, uint32_t count);
+
+extern const app_bas_meas_source_t app_bas_meas_trace_source;
+
+#endif      /*__APP_BAS_MEAS_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,327 @@
+/******************************************************************************
+* File Name:   app_bt_adv_bas.c
+*
+* Description: This file fits the battery level as Battery Service data into the
+*                           legacy advertising payload and keeps it current
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_adv_bas.h"
+#include "wiced_bt_uuid.h"
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/* Length and type bytes in front of the data of each element */
+#define APP_BT_ADV_BAS_ELEM_OVERHEAD        (2u)
+
+/* Position of the level in the service data */
+#define APP_BT_ADV_BAS_LEVEL_OFFSET         (2u)
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* Elements handed to the stack. They point into the configured data, except
+ * for the Battery Service data below. */
+static wiced_bt_ble_advert_elem_t app_bt_adv_bas_adv[APP_BT_ADV_BAS_MAX_ELEMS];
+static wiced_bt_ble_advert_elem_t app_bt_adv_bas_scan_rsp[APP_BT_ADV_BAS_MAX_ELEMS];
+static uint8_t                    app_bt_adv_bas_num_adv;
+static uint8_t                    app_bt_adv_bas_num_scan_rsp;
+
+/* Battery Service UUID and level, the level is rewritten in place */
+static uint8_t app_bt_adv_bas_data[APP_BT_ADV_BAS_DATA_LEN];
+
+/* Written by the BAS task, read by others with the scheduler suspended */
+static app_bt_adv_bas_stats_t app_bt_adv_bas_stats;
+static bool                   app_bt_adv_bas_ready;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_adv_bas_size
+ *
+ * Function Description:
+ * @brief  Bytes the elements take on air
+ *
+ * @param p_elems   Elements
+ * @param num_elem  Number of elements
+ *
+ * @return uint32_t  Data lengths plus the length and type byte of each
+ */
+static uint32_t app_bt_adv_bas_size(const wiced_bt_ble_advert_elem_t *p_elems, uint8_t num_elem)
+{
+    uint32_t size = 0;
+    uint8_t  i;
+
+    for (i = 0; i < num_elem; i++)
+    {
+        size += p_elems[i].len + APP_BT_ADV_BAS_ELEM_OVERHEAD;
+    }
+    return size;
+}
+
+/**
+ * Function Name:
+ * app_bt_adv_bas_scan_rsp_add
+ *
+ * Function Description:
+ * @brief  Appends an element to the scan response data if it fits
+ *
+ * @param p_elem  Element
+ *
+ * @return bool  true if added, false if the scan response is full
+ */
+static bool app_bt_adv_bas_scan_rsp_add(const wiced_bt_ble_advert_elem_t *p_elem)
+{
+    if ((APP_BT_ADV_BAS_MAX_ELEMS <= app_bt_adv_bas_num_scan_rsp) ||
+        (APP_BT_ADV_BAS_PAYLOAD_MAX < app_bt_adv_bas_size(app_bt_adv_bas_scan_rsp,
+                                                          app_bt_adv_bas_num_scan_rsp) +
+                                      p_elem->len + APP_BT_ADV_BAS_ELEM_OVERHEAD))
+    {
+        return false;
+    }
+    app_bt_adv_bas_scan_rsp[app_bt_adv_bas_num_scan_rsp++] = *p_elem;
+    return true;
+}
+
+/**
+ * Function Name:
+ * app_bt_adv_bas_init
+ *
+ * Function Description:
+ * @brief  Sets the advertising data: the configured elements followed by
+ *         the Battery Service data carrying the level. Where the result
+ *         exceeds the legacy limit, room is made from the end of the
+ *         configured elements. A complete name is shortened if that is
+ *         enough, other elements move whole to the scan response, which
+ *         active scanners still receive. The Flags and the service data
+ *         always stay.
+ *
+ * @param p_elems   Configured advertising data, cy_bt_adv_packet_data
+ * @param num_elem  Number of elements, CY_BT_ADV_PACKET_DATA_SIZE
+ * @param level     Battery level to start with, in percent
+ *
+ * @return wiced_result_t  Result of setting the data in the stack
+ */
+wiced_result_t app_bt_adv_bas_init(const wiced_bt_ble_advert_elem_t *p_elems,
+                                   uint8_t num_elem, uint8_t level)
+{
+    wiced_bt_ble_advert_elem_t *p_elem;
+    wiced_result_t              result;
+    uint32_t                    excess;
+    uint8_t                     i;
+
+    memset(&app_bt_adv_bas_stats, 0, sizeof(app_bt_adv_bas_stats));
+    app_bt_adv_bas_ready = false;
+    app_bt_adv_bas_num_adv = 0;
+    app_bt_adv_bas_num_scan_rsp = 0;
+
+    for (i = 0; i < num_elem; i++)
+    {
+        if ((APP_BT_ADV_BAS_MAX_ELEMS - 1u) <= app_bt_adv_bas_num_adv)
+        {
+            app_bt_adv_bas_stats.dropped++;
+            continue;
+        }
+        app_bt_adv_bas_adv[app_bt_adv_bas_num_adv++] = p_elems[i];
+    }
+
+    app_bt_adv_bas_data[0] = (uint8_t)(UUID_SERVICE_BATTERY & 0xFFu);
+    app_bt_adv_bas_data[1] = (uint8_t)(UUID_SERVICE_BATTERY >> 8);
+    app_bt_adv_bas_data[APP_BT_ADV_BAS_LEVEL_OFFSET] = level;
+    p_elem = &app_bt_adv_bas_adv[app_bt_adv_bas_num_adv++];
+    p_elem->advert_type = BTM_BLE_ADVERT_TYPE_SERVICE_DATA;
+    p_elem->len = APP_BT_ADV_BAS_DATA_LEN;
+    p_elem->p_data = app_bt_adv_bas_data;
+
+    /* The service data is last, make room in front of it */
+    i = app_bt_adv_bas_num_adv - 1u;
+    while ((0 < i) && (APP_BT_ADV_BAS_PAYLOAD_MAX < app_bt_adv_bas_size(app_bt_adv_bas_adv,
+                                                                         app_bt_adv_bas_num_adv)))
+    {
+        p_elem = &app_bt_adv_bas_adv[--i];
+        if (BTM_BLE_ADVERT_TYPE_FLAG == p_elem->advert_type)
+        {
+            continue;
+        }
+        excess = app_bt_adv_bas_size(app_bt_adv_bas_adv, app_bt_adv_bas_num_adv) -
+                 APP_BT_ADV_BAS_PAYLOAD_MAX;
+        if ((BTM_BLE_ADVERT_TYPE_NAME_COMPLETE == p_elem->advert_type) &&
+            (p_elem->len >= excess + APP_BT_ADV_BAS_NAME_MIN))
+        {
+            /* Scanners that ask still get the complete name */
+            (void)app_bt_adv_bas_scan_rsp_add(p_elem);
+            p_elem->advert_type = BTM_BLE_ADVERT_TYPE_NAME_SHORT;
+            p_elem->len = (uint16_t)(p_elem->len - excess);
+            app_bt_adv_bas_stats.shortened = true;
+            continue;
+        }
+        if (app_bt_adv_bas_scan_rsp_add(p_elem))
+        {
+            app_bt_adv_bas_stats.moved++;
+        }
+        else
+        {
+            app_bt_adv_bas_stats.dropped++;
+        }
+        memmove(p_elem, p_elem + 1, (app_bt_adv_bas_num_adv - i - 1u) * sizeof(*p_elem));
+        app_bt_adv_bas_num_adv--;
+    }
+
+    app_bt_adv_bas_stats.adv_len = (uint8_t)app_bt_adv_bas_size(app_bt_adv_bas_adv,
+                                                                app_bt_adv_bas_num_adv);
+    app_bt_adv_bas_stats.scan_rsp_len = (uint8_t)app_bt_adv_bas_size(app_bt_adv_bas_scan_rsp,
+                                                                     app_bt_adv_bas_num_scan_rsp);
+    app_bt_adv_bas_stats.level = level;
+    if (0 != app_bt_adv_bas_stats.dropped)
+    {
+        printf("Adv BAS: %u advertising data elements left out\r\n",
+               app_bt_adv_bas_stats.dropped);
+    }
+
+    result = wiced_bt_ble_set_raw_advertisement_data(app_bt_adv_bas_num_adv, app_bt_adv_bas_adv);
+    if ((WICED_BT_SUCCESS == result) && (0 != app_bt_adv_bas_num_scan_rsp))
+    {
+        result = wiced_bt_ble_set_raw_scan_response_data(app_bt_adv_bas_num_scan_rsp,
+                                                         app_bt_adv_bas_scan_rsp);
+    }
+    if (WICED_BT_SUCCESS != result)
+    {
+        printf("Adv BAS: advertising data not set, error %d\r\n", result);
+        return result;
+    }
+    app_bt_adv_bas_ready = true;
+    return result;
+}
+
+/**
+ * Function Name:
+ * app_bt_adv_bas_update
+ *
+ * Function Description:
+ * @brief  Advertises a new battery level. Only the level byte changes; the
+ *         stack passes the data to the controller, which uses it from the
+ *         next advertising event on, without advertising being stopped. An
+ *         unchanged level costs nothing.
+ *
+ * @param level  Battery level in percent
+ *
+ * @return void
+ */
+void app_bt_adv_bas_update(uint8_t level)
+{
+    wiced_result_t result;
+
+    if (!app_bt_adv_bas_ready)
+    {
+        return;
+    }
+    if (level == app_bt_adv_bas_stats.level)
+    {
+        app_bt_adv_bas_stats.unchanged++;
+        return;
+    }
+
+    app_bt_adv_bas_data[APP_BT_ADV_BAS_LEVEL_OFFSET] = level;
+    result = wiced_bt_ble_set_raw_advertisement_data(app_bt_adv_bas_num_adv, app_bt_adv_bas_adv);
+
+    vTaskSuspendAll();
+    if (WICED_BT_SUCCESS == result)
+    {
+        /* A failed level is retried at the next update */
+        app_bt_adv_bas_stats.level = level;
+        app_bt_adv_bas_stats.updates++;
+    }
+    else
+    {
+        app_bt_adv_bas_stats.failed++;
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_adv_bas_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the payload layout and update counters
+ *
+ * @param p_stats  Destination
+ *
+ * @return void
+ */
+void app_bt_adv_bas_get_stats(app_bt_adv_bas_stats_t *p_stats)
+{
+    vTaskSuspendAll();
+    *p_stats = app_bt_adv_bas_stats;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_adv_bas_print
+ *
+ * Function Description:
+ * @brief  Prints the advertised level, the update counters and the payload
+ *         layout
+ *
+ * @return void
+ */
+void app_bt_adv_bas_print(void)
+{
+    app_bt_adv_bas_stats_t stats;
+
+    app_bt_adv_bas_get_stats(&stats);
+    printf("Adv BAS: level %u, %lu updates, %lu unchanged, %lu failed\r\n",
+           stats.level, (unsigned long)stats.updates, (unsigned long)stats.unchanged,
+           (unsigned long)stats.failed);
+    printf("  advertising data %u bytes, scan response %u bytes, %u moved, %u left out%s\r\n",
+           stats.adv_len, stats.scan_rsp_len, stats.moved, stats.dropped,
+           stats.shortened ? ", name shortened" : "");
+}
+
+
+/* [] END OF FILE */
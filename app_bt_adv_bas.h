@@ -0,0 +1,115 @@
+/******************************************************************************
+* File Name:   app_bt_adv_bas.h
+*
+* Description: This file contains the declarations of the battery level carried
+*                           as Battery Service data in the advertising payload
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_ADV_BAS_H__
+#define __APP_BT_ADV_BAS_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_ble.h"
+#include "wiced_bt_dev.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Advertising and scan response data limit of legacy advertising PDUs
+ */
+#define APP_BT_ADV_BAS_PAYLOAD_MAX          (31u)
+
+/**
+ * @brief Most elements of the configured advertising data, plus one for the
+ *        Battery Service data
+ */
+#ifndef APP_BT_ADV_BAS_MAX_ELEMS
+#define APP_BT_ADV_BAS_MAX_ELEMS            (8u)
+#endif
+
+/**
+ * @brief Shortest name left in the advertising data when a complete name has
+ *        to be shortened to make room. The complete name then moves to the
+ *        scan response.
+ */
+#ifndef APP_BT_ADV_BAS_NAME_MIN
+#define APP_BT_ADV_BAS_NAME_MIN             (4u)
+#endif
+
+/**
+ * @brief Service data element: the Battery Service UUID, little endian,
+ *        followed by the Battery Level in percent
+ */
+#define APP_BT_ADV_BAS_DATA_LEN             (3u)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Payload layout and update counters since app_bt_adv_bas_init()
+ */
+typedef struct
+{
+    uint32_t updates;                           /* Advertising data rewritten */
+    uint32_t unchanged;                         /* Updates skipped, level unchanged */
+    uint32_t failed;                            /* Rewrites the stack refused */
+    uint8_t  level;                             /* Level currently advertised */
+    uint8_t  adv_len;                           /* Advertising data, bytes */
+    uint8_t  scan_rsp_len;                      /* Scan response data, bytes */
+    uint8_t  moved;                             /* Elements moved to the scan response */
+    uint8_t  dropped;                           /* Elements left out, no room in either */
+    bool     shortened;                         /* Name shortened in the advertising data */
+} app_bt_adv_bas_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_result_t app_bt_adv_bas_init      (const wiced_bt_ble_advert_elem_t *p_elems,
+                                         uint8_t num_elem, uint8_t level);
+void           app_bt_adv_bas_update    (uint8_t level);
+void           app_bt_adv_bas_get_stats (app_bt_adv_bas_stats_t *p_stats);
+void           app_bt_adv_bas_print     (void);
+
+#endif      /*__APP_BT_ADV_BAS_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,393 @@
+/******************************************************************************
+* File Name:   app_bt_att_latency.c
+*
+* Description: This file implements per ATT opcode log2 histograms of the
+*                           time app_bt_server_event_handler() takes per request
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_att_latency.h"
+#include "cybsp.h"
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Histogram of one opcode class
+ */
+typedef struct
+{
+    uint32_t count;
+    uint32_t max_cycles;
+    uint32_t buckets[APP_BT_ATT_LAT_BUCKETS];
+} app_bt_att_lat_hist_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* Only touched from the BT stack task: the GATT handler records, and the
+ * diagnostics read and write hooks run from the same handler */
+static app_bt_att_lat_hist_t app_bt_att_lat_hist[APP_BT_ATT_LAT_NUM_CLASSES];
+
+static const char *const app_bt_att_lat_class_names[APP_BT_ATT_LAT_NUM_CLASSES] =
+{
+    "read", "read by type", "read multi", "write", "prep write", "exec write", "mtu", "other"
+};
+
+/* Characteristic value, built on each read */
+static uint8_t app_bt_att_lat_value[APP_BT_ATT_LAT_HEADER_LEN +
+                                    (APP_BT_ATT_LAT_NUM_CLASSES * APP_BT_ATT_LAT_RECORD_LEN)];
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_att_latency_class
+ *
+ * Function Description:
+ * @brief  Maps an ATT opcode to its histogram
+ *
+ * @param opcode    ATT opcode
+ *
+ * @return app_bt_att_lat_class_t  Opcode class
+ */
+static app_bt_att_lat_class_t app_bt_att_latency_class(wiced_bt_gatt_opcode_t opcode)
+{
+    switch (opcode)
+    {
+    case GATT_REQ_READ:
+    case GATT_REQ_READ_BLOB:
+        return APP_BT_ATT_LAT_READ;
+
+    case GATT_REQ_READ_BY_TYPE:
+        return APP_BT_ATT_LAT_READ_BY_TYPE;
+
+    case GATT_REQ_READ_MULTI:
+    case GATT_REQ_READ_MULTI_VAR_LENGTH:
+        return APP_BT_ATT_LAT_READ_MULTI;
+
+    case GATT_REQ_WRITE:
+    case GATT_CMD_WRITE:
+    case GATT_CMD_SIGNED_WRITE:
+        return APP_BT_ATT_LAT_WRITE;
+
+    case GATT_REQ_PREPARE_WRITE:
+        return APP_BT_ATT_LAT_PREPARE_WRITE;
+
+    case GATT_REQ_EXECUTE_WRITE:
+        return APP_BT_ATT_LAT_EXECUTE_WRITE;
+
+    case GATT_REQ_MTU:
+        return APP_BT_ATT_LAT_MTU;
+
+    default:
+        return APP_BT_ATT_LAT_OTHER;
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_record
+ *
+ * Function Description:
+ * @brief  Adds one handler run to the histogram of its opcode. Two cycle
+ *         counter reads, a CLZ and three stores.
+ *
+ * @param opcode    ATT opcode handled
+ * @param start     app_bt_att_latency_start() taken before the handler
+ *
+ * @return void
+ */
+void app_bt_att_latency_record(wiced_bt_gatt_opcode_t opcode, uint32_t start)
+{
+    app_bt_att_lat_hist_t *p_hist = &app_bt_att_lat_hist[app_bt_att_latency_class(opcode)];
+    uint32_t               cycles = app_bt_cpu_stats_get_counter() - start;
+    uint32_t               bucket;
+
+    /* floor(log2(cycles)) is 31 - CLZ, cycles | 1 keeps CLZ below 32 */
+    bucket = 31u - __CLZ(cycles | 1u);
+    bucket = (bucket > APP_BT_ATT_LAT_FIRST_SHIFT) ? (bucket - APP_BT_ATT_LAT_FIRST_SHIFT) : 0u;
+    bucket = (bucket < APP_BT_ATT_LAT_BUCKETS) ? bucket : (APP_BT_ATT_LAT_BUCKETS - 1u);
+
+    p_hist->count++;
+    p_hist->buckets[bucket]++;
+    if (cycles > p_hist->max_cycles)
+    {
+        p_hist->max_cycles = cycles;
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_reset
+ *
+ * Function Description:
+ * @brief  Clears all histograms
+ *
+ * @return void
+ */
+void app_bt_att_latency_reset(void)
+{
+    memset(app_bt_att_lat_hist, 0, sizeof(app_bt_att_lat_hist));
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_percentile
+ *
+ * Function Description:
+ * @brief  Upper bound, in microseconds, of the bucket holding a percentile
+ *
+ * @param p_hist    Histogram
+ * @param percent   Percentile, 1 to 100
+ *
+ * @return uint32_t Microseconds, the longest run for the last bucket
+ */
+static uint32_t app_bt_att_latency_percentile(const app_bt_att_lat_hist_t *p_hist,
+                                              uint32_t percent)
+{
+    uint64_t rank = (((uint64_t)p_hist->count * percent) + 99u) / 100u;
+    uint64_t seen = 0;
+    uint32_t cycles_per_us = (SystemCoreClock / 1000000u) + 1u;
+    uint32_t i;
+
+    for (i = 0; i < (APP_BT_ATT_LAT_BUCKETS - 1u); i++)
+    {
+        seen += p_hist->buckets[i];
+        if (seen >= rank)
+        {
+            return (uint32_t)((1ull << (APP_BT_ATT_LAT_FIRST_SHIFT + i + 1u)) / cycles_per_us);
+        }
+    }
+    return p_hist->max_cycles / cycles_per_us;
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_print
+ *
+ * Function Description:
+ * @brief  Prints the request count, p50, p99 and longest handler of every
+ *         opcode class seen. Percentiles are bucket upper bounds.
+ *
+ * @return void
+ */
+void app_bt_att_latency_print(void)
+{
+    const app_bt_att_lat_hist_t *p_hist;
+    uint32_t                     cycles_per_us = (SystemCoreClock / 1000000u) + 1u;
+    uint32_t                     i;
+
+    printf("ATT handler latency, us:\r\n");
+    printf("  %-12s %8s %8s %8s %8s\r\n", "opcode", "count", "p50 <", "p99 <", "max");
+    for (i = 0; i < APP_BT_ATT_LAT_NUM_CLASSES; i++)
+    {
+        p_hist = &app_bt_att_lat_hist[i];
+        if (0 == p_hist->count)
+        {
+            continue;
+        }
+        printf("  %-12s %8lu %8lu %8lu %8lu\r\n", app_bt_att_lat_class_names[i],
+               (unsigned long)p_hist->count,
+               (unsigned long)app_bt_att_latency_percentile(p_hist, 50u),
+               (unsigned long)app_bt_att_latency_percentile(p_hist, 99u),
+               (unsigned long)(p_hist->max_cycles / cycles_per_us));
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_put_u32
+ *
+ * Function Description:
+ * @brief  Stores a little endian uint32
+ *
+ * @param p_buf     Destination
+ * @param value     Value
+ *
+ * @return void
+ */
+static void app_bt_att_latency_put_u32(uint8_t *p_buf, uint32_t value)
+{
+    p_buf[0] = (uint8_t)(value & 0xFF);
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+    p_buf[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_serialize
+ *
+ * Function Description:
+ * @brief  Builds the binary snapshot described at APP_BT_ATT_LAT_VERSION
+ *
+ * @param p_buf     Destination
+ * @param size      Size of p_buf, classes that do not fit are left out
+ *
+ * @return uint16_t Bytes written
+ */
+uint16_t app_bt_att_latency_serialize(uint8_t *p_buf, uint16_t size)
+{
+    const app_bt_att_lat_hist_t *p_hist;
+    uint16_t                     len = APP_BT_ATT_LAT_HEADER_LEN;
+    uint16_t                     bucket;
+    uint8_t                      count = 0;
+    uint8_t                      i;
+    uint8_t                      j;
+
+    if (size < APP_BT_ATT_LAT_HEADER_LEN)
+    {
+        return 0;
+    }
+
+    for (i = 0; (i < APP_BT_ATT_LAT_NUM_CLASSES) &&
+                ((len + APP_BT_ATT_LAT_RECORD_LEN) <= size); i++)
+    {
+        p_hist = &app_bt_att_lat_hist[i];
+
+        app_bt_att_latency_put_u32(&p_buf[len], p_hist->count);
+        app_bt_att_latency_put_u32(&p_buf[len + 4u], p_hist->max_cycles);
+        len += 8u;
+        for (j = 0; j < APP_BT_ATT_LAT_BUCKETS; j++)
+        {
+            bucket = (p_hist->buckets[j] > UINT16_MAX) ? UINT16_MAX : (uint16_t)p_hist->buckets[j];
+            p_buf[len++] = (uint8_t)(bucket & 0xFF);
+            p_buf[len++] = (uint8_t)(bucket >> 8);
+        }
+        count++;
+    }
+
+    p_buf[0] = APP_BT_ATT_LAT_VERSION;
+    p_buf[1] = count;
+    p_buf[2] = APP_BT_ATT_LAT_BUCKETS;
+    p_buf[3] = APP_BT_ATT_LAT_FIRST_SHIFT;
+    app_bt_att_latency_put_u32(&p_buf[4], SystemCoreClock);
+
+    return len;
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the ATT Latency diagnostics characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the snapshot
+ * @param p_len     Returns its length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_att_latency_on_read(uint16_t conn_id, uint16_t handle,
+                                                  uint8_t **pp_val, uint16_t *p_len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    *p_len  = app_bt_att_latency_serialize(app_bt_att_lat_value, sizeof(app_bt_att_lat_value));
+    *pp_val = app_bt_att_lat_value;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the ATT Latency characteristic. Writing a single 0
+ *         clears the histograms, anything else is refused.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_att_latency_validate(uint16_t conn_id, uint16_t handle,
+                                                   uint8_t *p_val, uint16_t len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    if (1 != len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    return (0 == p_val[0]) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_VALUE_NOT_ALLOWED;
+}
+
+/**
+ * Function Name:
+ * app_bt_att_latency_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the ATT Latency characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_att_latency_on_write(uint16_t conn_id,
+                                                   wiced_bt_gatt_event_data_t *p_data,
+                                                   uint16_t handle, uint8_t *p_val,
+                                                   uint16_t len)
+{
+    (void)conn_id;
+    (void)p_data;
+    (void)handle;
+    (void)p_val;
+    (void)len;
+
+    app_bt_att_latency_reset();
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,133 @@
+/******************************************************************************
+* File Name:   app_bt_att_latency.h
+*
+* Description: This file contains the declarations of the ATT request latency
+*                           histograms
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_ATT_LATENCY_H__
+#define __APP_BT_ATT_LATENCY_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+#include "app_bt_cpu_stats.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Buckets per histogram. Bucket i counts handlers that took
+ *        [2^(SHIFT + i), 2^(SHIFT + i + 1)) core cycles, the first and last
+ *        buckets are open ended.
+ */
+#define APP_BT_ATT_LAT_BUCKETS              (16u)
+
+/**
+ * @brief log2 of the lower bound of bucket 1, in core cycles
+ */
+#ifndef APP_BT_ATT_LAT_FIRST_SHIFT
+#define APP_BT_ATT_LAT_FIRST_SHIFT          (8u)
+#endif
+
+/**
+ * @brief Characteristic snapshot: a header of version, class count, bucket
+ *        count, first shift and the core clock in Hz (uint32), then one
+ *        record per opcode class of request count (uint32), longest handler
+ *        in cycles (uint32) and the bucket counts (uint16, saturating).
+ *        Little endian.
+ */
+#define APP_BT_ATT_LAT_VERSION              (1u)
+#define APP_BT_ATT_LAT_HEADER_LEN           (8u)
+#define APP_BT_ATT_LAT_RECORD_LEN           (8u + (2u * APP_BT_ATT_LAT_BUCKETS))
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Opcode classes with a histogram each, in snapshot order
+ */
+typedef enum
+{
+    APP_BT_ATT_LAT_READ,                    /* Read, Read Blob */
+    APP_BT_ATT_LAT_READ_BY_TYPE,
+    APP_BT_ATT_LAT_READ_MULTI,              /* Read Multiple, Read Multiple Variable */
+    APP_BT_ATT_LAT_WRITE,                   /* Write Request, Write and Signed Write Command */
+    APP_BT_ATT_LAT_PREPARE_WRITE,
+    APP_BT_ATT_LAT_EXECUTE_WRITE,
+    APP_BT_ATT_LAT_MTU,
+    APP_BT_ATT_LAT_OTHER,
+    APP_BT_ATT_LAT_NUM_CLASSES
+} app_bt_att_lat_class_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void                   app_bt_att_latency_record    (wiced_bt_gatt_opcode_t opcode,
+                                                     uint32_t start);
+void                   app_bt_att_latency_reset     (void);
+void                   app_bt_att_latency_print     (void);
+uint16_t               app_bt_att_latency_serialize (uint8_t *p_buf, uint16_t size);
+wiced_bt_gatt_status_t app_bt_att_latency_on_read   (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t **pp_val, uint16_t *p_len);
+wiced_bt_gatt_status_t app_bt_att_latency_validate  (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_att_latency_on_write  (uint16_t conn_id,
+                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                     uint16_t handle, uint8_t *p_val,
+                                                     uint16_t len);
+
+/**
+ * Function Name:
+ * app_bt_att_latency_start
+ *
+ * Function Description:
+ * @brief  Start time of a handler, passed to app_bt_att_latency_record()
+ *
+ * @return uint32_t Core cycle count
+ */
+static inline uint32_t app_bt_att_latency_start(void)
+{
+    return app_bt_cpu_stats_get_counter();
+}
+
+#endif      /*__APP_BT_ATT_LATENCY_H__ */
+
+
+/* [] END OF FILE */
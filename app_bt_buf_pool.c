@@ -0,0 +1,376 @@
+/******************************************************************************
+* File Name:   app_bt_buf_pool.c
+*
+* Description: This file implements a lock-free fixed block pool for the GATT
+*                           response buffers, with a malloc fallback
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_buf_pool.h"
+#include "app_bt_trace.h"
+#include "app_bt_heap.h"
+#include <stdatomic.h>
+#include <string.h>
+
+/******************************************************************************
+ *                                Macros
+ ******************************************************************************/
+/* The free list head packs a modification tag above the index so that a
+ * block freed and reallocated between the load and the swap (ABA) makes the
+ * compare-and-swap fail */
+#define APP_BT_BUF_POOL_IDX_MASK            (0x0000FFFFu)
+#define APP_BT_BUF_POOL_TAG_INC             (0x00010000u)
+#define APP_BT_BUF_POOL_ALIGN(x)            (((x) + 3u) & ~3u)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief One block class. Free blocks are linked through p_next by index + 1,
+ *        0 ending the list.
+ */
+typedef struct
+{
+    uint8_t          *p_arena;
+    atomic_ushort    *p_next;
+    uint16_t          block_size;
+    uint16_t          num_blocks;
+    atomic_uint       head;
+    atomic_uint       in_use;
+    atomic_uint       peak;
+    atomic_uint       allocs;
+} app_bt_buf_pool_cls_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static uint32_t app_bt_buf_pool_small_arena[(APP_BT_BUF_POOL_ALIGN(APP_BT_BUF_POOL_SMALL_SIZE) *
+                                             APP_BT_BUF_POOL_SMALL_BLOCKS) / sizeof(uint32_t)];
+static atomic_ushort app_bt_buf_pool_small_next[APP_BT_BUF_POOL_SMALL_BLOCKS];
+static atomic_ushort app_bt_buf_pool_large_next[APP_BT_BUF_POOL_LARGE_BLOCKS];
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+static uint32_t app_bt_buf_pool_large_arena[(APP_BT_BUF_POOL_ALIGN(APP_BT_BUF_POOL_LARGE_SIZE) *
+                                             APP_BT_BUF_POOL_LARGE_BLOCKS) / sizeof(uint32_t)];
+#endif
+
+static app_bt_buf_pool_cls_t app_bt_buf_pool_classes[APP_BT_BUF_POOL_NUM_CLASSES];
+
+static atomic_uint app_bt_buf_pool_fallback_allocs;
+static atomic_uint app_bt_buf_pool_fallback_frees;
+static atomic_uint app_bt_buf_pool_failures;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_buf_pool_class_init
+ *
+ * Function Description:
+ * @brief  Links all blocks of a class into its free list
+ *
+ * @param p_cls         Block class
+ * @param p_arena       Block storage, NULL leaves the class empty
+ * @param p_next        Link storage of num_blocks entries
+ * @param block_size    Size of each block, a multiple of 4
+ * @param num_blocks    Number of blocks
+ *
+ * @return void
+ */
+static void app_bt_buf_pool_class_init(app_bt_buf_pool_cls_t *p_cls, uint8_t *p_arena,
+                                       atomic_ushort *p_next, uint16_t block_size, uint16_t num_blocks)
+{
+    uint16_t i;
+
+    p_cls->p_arena    = p_arena;
+    p_cls->p_next     = p_next;
+    p_cls->block_size = block_size;
+    p_cls->num_blocks = (NULL != p_arena) ? num_blocks : 0;
+
+    for (i = 0; i < p_cls->num_blocks; i++)
+    {
+        atomic_init(&p_next[i], (uint16_t)((i + 1u < p_cls->num_blocks) ? (i + 2u) : 0u));
+    }
+    atomic_init(&p_cls->head, (0 != p_cls->num_blocks) ? 1u : 0u);
+    atomic_init(&p_cls->in_use, 0u);
+    atomic_init(&p_cls->peak, 0u);
+    atomic_init(&p_cls->allocs, 0u);
+}
+
+/**
+ * Function Name:
+ * app_bt_buf_pool_pop
+ *
+ * Function Description:
+ * @brief  Takes a block off the free list of a class
+ *
+ * @param p_cls     Block class
+ *
+ * @return uint8_t* Block, NULL if the class is exhausted
+ */
+static uint8_t *app_bt_buf_pool_pop(app_bt_buf_pool_cls_t *p_cls)
+{
+    unsigned int head = atomic_load_explicit(&p_cls->head, memory_order_acquire);
+    unsigned int new_head;
+    unsigned int in_use;
+    unsigned int peak;
+    uint16_t     idx;
+
+    do
+    {
+        idx = (uint16_t)(head & APP_BT_BUF_POOL_IDX_MASK);
+        if (0 == idx)
+        {
+            return NULL;
+        }
+        /* A stale link is harmless, the tag makes the swap fail */
+        new_head = ((head & ~APP_BT_BUF_POOL_IDX_MASK) + APP_BT_BUF_POOL_TAG_INC) |
+                   atomic_load_explicit(&p_cls->p_next[idx - 1u], memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&p_cls->head, &head, new_head,
+                                                    memory_order_acq_rel,
+                                                    memory_order_acquire));
+
+    atomic_fetch_add_explicit(&p_cls->allocs, 1u, memory_order_relaxed);
+    in_use = atomic_fetch_add_explicit(&p_cls->in_use, 1u, memory_order_relaxed) + 1u;
+    peak   = atomic_load_explicit(&p_cls->peak, memory_order_relaxed);
+    while ((in_use > peak) &&
+           !atomic_compare_exchange_weak_explicit(&p_cls->peak, &peak, in_use,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+    }
+
+    return p_cls->p_arena + ((uint32_t)(idx - 1u) * p_cls->block_size);
+}
+
+/**
+ * Function Name:
+ * app_bt_buf_pool_push
+ *
+ * Function Description:
+ * @brief  Returns a block to the free list of a class
+ *
+ * @param p_cls     Block class
+ * @param idx       Block index
+ *
+ * @return void
+ */
+static void app_bt_buf_pool_push(app_bt_buf_pool_cls_t *p_cls, uint16_t idx)
+{
+    unsigned int head = atomic_load_explicit(&p_cls->head, memory_order_relaxed);
+    unsigned int new_head;
+
+    do
+    {
+        atomic_store_explicit(&p_cls->p_next[idx], (uint16_t)(head & APP_BT_BUF_POOL_IDX_MASK),
+                              memory_order_relaxed);
+        new_head = ((head & ~APP_BT_BUF_POOL_IDX_MASK) + APP_BT_BUF_POOL_TAG_INC) |
+                   (idx + 1u);
+    } while (!atomic_compare_exchange_weak_explicit(&p_cls->head, &head, new_head,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+
+    atomic_fetch_sub_explicit(&p_cls->in_use, 1u, memory_order_relaxed);
+}
+
+/**
+ * Function Name:
+ * app_bt_buf_pool_init
+ *
+ * Function Description:
+ * @brief  Sets up the pool. The MTU sized blocks are carved from a single
+ *         allocation made here, before the stack runs, and never returned. The
+ *         static allocation build uses a fixed arena of
+ *         APP_BT_BUF_POOL_LARGE_SIZE blocks instead.
+ *
+ * @param large_size    Size of the large blocks, normally
+ *                      wiced_bt_cfg_settings.p_ble_cfg->ble_max_rx_pdu_size
+ *
+ * @return wiced_bool_t WICED_FALSE if the large blocks could not be allocated,
+ *                      or are smaller than large_size in the static build
+ */
+wiced_bool_t app_bt_buf_pool_init(uint16_t large_size)
+{
+    uint8_t     *p_large;
+    wiced_bool_t result;
+
+    large_size = (uint16_t)APP_BT_BUF_POOL_ALIGN(large_size);
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+    result     = (large_size <= APP_BT_BUF_POOL_ALIGN(APP_BT_BUF_POOL_LARGE_SIZE)) ?
+                 WICED_TRUE : WICED_FALSE;
+    large_size = (uint16_t)APP_BT_BUF_POOL_ALIGN(APP_BT_BUF_POOL_LARGE_SIZE);
+    p_large    = (uint8_t *)app_bt_buf_pool_large_arena;
+#else
+    p_large    = (uint8_t *)app_bt_heap_alloc(APP_BT_HEAP_TAG_GATT_RSP,
+                                              (size_t)large_size * APP_BT_BUF_POOL_LARGE_BLOCKS);
+    result     = (NULL != p_large) ? WICED_TRUE : WICED_FALSE;
+#endif
+
+    app_bt_buf_pool_class_init(&app_bt_buf_pool_classes[APP_BT_BUF_POOL_SMALL],
+                               (uint8_t *)app_bt_buf_pool_small_arena,
+                               app_bt_buf_pool_small_next,
+                               (uint16_t)APP_BT_BUF_POOL_ALIGN(APP_BT_BUF_POOL_SMALL_SIZE),
+                               APP_BT_BUF_POOL_SMALL_BLOCKS);
+    app_bt_buf_pool_class_init(&app_bt_buf_pool_classes[APP_BT_BUF_POOL_LARGE], p_large,
+                               app_bt_buf_pool_large_next, large_size,
+                               APP_BT_BUF_POOL_LARGE_BLOCKS);
+
+    atomic_init(&app_bt_buf_pool_fallback_allocs, 0u);
+    atomic_init(&app_bt_buf_pool_fallback_frees, 0u);
+    atomic_init(&app_bt_buf_pool_failures, 0u);
+
+    return result;
+}
+
+/**
+ * Function Name:
+ * app_bt_buf_pool_alloc
+ *
+ * Function Description:
+ * @brief  Allocates a buffer from the smallest class that fits and has a free
+ *         block, falling back to the heap unless APP_BT_BUF_POOL_FALLBACK is
+ *         0. Safe from any task.
+ *
+ * @param len            Length of the buffer
+ *
+ * @return uint8_t*      pointer to allocated buffer, NULL if none is left
+ */
+uint8_t *app_bt_buf_pool_alloc(uint16_t len)
+{
+    uint8_t *p = NULL;
+    uint8_t  i;
+
+    for (i = 0; (NULL == p) && (i < APP_BT_BUF_POOL_NUM_CLASSES); i++)
+    {
+        if (len <= app_bt_buf_pool_classes[i].block_size)
+        {
+            p = app_bt_buf_pool_pop(&app_bt_buf_pool_classes[i]);
+            if (NULL != p)
+            {
+                APP_BT_TRACE(APP_BT_TRACE_EVT_ALLOC, i, len, p);
+            }
+        }
+    }
+
+    if (NULL == p)
+    {
+#if APP_BT_BUF_POOL_FALLBACK
+        p = (uint8_t *)app_bt_heap_alloc(APP_BT_HEAP_TAG_GATT_RSP, len);
+#endif
+        atomic_fetch_add_explicit((NULL != p) ? &app_bt_buf_pool_fallback_allocs :
+                                                &app_bt_buf_pool_failures,
+                                  1u, memory_order_relaxed);
+        APP_BT_TRACE((NULL != p) ? APP_BT_TRACE_EVT_ALLOC_FALLBACK : APP_BT_TRACE_EVT_ALLOC_FAIL,
+                     0, len, p);
+    }
+    return p;
+}
+
+/**
+ * Function Name:
+ * app_bt_buf_pool_free
+ *
+ * Function Description:
+ * @brief  Frees a buffer from app_bt_buf_pool_alloc. Matches pfn_free_buffer_t
+ *         so it can be handed to the stack with the buffer.
+ *
+ * @param p_buf         pointer to the buffer to be freed
+ *
+ * @return void
+ */
+void app_bt_buf_pool_free(uint8_t *p_buf)
+{
+    app_bt_buf_pool_cls_t *p_cls;
+    uint8_t                   i;
+
+    if (NULL == p_buf)
+    {
+        return;
+    }
+
+    for (i = 0; i < APP_BT_BUF_POOL_NUM_CLASSES; i++)
+    {
+        p_cls = &app_bt_buf_pool_classes[i];
+        if ((0 != p_cls->num_blocks) && (p_buf >= p_cls->p_arena) &&
+            (p_buf < p_cls->p_arena + ((uint32_t)p_cls->num_blocks * p_cls->block_size)))
+        {
+            app_bt_buf_pool_push(p_cls,
+                                 (uint16_t)((uint32_t)(p_buf - p_cls->p_arena) / p_cls->block_size));
+            APP_BT_TRACE(APP_BT_TRACE_EVT_FREE, i, 0, p_buf);
+            return;
+        }
+    }
+
+    app_bt_heap_free(p_buf);
+    atomic_fetch_add_explicit(&app_bt_buf_pool_fallback_frees, 1u, memory_order_relaxed);
+    APP_BT_TRACE(APP_BT_TRACE_EVT_FREE_FALLBACK, 0, 0, p_buf);
+}
+
+/**
+ * Function Name:
+ * app_bt_buf_pool_get_stats
+ *
+ * Function Description:
+ * @brief  Snapshot of the pool counters
+ *
+ * @param p_stats   Filled with the counters
+ *
+ * @return void
+ */
+void app_bt_buf_pool_get_stats(app_bt_buf_pool_stats_t *p_stats)
+{
+    const app_bt_buf_pool_cls_t *p_cls;
+    uint8_t                         i;
+
+    for (i = 0; i < APP_BT_BUF_POOL_NUM_CLASSES; i++)
+    {
+        p_cls = &app_bt_buf_pool_classes[i];
+        p_stats->cls[i].block_size = p_cls->block_size;
+        p_stats->cls[i].num_blocks = p_cls->num_blocks;
+        p_stats->cls[i].in_use     = (uint16_t)atomic_load_explicit(&p_cls->in_use, memory_order_relaxed);
+        p_stats->cls[i].peak       = (uint16_t)atomic_load_explicit(&p_cls->peak, memory_order_relaxed);
+        p_stats->cls[i].allocs     = atomic_load_explicit(&p_cls->allocs, memory_order_relaxed);
+    }
+    p_stats->fallback_allocs = atomic_load_explicit(&app_bt_buf_pool_fallback_allocs, memory_order_relaxed);
+    p_stats->fallback_frees  = atomic_load_explicit(&app_bt_buf_pool_fallback_frees, memory_order_relaxed);
+    p_stats->failures        = atomic_load_explicit(&app_bt_buf_pool_failures, memory_order_relaxed);
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,144 @@
+/******************************************************************************
+* File Name:   app_bt_buf_pool.h
+*
+* Description: This file contains the declarations of the fixed block pool that
+*                           backs the GATT response buffers
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_BUF_POOL_H__
+#define __APP_BT_BUF_POOL_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_conn.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Size of the small blocks, enough for short reads and error sized
+ *        responses
+ */
+#ifndef APP_BT_BUF_POOL_SMALL_SIZE
+#define APP_BT_BUF_POOL_SMALL_SIZE          (32u)
+#endif
+
+/**
+ * @brief Number of small blocks
+ */
+#ifndef APP_BT_BUF_POOL_SMALL_BLOCKS
+#define APP_BT_BUF_POOL_SMALL_BLOCKS        (8u)
+#endif
+
+/**
+ * @brief Size of the MTU sized blocks in the static allocation build, where
+ *        they cannot follow ble_max_rx_pdu_size at run time. 517 is the
+ *        largest ATT MTU.
+ */
+#ifndef APP_BT_BUF_POOL_LARGE_SIZE
+#define APP_BT_BUF_POOL_LARGE_SIZE          (517u)
+#endif
+
+/**
+ * @brief Number of MTU sized blocks. Every connection may hold a response in
+ *        flight while the next one is built.
+ */
+#ifndef APP_BT_BUF_POOL_LARGE_BLOCKS
+#define APP_BT_BUF_POOL_LARGE_BLOCKS        (2u * APP_BT_MAX_CONNECTIONS)
+#endif
+
+/**
+ * @brief Set to 0 to fail requests the pool cannot serve instead of using the
+ *        heap. Off by default in the static allocation build.
+ */
+#ifndef APP_BT_BUF_POOL_FALLBACK
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+#define APP_BT_BUF_POOL_FALLBACK            (0)
+#else
+#define APP_BT_BUF_POOL_FALLBACK            (1)
+#endif
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Block classes of the pool
+ */
+typedef enum
+{
+    APP_BT_BUF_POOL_SMALL,
+    APP_BT_BUF_POOL_LARGE,
+    APP_BT_BUF_POOL_NUM_CLASSES
+} app_bt_buf_pool_class_t;
+
+/**
+ * @brief Counters of one block class
+ */
+typedef struct
+{
+    uint16_t block_size;
+    uint16_t num_blocks;
+    uint16_t in_use;
+    uint16_t peak;          /* Highest in_use seen */
+    uint32_t allocs;
+} app_bt_buf_pool_class_stats_t;
+
+/**
+ * @brief Pool counters. Requests the pool cannot serve go to malloc.
+ */
+typedef struct
+{
+    app_bt_buf_pool_class_stats_t cls[APP_BT_BUF_POOL_NUM_CLASSES];
+    uint32_t fallback_allocs;
+    uint32_t fallback_frees;
+    uint32_t failures;      /* Not served by the pool nor the heap */
+} app_bt_buf_pool_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_bool_t app_bt_buf_pool_init      (uint16_t large_size);
+uint8_t     *app_bt_buf_pool_alloc     (uint16_t len);
+void         app_bt_buf_pool_free      (uint8_t *p_buf);
+void         app_bt_buf_pool_get_stats (app_bt_buf_pool_stats_t *p_stats);
+
+#endif      /*__APP_BT_BUF_POOL_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,595 @@
+/******************************************************************************
+* File Name:   app_bt_conn.c
+*
+* Description: This file implements the connection table. Every connected peer
+*              gets a slot holding its address, its ATT MTU and its own copy
+*              of each client characteristic configuration descriptor, plus
+*              per-descriptor bitmaps of the slots that enabled notifications
+*              or indications.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_conn.h"
+#include <string.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Connection slot
+ */
+typedef struct
+{
+    uint16_t                  conn_id;                  /* 0 when the slot is free */
+    uint16_t                  mtu;
+    wiced_bt_device_address_t peer_addr;
+    uint8_t                   cccd[APP_BT_CONN_MAX_CCCDS][2]; /* Little endian, as on air */
+    uint8_t                   client_features;          /* APP_BT_CONN_CLIENT_FEAT_xxx */
+} app_bt_conn_slot_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static app_bt_conn_slot_t app_bt_conn_slots[APP_BT_MAX_CONNECTIONS];
+static uint8_t            app_bt_conn_num_open;
+
+/**
+ * @brief Descriptor handles registered by the application
+ */
+static uint16_t app_bt_conn_cccd_handles[APP_BT_CONN_MAX_CCCDS];
+static uint8_t  app_bt_conn_num_cccds;
+
+/**
+ * @brief Per descriptor bitmaps of the slots subscribed to notifications
+ *        and indications
+ */
+static uint32_t app_bt_conn_notify_mask[APP_BT_CONN_MAX_CCCDS];
+static uint32_t app_bt_conn_indicate_mask[APP_BT_CONN_MAX_CCCDS];
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_conn_find_cccd
+ *
+ * Function Description:
+ * @brief  Maps a descriptor handle to its index in the per-slot storage
+ *
+ * @param handle    Descriptor handle
+ *
+ * @return uint8_t  Index, APP_BT_CONN_MAX_CCCDS if not registered
+ */
+static uint8_t app_bt_conn_find_cccd(uint16_t handle)
+{
+    uint8_t i;
+
+    for (i = 0; i < app_bt_conn_num_cccds; i++)
+    {
+        if (app_bt_conn_cccd_handles[i] == handle)
+        {
+            break;
+        }
+    }
+    return (i < app_bt_conn_num_cccds) ? i : APP_BT_CONN_MAX_CCCDS;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_init
+ *
+ * Function Description:
+ * @brief  Empties the connection table and registers the descriptors that
+ *         are kept per connection
+ *
+ * @param p_cccd_handles    Descriptor handles
+ * @param num_cccds         Number of handles, at most APP_BT_CONN_MAX_CCCDS
+ *
+ * @return void
+ */
+void app_bt_conn_init(const uint16_t *p_cccd_handles, uint8_t num_cccds)
+{
+    memset(app_bt_conn_slots, 0, sizeof(app_bt_conn_slots));
+    app_bt_conn_num_open = 0;
+    memset(app_bt_conn_notify_mask, 0, sizeof(app_bt_conn_notify_mask));
+    memset(app_bt_conn_indicate_mask, 0, sizeof(app_bt_conn_indicate_mask));
+
+    app_bt_conn_num_cccds = (num_cccds < APP_BT_CONN_MAX_CCCDS) ? num_cccds : APP_BT_CONN_MAX_CCCDS;
+    memcpy(app_bt_conn_cccd_handles, p_cccd_handles,
+           app_bt_conn_num_cccds * sizeof(app_bt_conn_cccd_handles[0]));
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_open
+ *
+ * Function Description:
+ * @brief  Assigns a slot to a new connection. Descriptors start disabled
+ *         and the MTU at its default.
+ *
+ * @param conn_id       Connection ID
+ * @param p_peer_addr   Peer Bluetooth device address
+ *
+ * @return uint8_t  Slot, APP_BT_CONN_INVALID_SLOT if the table is full
+ */
+uint8_t app_bt_conn_open(uint16_t conn_id, const uint8_t *p_peer_addr)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT != slot)
+    {
+        return slot;
+    }
+
+    for (slot = 0; slot < APP_BT_MAX_CONNECTIONS; slot++)
+    {
+        if (0 == app_bt_conn_slots[slot].conn_id)
+        {
+            memset(&app_bt_conn_slots[slot], 0, sizeof(app_bt_conn_slots[slot]));
+            app_bt_conn_slots[slot].conn_id = conn_id;
+            app_bt_conn_slots[slot].mtu = APP_BT_CONN_DEFAULT_MTU;
+            memcpy(app_bt_conn_slots[slot].peer_addr, p_peer_addr, BD_ADDR_LEN);
+            app_bt_conn_num_open++;
+            return slot;
+        }
+    }
+    return APP_BT_CONN_INVALID_SLOT;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_close
+ *
+ * Function Description:
+ * @brief  Releases the slot of a connection and its subscriptions
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_conn_close(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < app_bt_conn_num_cccds; i++)
+    {
+        app_bt_conn_notify_mask[i]   &= ~(1uL << slot);
+        app_bt_conn_indicate_mask[i] &= ~(1uL << slot);
+    }
+    app_bt_conn_slots[slot].conn_id = 0;
+    app_bt_conn_num_open--;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_find_slot
+ *
+ * Function Description:
+ * @brief  Returns the slot of a connection
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return uint8_t  Slot, APP_BT_CONN_INVALID_SLOT if not connected
+ */
+uint8_t app_bt_conn_find_slot(uint16_t conn_id)
+{
+    if (0 == conn_id)
+    {
+        return APP_BT_CONN_INVALID_SLOT;
+    }
+
+    for (uint8_t slot = 0; slot < APP_BT_MAX_CONNECTIONS; slot++)
+    {
+        if (app_bt_conn_slots[slot].conn_id == conn_id)
+        {
+            return slot;
+        }
+    }
+    return APP_BT_CONN_INVALID_SLOT;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_count
+ *
+ * Function Description:
+ * @brief  Returns the number of open connections
+ *
+ * @return uint8_t  Number of slots in use
+ */
+uint8_t app_bt_conn_count(void)
+{
+    return app_bt_conn_num_open;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_get_conn_id
+ *
+ * Function Description:
+ * @brief  Returns the connection ID held by a slot
+ *
+ * @param slot      Slot
+ *
+ * @return uint16_t  Connection ID, 0 if the slot is free
+ */
+uint16_t app_bt_conn_get_conn_id(uint8_t slot)
+{
+    return (slot < APP_BT_MAX_CONNECTIONS) ? app_bt_conn_slots[slot].conn_id : 0;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_get_peer_addr
+ *
+ * Function Description:
+ * @brief  Returns the address of the peer on a connection
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return const uint8_t*  Peer address, NULL if not connected
+ */
+const uint8_t *app_bt_conn_get_peer_addr(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    return (APP_BT_CONN_INVALID_SLOT != slot) ? app_bt_conn_slots[slot].peer_addr : NULL;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_set_mtu
+ *
+ * Function Description:
+ * @brief  Records the ATT MTU agreed with the peer of a connection
+ *
+ * @param conn_id   Connection ID
+ * @param mtu       Negotiated ATT MTU
+ *
+ * @return void
+ */
+void app_bt_conn_set_mtu(uint16_t conn_id, uint16_t mtu)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT != slot)
+    {
+        app_bt_conn_slots[slot].mtu = mtu;
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_get_mtu
+ *
+ * Function Description:
+ * @brief  Returns the ATT MTU of a connection
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return uint16_t  ATT MTU, APP_BT_CONN_DEFAULT_MTU if not connected
+ */
+uint16_t app_bt_conn_get_mtu(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    return (APP_BT_CONN_INVALID_SLOT != slot) ? app_bt_conn_slots[slot].mtu : APP_BT_CONN_DEFAULT_MTU;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_cccd_set
+ *
+ * Function Description:
+ * @brief  Stores the descriptor value written by one connection
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Descriptor handle
+ * @param value     GATT_CLIENT_CONFIG_xxx bits
+ * @param p_changed Returns whether the value differs from the previous one,
+ *                  may be NULL
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_conn_cccd_set(uint16_t conn_id,
+                                            uint16_t handle,
+                                            uint16_t value,
+                                            wiced_bool_t *p_changed)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+    uint8_t idx = app_bt_conn_find_cccd(handle);
+    uint8_t *p_cccd;
+
+    if (APP_BT_CONN_MAX_CCCDS == idx)
+    {
+        return WICED_BT_GATT_INVALID_HANDLE;
+    }
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return WICED_BT_GATT_ERROR;
+    }
+
+    p_cccd = app_bt_conn_slots[slot].cccd[idx];
+    if (NULL != p_changed)
+    {
+        *p_changed = ((p_cccd[0] | (p_cccd[1] << 8)) != value) ? WICED_TRUE : WICED_FALSE;
+    }
+    p_cccd[0] = (uint8_t)(value & 0xFFu);
+    p_cccd[1] = (uint8_t)(value >> 8);
+
+    if (0 != (value & GATT_CLIENT_CONFIG_NOTIFICATION))
+    {
+        app_bt_conn_notify_mask[idx] |= (1uL << slot);
+    }
+    else
+    {
+        app_bt_conn_notify_mask[idx] &= ~(1uL << slot);
+    }
+
+    if (0 != (value & GATT_CLIENT_CONFIG_INDICATION))
+    {
+        app_bt_conn_indicate_mask[idx] |= (1uL << slot);
+    }
+    else
+    {
+        app_bt_conn_indicate_mask[idx] &= ~(1uL << slot);
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_cccd_get
+ *
+ * Function Description:
+ * @brief  Returns the descriptor value of one connection
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Descriptor handle
+ *
+ * @return uint16_t  GATT_CLIENT_CONFIG_xxx bits, 0 if unknown
+ */
+uint16_t app_bt_conn_cccd_get(uint16_t conn_id, uint16_t handle)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+    uint8_t idx = app_bt_conn_find_cccd(handle);
+
+    if ((APP_BT_CONN_INVALID_SLOT == slot) || (APP_BT_CONN_MAX_CCCDS == idx))
+    {
+        return 0;
+    }
+    return app_bt_conn_slots[slot].cccd[idx][0] | (app_bt_conn_slots[slot].cccd[idx][1] << 8);
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_cccd_subscribers
+ *
+ * Function Description:
+ * @brief  Returns the bitmap of slots that enabled any of the given
+ *         GATT_CLIENT_CONFIG_xxx bits on a descriptor. Bit n is slot n.
+ *
+ * @param handle    Descriptor handle
+ * @param flags     GATT_CLIENT_CONFIG_NOTIFICATION and/or _INDICATION
+ *
+ * @return uint32_t  Bitmap of subscribed slots
+ */
+uint32_t app_bt_conn_cccd_subscribers(uint16_t handle, uint16_t flags)
+{
+    uint8_t idx = app_bt_conn_find_cccd(handle);
+    uint32_t mask = 0;
+
+    if (APP_BT_CONN_MAX_CCCDS == idx)
+    {
+        return 0;
+    }
+    if (0 != (flags & GATT_CLIENT_CONFIG_NOTIFICATION))
+    {
+        mask |= app_bt_conn_notify_mask[idx];
+    }
+    if (0 != (flags & GATT_CLIENT_CONFIG_INDICATION))
+    {
+        mask |= app_bt_conn_indicate_mask[idx];
+    }
+    return mask;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_cccd_on_read
+ *
+ * Function Description:
+ * @brief  Attribute read hook for descriptors kept per connection; returns
+ *         the value of the connection doing the read
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Descriptor handle
+ * @param pp_val    Returns a pointer to the value
+ * @param p_len     Returns the length of the value
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_conn_cccd_on_read(uint16_t conn_id,
+                                                uint16_t handle,
+                                                uint8_t **pp_val,
+                                                uint16_t *p_len)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+    uint8_t idx = app_bt_conn_find_cccd(handle);
+
+    if ((APP_BT_CONN_INVALID_SLOT == slot) || (APP_BT_CONN_MAX_CCCDS == idx))
+    {
+        return WICED_BT_GATT_INVALID_HANDLE;
+    }
+
+    *pp_val = app_bt_conn_slots[slot].cccd[idx];
+    *p_len = sizeof(app_bt_conn_slots[slot].cccd[idx]);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/**
+ * Function Name:
+ * app_bt_conn_get_client_features
+ *
+ * Function Description:
+ * @brief  Returns the Client Supported Features the peer of a connection
+ *         wrote
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return uint8_t  APP_BT_CONN_CLIENT_FEAT_xxx bits, 0 if not connected
+ */
+uint8_t app_bt_conn_get_client_features(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    return (APP_BT_CONN_INVALID_SLOT != slot) ? app_bt_conn_slots[slot].client_features : 0;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_client_features_validate
+ *
+ * Function Description:
+ * @brief  Validate hook for Client Supported Features. A client may not
+ *         clear a bit it has set; unknown bits are ignored.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_conn_client_features_validate(uint16_t conn_id,
+                                                            uint16_t handle,
+                                                            uint8_t *p_val,
+                                                            uint16_t len)
+{
+    uint8_t current = app_bt_conn_get_client_features(conn_id);
+
+    (void)handle;
+
+    if (0 == len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    if (current != (current & p_val[0]))
+    {
+        return WICED_BT_GATT_VALUE_NOT_ALLOWED;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_client_features_on_write
+ *
+ * Function Description:
+ * @brief  Write hook for Client Supported Features, kept per connection
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_conn_client_features_on_write(uint16_t conn_id,
+                                                            wiced_bt_gatt_event_data_t *p_data,
+                                                            uint16_t handle,
+                                                            uint8_t *p_val,
+                                                            uint16_t len)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    (void)p_data;
+    (void)handle;
+    (void)len;
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return WICED_BT_GATT_INVALID_HANDLE;
+    }
+    app_bt_conn_slots[slot].client_features = p_val[0] & APP_BT_CONN_CLIENT_FEAT_ALL;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_conn_client_features_on_read
+ *
+ * Function Description:
+ * @brief  Read hook for Client Supported Features; returns the value of
+ *         the connection doing the read
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns a pointer to the value
+ * @param p_len     Returns the length of the value
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_conn_client_features_on_read(uint16_t conn_id,
+                                                           uint16_t handle,
+                                                           uint8_t **pp_val,
+                                                           uint16_t *p_len)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    (void)handle;
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return WICED_BT_GATT_INVALID_HANDLE;
+    }
+    *pp_val = &app_bt_conn_slots[slot].client_features;
+    *p_len = sizeof(app_bt_conn_slots[slot].client_features);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,138 @@
+/******************************************************************************
+* File Name:   app_bt_conn.h
+*
+* Description: This file contains the interface of the connection table, which
+*              keeps per-connection state such as client configuration
+*              descriptors.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_CONN_H__
+#define __APP_BT_CONN_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Number of connection slots. Keep in line with MaxClientsConnections
+ *        in design.cybt, which sets how many links the stack accepts.
+ */
+#ifndef APP_BT_MAX_CONNECTIONS
+#define APP_BT_MAX_CONNECTIONS              (3u)
+#endif
+
+#if (APP_BT_MAX_CONNECTIONS > 32u)
+#error "Subscriber bitmaps hold at most 32 connection slots"
+#endif
+
+/**
+ * @brief Number of client characteristic configuration descriptors kept
+ *        per connection
+ */
+#ifndef APP_BT_CONN_MAX_CCCDS
+#define APP_BT_CONN_MAX_CCCDS               (2u)
+#endif
+
+/**
+ * @brief Returned when a connection has no slot
+ */
+#define APP_BT_CONN_INVALID_SLOT            (0xFFu)
+
+/**
+ * @brief ATT MTU in use until the client exchanges MTU
+ */
+#define APP_BT_CONN_DEFAULT_MTU             (23u)
+
+/**
+ * @brief Client Supported Features bits (Core Vol 3 Part G 7.2)
+ */
+#define APP_BT_CONN_CLIENT_FEAT_ROBUST_CACHING  (0x01u)
+#define APP_BT_CONN_CLIENT_FEAT_EATT            (0x02u)
+#define APP_BT_CONN_CLIENT_FEAT_MULTI_NOTIF     (0x04u)
+#define APP_BT_CONN_CLIENT_FEAT_ALL             (0x07u)
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void                   app_bt_conn_init                 (const uint16_t *p_cccd_handles,
+                                                         uint8_t num_cccds);
+uint8_t                app_bt_conn_open                 (uint16_t conn_id,
+                                                         const uint8_t *p_peer_addr);
+void                   app_bt_conn_close                (uint16_t conn_id);
+uint8_t                app_bt_conn_find_slot            (uint16_t conn_id);
+uint8_t                app_bt_conn_count                (void);
+uint16_t               app_bt_conn_get_conn_id          (uint8_t slot);
+const uint8_t         *app_bt_conn_get_peer_addr        (uint16_t conn_id);
+void                   app_bt_conn_set_mtu              (uint16_t conn_id,
+                                                         uint16_t mtu);
+uint16_t               app_bt_conn_get_mtu              (uint16_t conn_id);
+wiced_bt_gatt_status_t app_bt_conn_cccd_set             (uint16_t conn_id,
+                                                         uint16_t handle,
+                                                         uint16_t value,
+                                                         wiced_bool_t *p_changed);
+uint16_t               app_bt_conn_cccd_get             (uint16_t conn_id,
+                                                         uint16_t handle);
+uint32_t               app_bt_conn_cccd_subscribers     (uint16_t handle,
+                                                         uint16_t flags);
+wiced_bt_gatt_status_t app_bt_conn_cccd_on_read         (uint16_t conn_id,
+                                                         uint16_t handle,
+                                                         uint8_t **pp_val,
+                                                         uint16_t *p_len);
+uint8_t                app_bt_conn_get_client_features  (uint16_t conn_id);
+wiced_bt_gatt_status_t app_bt_conn_client_features_validate(uint16_t conn_id,
+                                                         uint16_t handle,
+                                                         uint8_t *p_val,
+                                                         uint16_t len);
+wiced_bt_gatt_status_t app_bt_conn_client_features_on_write(uint16_t conn_id,
+                                                         wiced_bt_gatt_event_data_t *p_data,
+                                                         uint16_t handle,
+                                                         uint8_t *p_val,
+                                                         uint16_t len);
+wiced_bt_gatt_status_t app_bt_conn_client_features_on_read(uint16_t conn_id,
+                                                         uint16_t handle,
+                                                         uint8_t **pp_val,
+                                                         uint16_t *p_len);
+
+#endif      /*__APP_BT_CONN_H__ */
+
+
+/* [] END OF FILE */
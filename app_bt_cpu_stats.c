@@ -0,0 +1,438 @@
+/******************************************************************************
+* File Name:   app_bt_cpu_stats.c
+*
+* Description: This file implements the per task CPU utilisation report. The
+*                           FreeRTOS run-time counter is the core cycle counter (DWT)
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_cpu_stats.h"
+#include "cybsp.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief CPU use of one task. The FreeRTOS counters are 32 bit cycle counts
+ *        and wrap within a minute, so only their differences between two
+ *        updates are used.
+ */
+typedef struct
+{
+    UBaseType_t task_number;                        /* Unique per task */
+    char        name[configMAX_TASK_NAME_LEN];
+    uint32_t    last_counter;                       /* ulRunTimeCounter at the last update */
+    uint32_t    window_cycles;                      /* Cycles in the last window */
+    uint64_t    total_cycles;                       /* Cycles since reset */
+    bool        alive;
+} app_bt_cpu_stats_entry_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static app_bt_cpu_stats_entry_t app_bt_cpu_stats_entries[APP_BT_CPU_STATS_MAX_TASKS];
+static uint8_t                  app_bt_cpu_stats_num_entries;
+static uint32_t                 app_bt_cpu_stats_last_total;
+static uint32_t                 app_bt_cpu_stats_window_total;
+static uint64_t                 app_bt_cpu_stats_total;         /* Cycles since reset */
+static bool                     app_bt_cpu_stats_primed;
+static uint32_t                 app_bt_cpu_stats_windows;
+
+/* Characteristic value, built on each read */
+static uint8_t app_bt_cpu_stats_value[APP_BT_CPU_STATS_HEADER_LEN +
+                                      (APP_BT_CPU_STATS_MAX_TASKS * APP_BT_CPU_STATS_RECORD_LEN)];
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_cpu_stats_timer_init
+ *
+ * Function Description:
+ * @brief  portCONFIGURE_TIMER_FOR_RUN_TIME_STATS: starts the DWT cycle
+ *         counter
+ *
+ * @return void
+ */
+void app_bt_cpu_stats_timer_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_get_counter
+ *
+ * Function Description:
+ * @brief  portGET_RUN_TIME_COUNTER_VALUE: core clock cycles
+ *
+ * @return uint32_t Cycle count
+ */
+uint32_t app_bt_cpu_stats_get_counter(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_load
+ *
+ * Function Description:
+ * @brief  Share of a total, in 0.01 % units
+ *
+ * @param part      Cycles of a task
+ * @param total     Cycles of all tasks
+ *
+ * @return uint16_t Load, 0 to 10000
+ */
+static uint16_t app_bt_cpu_stats_load(uint64_t part, uint64_t total)
+{
+    return (0 != total) ? (uint16_t)((part * 10000u) / total) : 0;
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_ms
+ *
+ * Function Description:
+ * @brief  Converts core clock cycles to milliseconds
+ *
+ * @param cycles    Cycles
+ *
+ * @return uint64_t Milliseconds
+ */
+static uint64_t app_bt_cpu_stats_ms(uint64_t cycles)
+{
+    return cycles / ((SystemCoreClock / 1000u) + 1u);
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_update
+ *
+ * Function Description:
+ * @brief  Closes a window: charges every task the cycles it ran since the
+ *         previous update. Called by the stack profiler task with the
+ *         uxTaskGetSystemState() snapshot it takes anyway.
+ *
+ * @param p_status          Task states
+ * @param num_tasks         Number of task states
+ * @param total_run_time    Run-time counter at the snapshot
+ *
+ * @return void
+ */
+void app_bt_cpu_stats_update(const TaskStatus_t *p_status, UBaseType_t num_tasks,
+                             uint32_t total_run_time)
+{
+    app_bt_cpu_stats_entry_t *p_entry;
+    UBaseType_t               i;
+    uint32_t                  delta;
+    uint8_t                   j;
+    bool                      print;
+
+    vTaskSuspendAll();
+    app_bt_cpu_stats_window_total = app_bt_cpu_stats_primed ?
+                                    (total_run_time - app_bt_cpu_stats_last_total) : 0;
+    app_bt_cpu_stats_last_total   = total_run_time;
+    app_bt_cpu_stats_total       += app_bt_cpu_stats_window_total;
+
+    for (j = 0; j < app_bt_cpu_stats_num_entries; j++)
+    {
+        app_bt_cpu_stats_entries[j].alive         = false;
+        app_bt_cpu_stats_entries[j].window_cycles = 0;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        for (j = 0; j < app_bt_cpu_stats_num_entries; j++)
+        {
+            if (app_bt_cpu_stats_entries[j].task_number == p_status[i].xTaskNumber)
+            {
+                break;
+            }
+        }
+        if (j == app_bt_cpu_stats_num_entries)
+        {
+            if (APP_BT_CPU_STATS_MAX_TASKS == app_bt_cpu_stats_num_entries)
+            {
+                continue;
+            }
+            /* A task created within the window ran for all its counter */
+            p_entry = &app_bt_cpu_stats_entries[app_bt_cpu_stats_num_entries++];
+            memset(p_entry, 0, sizeof(*p_entry));
+            p_entry->task_number  = p_status[i].xTaskNumber;
+            strncpy(p_entry->name, p_status[i].pcTaskName, sizeof(p_entry->name) - 1);
+            p_entry->last_counter = app_bt_cpu_stats_primed ? 0 : p_status[i].ulRunTimeCounter;
+        }
+
+        p_entry = &app_bt_cpu_stats_entries[j];
+        delta   = p_status[i].ulRunTimeCounter - p_entry->last_counter;
+        p_entry->last_counter   = p_status[i].ulRunTimeCounter;
+        p_entry->window_cycles  = delta;
+        p_entry->total_cycles  += delta;
+        p_entry->alive          = true;
+    }
+    app_bt_cpu_stats_primed = true;
+    app_bt_cpu_stats_windows++;
+    print = (0 != APP_BT_CPU_STATS_PRINT_WINDOWS) &&
+            (0 == (app_bt_cpu_stats_windows % APP_BT_CPU_STATS_PRINT_WINDOWS));
+    (void)xTaskResumeAll();
+
+    if (print)
+    {
+        app_bt_cpu_stats_print();
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_reset
+ *
+ * Function Description:
+ * @brief  Restarts the loads accumulated since reset, for instance before an
+ *         OTA download or a notification burst
+ *
+ * @return void
+ */
+void app_bt_cpu_stats_reset(void)
+{
+    uint8_t j;
+
+    vTaskSuspendAll();
+    app_bt_cpu_stats_total = 0;
+    for (j = 0; j < app_bt_cpu_stats_num_entries; j++)
+    {
+        app_bt_cpu_stats_entries[j].total_cycles = 0;
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_print
+ *
+ * Function Description:
+ * @brief  Prints the load of every task on the UART
+ *
+ * @return void
+ */
+void app_bt_cpu_stats_print(void)
+{
+    app_bt_cpu_stats_entry_t entries[APP_BT_CPU_STATS_MAX_TASKS];
+    uint64_t                 total;
+    uint32_t                 window_total;
+    uint8_t                  num_entries;
+    uint16_t                 window_load;
+    uint16_t                 total_load;
+    uint8_t                  i;
+
+    vTaskSuspendAll();
+    num_entries  = app_bt_cpu_stats_num_entries;
+    window_total = app_bt_cpu_stats_window_total;
+    total        = app_bt_cpu_stats_total;
+    memcpy(entries, app_bt_cpu_stats_entries, num_entries * sizeof(entries[0]));
+    (void)xTaskResumeAll();
+
+    printf("CPU load, last %lu ms / since reset %lu ms:\r\n",
+           (unsigned long)app_bt_cpu_stats_ms(window_total),
+           (unsigned long)app_bt_cpu_stats_ms(total));
+    for (i = 0; i < num_entries; i++)
+    {
+        if (!entries[i].alive && (0 == entries[i].total_cycles))
+        {
+            continue;
+        }
+        window_load = app_bt_cpu_stats_load(entries[i].window_cycles, window_total);
+        total_load  = app_bt_cpu_stats_load(entries[i].total_cycles, total);
+        printf("  %-*s %3u.%02u %% %3u.%02u %%\r\n", configMAX_TASK_NAME_LEN, entries[i].name,
+               window_load / 100u, window_load % 100u, total_load / 100u, total_load % 100u);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_serialize
+ *
+ * Function Description:
+ * @brief  Builds the binary snapshot described at APP_BT_CPU_STATS_VERSION
+ *
+ * @param p_buf     Destination
+ * @param size      Size of p_buf, records that do not fit are left out
+ *
+ * @return uint16_t Bytes written
+ */
+uint16_t app_bt_cpu_stats_serialize(uint8_t *p_buf, uint16_t size)
+{
+    const app_bt_cpu_stats_entry_t *p_entry;
+    uint64_t                        value;
+    uint16_t                        len = APP_BT_CPU_STATS_HEADER_LEN;
+    uint16_t                        load;
+    uint8_t                         count = 0;
+    uint8_t                         i;
+
+    if (size < APP_BT_CPU_STATS_HEADER_LEN)
+    {
+        return 0;
+    }
+
+    vTaskSuspendAll();
+    for (i = 0; (i < app_bt_cpu_stats_num_entries) &&
+                ((len + APP_BT_CPU_STATS_RECORD_LEN) <= size); i++)
+    {
+        p_entry = &app_bt_cpu_stats_entries[i];
+
+        memset(&p_buf[len], 0, APP_BT_CPU_STATS_NAME_LEN);
+        strncpy((char *)&p_buf[len], p_entry->name, APP_BT_CPU_STATS_NAME_LEN);
+        len += APP_BT_CPU_STATS_NAME_LEN;
+        load = app_bt_cpu_stats_load(p_entry->window_cycles, app_bt_cpu_stats_window_total);
+        p_buf[len++] = (uint8_t)(load & 0xFF);
+        p_buf[len++] = (uint8_t)(load >> 8);
+        load = app_bt_cpu_stats_load(p_entry->total_cycles, app_bt_cpu_stats_total);
+        p_buf[len++] = (uint8_t)(load & 0xFF);
+        p_buf[len++] = (uint8_t)(load >> 8);
+        count++;
+    }
+
+    p_buf[0] = APP_BT_CPU_STATS_VERSION;
+    p_buf[1] = count;
+    value    = app_bt_cpu_stats_ms(app_bt_cpu_stats_window_total);
+    value    = (value > UINT16_MAX) ? UINT16_MAX : value;
+    p_buf[2] = (uint8_t)(value & 0xFF);
+    p_buf[3] = (uint8_t)(value >> 8);
+    value    = app_bt_cpu_stats_ms(app_bt_cpu_stats_total);
+    value    = (value > UINT32_MAX) ? UINT32_MAX : value;
+    p_buf[4] = (uint8_t)(value & 0xFF);
+    p_buf[5] = (uint8_t)(value >> 8);
+    p_buf[6] = (uint8_t)(value >> 16);
+    p_buf[7] = (uint8_t)(value >> 24);
+    (void)xTaskResumeAll();
+
+    return len;
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the CPU Load diagnostics characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the snapshot
+ * @param p_len     Returns its length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_cpu_stats_on_read(uint16_t conn_id, uint16_t handle,
+                                                uint8_t **pp_val, uint16_t *p_len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    *p_len  = app_bt_cpu_stats_serialize(app_bt_cpu_stats_value, sizeof(app_bt_cpu_stats_value));
+    *pp_val = app_bt_cpu_stats_value;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the CPU Load characteristic. Writing a single 0
+ *         resets the loads since reset, anything else is refused.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_cpu_stats_validate(uint16_t conn_id, uint16_t handle,
+                                                 uint8_t *p_val, uint16_t len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    if (1 != len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    return (0 == p_val[0]) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_VALUE_NOT_ALLOWED;
+}
+
+/**
+ * Function Name:
+ * app_bt_cpu_stats_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the CPU Load characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_cpu_stats_on_write(uint16_t conn_id,
+                                                 wiced_bt_gatt_event_data_t *p_data,
+                                                 uint16_t handle, uint8_t *p_val,
+                                                 uint16_t len)
+{
+    (void)conn_id;
+    (void)p_data;
+    (void)handle;
+    (void)p_val;
+    (void)len;
+
+    app_bt_cpu_stats_reset();
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
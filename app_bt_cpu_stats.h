@@ -0,0 +1,109 @@
+/******************************************************************************
+* File Name:   app_bt_cpu_stats.h
+*
+* Description: This file contains the declarations of the per task CPU utilisation
+*                           report built on the FreeRTOS run-time stats
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_CPU_STATS_H__
+#define __APP_BT_CPU_STATS_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Number of tasks reported
+ */
+#ifndef APP_BT_CPU_STATS_MAX_TASKS
+#define APP_BT_CPU_STATS_MAX_TASKS          (16u)
+#endif
+
+/**
+ * @brief The report is printed on the UART every this many windows, 0 never
+ */
+#ifndef APP_BT_CPU_STATS_PRINT_WINDOWS
+#define APP_BT_CPU_STATS_PRINT_WINDOWS      (10u)
+#endif
+
+/**
+ * @brief Task name bytes in each characteristic record
+ */
+#define APP_BT_CPU_STATS_NAME_LEN           (8u)
+
+/**
+ * @brief Characteristic snapshot: a header of version, record count, window
+ *        length in ms (uint16) and time since reset in ms (uint32), then one
+ *        record per task of name, load in the last window and load since
+ *        reset, both uint16 in 0.01 % units. Little endian.
+ */
+#define APP_BT_CPU_STATS_VERSION            (1u)
+#define APP_BT_CPU_STATS_HEADER_LEN         (8u)
+#define APP_BT_CPU_STATS_RECORD_LEN         (APP_BT_CPU_STATS_NAME_LEN + 4u)
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void                   app_bt_cpu_stats_timer_init  (void);
+uint32_t               app_bt_cpu_stats_get_counter (void);
+void                   app_bt_cpu_stats_update      (const TaskStatus_t *p_status,
+                                                     UBaseType_t num_tasks,
+                                                     uint32_t total_run_time);
+void                   app_bt_cpu_stats_reset       (void);
+void                   app_bt_cpu_stats_print       (void);
+uint16_t               app_bt_cpu_stats_serialize   (uint8_t *p_buf, uint16_t size);
+wiced_bt_gatt_status_t app_bt_cpu_stats_on_read     (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t **pp_val, uint16_t *p_len);
+wiced_bt_gatt_status_t app_bt_cpu_stats_validate    (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_cpu_stats_on_write    (uint16_t conn_id,
+                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                     uint16_t handle, uint8_t *p_val,
+                                                     uint16_t len);
+
+#endif      /*__APP_BT_CPU_STATS_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,407 @@
+/******************************************************************************
+* File Name:   app_bt_gatt_cache.c
+*
+* Description: This file keeps prebuilt read-by-type and read-multiple response
+*              streams so that repeated discovery requests are answered by
+*              handing the stack a pointer to an existing buffer. Entries are
+*              invalidated through the per-attribute write generation kept by
+*              app_bt_gatt_db.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_gatt_cache.h"
+#include "app_bt_gatt_db.h"
+#include <string.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+typedef enum
+{
+    APP_BT_GATT_CACHE_FREE,         /* Unused */
+    APP_BT_GATT_CACHE_BUILDING,     /* Response being built in place */
+    APP_BT_GATT_CACHE_VALID,        /* Response can be handed out again */
+    APP_BT_GATT_CACHE_STALE,        /* Not reusable, free once unpinned */
+} app_bt_gatt_cache_state_t;
+
+typedef struct
+{
+    app_bt_gatt_cache_key_t     key;
+    app_bt_gatt_cache_state_t   state;
+    uint8_t                     pins;           /* Responses queued in the stack */
+    uint8_t                     pair_len;
+    uint8_t                     num_attrs;
+    uint16_t                    len;
+    uint32_t                    last_used;
+    uint16_t                    handles[APP_BT_GATT_CACHE_MAX_ATTRS];
+    uint32_t                    generations[APP_BT_GATT_CACHE_MAX_ATTRS];
+    uint8_t                     rsp[APP_BT_GATT_CACHE_RSP_SIZE];
+} app_bt_gatt_cache_entry_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static app_bt_gatt_cache_entry_t app_bt_gatt_cache[APP_BT_GATT_CACHE_ENTRIES];
+static uint32_t                  app_bt_gatt_cache_clock;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_gatt_cache_entry_from_rsp
+ *
+ * Function Description:
+ * @brief  Maps a response buffer back to its cache entry
+ *
+ * @param p_rsp     Response buffer
+ *
+ * @return app_bt_gatt_cache_entry_t  Owning entry, NULL if p_rsp is not a
+ *                                    cache buffer
+ */
+static app_bt_gatt_cache_entry_t *app_bt_gatt_cache_entry_from_rsp(uint8_t *p_rsp)
+{
+    for (uint16_t i = 0; i < APP_BT_GATT_CACHE_ENTRIES; i++)
+    {
+        if (app_bt_gatt_cache[i].rsp == p_rsp)
+        {
+            return &app_bt_gatt_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_key_equal
+ *
+ * Function Description:
+ * @brief  Compares two response keys
+ *
+ * @return wiced_bool_t  WICED_TRUE if both keys identify the same response
+ */
+static wiced_bool_t app_bt_gatt_cache_key_equal(const app_bt_gatt_cache_key_t *p_a,
+                                                const app_bt_gatt_cache_key_t *p_b)
+{
+    if ((p_a->opcode != p_b->opcode) ||
+        (p_a->len_requested != p_b->len_requested) ||
+        (p_a->s_handle != p_b->s_handle) ||
+        (p_a->e_handle != p_b->e_handle) ||
+        (p_a->num_handles != p_b->num_handles) ||
+        (p_a->uuid.len != p_b->uuid.len))
+    {
+        return WICED_FALSE;
+    }
+
+    /* Unused handle slots are zero in both keys */
+    if (0 != memcmp(p_a->handles, p_b->handles, sizeof(p_a->handles)))
+    {
+        return WICED_FALSE;
+    }
+
+    /* 16 and 32 bit UUIDs occupy the leading bytes of the union */
+    return (0 == memcmp(&p_a->uuid.uu, &p_b->uuid.uu, p_a->uuid.len)) ? WICED_TRUE : WICED_FALSE;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_key_read_by_type
+ *
+ * Function Description:
+ * @brief  Builds the cache key of a read-by-type request
+ *
+ * @param p_key         Key to fill
+ * @param opcode        Bluetooth LE GATT request type opcode
+ * @param p_read_req    Read-by-type request
+ * @param len_requested Maximum response length
+ *
+ * @return void
+ */
+void app_bt_gatt_cache_key_read_by_type(app_bt_gatt_cache_key_t *p_key,
+                                        wiced_bt_gatt_opcode_t opcode,
+                                        wiced_bt_gatt_read_by_type_t *p_read_req,
+                                        uint16_t len_requested)
+{
+    memset(p_key, 0, sizeof(*p_key));
+    p_key->opcode        = opcode;
+    p_key->len_requested = len_requested;
+    p_key->s_handle      = p_read_req->s_handle;
+    p_key->e_handle      = p_read_req->e_handle;
+    p_key->uuid          = p_read_req->uuid;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_key_read_multi
+ *
+ * Function Description:
+ * @brief  Builds the cache key of a read-multiple request
+ *
+ * @param p_key         Key to fill
+ * @param opcode        Bluetooth LE GATT request type opcode
+ * @param p_read_req    Read-multiple request
+ * @param len_requested Maximum response length
+ *
+ * @return void
+ */
+void app_bt_gatt_cache_key_read_multi(app_bt_gatt_cache_key_t *p_key,
+                                      wiced_bt_gatt_opcode_t opcode,
+                                      wiced_bt_gatt_read_multiple_req_t *p_read_req,
+                                      uint16_t len_requested)
+{
+    memset(p_key, 0, sizeof(*p_key));
+    p_key->opcode        = opcode;
+    p_key->len_requested = len_requested;
+    p_key->num_handles   = (uint16_t)p_read_req->num_handles;
+
+    /* Longer lists are refused by app_bt_gatt_cache_reserve() */
+    for (int xx = 0; (xx < p_read_req->num_handles) && (xx < (int)APP_BT_GATT_CACHE_MAX_ATTRS); xx++)
+    {
+        p_key->handles[xx] = wiced_bt_gatt_get_handle_from_stream(p_read_req->p_handle_stream, xx);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_lookup
+ *
+ * Function Description:
+ * @brief  Looks up a prebuilt response. A hit is pinned until the stack
+ *         hands the buffer back through app_bt_gatt_cache_release().
+ *
+ * @param p_key         Response key
+ * @param p_len         Returns the response length
+ * @param p_pair_len    Returns the read-by-type pair length
+ *
+ * @return uint8_t*     Response stream, NULL on a miss
+ */
+uint8_t *app_bt_gatt_cache_lookup(const app_bt_gatt_cache_key_t *p_key,
+                                  uint16_t *p_len,
+                                  uint8_t *p_pair_len)
+{
+    app_bt_gatt_cache_entry_t *p_entry;
+
+    for (uint16_t i = 0; i < APP_BT_GATT_CACHE_ENTRIES; i++)
+    {
+        p_entry = &app_bt_gatt_cache[i];
+
+        if ((APP_BT_GATT_CACHE_VALID != p_entry->state) ||
+            !app_bt_gatt_cache_key_equal(&p_entry->key, p_key))
+        {
+            continue;
+        }
+
+        /* Any attribute written since the response was built makes it stale */
+        for (uint8_t j = 0; j < p_entry->num_attrs; j++)
+        {
+            if (app_bt_gatt_db_get_generation(p_entry->handles[j]) != p_entry->generations[j])
+            {
+                p_entry->state = (0 == p_entry->pins) ? APP_BT_GATT_CACHE_FREE :
+                                                        APP_BT_GATT_CACHE_STALE;
+                return NULL;
+            }
+        }
+
+        if (UINT8_MAX == p_entry->pins)
+        {
+            return NULL;
+        }
+
+        p_entry->pins++;
+        p_entry->last_used = ++app_bt_gatt_cache_clock;
+        *p_len = p_entry->len;
+        *p_pair_len = p_entry->pair_len;
+        return p_entry->rsp;
+    }
+    return NULL;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_reserve
+ *
+ * Function Description:
+ * @brief  Claims an entry to build a response in place, evicting the least
+ *         recently used unpinned entry if needed.
+ *
+ * @param p_key     Key of the response to be built
+ *
+ * @return uint8_t* Buffer of len_requested bytes to build the response in,
+ *                  NULL if no entry is available or the request is not
+ *                  cacheable
+ */
+uint8_t *app_bt_gatt_cache_reserve(const app_bt_gatt_cache_key_t *p_key)
+{
+    app_bt_gatt_cache_entry_t *p_victim = NULL;
+    app_bt_gatt_cache_entry_t *p_entry;
+
+    if ((p_key->len_requested > APP_BT_GATT_CACHE_RSP_SIZE) ||
+        (p_key->num_handles > APP_BT_GATT_CACHE_MAX_ATTRS))
+    {
+        return NULL;
+    }
+
+    for (uint16_t i = 0; i < APP_BT_GATT_CACHE_ENTRIES; i++)
+    {
+        p_entry = &app_bt_gatt_cache[i];
+
+        if ((0 != p_entry->pins) || (APP_BT_GATT_CACHE_BUILDING == p_entry->state))
+        {
+            continue;
+        }
+        if (APP_BT_GATT_CACHE_VALID != p_entry->state)
+        {
+            p_victim = p_entry;
+            break;
+        }
+        if ((NULL == p_victim) || (p_entry->last_used < p_victim->last_used))
+        {
+            p_victim = p_entry;
+        }
+    }
+
+    if (NULL == p_victim)
+    {
+        return NULL;
+    }
+
+    p_victim->key       = *p_key;
+    p_victim->state     = APP_BT_GATT_CACHE_BUILDING;
+    p_victim->pins      = 1;
+    p_victim->num_attrs = 0;
+    return p_victim->rsp;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_track
+ *
+ * Function Description:
+ * @brief  Records an attribute placed in a response being built, so that the
+ *         response is dropped once the attribute is written. Attributes with
+ *         an on-read hook are dynamic and make the response uncacheable.
+ *
+ * @param p_rsp     Response buffer, ignored if not a cache buffer
+ * @param handle    Attribute handle placed in the response
+ *
+ * @return void
+ */
+void app_bt_gatt_cache_track(uint8_t *p_rsp, uint16_t handle)
+{
+    app_bt_gatt_cache_entry_t *p_entry = app_bt_gatt_cache_entry_from_rsp(p_rsp);
+    const app_bt_gatt_attr_hooks_t *p_hooks;
+
+    if ((NULL == p_entry) || (APP_BT_GATT_CACHE_BUILDING != p_entry->state))
+    {
+        return;
+    }
+
+    p_hooks = app_bt_gatt_db_find_hooks(handle);
+    if ((p_entry->num_attrs >= APP_BT_GATT_CACHE_MAX_ATTRS) ||
+        ((NULL != p_hooks) && (NULL != p_hooks->p_on_read)))
+    {
+        p_entry->state = APP_BT_GATT_CACHE_STALE;
+        return;
+    }
+
+    p_entry->handles[p_entry->num_attrs]     = handle;
+    p_entry->generations[p_entry->num_attrs] = app_bt_gatt_db_get_generation(handle);
+    p_entry->num_attrs++;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_commit
+ *
+ * Function Description:
+ * @brief  Marks a response built in place as complete and reusable
+ *
+ * @param p_rsp     Response buffer, ignored if not a cache buffer
+ * @param len       Length of the response
+ * @param pair_len  Read-by-type pair length, 0 for read-multiple
+ *
+ * @return void
+ */
+void app_bt_gatt_cache_commit(uint8_t *p_rsp, uint16_t len, uint8_t pair_len)
+{
+    app_bt_gatt_cache_entry_t *p_entry = app_bt_gatt_cache_entry_from_rsp(p_rsp);
+
+    if ((NULL == p_entry) || (APP_BT_GATT_CACHE_BUILDING != p_entry->state))
+    {
+        return;
+    }
+
+    p_entry->len       = len;
+    p_entry->pair_len  = pair_len;
+    p_entry->state     = APP_BT_GATT_CACHE_VALID;
+    p_entry->last_used = ++app_bt_gatt_cache_clock;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_cache_release
+ *
+ * Function Description:
+ * @brief  Unpins a response buffer. Passed to the stack as the free function
+ *         of cached responses and used on error paths while building; a
+ *         response released before it was committed is discarded.
+ *
+ * @param p_rsp     Response buffer
+ *
+ * @return void
+ */
+void app_bt_gatt_cache_release(uint8_t *p_rsp)
+{
+    app_bt_gatt_cache_entry_t *p_entry = app_bt_gatt_cache_entry_from_rsp(p_rsp);
+
+    if ((NULL == p_entry) || (0 == p_entry->pins))
+    {
+        return;
+    }
+
+    p_entry->pins--;
+    if ((APP_BT_GATT_CACHE_BUILDING == p_entry->state) ||
+        ((APP_BT_GATT_CACHE_STALE == p_entry->state) && (0 == p_entry->pins)))
+    {
+        p_entry->state = APP_BT_GATT_CACHE_FREE;
+    }
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,116 @@
+/******************************************************************************
+* File Name:   app_bt_gatt_cache.h
+*
+* Description: This file contains the interface of a small cache of prebuilt
+*              read-by-type and read-multiple response streams.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_GATT_CACHE_H__
+#define __APP_BT_GATT_CACHE_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Number of cached responses
+ */
+#ifndef APP_BT_GATT_CACHE_ENTRIES
+#define APP_BT_GATT_CACHE_ENTRIES           (4u)
+#endif
+
+/**
+ * @brief Size of each cached response stream. Requests allowing a longer
+ *        response (larger MTU) are built without the cache.
+ */
+#ifndef APP_BT_GATT_CACHE_RSP_SIZE
+#define APP_BT_GATT_CACHE_RSP_SIZE          (256u)
+#endif
+
+/**
+ * @brief Maximum number of attributes a cached response may contain
+ */
+#ifndef APP_BT_GATT_CACHE_MAX_ATTRS
+#define APP_BT_GATT_CACHE_MAX_ATTRS         (8u)
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Identifies a response. Read-by-type uses the handle range and UUID,
+ *        read-multiple the handle list itself; longer lists than
+ *        APP_BT_GATT_CACHE_MAX_ATTRS are never cached.
+ */
+typedef struct
+{
+    wiced_bt_gatt_opcode_t  opcode;
+    uint16_t                len_requested;  /* Depends on the MTU */
+    uint16_t                s_handle;
+    uint16_t                e_handle;
+    wiced_bt_uuid_t         uuid;
+    uint16_t                num_handles;
+    uint16_t                handles[APP_BT_GATT_CACHE_MAX_ATTRS];
+} app_bt_gatt_cache_key_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void     app_bt_gatt_cache_key_read_by_type (app_bt_gatt_cache_key_t *p_key,
+                                             wiced_bt_gatt_opcode_t opcode,
+                                             wiced_bt_gatt_read_by_type_t *p_read_req,
+                                             uint16_t len_requested);
+void     app_bt_gatt_cache_key_read_multi   (app_bt_gatt_cache_key_t *p_key,
+                                             wiced_bt_gatt_opcode_t opcode,
+                                             wiced_bt_gatt_read_multiple_req_t *p_read_req,
+                                             uint16_t len_requested);
+uint8_t *app_bt_gatt_cache_lookup           (const app_bt_gatt_cache_key_t *p_key,
+                                             uint16_t *p_len,
+                                             uint8_t *p_pair_len);
+uint8_t *app_bt_gatt_cache_reserve          (const app_bt_gatt_cache_key_t *p_key);
+void     app_bt_gatt_cache_track            (uint8_t *p_rsp, uint16_t handle);
+void     app_bt_gatt_cache_commit           (uint8_t *p_rsp, uint16_t len, uint8_t pair_len);
+void     app_bt_gatt_cache_release          (uint8_t *p_rsp);
+
+#endif      /*__APP_BT_GATT_CACHE_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,592 @@
+/******************************************************************************
+* File Name:   app_bt_gatt_db.c
+*
+* Description: This file builds a handle-indexed view of the external GATT
+*              attribute table (app_gatt_db_ext_attr_tbl) so that every
+*              ATT request resolves its attribute in constant time.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_gatt_db.h"
+#include <stdio.h>
+#include <string.h>
+
+/*******************************************************************************
+*        Macros
+*******************************************************************************/
+#define APP_BT_GATT_DB_UUID_UNINDEXED   (0xFFFFu)
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/**
+ * @brief Dense index keyed by attribute handle. Each entry holds the position
+ *        of the attribute in app_gatt_db_ext_attr_tbl plus one, so that a zero
+ *        (the reset value) means "no attribute with this handle".
+ */
+static uint16_t app_bt_gatt_db_handle_index[APP_BT_GATT_DB_MAX_HANDLE + 1];
+
+/**
+ * @brief Dense index keyed by attribute handle into the application hook
+ *        table, using the same "position plus one" encoding.
+ */
+static uint8_t app_bt_gatt_db_hook_index[APP_BT_GATT_DB_MAX_HANDLE + 1];
+
+/**
+ * @brief Per-handle write generation, bumped every time a stored value
+ *        changes. 32 bits so that a value written at the battery level
+ *        rate never wraps back to a generation a cached response holds.
+ */
+static uint32_t app_bt_gatt_db_generation[APP_BT_GATT_DB_MAX_HANDLE + 1];
+
+/**
+ * @brief Hook table registered by the application
+ */
+static const app_bt_gatt_attr_hooks_t *app_bt_gatt_db_hooks;
+static uint16_t                        app_bt_gatt_db_num_hooks;
+
+/**
+ * @brief Type index entry: all handles of one attribute type, stored sorted
+ *        in app_bt_gatt_db_uuid_handles[first .. first + count - 1]. A type
+ *        that did not fit keeps an entry with first set to
+ *        APP_BT_GATT_DB_UUID_UNINDEXED, so that it is not collected again.
+ */
+typedef struct
+{
+    wiced_bt_uuid_t uuid;
+    uint16_t        first;
+    uint16_t        count;
+} app_bt_gatt_db_uuid_entry_t;
+
+/**
+ * @brief Type index. Entries are added the first time a type is queried and
+ *        stay valid until the index is rebuilt, as the database is static.
+ */
+static app_bt_gatt_db_uuid_entry_t app_bt_gatt_db_uuid_index[APP_BT_GATT_DB_UUID_INDEX_TYPES];
+static uint16_t                    app_bt_gatt_db_uuid_handles[APP_BT_GATT_DB_UUID_INDEX_HANDLES];
+static uint16_t                    app_bt_gatt_db_uuid_num_types;
+static uint16_t                    app_bt_gatt_db_uuid_num_handles;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_gatt_db_index_init
+ *
+ * Function Description:
+ * @brief  Builds the handle index over app_gatt_db_ext_attr_tbl and the
+ *         application hook table. Must be called once before the GATT
+ *         database is registered with the stack.
+ *
+ * @param  p_hooks     Hook table, may be NULL
+ * @param  num_hooks   Number of entries in p_hooks
+ *
+ * @return wiced_result_t  WICED_BT_BADARG if a handle is above
+ *                         APP_BT_GATT_DB_MAX_HANDLE
+ */
+wiced_result_t app_bt_gatt_db_index_init(const app_bt_gatt_attr_hooks_t *p_hooks,
+                                         uint16_t num_hooks)
+{
+    uint16_t handle;
+    uint16_t highest = 0;
+    uint16_t unindexed = 0;
+
+    memset(app_bt_gatt_db_handle_index, 0, sizeof(app_bt_gatt_db_handle_index));
+    memset(app_bt_gatt_db_hook_index, 0, sizeof(app_bt_gatt_db_hook_index));
+    app_bt_gatt_db_uuid_num_types = 0;
+    app_bt_gatt_db_uuid_num_handles = 0;
+
+    app_bt_gatt_db_hooks = p_hooks;
+    app_bt_gatt_db_num_hooks = (NULL != p_hooks) ? num_hooks : 0;
+
+    for (uint16_t i = 0; i < app_gatt_db_ext_attr_tbl_size; i++)
+    {
+        handle = app_gatt_db_ext_attr_tbl[i].handle;
+
+        if (handle > APP_BT_GATT_DB_MAX_HANDLE)
+        {
+            highest = (handle > highest) ? handle : highest;
+            unindexed++;
+            continue;
+        }
+
+        /* Keep the first entry for a handle, as the linear scan used to do */
+        if (0 == app_bt_gatt_db_handle_index[handle])
+        {
+            app_bt_gatt_db_handle_index[handle] = i + 1;
+        }
+    }
+
+    for (uint16_t i = 0; i < app_bt_gatt_db_num_hooks; i++)
+    {
+        handle = app_bt_gatt_db_hooks[i].handle;
+
+        if (handle > APP_BT_GATT_DB_MAX_HANDLE)
+        {
+            highest = (handle > highest) ? handle : highest;
+            unindexed++;
+            continue;
+        }
+
+        /* Hooks past the 8-bit slots are found by app_bt_gatt_db_find_hooks() */
+        if (i >= UINT8_MAX)
+        {
+            continue;
+        }
+
+        if (0 == app_bt_gatt_db_hook_index[handle])
+        {
+            app_bt_gatt_db_hook_index[handle] = (uint8_t)(i + 1);
+        }
+    }
+
+    if (0 != unindexed)
+    {
+        printf("%s() %d handle(s) up to 0x%04x above APP_BT_GATT_DB_MAX_HANDLE 0x%04x\r\n",
+               __func__, unindexed, highest, APP_BT_GATT_DB_MAX_HANDLE);
+        return WICED_BT_BADARG;
+    }
+    return WICED_BT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_find_by_handle
+ *
+ * Function Description:
+ * @brief  Find attribute description by handle
+ *
+ * @param handle    handle to look up
+ *
+ * @return gatt_db_lookup_table_t   pointer containing handle data, NULL if the
+ *                                  handle is not in the external table
+ */
+gatt_db_lookup_table_t *app_bt_gatt_db_find_by_handle(uint16_t handle)
+{
+    uint16_t slot;
+
+    if (handle > APP_BT_GATT_DB_MAX_HANDLE)
+    {
+        return NULL;
+    }
+
+    slot = app_bt_gatt_db_handle_index[handle];
+    return (0 != slot) ? &app_gatt_db_ext_attr_tbl[slot - 1] : NULL;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_uuid_equal
+ *
+ * Function Description:
+ * @brief  Compares two attribute types
+ *
+ * @return wiced_bool_t  WICED_TRUE if both UUIDs are the same
+ */
+static wiced_bool_t app_bt_gatt_db_uuid_equal(const wiced_bt_uuid_t *p_a,
+                                              const wiced_bt_uuid_t *p_b)
+{
+    if (p_a->len != p_b->len)
+    {
+        return WICED_FALSE;
+    }
+
+    switch (p_a->len)
+    {
+    case LEN_UUID_16:
+        return (p_a->uu.uuid16 == p_b->uu.uuid16) ? WICED_TRUE : WICED_FALSE;
+    case LEN_UUID_32:
+        return (p_a->uu.uuid32 == p_b->uu.uuid32) ? WICED_TRUE : WICED_FALSE;
+    case LEN_UUID_128:
+        return (0 == memcmp(p_a->uu.uuid128, p_b->uu.uuid128, LEN_UUID_128)) ?
+                WICED_TRUE : WICED_FALSE;
+    default:
+        return WICED_FALSE;
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_uuid_index_get
+ *
+ * Function Description:
+ * @brief  Returns the type index entry for a UUID, collecting its handles
+ *         from the stack database on first use
+ *
+ * @param p_uuid    Attribute type
+ *
+ * @return app_bt_gatt_db_uuid_entry_t  Entry, NULL if the type is not indexed
+ */
+static app_bt_gatt_db_uuid_entry_t *app_bt_gatt_db_uuid_index_get(wiced_bt_uuid_t *p_uuid)
+{
+    app_bt_gatt_db_uuid_entry_t *p_entry;
+    uint16_t handle = 1;
+
+    for (uint16_t i = 0; i < app_bt_gatt_db_uuid_num_types; i++)
+    {
+        if (app_bt_gatt_db_uuid_equal(&app_bt_gatt_db_uuid_index[i].uuid, p_uuid))
+        {
+            return (APP_BT_GATT_DB_UUID_UNINDEXED != app_bt_gatt_db_uuid_index[i].first) ?
+                    &app_bt_gatt_db_uuid_index[i] : NULL;
+        }
+    }
+
+    if (app_bt_gatt_db_uuid_num_types >= APP_BT_GATT_DB_UUID_INDEX_TYPES)
+    {
+        return NULL;
+    }
+
+    p_entry = &app_bt_gatt_db_uuid_index[app_bt_gatt_db_uuid_num_types];
+    p_entry->uuid  = *p_uuid;
+    p_entry->first = app_bt_gatt_db_uuid_num_handles;
+    p_entry->count = 0;
+
+    /* The stack returns matches in handle order, so the list comes out sorted */
+    while ((handle = wiced_bt_gatt_find_handle_by_type(handle, 0xFFFF, p_uuid)) != 0)
+    {
+        if ((p_entry->first + p_entry->count) >= APP_BT_GATT_DB_UUID_INDEX_HANDLES)
+        {
+            /* Out of room; leave this type to the stack from now on */
+            p_entry->first = APP_BT_GATT_DB_UUID_UNINDEXED;
+            p_entry->count = 0;
+            app_bt_gatt_db_uuid_num_types++;
+            return NULL;
+        }
+        app_bt_gatt_db_uuid_handles[p_entry->first + p_entry->count] = handle;
+        p_entry->count++;
+
+        if (0xFFFF == handle)
+        {
+            break;
+        }
+        handle++;
+    }
+
+    app_bt_gatt_db_uuid_num_handles += p_entry->count;
+    app_bt_gatt_db_uuid_num_types++;
+    return p_entry;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_find_handle_by_type
+ *
+ * Function Description:
+ * @brief  Drop-in replacement for wiced_bt_gatt_find_handle_by_type() that
+ *         answers from the type index with a binary search instead of
+ *         scanning the stack database on every call.
+ *
+ * @param s_handle  First handle of the range
+ * @param e_handle  Last handle of the range
+ * @param p_uuid    Attribute type
+ *
+ * @return uint16_t  First matching handle in the range, 0 if none
+ */
+uint16_t app_bt_gatt_db_find_handle_by_type(uint16_t s_handle,
+                                            uint16_t e_handle,
+                                            wiced_bt_uuid_t *p_uuid)
+{
+    app_bt_gatt_db_uuid_entry_t *p_entry = app_bt_gatt_db_uuid_index_get(p_uuid);
+    const uint16_t *p_handles;
+    uint16_t lo = 0;
+    uint16_t hi;
+    uint16_t mid;
+
+    if (NULL == p_entry)
+    {
+        return wiced_bt_gatt_find_handle_by_type(s_handle, e_handle, p_uuid);
+    }
+
+    /* Lower bound of s_handle in the sorted handle list */
+    p_handles = &app_bt_gatt_db_uuid_handles[p_entry->first];
+    hi = p_entry->count;
+    while (lo < hi)
+    {
+        mid = lo + ((hi - lo) / 2);
+        if (p_handles[mid] < s_handle)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    if ((lo < p_entry->count) && (p_handles[lo] <= e_handle))
+    {
+        return p_handles[lo];
+    }
+    return 0;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_find_hooks
+ *
+ * Function Description:
+ * @brief  Find the application hooks registered for a handle
+ *
+ * @param handle    handle to look up
+ *
+ * @return app_bt_gatt_attr_hooks_t   hooks for the handle, NULL if none
+ */
+const app_bt_gatt_attr_hooks_t *app_bt_gatt_db_find_hooks(uint16_t handle)
+{
+    uint8_t slot;
+
+    if (handle > APP_BT_GATT_DB_MAX_HANDLE)
+    {
+        return NULL;
+    }
+
+    slot = app_bt_gatt_db_hook_index[handle];
+    if ((0 != slot) || (app_bt_gatt_db_num_hooks <= UINT8_MAX))
+    {
+        return (0 != slot) ? &app_bt_gatt_db_hooks[slot - 1] : NULL;
+    }
+
+    /* Hook table too large for 8-bit slots */
+    for (uint16_t i = UINT8_MAX; i < app_bt_gatt_db_num_hooks; i++)
+    {
+        if (app_bt_gatt_db_hooks[i].handle == handle)
+        {
+            return &app_bt_gatt_db_hooks[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_get_generation
+ *
+ * Function Description:
+ * @brief  Returns the write generation of an attribute. Anything derived from
+ *         the value (e.g. a cached response) is stale once this changes;
+ *         rewriting an identical value does not change it.
+ *
+ * @param handle    GATT attribute handle
+ *
+ * @return uint32_t  Current generation
+ */
+uint32_t app_bt_gatt_db_get_generation(uint16_t handle)
+{
+    return (handle <= APP_BT_GATT_DB_MAX_HANDLE) ? app_bt_gatt_db_generation[handle] : 0;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_store
+ *
+ * Function Description:
+ * @brief  Stores a value that is known to fit. Only len bytes are copied;
+ *         bytes left over from a longer previous value are zeroed so that
+ *         the table never holds anything past cur_len. Identical rewrites
+ *         leave the generation untouched.
+ *
+ * @param p_attr    Attribute to write
+ * @param p_val     Value to write
+ * @param len       Length of the value
+ *
+ * @return void
+ */
+static void app_bt_gatt_db_store(gatt_db_lookup_table_t *p_attr,
+                                 const uint8_t *p_val,
+                                 uint16_t len)
+{
+    uint16_t handle = p_attr->handle;
+
+    if ((len == p_attr->cur_len) && (0 == memcmp(p_attr->p_data, p_val, len)))
+    {
+        return;
+    }
+
+    memcpy(p_attr->p_data, p_val, len);
+    if (len < p_attr->cur_len)
+    {
+        memset(&p_attr->p_data[len], 0x00, p_attr->cur_len - len);
+    }
+    p_attr->cur_len = len;
+
+    /* Only indexed handles are ever found, see app_bt_gatt_db_find_by_handle() */
+    app_bt_gatt_db_generation[handle]++;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_check_write
+ *
+ * Function Description:
+ * @brief  Checks whether a value can be written to an attribute: the
+ *         attribute must exist, the value must fit and the validate hook
+ *         must accept it. Nothing is stored.
+ *
+ * @param conn_id      Connection ID the write came from
+ * @param handle       GATT attribute handle
+ * @param p_val        Value to write
+ * @param len          Length of the value
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_gatt_db_check_write(uint16_t conn_id,
+                                                  uint16_t handle,
+                                                  uint8_t *p_val,
+                                                  uint16_t len)
+{
+    const app_bt_gatt_attr_hooks_t *p_hooks = app_bt_gatt_db_find_hooks(handle);
+    gatt_db_lookup_table_t *p_attr;
+
+    if ((NULL == p_hooks) || (0 == (p_hooks->flags & APP_BT_GATT_ATTR_FLAG_NO_STORE)))
+    {
+        if ((p_attr = app_bt_gatt_db_find_by_handle(handle)) == NULL)
+        {
+            return WICED_BT_GATT_INVALID_HANDLE;
+        }
+
+        if (p_attr->max_len < len)
+        {
+            /* Value to write will not fit within the table */
+            return WICED_BT_GATT_INVALID_ATTR_LEN;
+        }
+    }
+    else if (NULL == p_hooks->p_on_write)
+    {
+        return WICED_BT_GATT_WRITE_NOT_PERMIT;
+    }
+
+    if ((NULL != p_hooks) && (NULL != p_hooks->p_validate))
+    {
+        return p_hooks->p_validate(conn_id, handle, p_val, len);
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_write
+ *
+ * Function Description:
+ * @brief  Writes an attribute value: runs the checks of
+ *         app_bt_gatt_db_check_write(), stores the value in
+ *         app_gatt_db_ext_attr_tbl and then runs the on-write hook.
+ *
+ * @param conn_id      Connection ID the write came from
+ * @param p_data       Originating ATT request, NULL for local writes
+ * @param handle       GATT attribute handle
+ * @param p_val        Value to write
+ * @param len          Length of the value
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_gatt_db_write(uint16_t conn_id,
+                                            wiced_bt_gatt_event_data_t *p_data,
+                                            uint16_t handle,
+                                            uint8_t *p_val,
+                                            uint16_t len)
+{
+    const app_bt_gatt_attr_hooks_t *p_hooks = app_bt_gatt_db_find_hooks(handle);
+    gatt_db_lookup_table_t *p_attr = NULL;
+    wiced_bt_gatt_status_t status;
+
+    status = app_bt_gatt_db_check_write(conn_id, handle, p_val, len);
+    if (WICED_BT_GATT_SUCCESS != status)
+    {
+        return status;
+    }
+
+    if ((NULL == p_hooks) || (0 == (p_hooks->flags & APP_BT_GATT_ATTR_FLAG_NO_STORE)))
+    {
+        p_attr = app_bt_gatt_db_find_by_handle(handle);
+    }
+
+    if (NULL != p_attr)
+    {
+        /* Value fits within the supplied buffer; copy over the value */
+        app_bt_gatt_db_store(p_attr, p_val, len);
+    }
+
+    if ((NULL != p_hooks) && (NULL != p_hooks->p_on_write))
+    {
+        return p_hooks->p_on_write(conn_id, p_data, handle, p_val, len);
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_db_read
+ *
+ * Function Description:
+ * @brief  Resolves the value to return for a read of the given handle, giving
+ *         the on-read hook a chance to supply or refresh it.
+ *
+ * @param conn_id      Connection ID the read came from
+ * @param handle       GATT attribute handle
+ * @param pp_val       Returns a pointer to the value
+ * @param p_len        Returns the length of the value
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_gatt_db_read(uint16_t conn_id,
+                                           uint16_t handle,
+                                           uint8_t **pp_val,
+                                           uint16_t *p_len)
+{
+    const app_bt_gatt_attr_hooks_t *p_hooks = app_bt_gatt_db_find_hooks(handle);
+    gatt_db_lookup_table_t *p_attr = app_bt_gatt_db_find_by_handle(handle);
+
+    if ((NULL == p_attr) && ((NULL == p_hooks) || (NULL == p_hooks->p_on_read)))
+    {
+        return WICED_BT_GATT_INVALID_HANDLE;
+    }
+
+    *pp_val = (NULL != p_attr) ? p_attr->p_data : NULL;
+    *p_len  = (NULL != p_attr) ? p_attr->cur_len : 0;
+
+    if ((NULL != p_hooks) && (NULL != p_hooks->p_on_read))
+    {
+        return p_hooks->p_on_read(conn_id, handle, pp_val, p_len);
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
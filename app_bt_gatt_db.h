@@ -0,0 +1,159 @@
+/******************************************************************************
+* File Name:   app_bt_gatt_db.h
+*
+* Description: This file is the public interface of the external GATT
+*              attribute table helpers in app_bt_gatt_db.c
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_GATT_DB_H__
+#define __APP_BT_GATT_DB_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "cycfg_gatt_db.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Highest attribute handle covered by the dense handle index, enough
+ *        for a database of 500 attributes. Every handle of
+ *        app_gatt_db_ext_attr_tbl and of the hook table must fit;
+ *        app_bt_gatt_db_index_init() fails otherwise.
+ */
+#ifndef APP_BT_GATT_DB_MAX_HANDLE
+#define APP_BT_GATT_DB_MAX_HANDLE           (0x01FFu)
+#endif
+
+/**
+ * @brief Number of distinct attribute types (UUIDs) kept in the type index
+ *        used for read-by-type requests
+ */
+#ifndef APP_BT_GATT_DB_UUID_INDEX_TYPES
+#define APP_BT_GATT_DB_UUID_INDEX_TYPES     (8u)
+#endif
+
+/**
+ * @brief Total number of handles shared by all type index entries, enough
+ *        for the characteristic declarations of a 500 attribute database.
+ *        Types that do not fit are looked up through the stack instead.
+ */
+#ifndef APP_BT_GATT_DB_UUID_INDEX_HANDLES
+#define APP_BT_GATT_DB_UUID_INDEX_HANDLES   (192u)
+#endif
+
+/**
+ * @brief Attribute hook flag: the value is not kept in app_gatt_db_ext_attr_tbl,
+ *        writes are handed to p_on_write as they arrive (e.g. OTA control point)
+ */
+#define APP_BT_GATT_ATTR_FLAG_NO_STORE      (0x01u)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Checks a value before it is written. Returning anything other than
+ *        WICED_BT_GATT_SUCCESS rejects the write with that status.
+ */
+typedef wiced_bt_gatt_status_t (*app_bt_gatt_validate_cb_t)(uint16_t conn_id,
+                                                            uint16_t handle,
+                                                            uint8_t *p_val,
+                                                            uint16_t len);
+
+/**
+ * @brief Called once a write has been accepted. p_data is the originating ATT
+ *        request, or NULL for writes committed locally (e.g. queued writes).
+ */
+typedef wiced_bt_gatt_status_t (*app_bt_gatt_write_cb_t)(uint16_t conn_id,
+                                                         wiced_bt_gatt_event_data_t *p_data,
+                                                         uint16_t handle,
+                                                         uint8_t *p_val,
+                                                         uint16_t len);
+
+/**
+ * @brief Called on every read. *pp_val and *p_len hold the stored value on
+ *        entry and may be replaced with a value owned by the hook.
+ */
+typedef wiced_bt_gatt_status_t (*app_bt_gatt_read_cb_t)(uint16_t conn_id,
+                                                        uint16_t handle,
+                                                        uint8_t **pp_val,
+                                                        uint16_t *p_len);
+
+/**
+ * @brief Per-attribute hooks. Applications list these in a const table that
+ *        is passed to app_bt_gatt_db_index_init(); any hook may be NULL.
+ */
+typedef struct
+{
+    uint16_t                    handle;
+    uint8_t                     flags;          /* APP_BT_GATT_ATTR_FLAG_xxx */
+    app_bt_gatt_validate_cb_t   p_validate;
+    app_bt_gatt_write_cb_t      p_on_write;
+    app_bt_gatt_read_cb_t       p_on_read;
+} app_bt_gatt_attr_hooks_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_result_t          app_bt_gatt_db_index_init       (const app_bt_gatt_attr_hooks_t *p_hooks,
+                                                         uint16_t num_hooks);
+gatt_db_lookup_table_t *app_bt_gatt_db_find_by_handle   (uint16_t handle);
+uint16_t                app_bt_gatt_db_find_handle_by_type(uint16_t s_handle,
+                                                         uint16_t e_handle,
+                                                         wiced_bt_uuid_t *p_uuid);
+const app_bt_gatt_attr_hooks_t *app_bt_gatt_db_find_hooks(uint16_t handle);
+uint32_t                app_bt_gatt_db_get_generation   (uint16_t handle);
+wiced_bt_gatt_status_t  app_bt_gatt_db_check_write      (uint16_t conn_id,
+                                                         uint16_t handle,
+                                                         uint8_t *p_val,
+                                                         uint16_t len);
+wiced_bt_gatt_status_t  app_bt_gatt_db_write            (uint16_t conn_id,
+                                                         wiced_bt_gatt_event_data_t *p_data,
+                                                         uint16_t handle,
+                                                         uint8_t *p_val,
+                                                         uint16_t len);
+wiced_bt_gatt_status_t  app_bt_gatt_db_read             (uint16_t conn_id,
+                                                         uint16_t handle,
+                                                         uint8_t **pp_val,
+                                                         uint16_t *p_len);
+
+#endif      /*__APP_BT_GATT_DB_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,343 @@
+/******************************************************************************
+* File Name:   app_bt_gatt_prep_write.c
+*
+* Description: This file implements the per-connection prepared write queue.
+*              Fragments are assembled in a preallocated staging arena and
+*              committed to the GATT DB only when the client executes the queue.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_gatt_prep_write.h"
+#include <stddef.h>
+#include <string.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Value being assembled for one attribute
+ */
+typedef struct
+{
+    uint16_t handle;
+    uint16_t arena_offset;  /* Start of the region in the arena */
+    uint16_t max_len;       /* Size of the region */
+    uint16_t len;           /* Bytes assembled so far, always contiguous */
+} app_bt_gatt_prep_write_region_t;
+
+/**
+ * @brief Prepared write queue of one connection
+ */
+typedef struct
+{
+    uint16_t                        conn_id;        /* 0 when the queue is unused */
+    uint16_t                        arena_used;
+    uint8_t                         num_regions;
+    wiced_bt_gatt_status_t          error;          /* First deferred error */
+    uint16_t                        error_handle;
+    app_bt_gatt_prep_write_region_t regions[APP_BT_GATT_PREP_WRITE_MAX_ATTRS];
+    uint8_t                         arena[APP_BT_GATT_PREP_WRITE_ARENA_SIZE];
+} app_bt_gatt_prep_write_queue_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static app_bt_gatt_prep_write_queue_t app_bt_gatt_prep_write_queues[APP_BT_GATT_PREP_WRITE_QUEUES];
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_gatt_prep_write_find_queue
+ *
+ * Function Description:
+ * @brief  Returns the queue of a connection, optionally claiming a free one
+ *
+ * @param conn_id   Connection ID
+ * @param alloc     WICED_TRUE to claim a free queue if the connection has none
+ *
+ * @return app_bt_gatt_prep_write_queue_t  Queue, NULL if none
+ */
+static app_bt_gatt_prep_write_queue_t *app_bt_gatt_prep_write_find_queue(uint16_t conn_id,
+                                                                         wiced_bool_t alloc)
+{
+    app_bt_gatt_prep_write_queue_t *p_free = NULL;
+
+    for (uint16_t i = 0; i < APP_BT_GATT_PREP_WRITE_QUEUES; i++)
+    {
+        if (app_bt_gatt_prep_write_queues[i].conn_id == conn_id)
+        {
+            return &app_bt_gatt_prep_write_queues[i];
+        }
+        if ((NULL == p_free) && (0 == app_bt_gatt_prep_write_queues[i].conn_id))
+        {
+            p_free = &app_bt_gatt_prep_write_queues[i];
+        }
+    }
+
+    if (!alloc || (NULL == p_free))
+    {
+        return NULL;
+    }
+
+    memset(p_free, 0, offsetof(app_bt_gatt_prep_write_queue_t, arena));
+    p_free->conn_id = conn_id;
+    p_free->error = WICED_BT_GATT_SUCCESS;
+    return p_free;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_prep_write_find_region
+ *
+ * Function Description:
+ * @brief  Returns the region assembling a handle, reserving one in the arena
+ *         on the first fragment
+ *
+ * @param p_queue   Queue of the connection
+ * @param handle    GATT attribute handle
+ * @param p_status  Returns the reason when no region is available
+ *
+ * @return app_bt_gatt_prep_write_region_t  Region, NULL on failure
+ */
+static app_bt_gatt_prep_write_region_t *app_bt_gatt_prep_write_find_region(app_bt_gatt_prep_write_queue_t *p_queue,
+                                                                           uint16_t handle,
+                                                                           wiced_bt_gatt_status_t *p_status)
+{
+    app_bt_gatt_prep_write_region_t *p_region;
+    gatt_db_lookup_table_t *p_attr;
+
+    for (uint8_t i = 0; i < p_queue->num_regions; i++)
+    {
+        if (p_queue->regions[i].handle == handle)
+        {
+            return &p_queue->regions[i];
+        }
+    }
+
+    /* Long writes are only supported for plain values of the attribute table.
+     * A hook could act on one value of the queue before another one fails,
+     * so hooked attributes are refused here rather than on execute. */
+    if (NULL != app_bt_gatt_db_find_hooks(handle))
+    {
+        *p_status = WICED_BT_GATT_WRITE_NOT_PERMIT;
+        return NULL;
+    }
+
+    if ((p_attr = app_bt_gatt_db_find_by_handle(handle)) == NULL)
+    {
+        *p_status = WICED_BT_GATT_INVALID_HANDLE;
+        return NULL;
+    }
+
+    if ((p_queue->num_regions >= APP_BT_GATT_PREP_WRITE_MAX_ATTRS) ||
+        (p_attr->max_len > (APP_BT_GATT_PREP_WRITE_ARENA_SIZE - p_queue->arena_used)))
+    {
+        *p_status = WICED_BT_GATT_PREPARE_Q_FULL;
+        return NULL;
+    }
+
+    p_region = &p_queue->regions[p_queue->num_regions++];
+    p_region->handle       = handle;
+    p_region->arena_offset = p_queue->arena_used;
+    p_region->max_len      = p_attr->max_len;
+    p_region->len          = 0;
+    p_queue->arena_used   += p_attr->max_len;
+    return p_region;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_prep_write_queue
+ *
+ * Function Description:
+ * @brief  Handles a Prepare Write Request. The fragment is copied into the
+ *         region of its attribute. Offset and length errors are kept and
+ *         reported on execute, as required by the ATT protocol.
+ *
+ * @param conn_id       Connection ID
+ * @param p_write_req   Prepare write request (handle, offset, value)
+ * @param pp_echo       Returns the value to echo in the Prepare Write Response
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_gatt_prep_write_queue(uint16_t conn_id,
+                                                    wiced_bt_gatt_write_req_t *p_write_req,
+                                                    uint8_t **pp_echo)
+{
+    app_bt_gatt_prep_write_queue_t *p_queue;
+    app_bt_gatt_prep_write_region_t *p_region;
+    wiced_bt_gatt_status_t status = WICED_BT_GATT_SUCCESS;
+    wiced_bt_gatt_status_t error = WICED_BT_GATT_SUCCESS;
+
+    *pp_echo = p_write_req->p_val;
+
+    if ((p_queue = app_bt_gatt_prep_write_find_queue(conn_id, WICED_TRUE)) == NULL)
+    {
+        return WICED_BT_GATT_PREPARE_Q_FULL;
+    }
+
+    if ((p_region = app_bt_gatt_prep_write_find_region(p_queue, p_write_req->handle, &status)) == NULL)
+    {
+        if (0 == p_queue->num_regions)
+        {
+            p_queue->conn_id = 0;
+        }
+        return status;
+    }
+
+    if (p_write_req->offset > p_region->len)
+    {
+        /* A gap would leave part of the value undefined */
+        error = WICED_BT_GATT_INVALID_OFFSET;
+    }
+    else if (p_write_req->val_len > (p_region->max_len - p_write_req->offset))
+    {
+        error = WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+
+    if (WICED_BT_GATT_SUCCESS != error)
+    {
+        if (WICED_BT_GATT_SUCCESS == p_queue->error)
+        {
+            p_queue->error = error;
+            p_queue->error_handle = p_write_req->handle;
+        }
+        return WICED_BT_GATT_SUCCESS;
+    }
+
+    *pp_echo = &p_queue->arena[p_region->arena_offset + p_write_req->offset];
+    memcpy(*pp_echo, p_write_req->p_val, p_write_req->val_len);
+
+    if ((p_write_req->offset + p_write_req->val_len) > p_region->len)
+    {
+        p_region->len = p_write_req->offset + p_write_req->val_len;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_prep_write_execute
+ *
+ * Function Description:
+ * @brief  Handles an Execute Write Request. On execute, every assembled value
+ *         is checked first and only then committed, so a queue that fails
+ *         leaves the GATT DB untouched. Hooked attributes never get into the
+ *         queue, so a commit only stores a value that has been checked to
+ *         fit and cannot fail half way. The queue is emptied either way.
+ *
+ * @param conn_id           Connection ID
+ * @param exec_flag         GATT_PREP_WRITE_EXEC or GATT_PREP_WRITE_CANCEL
+ * @param p_commit          Writes one value (the application's set_value)
+ * @param p_error_handle    Returns the handle to report on failure
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_gatt_prep_write_execute(uint16_t conn_id,
+                                                      wiced_bt_gatt_exec_flag_t exec_flag,
+                                                      app_bt_gatt_write_cb_t p_commit,
+                                                      uint16_t *p_error_handle)
+{
+    app_bt_gatt_prep_write_queue_t *p_queue = app_bt_gatt_prep_write_find_queue(conn_id, WICED_FALSE);
+    app_bt_gatt_prep_write_region_t *p_region;
+    wiced_bt_gatt_status_t status = WICED_BT_GATT_SUCCESS;
+    uint8_t i;
+
+    *p_error_handle = 0;
+
+    if ((NULL == p_queue) || (GATT_PREP_WRITE_EXEC != exec_flag))
+    {
+        app_bt_gatt_prep_write_clear(conn_id);
+        return WICED_BT_GATT_SUCCESS;
+    }
+
+    if (WICED_BT_GATT_SUCCESS != p_queue->error)
+    {
+        status = p_queue->error;
+        *p_error_handle = p_queue->error_handle;
+    }
+
+    for (i = 0; (WICED_BT_GATT_SUCCESS == status) && (i < p_queue->num_regions); i++)
+    {
+        p_region = &p_queue->regions[i];
+        status = app_bt_gatt_db_check_write(conn_id, p_region->handle,
+                                            &p_queue->arena[p_region->arena_offset],
+                                            p_region->len);
+        *p_error_handle = p_region->handle;
+    }
+
+    for (i = 0; (WICED_BT_GATT_SUCCESS == status) && (i < p_queue->num_regions); i++)
+    {
+        p_region = &p_queue->regions[i];
+        status = p_commit(conn_id, NULL, p_region->handle,
+                          &p_queue->arena[p_region->arena_offset], p_region->len);
+        *p_error_handle = p_region->handle;
+    }
+
+    app_bt_gatt_prep_write_clear(conn_id);
+    return status;
+}
+
+/**
+ * Function Name:
+ * app_bt_gatt_prep_write_clear
+ *
+ * Function Description:
+ * @brief  Drops any prepared writes of a connection, e.g. on disconnection
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_gatt_prep_write_clear(uint16_t conn_id)
+{
+    app_bt_gatt_prep_write_queue_t *p_queue = app_bt_gatt_prep_write_find_queue(conn_id, WICED_FALSE);
+
+    if (NULL != p_queue)
+    {
+        p_queue->conn_id = 0;
+        p_queue->num_regions = 0;
+        p_queue->arena_used = 0;
+    }
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,92 @@
+/******************************************************************************
+* File Name:   app_bt_gatt_prep_write.h
+*
+* Description: This file contains the interface of the prepared write queue used
+*              for long and reliable writes.
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_GATT_PREP_WRITE_H__
+#define __APP_BT_GATT_PREP_WRITE_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "app_bt_gatt_db.h"
+#include "app_bt_conn.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Number of connections that can have prepared writes queued at once
+ */
+#ifndef APP_BT_GATT_PREP_WRITE_QUEUES
+#define APP_BT_GATT_PREP_WRITE_QUEUES       APP_BT_MAX_CONNECTIONS
+#endif
+
+/**
+ * @brief Staging arena per connection. Each attribute in the queue takes its
+ *        max_len bytes from the arena.
+ */
+#ifndef APP_BT_GATT_PREP_WRITE_ARENA_SIZE
+#define APP_BT_GATT_PREP_WRITE_ARENA_SIZE   (512u)
+#endif
+
+/**
+ * @brief Number of distinct attributes per queue
+ */
+#ifndef APP_BT_GATT_PREP_WRITE_MAX_ATTRS
+#define APP_BT_GATT_PREP_WRITE_MAX_ATTRS    (4u)
+#endif
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_bt_gatt_status_t app_bt_gatt_prep_write_queue     (uint16_t conn_id,
+                                                         wiced_bt_gatt_write_req_t *p_write_req,
+                                                         uint8_t **pp_echo);
+wiced_bt_gatt_status_t app_bt_gatt_prep_write_execute   (uint16_t conn_id,
+                                                         wiced_bt_gatt_exec_flag_t exec_flag,
+                                                         app_bt_gatt_write_cb_t p_commit,
+                                                         uint16_t *p_error_handle);
+void                   app_bt_gatt_prep_write_clear     (uint16_t conn_id);
+
+#endif      /*__APP_BT_GATT_PREP_WRITE_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,543 @@
+/******************************************************************************
+* File Name:   app_bt_heap.c
+*
+* Description: This file implements the accounted heap. malloc and pvPortMalloc
+*                           both land here, so every allocation is attributed to a subsystem
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_heap.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+#if defined(APP_BT_HEAP_WRAP_MALLOC) && APP_BT_HEAP_WRAP_MALLOC
+#include <malloc.h>
+#include <reent.h>
+#endif
+
+/******************************************************************************
+ *                                Macros
+ ******************************************************************************/
+#if defined(APP_BT_HEAP_WRAP_MALLOC) && APP_BT_HEAP_WRAP_MALLOC
+/* Linked with --wrap=_malloc_r,--wrap=_free_r,--wrap=_calloc_r,
+ * --wrap=_realloc_r,--wrap=_memalign_r. malloc(), free() and the C library
+ * itself (strdup, stdio buffers) all go through these reentrant entry
+ * points, so every block of the heap is allocated here and has a header */
+extern void *__real__malloc_r(struct _reent *p_reent, size_t size);
+extern void  __real__free_r(struct _reent *p_reent, void *p);
+#define APP_BT_HEAP_SYS_MALLOC(size)        __real__malloc_r(_REENT, (size))
+#define APP_BT_HEAP_SYS_FREE(p)             __real__free_r(_REENT, (p))
+#else
+/* Only app_bt_heap_alloc() blocks reach app_bt_heap_free() */
+#define APP_BT_HEAP_SYS_MALLOC(size)        malloc(size)
+#define APP_BT_HEAP_SYS_FREE(p)             free(p)
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Prepended to every allocation, 8 bytes to keep the alignment
+ */
+typedef struct
+{
+    uint32_t size;
+    uint32_t tag;               /* app_bt_heap_tag_t */
+} app_bt_heap_hdr_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static atomic_uint app_bt_heap_current[APP_BT_HEAP_NUM_TAGS];
+static atomic_uint app_bt_heap_peak[APP_BT_HEAP_NUM_TAGS];
+static atomic_uint app_bt_heap_allocs[APP_BT_HEAP_NUM_TAGS];
+static atomic_uint app_bt_heap_failures[APP_BT_HEAP_NUM_TAGS];
+static atomic_uint app_bt_heap_total;
+static atomic_uint app_bt_heap_total_peak;
+
+static const char *const app_bt_heap_tag_names[APP_BT_HEAP_NUM_TAGS] =
+{
+    "app", "rtos", "bt stack", "gatt rsp", "ota"
+};
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_heap_raise_peak
+ *
+ * Function Description:
+ * @brief  Raises a peak counter to the given value if it is below it
+ *
+ * @param p_peak    Peak counter
+ * @param value     Current value
+ *
+ * @return void
+ */
+static void app_bt_heap_raise_peak(atomic_uint *p_peak, unsigned int value)
+{
+    unsigned int peak = atomic_load_explicit(p_peak, memory_order_relaxed);
+
+    while ((value > peak) &&
+           !atomic_compare_exchange_weak_explicit(p_peak, &peak, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_account
+ *
+ * Function Description:
+ * @brief  Adds an allocation to, or removes it from, the counters
+ *
+ * @param tag       Tag of the allocation
+ * @param size      Bytes requested
+ * @param add       true when allocated, false when freed
+ *
+ * @return void
+ */
+static void app_bt_heap_account(app_bt_heap_tag_t tag, uint32_t size, bool add)
+{
+    if (add)
+    {
+        atomic_fetch_add_explicit(&app_bt_heap_allocs[tag], 1u, memory_order_relaxed);
+        app_bt_heap_raise_peak(&app_bt_heap_peak[tag],
+                               atomic_fetch_add_explicit(&app_bt_heap_current[tag], size,
+                                                         memory_order_relaxed) + size);
+        app_bt_heap_raise_peak(&app_bt_heap_total_peak,
+                               atomic_fetch_add_explicit(&app_bt_heap_total, size,
+                                                         memory_order_relaxed) + size);
+    }
+    else
+    {
+        atomic_fetch_sub_explicit(&app_bt_heap_current[tag], size, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&app_bt_heap_total, size, memory_order_relaxed);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_task_tag
+ *
+ * Function Description:
+ * @brief  Tag of the calling task, APP_BT_HEAP_TAG_APP before the scheduler
+ *         runs or when the task was never tagged
+ *
+ * @return app_bt_heap_tag_t
+ */
+static app_bt_heap_tag_t app_bt_heap_task_tag(void)
+{
+    uintptr_t value;
+
+    if (taskSCHEDULER_NOT_STARTED == xTaskGetSchedulerState())
+    {
+        return APP_BT_HEAP_TAG_APP;
+    }
+    value = (uintptr_t)pvTaskGetThreadLocalStoragePointer(NULL, APP_BT_HEAP_TLS_INDEX);
+    return ((0 != value) && (value <= APP_BT_HEAP_NUM_TAGS)) ? (app_bt_heap_tag_t)(value - 1u) :
+                                                               APP_BT_HEAP_TAG_APP;
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_alloc
+ *
+ * Function Description:
+ * @brief  Allocates from the C library heap and accounts the block to a tag
+ *
+ * @param tag       Subsystem to account the block to
+ * @param size      Bytes requested
+ *
+ * @return void*    Block, NULL if the heap is exhausted
+ */
+void *app_bt_heap_alloc(app_bt_heap_tag_t tag, size_t size)
+{
+    app_bt_heap_hdr_t *p_hdr = NULL;
+
+    if (size <= (UINT32_MAX - sizeof(*p_hdr)))
+    {
+        p_hdr = (app_bt_heap_hdr_t *)APP_BT_HEAP_SYS_MALLOC(size + sizeof(*p_hdr));
+    }
+    if (NULL == p_hdr)
+    {
+        atomic_fetch_add_explicit(&app_bt_heap_failures[tag], 1u, memory_order_relaxed);
+        return NULL;
+    }
+
+    p_hdr->size = (uint32_t)size;
+    p_hdr->tag  = (uint32_t)tag;
+    app_bt_heap_account(tag, p_hdr->size, true);
+    return p_hdr + 1;
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_free
+ *
+ * Function Description:
+ * @brief  Frees a block and removes it from its tag
+ *
+ * @param p         Block of app_bt_heap_alloc(), may be NULL
+ *
+ * @return void
+ */
+void app_bt_heap_free(void *p)
+{
+    app_bt_heap_hdr_t *p_hdr;
+
+    if (NULL == p)
+    {
+        return;
+    }
+
+    p_hdr = (app_bt_heap_hdr_t *)p - 1;
+    app_bt_heap_account((app_bt_heap_tag_t)p_hdr->tag, p_hdr->size, false);
+    APP_BT_HEAP_SYS_FREE(p_hdr);
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_set_task_tag
+ *
+ * Function Description:
+ * @brief  Accounts the following malloc calls of the calling task to a tag.
+ *         Returns the previous tag so that a section can be scoped:
+ *         prev = app_bt_heap_set_task_tag(x); ...; app_bt_heap_set_task_tag(prev);
+ *
+ * @param tag       New tag
+ *
+ * @return app_bt_heap_tag_t    Previous tag
+ */
+app_bt_heap_tag_t app_bt_heap_set_task_tag(app_bt_heap_tag_t tag)
+{
+    app_bt_heap_tag_t prev = app_bt_heap_task_tag();
+
+    if (taskSCHEDULER_NOT_STARTED != xTaskGetSchedulerState())
+    {
+        vTaskSetThreadLocalStoragePointer(NULL, APP_BT_HEAP_TLS_INDEX,
+                                          (void *)((uintptr_t)tag + 1u));
+    }
+    return prev;
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_get_stats
+ *
+ * Function Description:
+ * @brief  Snapshot of the per tag counters and, with newlib, of the C
+ *         library arena
+ *
+ * @param p_stats   Filled with the report
+ *
+ * @return void
+ */
+void app_bt_heap_get_stats(app_bt_heap_stats_t *p_stats)
+{
+#if defined(APP_BT_HEAP_WRAP_MALLOC) && APP_BT_HEAP_WRAP_MALLOC
+    struct mallinfo info = mallinfo();
+#endif
+    uint8_t         i;
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    for (i = 0; i < APP_BT_HEAP_NUM_TAGS; i++)
+    {
+        p_stats->tag[i].current  = atomic_load_explicit(&app_bt_heap_current[i], memory_order_relaxed);
+        p_stats->tag[i].peak     = atomic_load_explicit(&app_bt_heap_peak[i], memory_order_relaxed);
+        p_stats->tag[i].allocs   = atomic_load_explicit(&app_bt_heap_allocs[i], memory_order_relaxed);
+        p_stats->tag[i].failures = atomic_load_explicit(&app_bt_heap_failures[i], memory_order_relaxed);
+    }
+    p_stats->current = atomic_load_explicit(&app_bt_heap_total, memory_order_relaxed);
+    p_stats->peak    = atomic_load_explicit(&app_bt_heap_total_peak, memory_order_relaxed);
+#if defined(APP_BT_HEAP_WRAP_MALLOC) && APP_BT_HEAP_WRAP_MALLOC
+    /* The only fields newlib-nano fills */
+    p_stats->arena      = (uint32_t)info.arena;
+    p_stats->arena_used = (uint32_t)info.uordblks;
+    p_stats->free_list  = (uint32_t)info.fordblks;
+#endif
+}
+
+/**
+ * Function Name:
+ * app_bt_heap_print_stats
+ *
+ * Function Description:
+ * @brief  Prints the heap report
+ *
+ * @return void
+ */
+void app_bt_heap_print_stats(void)
+{
+    app_bt_heap_stats_t stats;
+    uint8_t             i;
+
+    app_bt_heap_get_stats(&stats);
+
+    printf("Heap: current %lu peak %lu\r\n",
+           (unsigned long)stats.current, (unsigned long)stats.peak);
+    if (0 != stats.arena)
+    {
+        printf("  arena %lu, %lu in use, %lu free-list bytes\r\n",
+               (unsigned long)stats.arena, (unsigned long)stats.arena_used,
+               (unsigned long)stats.free_list);
+    }
+    for (i = 0; i < APP_BT_HEAP_NUM_TAGS; i++)
+    {
+        printf("  %-8s current %6lu peak %6lu allocs %8lu failures %lu\r\n",
+               app_bt_heap_tag_names[i],
+               (unsigned long)stats.tag[i].current, (unsigned long)stats.tag[i].peak,
+               (unsigned long)stats.tag[i].allocs, (unsigned long)stats.tag[i].failures);
+    }
+}
+
+/**
+ * Function Name:
+ * pvPortMalloc
+ *
+ * Function Description:
+ * @brief  FreeRTOS allocator, replacing heap_3 (configHEAP_ALLOCATION_SCHEME
+ *         is NO_HEAP_ALLOCATION). Same behaviour, plus the accounting.
+ *
+ * @param xWantedSize   Bytes requested
+ *
+ * @return void*        Block, NULL if the heap is exhausted
+ */
+void *pvPortMalloc(size_t xWantedSize)
+{
+    void *pvReturn;
+
+    vTaskSuspendAll();
+    {
+        pvReturn = app_bt_heap_alloc(APP_BT_HEAP_TAG_RTOS, xWantedSize);
+        traceMALLOC(pvReturn, xWantedSize);
+    }
+    (void)xTaskResumeAll();
+
+#if (configUSE_MALLOC_FAILED_HOOK == 1)
+    if (NULL == pvReturn)
+    {
+        extern void vApplicationMallocFailedHook(void);
+        vApplicationMallocFailedHook();
+    }
+#endif
+
+    return pvReturn;
+}
+
+/**
+ * Function Name:
+ * vPortFree
+ *
+ * Function Description:
+ * @brief  FreeRTOS free, replacing heap_3
+ *
+ * @param pv    Block, may be NULL
+ *
+ * @return void
+ */
+void vPortFree(void *pv)
+{
+    if (NULL != pv)
+    {
+        vTaskSuspendAll();
+        {
+            app_bt_heap_free(pv);
+            traceFREE(pv, 0);
+        }
+        (void)xTaskResumeAll();
+    }
+}
+
+#if defined(APP_BT_HEAP_WRAP_MALLOC) && APP_BT_HEAP_WRAP_MALLOC
+/**
+ * Function Name:
+ * __wrap__malloc_r
+ *
+ * Function Description:
+ * @brief  malloc of the application and of the linked libraries, accounted
+ *         to the tag of the calling task
+ *
+ * @param p_reent   Reentrancy structure of the caller
+ * @param size      Bytes requested
+ *
+ * @return void*    Block, NULL if the heap is exhausted
+ */
+void *__wrap__malloc_r(struct _reent *p_reent, size_t size)
+{
+    (void)p_reent;
+    return app_bt_heap_alloc(app_bt_heap_task_tag(), size);
+}
+
+/**
+ * Function Name:
+ * __wrap__free_r
+ *
+ * Function Description:
+ * @brief  free of the application and of the linked libraries
+ *
+ * @param p_reent   Reentrancy structure of the caller
+ * @param p         Block, may be NULL
+ *
+ * @return void
+ */
+void __wrap__free_r(struct _reent *p_reent, void *p)
+{
+    (void)p_reent;
+    app_bt_heap_free(p);
+}
+
+/**
+ * Function Name:
+ * __wrap__calloc_r
+ *
+ * Function Description:
+ * @brief  calloc of the application and of the linked libraries
+ *
+ * @param p_reent   Reentrancy structure of the caller
+ * @param num       Number of elements
+ * @param size      Size of each element
+ *
+ * @return void*    Zeroed block, NULL if the heap is exhausted
+ */
+void *__wrap__calloc_r(struct _reent *p_reent, size_t num, size_t size)
+{
+    void *p = NULL;
+
+    (void)p_reent;
+    if ((0 == size) || (num <= (SIZE_MAX / size)))
+    {
+        p = app_bt_heap_alloc(app_bt_heap_task_tag(), num * size);
+    }
+    if (NULL != p)
+    {
+        memset(p, 0, num * size);
+    }
+    return p;
+}
+
+/**
+ * Function Name:
+ * __wrap__realloc_r
+ *
+ * Function Description:
+ * @brief  realloc of the application and of the linked libraries. The block
+ *         keeps the tag it was allocated with. It is moved with a new
+ *         allocation and a copy, as newlib-nano does, rather than with the
+ *         library realloc, which would allocate and free through the wrapped
+ *         entry points itself.
+ *
+ * @param p_reent   Reentrancy structure of the caller
+ * @param p         Block, may be NULL
+ * @param size      New size
+ *
+ * @return void*    Resized block, NULL if the heap is exhausted
+ */
+void *__wrap__realloc_r(struct _reent *p_reent, void *p, size_t size)
+{
+    app_bt_heap_hdr_t *p_hdr;
+    void              *p_new;
+
+    (void)p_reent;
+    if (NULL == p)
+    {
+        return app_bt_heap_alloc(app_bt_heap_task_tag(), size);
+    }
+    if (0 == size)
+    {
+        app_bt_heap_free(p);
+        return NULL;
+    }
+
+    p_hdr = (app_bt_heap_hdr_t *)p - 1;
+    if (size <= p_hdr->size)
+    {
+        /* Shrinking in place keeps the accounting exact */
+        app_bt_heap_account((app_bt_heap_tag_t)p_hdr->tag, p_hdr->size, false);
+        p_hdr->size = (uint32_t)size;
+        app_bt_heap_account((app_bt_heap_tag_t)p_hdr->tag, p_hdr->size, true);
+        return p;
+    }
+
+    p_new = app_bt_heap_alloc((app_bt_heap_tag_t)p_hdr->tag, size);
+    if (NULL != p_new)
+    {
+        memcpy(p_new, p, p_hdr->size);
+        app_bt_heap_free(p);
+    }
+    return p_new;
+}
+
+/**
+ * Function Name:
+ * __wrap__memalign_r
+ *
+ * Function Description:
+ * @brief  memalign of the application and of the linked libraries. Blocks
+ *         are 8 byte aligned; a stricter alignment would put the header
+ *         where app_bt_heap_free() does not look, so it fails instead.
+ *
+ * @param p_reent   Reentrancy structure of the caller
+ * @param align     Alignment requested
+ * @param size      Bytes requested
+ *
+ * @return void*    Block, NULL if the heap is exhausted or align exceeds 8
+ */
+void *__wrap__memalign_r(struct _reent *p_reent, size_t align, size_t size)
+{
+    (void)p_reent;
+    if (align > sizeof(app_bt_heap_hdr_t))
+    {
+        atomic_fetch_add_explicit(&app_bt_heap_failures[app_bt_heap_task_tag()], 1u, memory_order_relaxed);
+        return NULL;
+    }
+    return app_bt_heap_alloc(app_bt_heap_task_tag(), size);
+}
+#endif /* APP_BT_HEAP_WRAP_MALLOC */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,116 @@
+/******************************************************************************
+* File Name:   app_bt_heap.h
+*
+* Description: This file contains the declarations of the accounted heap shared
+*                           by the C library and FreeRTOS
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_HEAP_H__
+#define __APP_BT_HEAP_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Thread local storage slot holding the tag of each task
+ */
+#ifndef APP_BT_HEAP_TLS_INDEX
+#define APP_BT_HEAP_TLS_INDEX               (configNUM_THREAD_LOCAL_STORAGE_POINTERS - 1)
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Subsystems the heap usage is accounted to
+ */
+typedef enum
+{
+    APP_BT_HEAP_TAG_APP,        /* Default for untagged tasks */
+    APP_BT_HEAP_TAG_RTOS,       /* pvPortMalloc: task stacks, queues, timers */
+    APP_BT_HEAP_TAG_BT_STACK,
+    APP_BT_HEAP_TAG_GATT_RSP,
+    APP_BT_HEAP_TAG_OTA,
+    APP_BT_HEAP_NUM_TAGS
+} app_bt_heap_tag_t;
+
+/**
+ * @brief Usage of one tag, in bytes requested
+ */
+typedef struct
+{
+    uint32_t current;
+    uint32_t peak;
+    uint32_t allocs;
+    uint32_t failures;
+} app_bt_heap_tag_stats_t;
+
+/**
+ * @brief Heap report. The arena figures come from mallinfo() of newlib-nano
+ *        (GCC_ARM, --specs=nano.specs), which fills arena, uordblks and
+ *        fordblks only. They are 0 in builds without APP_BT_HEAP_WRAP_MALLOC,
+ *        the ARM and IAR libraries have no mallinfo().
+ */
+typedef struct
+{
+    app_bt_heap_tag_stats_t tag[APP_BT_HEAP_NUM_TAGS];
+    uint32_t current;           /* All tags */
+    uint32_t peak;              /* All tags */
+    uint32_t arena;             /* Bytes taken from the system by the C library */
+    uint32_t arena_used;        /* Bytes in allocated blocks, headers included */
+    uint32_t free_list;         /* Bytes in freed blocks kept on the free list */
+} app_bt_heap_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void             *app_bt_heap_alloc        (app_bt_heap_tag_t tag, size_t size);
+void              app_bt_heap_free         (void *p);
+app_bt_heap_tag_t app_bt_heap_set_task_tag (app_bt_heap_tag_t tag);
+void              app_bt_heap_get_stats    (app_bt_heap_stats_t *p_stats);
+void              app_bt_heap_print_stats  (void);
+
+#endif      /*__APP_BT_HEAP_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,908 @@
+/******************************************************************************
+* File Name:   app_bt_history.c
+*
+* Description: This file implements a delta encoded battery level history ring and
+*                           streams it in notifications paced by transmitted buffers
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_history.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/*******************************************************************************
+*        Constants
+*******************************************************************************/
+#define APP_BT_HISTORY_CODES        (APP_BT_HISTORY_BLOCK_LEN - 8u)
+#define APP_BT_HISTORY_NO_RUN       (0xFFu)
+
+/*******************************************************************************
+*        Types
+*******************************************************************************/
+/* Decodable on its own, so dropping the oldest block loses nothing else */
+typedef struct
+{
+    uint32_t first_seq;                         /* Sample number of level */
+    uint16_t count;                             /* Samples in the block */
+    uint8_t  level;                             /* First sample */
+    uint8_t  used;                              /* Bytes of codes */
+    uint8_t  codes[APP_BT_HISTORY_CODES];
+} app_bt_history_block_t;
+
+/* Position on one sample of the ring */
+typedef struct
+{
+    uint8_t  pos;                               /* Block, counted from the oldest */
+    uint8_t  off;                               /* Next code in the block */
+    uint8_t  run;                               /* Samples left of the current run */
+    uint8_t  level;
+    uint32_t seq;
+} app_bt_history_iter_t;
+
+/* Download in progress, owned by the BT stack task */
+typedef struct
+{
+    uint16_t conn_id;                           /* 0 when idle */
+    bool     congested;
+    uint32_t next_seq;
+    uint32_t last_seq;
+    uint8_t *in_flight[APP_BT_HISTORY_MAX_IN_FLIGHT];
+} app_bt_history_stream_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* Written by the BAS task, read by the BT stack task, both with the
+ * scheduler suspended */
+static app_bt_history_block_t  app_bt_history_blocks[APP_BT_HISTORY_BLOCKS];
+static uint8_t                 app_bt_history_head;
+static uint8_t                 app_bt_history_num;
+static uint8_t                 app_bt_history_last_level;
+static uint8_t                 app_bt_history_run_off = APP_BT_HISTORY_NO_RUN;
+static app_bt_history_stats_t  app_bt_history_stats;
+
+/* Uptime, kept across tick counter wraps */
+static TickType_t              app_bt_history_tick;
+static uint32_t                app_bt_history_ms;
+static uint32_t                app_bt_history_uptime_s;
+
+static app_bt_history_stream_t app_bt_history_stream;
+static uint8_t                 app_bt_history_pdus[APP_BT_HISTORY_MAX_IN_FLIGHT][APP_BT_HISTORY_PDU_LEN];
+static uint16_t                app_bt_history_value_handle;
+static uint16_t                app_bt_history_cccd_handle;
+
+/* Characteristic value, built on each read */
+static uint8_t                 app_bt_history_info[APP_BT_HISTORY_INFO_LEN];
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_history_put_u32
+ *
+ * Function Description:
+ * @brief  Stores a little endian uint32
+ *
+ * @param p_buf     Destination
+ * @param value     Value
+ *
+ * @return void
+ */
+static void app_bt_history_put_u32(uint8_t *p_buf, uint32_t value)
+{
+    p_buf[0] = (uint8_t)(value & 0xFF);
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+    p_buf[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * Function Name:
+ * app_bt_history_get_u32
+ *
+ * Function Description:
+ * @brief  Loads a little endian uint32
+ *
+ * @param p_buf     Source
+ *
+ * @return uint32_t  Value
+ */
+static uint32_t app_bt_history_get_u32(const uint8_t *p_buf)
+{
+    return (uint32_t)p_buf[0] | ((uint32_t)p_buf[1] << 8) |
+           ((uint32_t)p_buf[2] << 16) | ((uint32_t)p_buf[3] << 24);
+}
+
+/**
+ * Function Name:
+ * app_bt_history_block
+ *
+ * Function Description:
+ * @brief  Block at a position counted from the oldest
+ *
+ * @param pos       Position, below app_bt_history_num
+ *
+ * @return app_bt_history_block_t*  Block
+ */
+static app_bt_history_block_t *app_bt_history_block(uint8_t pos)
+{
+    return &app_bt_history_blocks[(app_bt_history_head + pos) % APP_BT_HISTORY_BLOCKS];
+}
+
+/**
+ * Function Name:
+ * app_bt_history_uptime
+ *
+ * Function Description:
+ * @brief  Advances and returns the uptime in seconds. Call with the
+ *         scheduler suspended.
+ *
+ * @return uint32_t  Seconds since the scheduler started
+ */
+static uint32_t app_bt_history_uptime(void)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    app_bt_history_ms       += (uint32_t)(now - app_bt_history_tick) * portTICK_PERIOD_MS;
+    app_bt_history_tick      = now;
+    app_bt_history_uptime_s += app_bt_history_ms / 1000u;
+    app_bt_history_ms       %= 1000u;
+    return app_bt_history_uptime_s;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_newest
+ *
+ * Function Description:
+ * @brief  Sample number of the newest sample. The ring must not be empty.
+ *
+ * @return uint32_t  Sample number
+ */
+static uint32_t app_bt_history_newest(void)
+{
+    app_bt_history_block_t *p_block = app_bt_history_block(app_bt_history_num - 1u);
+
+    return p_block->first_seq + p_block->count - 1u;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_append
+ *
+ * Function Description:
+ * @brief  Adds the code for the sample following the newest one to the
+ *         newest block, extending a run where the level is unchanged
+ *
+ * @param level     Level of the sample
+ *
+ * @return bool  false if the block has no room left
+ */
+static bool app_bt_history_append(uint8_t level)
+{
+    app_bt_history_block_t *p_block = app_bt_history_block(app_bt_history_num - 1u);
+    int32_t                 delta   = (int32_t)level - app_bt_history_last_level;
+
+    if ((0 == delta) && (APP_BT_HISTORY_NO_RUN != app_bt_history_run_off) &&
+        (p_block->codes[app_bt_history_run_off] < APP_BT_HISTORY_CODE_RUN_MAX))
+    {
+        p_block->codes[app_bt_history_run_off]++;
+    }
+    else if ((delta >= -32) && (delta <= 31))
+    {
+        if (p_block->used >= APP_BT_HISTORY_CODES)
+        {
+            return false;
+        }
+        app_bt_history_run_off = (0 == delta) ? p_block->used : APP_BT_HISTORY_NO_RUN;
+        p_block->codes[p_block->used++] = (0 == delta) ? 0u :
+                                          (uint8_t)(APP_BT_HISTORY_CODE_DELTA | ((uint32_t)delta & 0x3Fu));
+    }
+    else
+    {
+        if (p_block->used + 2u > APP_BT_HISTORY_CODES)
+        {
+            return false;
+        }
+        app_bt_history_run_off = APP_BT_HISTORY_NO_RUN;
+        p_block->codes[p_block->used++] = APP_BT_HISTORY_CODE_ABS;
+        p_block->codes[p_block->used++] = level;
+    }
+    p_block->count++;
+    return true;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_add
+ *
+ * Function Description:
+ * @brief  Records the battery level once per APP_BT_HISTORY_PERIOD_S. Call
+ *         on every update, calls within the current period are ignored. A
+ *         period missed altogether starts a new block, leaving a gap in the
+ *         sample numbers.
+ *
+ * @param level     Battery level in percent
+ *
+ * @return void
+ */
+void app_bt_history_add(uint8_t level)
+{
+    app_bt_history_block_t *p_block;
+    uint32_t                seq;
+
+    vTaskSuspendAll();
+    seq = app_bt_history_uptime() / APP_BT_HISTORY_PERIOD_S;
+    if ((0 != app_bt_history_num) && (seq <= app_bt_history_newest()))
+    {
+        (void)xTaskResumeAll();
+        return;
+    }
+
+    if ((0 == app_bt_history_num) || (seq != app_bt_history_newest() + 1u) ||
+        !app_bt_history_append(level))
+    {
+        if (APP_BT_HISTORY_BLOCKS == app_bt_history_num)
+        {
+            app_bt_history_head = (uint8_t)((app_bt_history_head + 1u) % APP_BT_HISTORY_BLOCKS);
+            app_bt_history_num--;
+            app_bt_history_stats.evicted++;
+        }
+        p_block = app_bt_history_block(app_bt_history_num++);
+        p_block->first_seq     = seq;
+        p_block->count         = 1;
+        p_block->level         = level;
+        p_block->used          = 0;
+        app_bt_history_run_off = APP_BT_HISTORY_NO_RUN;
+    }
+    app_bt_history_last_level = level;
+    app_bt_history_stats.samples++;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_history_iter_next
+ *
+ * Function Description:
+ * @brief  Moves to the next sample of the ring. Call with the scheduler
+ *         suspended.
+ *
+ * @param p_it      Position
+ *
+ * @return bool  false past the newest sample
+ */
+static bool app_bt_history_iter_next(app_bt_history_iter_t *p_it)
+{
+    app_bt_history_block_t *p_block = app_bt_history_block(p_it->pos);
+    uint8_t                 code;
+
+    if (0 != p_it->run)
+    {
+        p_it->run--;
+        p_it->seq++;
+        return true;
+    }
+    if (p_it->seq + 1u < p_block->first_seq + p_block->count)
+    {
+        code = p_block->codes[p_it->off++];
+        if (code <= APP_BT_HISTORY_CODE_RUN_MAX)
+        {
+            p_it->run = code;
+        }
+        else if (APP_BT_HISTORY_CODE_ABS == code)
+        {
+            p_it->level = p_block->codes[p_it->off++];
+        }
+        else
+        {
+            /* Sign extend the 6 bit delta */
+            p_it->level = (uint8_t)(p_it->level + (int8_t)(uint8_t)(code << 2) / 4);
+        }
+        p_it->seq++;
+        return true;
+    }
+    if (p_it->pos + 1u >= app_bt_history_num)
+    {
+        return false;
+    }
+    p_block     = app_bt_history_block(++p_it->pos);
+    p_it->off   = 0;
+    p_it->run   = 0;
+    p_it->level = p_block->level;
+    p_it->seq   = p_block->first_seq;
+    return true;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_iter_init
+ *
+ * Function Description:
+ * @brief  Finds the oldest sample numbered seq or later. Call with the
+ *         scheduler suspended.
+ *
+ * @param p_it      Position, on the sample found
+ * @param seq       Sample number
+ *
+ * @return bool  false if there is none
+ */
+static bool app_bt_history_iter_init(app_bt_history_iter_t *p_it, uint32_t seq)
+{
+    app_bt_history_block_t *p_block;
+
+    if ((0 == app_bt_history_num) || (seq > app_bt_history_newest()))
+    {
+        return false;
+    }
+
+    /* Skip whole blocks before decoding */
+    p_it->pos = 0;
+    while ((p_it->pos + 1u < app_bt_history_num) &&
+           (app_bt_history_block(p_it->pos + 1u)->first_seq <= seq))
+    {
+        p_it->pos++;
+    }
+    p_block     = app_bt_history_block(p_it->pos);
+    p_it->off   = 0;
+    p_it->run   = 0;
+    p_it->level = p_block->level;
+    p_it->seq   = p_block->first_seq;
+
+    while (p_it->seq < seq)
+    {
+        if (!app_bt_history_iter_next(p_it))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_fill
+ *
+ * Function Description:
+ * @brief  Encodes the next record PDU of the download, or the end marker
+ *         once it is past its last sample or the newest one. Call with the
+ *         scheduler suspended.
+ *
+ * @param p_buf     Destination
+ * @param size      ATT MTU - 3
+ * @param p_samples Returns the number of samples encoded, 0 for the end
+ *                  marker
+ *
+ * @return uint16_t  Length of the PDU
+ */
+static uint16_t app_bt_history_fill(uint8_t *p_buf, uint16_t size, uint16_t *p_samples)
+{
+    app_bt_history_stream_t *p_stream = &app_bt_history_stream;
+    app_bt_history_iter_t    it;
+    uint32_t                 seq;
+    uint16_t                 len;
+    uint16_t                 run_off = 0;
+    uint8_t                  level;
+    int32_t                  delta;
+
+    if (!app_bt_history_iter_init(&it, p_stream->next_seq) || (it.seq > p_stream->last_seq))
+    {
+        app_bt_history_put_u32(p_buf, p_stream->next_seq);
+        p_buf[4] = APP_BT_HISTORY_END;
+        *p_samples = 0;
+        return APP_BT_HISTORY_RECORD_HEADER_LEN;
+    }
+
+    app_bt_history_put_u32(p_buf, it.seq);
+    p_buf[4] = it.level;
+    len      = APP_BT_HISTORY_RECORD_HEADER_LEN;
+    seq      = it.seq;
+    level    = it.level;
+    *p_samples = 1;
+
+    while (app_bt_history_iter_next(&it) && (it.seq == seq + 1u) && (it.seq <= p_stream->last_seq))
+    {
+        delta = (int32_t)it.level - level;
+        if ((0 == delta) && (0 != run_off) && (p_buf[run_off] < APP_BT_HISTORY_CODE_RUN_MAX))
+        {
+            p_buf[run_off]++;
+        }
+        else if ((delta >= -32) && (delta <= 31) && (len < size))
+        {
+            run_off = (0 == delta) ? len : 0;
+            p_buf[len++] = (0 == delta) ? 0u :
+                           (uint8_t)(APP_BT_HISTORY_CODE_DELTA | ((uint32_t)delta & 0x3Fu));
+        }
+        else if ((delta < -32 || delta > 31) && (len + 2u <= size))
+        {
+            run_off = 0;
+            p_buf[len++] = APP_BT_HISTORY_CODE_ABS;
+            p_buf[len++] = it.level;
+        }
+        else
+        {
+            break;
+        }
+        seq   = it.seq;
+        level = it.level;
+        (*p_samples)++;
+    }
+    p_stream->next_seq = seq + 1u;
+    return len;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_pump
+ *
+ * Function Description:
+ * @brief  Keeps up to APP_BT_HISTORY_MAX_IN_FLIGHT record PDUs with the
+ *         stack until the end marker is out, each in its own buffer. Each
+ *         transmitted buffer sends the next one, so the link runs as fast
+ *         as it drains.
+ *
+ * @return void
+ */
+static void app_bt_history_pump(void)
+{
+    app_bt_history_stream_t *p_stream = &app_bt_history_stream;
+    wiced_bt_gatt_status_t   status;
+    uint8_t                 *p_buf;
+    uint16_t                 size;
+    uint16_t                 len;
+    uint16_t                 samples;
+    uint32_t                 resume_seq;
+    uint8_t                  slot;
+
+    while ((0 != p_stream->conn_id) && !p_stream->congested)
+    {
+        for (slot = 0; slot < APP_BT_HISTORY_MAX_IN_FLIGHT; slot++)
+        {
+            if (NULL == p_stream->in_flight[slot])
+            {
+                break;
+            }
+        }
+        if (APP_BT_HISTORY_MAX_IN_FLIGHT == slot)
+        {
+            return;
+        }
+
+        size  = app_bt_conn_get_mtu(p_stream->conn_id) - 3u;
+        size  = (size < APP_BT_HISTORY_PDU_LEN) ? size : APP_BT_HISTORY_PDU_LEN;
+        p_buf = app_bt_history_pdus[slot];
+
+        resume_seq = p_stream->next_seq;
+        vTaskSuspendAll();
+        len = app_bt_history_fill(p_buf, size, &samples);
+        (void)xTaskResumeAll();
+
+        status = wiced_bt_gatt_server_send_notification(p_stream->conn_id,
+                                                        app_bt_history_value_handle,
+                                                        len, p_buf,
+                                                        (void *)app_bt_history_transmitted);
+        if (WICED_BT_GATT_SUCCESS != status)
+        {
+            if (WICED_BT_GATT_CONGESTED == status)
+            {
+                /* Resent by GATT_CONGESTION_EVT or the next transmitted buffer */
+                app_bt_history_stats.congested++;
+                p_stream->next_seq  = resume_seq;
+                p_stream->congested = true;
+                return;
+            }
+            app_bt_history_stats.errors++;
+            p_stream->conn_id = 0;
+            return;
+        }
+
+        p_stream->in_flight[slot] = p_buf;
+        app_bt_history_stats.pdus++;
+        app_bt_history_stats.streamed += samples;
+        if (0 == samples)
+        {
+            p_stream->conn_id = 0;
+        }
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_history_init
+ *
+ * Function Description:
+ * @brief  Sets the attributes records are notified on
+ *
+ * @param value_handle  Characteristic value handle
+ * @param cccd_handle   Its client characteristic configuration descriptor,
+ *                      kept per connection by app_bt_conn
+ *
+ * @return void
+ */
+void app_bt_history_init(uint16_t value_handle, uint16_t cccd_handle)
+{
+    app_bt_history_value_handle = value_handle;
+    app_bt_history_cccd_handle  = cccd_handle;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_transmitted
+ *
+ * Function Description:
+ * @brief  Passed as the application context of record notifications, so
+ *         GATT_APP_BUFFER_TRANSMITTED_EVT calls it like a buffer free
+ *         function. Releases the PDU buffer and sends the next one.
+ *
+ * @param p_data    PDU handed to the stack
+ *
+ * @return void
+ */
+void app_bt_history_transmitted(uint8_t *p_data)
+{
+    app_bt_history_stream_t *p_stream = &app_bt_history_stream;
+    uint8_t                  slot;
+
+    for (slot = 0; slot < APP_BT_HISTORY_MAX_IN_FLIGHT; slot++)
+    {
+        if (p_data == p_stream->in_flight[slot])
+        {
+            p_stream->in_flight[slot] = NULL;
+        }
+    }
+
+    /* A buffer went out, so the link has room again */
+    p_stream->congested = false;
+    app_bt_history_pump();
+}
+
+/**
+ * Function Name:
+ * app_bt_history_congestion
+ *
+ * Function Description:
+ * @brief  Tracks GATT_CONGESTION_EVT, the download resumes once the link
+ *         clears
+ *
+ * @param conn_id   Connection ID
+ * @param congested WICED_TRUE while the stack is out of buffers for the link
+ *
+ * @return void
+ */
+void app_bt_history_congestion(uint16_t conn_id, wiced_bool_t congested)
+{
+    if (conn_id != app_bt_history_stream.conn_id)
+    {
+        return;
+    }
+    app_bt_history_stream.congested = (WICED_TRUE == congested);
+    app_bt_history_pump();
+}
+
+/**
+ * Function Name:
+ * app_bt_history_close
+ *
+ * Function Description:
+ * @brief  Ends the download of a connection. Call on disconnection; the
+ *         buffers of PDUs the stack still holds stay taken until reported
+ *         transmitted.
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_history_close(uint16_t conn_id)
+{
+    if (conn_id == app_bt_history_stream.conn_id)
+    {
+        app_bt_history_stream.conn_id = 0;
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_history_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the ring and download counters
+ *
+ * @param p_stats   Destination
+ *
+ * @return void
+ */
+void app_bt_history_get_stats(app_bt_history_stats_t *p_stats)
+{
+    uint8_t pos;
+
+    vTaskSuspendAll();
+    *p_stats = app_bt_history_stats;
+    p_stats->blocks = app_bt_history_num;
+    for (pos = 0; pos < app_bt_history_num; pos++)
+    {
+        p_stats->stored     += app_bt_history_block(pos)->count;
+        p_stats->code_bytes += app_bt_history_block(pos)->used;
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_history_print
+ *
+ * Function Description:
+ * @brief  Prints how much history is held and the download counters
+ *
+ * @return void
+ */
+void app_bt_history_print(void)
+{
+    app_bt_history_stats_t stats;
+
+    app_bt_history_get_stats(&stats);
+    printf("History: %lu samples of %u s in %u/%u blocks, %u code bytes, %lu blocks evicted\r\n",
+           (unsigned long)stats.stored, (unsigned)APP_BT_HISTORY_PERIOD_S,
+           (unsigned)stats.blocks, (unsigned)APP_BT_HISTORY_BLOCKS,
+           (unsigned)stats.code_bytes, (unsigned long)stats.evicted);
+    printf("  downloads %lu, PDUs %lu, samples %lu, congested %lu, errors %lu\r\n",
+           (unsigned long)stats.streams, (unsigned long)stats.pdus,
+           (unsigned long)stats.streamed, (unsigned long)stats.congested,
+           (unsigned long)stats.errors);
+}
+
+/**
+ * Function Name:
+ * app_bt_history_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the History Records characteristic, see
+ *         APP_BT_HISTORY_INFO_LEN
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the value
+ * @param p_len     Returns its length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_history_on_read(uint16_t conn_id, uint16_t handle,
+                                              uint8_t **pp_val, uint16_t *p_len)
+{
+    uint8_t *p_info = app_bt_history_info;
+
+    (void)handle;
+
+    vTaskSuspendAll();
+    p_info[0] = APP_BT_HISTORY_VERSION;
+    p_info[1] = (conn_id == app_bt_history_stream.conn_id) ? APP_BT_HISTORY_FLAG_STREAMING : 0u;
+    p_info[2] = (uint8_t)(APP_BT_HISTORY_PERIOD_S & 0xFF);
+    p_info[3] = (uint8_t)(APP_BT_HISTORY_PERIOD_S >> 8);
+    app_bt_history_put_u32(&p_info[4], (0 == app_bt_history_num) ? APP_BT_HISTORY_NO_SEQ :
+                                       app_bt_history_block(0)->first_seq);
+    app_bt_history_put_u32(&p_info[8], (0 == app_bt_history_num) ? APP_BT_HISTORY_NO_SEQ :
+                                       app_bt_history_newest());
+    app_bt_history_put_u32(&p_info[12], app_bt_history_uptime());
+    (void)xTaskResumeAll();
+
+    *pp_val = p_info;
+    *p_len  = APP_BT_HISTORY_INFO_LEN;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the History Records characteristic. Takes the
+ *         commands of APP_BT_HISTORY_CMD_STOP and following; a download
+ *         needs notifications enabled and no other client downloading.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_history_validate(uint16_t conn_id, uint16_t handle,
+                                               uint8_t *p_val, uint16_t len)
+{
+    (void)handle;
+
+    if (0 == len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    switch (p_val[0])
+    {
+    case APP_BT_HISTORY_CMD_STOP:
+        return (1 == len) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_INVALID_ATTR_LEN;
+
+    case APP_BT_HISTORY_CMD_FROM_SEQ:
+        if ((5 != len) && (9 != len))
+        {
+            return WICED_BT_GATT_INVALID_ATTR_LEN;
+        }
+        break;
+
+    case APP_BT_HISTORY_CMD_TIME_RANGE:
+        if (9 != len)
+        {
+            return WICED_BT_GATT_INVALID_ATTR_LEN;
+        }
+        break;
+
+    default:
+        return WICED_BT_GATT_VALUE_NOT_ALLOWED;
+    }
+
+    if (0 == (app_bt_conn_cccd_get(conn_id, app_bt_history_cccd_handle) &
+              GATT_CLIENT_CONFIG_NOTIFICATION))
+    {
+        return WICED_BT_GATT_CCC_CFG_ERR;
+    }
+    if ((0 != app_bt_history_stream.conn_id) && (conn_id != app_bt_history_stream.conn_id))
+    {
+        return WICED_BT_GATT_PRC_IN_PROGRESS;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the History Records characteristic. Starts,
+ *         restarts or stops the download of the writing connection.
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_history_on_write(uint16_t conn_id,
+                                               wiced_bt_gatt_event_data_t *p_data,
+                                               uint16_t handle, uint8_t *p_val,
+                                               uint16_t len)
+{
+    app_bt_history_stream_t *p_stream = &app_bt_history_stream;
+
+    (void)p_data;
+    (void)handle;
+
+    if (APP_BT_HISTORY_CMD_STOP == p_val[0])
+    {
+        app_bt_history_close(conn_id);
+        return WICED_BT_GATT_SUCCESS;
+    }
+
+    if (APP_BT_HISTORY_CMD_TIME_RANGE == p_val[0])
+    {
+        /* First sample at or after the start, last one at or before the end */
+        p_stream->next_seq = (app_bt_history_get_u32(&p_val[1]) + APP_BT_HISTORY_PERIOD_S - 1u) /
+                             APP_BT_HISTORY_PERIOD_S;
+        p_stream->last_seq = app_bt_history_get_u32(&p_val[5]) / APP_BT_HISTORY_PERIOD_S;
+    }
+    else
+    {
+        p_stream->next_seq = app_bt_history_get_u32(&p_val[1]);
+        p_stream->last_seq = (9 == len) ? app_bt_history_get_u32(&p_val[5]) : APP_BT_HISTORY_NO_SEQ;
+    }
+    p_stream->conn_id   = conn_id;
+    p_stream->congested = false;
+    app_bt_history_stats.streams++;
+
+    app_bt_history_pump();
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_cccd_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the History Records CCCD, notifications only
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_history_cccd_validate(uint16_t conn_id, uint16_t handle,
+                                                    uint8_t *p_val, uint16_t len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    if ((0 == len) || (0 != (p_val[0] & ~GATT_CLIENT_CONFIG_NOTIFICATION)) ||
+        ((len > 1) && (0 != p_val[1])))
+    {
+        return WICED_BT_GATT_CCC_CFG_ERR;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_history_cccd_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the History Records CCCD. Disabling notifications
+ *         ends the download of the connection.
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_history_cccd_on_write(uint16_t conn_id,
+                                                    wiced_bt_gatt_event_data_t *p_data,
+                                                    uint16_t handle, uint8_t *p_val,
+                                                    uint16_t len)
+{
+    wiced_bool_t changed;
+
+    (void)p_data;
+    (void)len;
+
+    if (0 == p_val[0])
+    {
+        app_bt_history_close(conn_id);
+    }
+    return app_bt_conn_cccd_set(conn_id, handle, p_val[0], &changed);
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,194 @@
+/******************************************************************************
+* File Name:   app_bt_history.h
+*
+* Description: This file contains the declarations of the battery level history ring
+*                           and its streaming download
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_HISTORY_H__
+#define __APP_BT_HISTORY_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+#include "app_bt_conn.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Seconds between two recorded samples. Sample n is the level at
+ *        n * APP_BT_HISTORY_PERIOD_S seconds of uptime.
+ */
+#ifndef APP_BT_HISTORY_PERIOD_S
+#define APP_BT_HISTORY_PERIOD_S                 (60u)
+#endif
+
+/**
+ * @brief Blocks in the ring. The oldest block is dropped as a whole when a
+ *        new one is needed.
+ */
+#ifndef APP_BT_HISTORY_BLOCKS
+#define APP_BT_HISTORY_BLOCKS                   (32u)
+#endif
+
+/**
+ * @brief Bytes per block, an 8 byte header and the codes. A block holds
+ *        from (len - 7) samples, every level different, to 128 per code
+ *        byte while the level is steady.
+ */
+#ifndef APP_BT_HISTORY_BLOCK_LEN
+#define APP_BT_HISTORY_BLOCK_LEN                (64u)
+#endif
+
+#if (APP_BT_HISTORY_BLOCK_LEN > 255u + 8u) || (APP_BT_HISTORY_BLOCK_LEN < 16u)
+#error "APP_BT_HISTORY_BLOCK_LEN out of range"
+#endif
+
+/**
+ * @brief Record PDUs handed to the stack and not yet reported by
+ *        GATT_APP_BUFFER_TRANSMITTED_EVT
+ */
+#ifndef APP_BT_HISTORY_MAX_IN_FLIGHT
+#define APP_BT_HISTORY_MAX_IN_FLIGHT            (4u)
+#endif
+
+/**
+ * @brief Largest record PDU. Each in flight PDU has a static buffer of this
+ *        size, apart from the GATT response pool; the default fills one
+ *        link layer PDU with Data Length Extension (251 - 4 - 3 bytes).
+ *        Smaller MTUs send shorter records.
+ */
+#ifndef APP_BT_HISTORY_PDU_LEN
+#define APP_BT_HISTORY_PDU_LEN                  (244u)
+#endif
+
+/**
+ * @brief Codes, the same in the ring and in record notifications. Each
+ *        code describes the samples following the previous one.
+ *        0x00-0x7F: level unchanged for (code + 1) samples.
+ *        0x80-0xBF: level changed by the 6 bit signed value, one sample.
+ *        0xC0: level set to the next byte, one sample. Others reserved.
+ */
+#define APP_BT_HISTORY_CODE_RUN_MAX             (0x7Fu)
+#define APP_BT_HISTORY_CODE_DELTA               (0x80u)
+#define APP_BT_HISTORY_CODE_ABS                 (0xC0u)
+
+/**
+ * @brief Record notification: sample number (uint32), its level (uint8),
+ *        then codes for the samples after it, up to ATT MTU - 3 bytes. A
+ *        level of APP_BT_HISTORY_END ends the stream, with the sample
+ *        number to resume from.
+ */
+#define APP_BT_HISTORY_RECORD_HEADER_LEN        (5u)
+#define APP_BT_HISTORY_END                      (0xFFu)
+
+/**
+ * @brief Commands written to the characteristic, little endian:
+ *        STOP, no argument.
+ *        FROM_SEQ, first sample number (uint32) and optionally the last
+ *        one (uint32), to resume an interrupted download.
+ *        TIME_RANGE, first and last second of uptime (uint32 each).
+ */
+#define APP_BT_HISTORY_CMD_STOP                 (0x00u)
+#define APP_BT_HISTORY_CMD_FROM_SEQ             (0x01u)
+#define APP_BT_HISTORY_CMD_TIME_RANGE           (0x02u)
+
+/**
+ * @brief Value read from the characteristic: version (uint8), flags
+ *        (uint8, bit 0 streaming), period in s (uint16), oldest and newest
+ *        sample numbers (uint32 each, 0xFFFFFFFF when empty) and uptime in
+ *        s (uint32). Little endian.
+ */
+#define APP_BT_HISTORY_VERSION                  (1u)
+#define APP_BT_HISTORY_INFO_LEN                 (16u)
+#define APP_BT_HISTORY_FLAG_STREAMING           (0x01u)
+#define APP_BT_HISTORY_NO_SEQ                   (0xFFFFFFFFu)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Ring and download counters
+ */
+typedef struct
+{
+    uint32_t samples;                           /* Samples recorded */
+    uint32_t stored;                            /* Samples held now */
+    uint32_t evicted;                           /* Blocks dropped for new ones */
+    uint16_t blocks;                            /* Blocks in use */
+    uint16_t code_bytes;                        /* Code bytes in use */
+    uint32_t streams;                           /* Downloads started */
+    uint32_t pdus;                              /* Record notifications sent */
+    uint32_t streamed;                          /* Samples they carried */
+    uint32_t congested;                         /* Sends refused as congested */
+    uint32_t errors;                            /* Downloads ended by a send error */
+} app_bt_history_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void                   app_bt_history_init          (uint16_t value_handle,
+                                                     uint16_t cccd_handle);
+void                   app_bt_history_add           (uint8_t level);
+void                   app_bt_history_transmitted   (uint8_t *p_data);
+void                   app_bt_history_congestion    (uint16_t conn_id,
+                                                     wiced_bool_t congested);
+void                   app_bt_history_close         (uint16_t conn_id);
+void                   app_bt_history_get_stats     (app_bt_history_stats_t *p_stats);
+void                   app_bt_history_print         (void);
+wiced_bt_gatt_status_t app_bt_history_on_read       (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t **pp_val, uint16_t *p_len);
+wiced_bt_gatt_status_t app_bt_history_validate      (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_history_on_write      (uint16_t conn_id,
+                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                     uint16_t handle, uint8_t *p_val,
+                                                     uint16_t len);
+wiced_bt_gatt_status_t app_bt_history_cccd_validate (uint16_t conn_id, uint16_t handle,
+                                                     uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_history_cccd_on_write (uint16_t conn_id,
+                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                     uint16_t handle, uint8_t *p_val,
+                                                     uint16_t len);
+
+#endif      /*__APP_BT_HISTORY_H__ */
+
+
+/* [] END OF FILE */
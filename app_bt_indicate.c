@@ -0,0 +1,412 @@
+/******************************************************************************
+* File Name:   app_bt_indicate.c
+*
+* Description: This file implements indications with one outstanding value per
+*                           connection, confirmation round trip times, retry and timeout
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_indicate.h"
+#include "cybsp.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief State of the indication of one connection
+ */
+typedef enum
+{
+    APP_BT_INDICATE_IDLE,
+    APP_BT_INDICATE_READY,                      /* Loaded, to be (re)sent */
+    APP_BT_INDICATE_OUTSTANDING,                /* Handed to the stack, waiting for the confirmation */
+    APP_BT_INDICATE_TIMED_OUT                   /* No confirmation in time, link done with */
+} app_bt_indicate_state_t;
+
+/**
+ * @brief Tracker of one connection slot. ATT allows a single unconfirmed
+ *        indication per link; a value arriving meanwhile waits in next, a
+ *        newer one replacing it.
+ */
+typedef struct
+{
+    uint8_t     value[APP_BT_INDICATE_MAX_VALUE_LEN];
+    uint16_t    handle;
+    uint16_t    len;
+    TickType_t  sent_tick;                      /* When value was handed to the stack */
+    uint8_t     state;                          /* app_bt_indicate_state_t */
+    bool        has_next;
+    uint16_t    next_handle;
+    uint16_t    next_len;
+    uint8_t     next_value[APP_BT_INDICATE_MAX_VALUE_LEN];
+} app_bt_indicate_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* The BAS task sends and polls, the BT stack task confirms */
+static app_bt_indicate_t       app_bt_indicate_slots[APP_BT_MAX_CONNECTIONS];
+static app_bt_indicate_stats_t app_bt_indicate_stats;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_indicate_load_next
+ *
+ * Function Description:
+ * @brief  Makes the waiting value, if any, the one to send. Call with the
+ *         scheduler suspended.
+ *
+ * @param p_ind     Tracker
+ *
+ * @return void
+ */
+static void app_bt_indicate_load_next(app_bt_indicate_t *p_ind)
+{
+    if (!p_ind->has_next)
+    {
+        p_ind->state = APP_BT_INDICATE_IDLE;
+        return;
+    }
+    memcpy(p_ind->value, p_ind->next_value, p_ind->next_len);
+    p_ind->handle   = p_ind->next_handle;
+    p_ind->len      = p_ind->next_len;
+    p_ind->has_next = false;
+    p_ind->state    = APP_BT_INDICATE_READY;
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_flush
+ *
+ * Function Description:
+ * @brief  Sends the loaded value of a connection, or gives the outstanding
+ *         indication up once the ATT transaction timeout has passed. Never
+ *         waits and never resends: a send the stack refuses stays loaded
+ *         for the next poll. The tracker is marked outstanding before the
+ *         stack is called, so a confirmation that comes back before the
+ *         call returns finds it, and is rolled back if the stack refuses.
+ *
+ * @param slot      Connection slot
+ *
+ * @return void
+ */
+static void app_bt_indicate_flush(uint8_t slot)
+{
+    app_bt_indicate_t     *p_ind = &app_bt_indicate_slots[slot];
+    wiced_bt_gatt_status_t status;
+    TickType_t             now;
+    uint16_t               conn_id;
+    bool                   send = false;
+
+    vTaskSuspendAll();
+    now = xTaskGetTickCount();
+    if ((APP_BT_INDICATE_OUTSTANDING == p_ind->state) &&
+        ((uint32_t)(now - p_ind->sent_tick) >= pdMS_TO_TICKS(APP_BT_INDICATE_TIMEOUT_MS)))
+    {
+        app_bt_indicate_stats.timeouts++;
+        if (p_ind->has_next)
+        {
+            app_bt_indicate_stats.dropped++;
+            p_ind->has_next = false;
+        }
+        p_ind->state = APP_BT_INDICATE_TIMED_OUT;
+    }
+    if (APP_BT_INDICATE_READY == p_ind->state)
+    {
+        p_ind->state     = APP_BT_INDICATE_OUTSTANDING;
+        p_ind->sent_tick = now;
+        send             = true;
+    }
+    conn_id = app_bt_conn_get_conn_id(slot);
+    (void)xTaskResumeAll();
+
+    if (!send)
+    {
+        return;
+    }
+
+    status = wiced_bt_gatt_server_send_indication(conn_id, p_ind->handle, p_ind->len,
+                                                  p_ind->value, NULL);
+
+    vTaskSuspendAll();
+    if (WICED_BT_GATT_SUCCESS == status)
+    {
+        app_bt_indicate_stats.sent++;
+    }
+    else
+    {
+        /* Nothing went out, so nothing can have been confirmed */
+        app_bt_indicate_stats.refused++;
+        p_ind->state = APP_BT_INDICATE_READY;
+        if (p_ind->has_next)
+        {
+            app_bt_indicate_stats.replaced++;
+            app_bt_indicate_load_next(p_ind);
+        }
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_send
+ *
+ * Function Description:
+ * @brief  Indicates a value, now if the link has no indication outstanding,
+ *         otherwise once it is confirmed. Only the newest waiting value is
+ *         kept.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Characteristic value handle
+ * @param p_val     Value, copied
+ * @param len       Length of the value
+ *
+ * @return wiced_bt_gatt_status_t  WICED_BT_GATT_SUCCESS once accepted,
+ *                                 WICED_BT_GATT_WRONG_STATE after a timeout
+ */
+wiced_bt_gatt_status_t app_bt_indicate_send(uint16_t conn_id, uint16_t handle,
+                                            const uint8_t *p_val, uint16_t len)
+{
+    app_bt_indicate_t *p_ind;
+    uint8_t            slot;
+
+    if (len > APP_BT_INDICATE_MAX_VALUE_LEN)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    slot = app_bt_conn_find_slot(conn_id);
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return WICED_BT_GATT_ILLEGAL_PARAMETER;
+    }
+    p_ind = &app_bt_indicate_slots[slot];
+
+    vTaskSuspendAll();
+    if (APP_BT_INDICATE_TIMED_OUT == p_ind->state)
+    {
+        app_bt_indicate_stats.dropped++;
+        (void)xTaskResumeAll();
+        return WICED_BT_GATT_WRONG_STATE;
+    }
+    if (p_ind->has_next)
+    {
+        app_bt_indicate_stats.replaced++;
+    }
+    memcpy(p_ind->next_value, p_val, len);
+    p_ind->next_handle = handle;
+    p_ind->next_len    = len;
+    p_ind->has_next    = true;
+    if (APP_BT_INDICATE_IDLE == p_ind->state)
+    {
+        app_bt_indicate_load_next(p_ind);
+    }
+    else if (APP_BT_INDICATE_READY == p_ind->state)
+    {
+        /* Not sent yet, the new value takes its place */
+        app_bt_indicate_stats.replaced++;
+        app_bt_indicate_load_next(p_ind);
+    }
+    (void)xTaskResumeAll();
+
+    app_bt_indicate_flush(slot);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_confirm
+ *
+ * Function Description:
+ * @brief  Handles GATT_HANDLE_VALUE_CONF: records the round trip time and
+ *         sends the value waiting behind the confirmed one
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Confirmed attribute handle
+ *
+ * @return wiced_bool_t  WICED_TRUE when the confirmation was for an
+ *                       indication sent here
+ */
+wiced_bool_t app_bt_indicate_confirm(uint16_t conn_id, uint16_t handle)
+{
+    app_bt_indicate_t *p_ind;
+    uint32_t           rtt_ms;
+    uint32_t           bucket;
+    uint8_t            slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return WICED_FALSE;
+    }
+    p_ind = &app_bt_indicate_slots[slot];
+
+    vTaskSuspendAll();
+    if ((APP_BT_INDICATE_OUTSTANDING != p_ind->state) || (p_ind->handle != handle))
+    {
+        (void)xTaskResumeAll();
+        return WICED_FALSE;
+    }
+
+    rtt_ms = (uint32_t)(xTaskGetTickCount() - p_ind->sent_tick) * portTICK_PERIOD_MS;
+    bucket = 31u - __CLZ(rtt_ms | 1u);
+    bucket = (bucket < APP_BT_INDICATE_RTT_BUCKETS) ? bucket : (APP_BT_INDICATE_RTT_BUCKETS - 1u);
+    app_bt_indicate_stats.rtt[bucket]++;
+    app_bt_indicate_stats.confirmed++;
+    if (rtt_ms > app_bt_indicate_stats.rtt_max_ms)
+    {
+        app_bt_indicate_stats.rtt_max_ms = rtt_ms;
+    }
+    app_bt_indicate_load_next(p_ind);
+    (void)xTaskResumeAll();
+
+    app_bt_indicate_flush(slot);
+    return WICED_TRUE;
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_poll
+ *
+ * Function Description:
+ * @brief  Retries refused sends and times out unconfirmed indications on
+ *         every connection. Call periodically, the BAS task does on each
+ *         tick.
+ *
+ * @return void
+ */
+void app_bt_indicate_poll(void)
+{
+    uint8_t slot;
+
+    for (slot = 0; slot < APP_BT_MAX_CONNECTIONS; slot++)
+    {
+        app_bt_indicate_flush(slot);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_close
+ *
+ * Function Description:
+ * @brief  Forgets the indications of a connection. Call on disconnection
+ *         before the slot is released.
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_indicate_close(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    memset(&app_bt_indicate_slots[slot], 0, sizeof(app_bt_indicate_slots[slot]));
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the indication counters and round trip histogram
+ *
+ * @param p_stats   Destination
+ *
+ * @return void
+ */
+void app_bt_indicate_get_stats(app_bt_indicate_stats_t *p_stats)
+{
+    vTaskSuspendAll();
+    *p_stats = app_bt_indicate_stats;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_indicate_print
+ *
+ * Function Description:
+ * @brief  Prints the indication counters and the round trip histogram
+ *
+ * @return void
+ */
+void app_bt_indicate_print(void)
+{
+    app_bt_indicate_stats_t stats;
+    uint32_t                i;
+
+    app_bt_indicate_get_stats(&stats);
+    printf("Indications: sent %lu confirmed %lu timeouts %lu dropped %lu replaced %lu refused %lu\r\n",
+           (unsigned long)stats.sent, (unsigned long)stats.confirmed,
+           (unsigned long)stats.timeouts, (unsigned long)stats.dropped,
+           (unsigned long)stats.replaced, (unsigned long)stats.refused);
+    if (0 == stats.confirmed)
+    {
+        return;
+    }
+    printf("  round trip, max %lu ms:\r\n", (unsigned long)stats.rtt_max_ms);
+    for (i = 0; i < APP_BT_INDICATE_RTT_BUCKETS; i++)
+    {
+        if (0 != stats.rtt[i])
+        {
+            printf("  %5lu ms %s %8lu\r\n", (unsigned long)((0 == i) ? 0 : (1ul << i)),
+                   (i == (APP_BT_INDICATE_RTT_BUCKETS - 1u)) ? "+  " : "...",
+                   (unsigned long)stats.rtt[i]);
+        }
+    }
+}
+
+
+/* [] END OF FILE */
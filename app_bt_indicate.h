@@ -0,0 +1,112 @@
+/******************************************************************************
+* File Name:   app_bt_indicate.h
+*
+* Description: This file contains the declarations of the per connection
+*                           indication tracker
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_INDICATE_H__
+#define __APP_BT_INDICATE_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+#include "app_bt_conn.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Time to wait for a confirmation, the ATT transaction timeout. An
+ *        indication is never resent: once it times out the link may carry
+ *        no further ATT PDUs, so indications stop on that connection.
+ */
+#ifndef APP_BT_INDICATE_TIMEOUT_MS
+#define APP_BT_INDICATE_TIMEOUT_MS              (30000u)
+#endif
+
+/**
+ * @brief Largest value indicated, the default ATT MTU minus the opcode and
+ *        handle
+ */
+#ifndef APP_BT_INDICATE_MAX_VALUE_LEN
+#define APP_BT_INDICATE_MAX_VALUE_LEN           (APP_BT_CONN_DEFAULT_MTU - 3u)
+#endif
+
+/**
+ * @brief Round trip histogram buckets. Bucket i counts confirmations that
+ *        took [2^i, 2^(i+1)) ms, bucket 0 includes 0 ms and the last bucket
+ *        is open ended.
+ */
+#define APP_BT_INDICATE_RTT_BUCKETS             (12u)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Indication counters and round trip times, summed over all
+ *        connections
+ */
+typedef struct
+{
+    uint32_t sent;                              /* Sends accepted by the stack */
+    uint32_t confirmed;
+    uint32_t timeouts;                          /* Unconfirmed after APP_BT_INDICATE_TIMEOUT_MS */
+    uint32_t dropped;                           /* Values not sent on a timed out link */
+    uint32_t replaced;                          /* Waiting values superseded by a newer one */
+    uint32_t refused;                           /* Sends the stack refused, tried again later */
+    uint32_t rtt_max_ms;
+    uint32_t rtt[APP_BT_INDICATE_RTT_BUCKETS];
+} app_bt_indicate_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_bt_gatt_status_t app_bt_indicate_send         (uint16_t conn_id, uint16_t handle,
+                                                     const uint8_t *p_val, uint16_t len);
+wiced_bool_t           app_bt_indicate_confirm      (uint16_t conn_id, uint16_t handle);
+void                   app_bt_indicate_poll         (void);
+void                   app_bt_indicate_close        (uint16_t conn_id);
+void                   app_bt_indicate_get_stats    (app_bt_indicate_stats_t *p_stats);
+void                   app_bt_indicate_print        (void);
+
+#endif      /*__APP_BT_INDICATE_H__ */
+
+
+/* [] END OF FILE */
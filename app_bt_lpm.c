@@ -0,0 +1,518 @@
+/******************************************************************************
+* File Name:   app_bt_lpm.c
+*
+* Description: This file implements the tickless Deep Sleep idle hook and counts
+*                           sleep entries, residency and wakeup latency
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_lpm.h"
+#include "app_bt_cpu_stats.h"
+#include "cybsp_bt_config.h"
+#include "cyhal.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+/* Wakes the device from tickless Deep Sleep */
+static cyhal_lptimer_t app_bt_lpm_lptimer;
+#endif
+
+/* Set by the Deep Sleep callback, read by the idle task after the wakeup */
+static volatile bool     app_bt_lpm_woke;
+static volatile bool     app_bt_lpm_woke_bt;
+static volatile uint32_t app_bt_lpm_woke_cycles;
+
+/* Updated by the idle task with the scheduler suspended */
+static app_bt_lpm_stats_t app_bt_lpm_stats;
+static TickType_t         app_bt_lpm_reset_tick;
+
+/* Characteristic value, built on each read */
+static uint8_t app_bt_lpm_value[APP_BT_LPM_LEN];
+
+/*******************************************************************************
+*        Function Prototypes
+*******************************************************************************/
+#if !(defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER) && configUSE_TICKLESS_IDLE
+/* Tickless idle of the RTOS abstraction library, honours the Device
+ * Configurator idle power mode */
+extern void vApplicationSleep(uint32_t xExpectedIdleTime);
+#endif
+
+static bool app_bt_lpm_deepsleep_cb (cyhal_syspm_callback_state_t state,
+                                     cyhal_syspm_callback_mode_t mode, void *callback_arg);
+
+static cyhal_syspm_callback_data_t app_bt_lpm_cb_data =
+{
+    .callback     = app_bt_lpm_deepsleep_cb,
+    .states       = CYHAL_SYSPM_CB_CPU_DEEPSLEEP,
+    .ignore_modes = (cyhal_syspm_callback_mode_t)(CYHAL_SYSPM_CHECK_READY |
+                                                  CYHAL_SYSPM_CHECK_FAIL |
+                                                  CYHAL_SYSPM_BEFORE_TRANSITION),
+    .args         = NULL,
+    .next         = NULL,
+};
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_lpm_host_wake_asserted
+ *
+ * Function Description:
+ * @brief  Whether the controller asserts BT host wake, that is it has HCI
+ *         traffic for the host
+ *
+ * @return bool  true if asserted, false if not or without controller sleep
+ */
+static bool app_bt_lpm_host_wake_asserted(void)
+{
+    const cybt_controller_sleep_config_t *p_sleep = &cybsp_bt_platform_cfg.controller_config.sleep_mode;
+
+    if (!p_sleep->sleep_mode_enabled || (NC == p_sleep->host_wakeup_pin))
+    {
+        return false;
+    }
+    return cyhal_gpio_read(p_sleep->host_wakeup_pin) ==
+           (CYBT_WAKE_ACTIVE_HIGH == p_sleep->host_wake_polarity);
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_deepsleep_cb
+ *
+ * Function Description:
+ * @brief  Deep Sleep callback, only after the transition. Being registered
+ *         last it is called first on wakeup, so it stamps the earliest point
+ *         software sees and notes whether the controller woke the host.
+ *
+ * @param state         Power state, CYHAL_SYSPM_CB_CPU_DEEPSLEEP
+ * @param mode          CYHAL_SYSPM_AFTER_TRANSITION
+ * @param callback_arg  Unused
+ *
+ * @return bool  Always true
+ */
+static bool app_bt_lpm_deepsleep_cb(cyhal_syspm_callback_state_t state,
+                                    cyhal_syspm_callback_mode_t mode, void *callback_arg)
+{
+    (void)state;
+    (void)callback_arg;
+
+    if (CYHAL_SYSPM_AFTER_TRANSITION == mode)
+    {
+        app_bt_lpm_woke_cycles = app_bt_cpu_stats_get_counter();
+        app_bt_lpm_woke_bt     = app_bt_lpm_host_wake_asserted();
+        app_bt_lpm_woke        = true;
+    }
+    return true;
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_init
+ *
+ * Function Description:
+ * @brief  Registers the Deep Sleep callback and, in the APP_LOW_POWER build,
+ *         the low power timer of tickless idle. Call from main() after the
+ *         BT platform configuration and before the scheduler starts.
+ *
+ * @return void
+ */
+void app_bt_lpm_init(void)
+{
+    if (!cybsp_bt_platform_cfg.controller_config.sleep_mode.sleep_mode_enabled)
+    {
+        printf("BT controller sleep disabled, the HCI UART keeps the host out of Deep Sleep\r\n");
+    }
+
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+    if (CY_RSLT_SUCCESS != cyhal_lptimer_init(&app_bt_lpm_lptimer))
+    {
+        printf("Low power timer init failed, no tickless Deep Sleep\r\n");
+    }
+#endif
+
+    cyhal_syspm_register_callback(&app_bt_lpm_cb_data);
+    app_bt_lpm_reset();
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_sleep
+ *
+ * Function Description:
+ * @brief  portSUPPRESS_TICKS_AND_SLEEP, run by the idle task with the
+ *         scheduler suspended. The APP_LOW_POWER build enters System Deep
+ *         Sleep itself: only when the idle time exceeds the Deep Sleep
+ *         latency and BT host wake is not asserted, and CPU Sleep when a
+ *         driver refuses Deep Sleep. Otherwise the Device Configurator idle
+ *         mode applies through vApplicationSleep(). Either way the sleep is
+ *         counted, and a Deep Sleep wakeup is timed up to the return here.
+ *
+ * @param expected_idle_ticks  Ticks until the next task is due
+ *
+ * @return void
+ */
+void app_bt_lpm_sleep(uint32_t expected_idle_ticks)
+{
+    TickType_t start = xTaskGetTickCount();
+    uint32_t   slept_ms;
+    uint32_t   cycles;
+    uint32_t   bucket;
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+    uint32_t   idle_ms = expected_idle_ticks * portTICK_PERIOD_MS;
+    uint32_t   actual_ms = 0;
+    uint32_t   irq_status;
+    cy_rslt_t  result = CYHAL_SYSPM_RSLT_ERR_PM_PENDING;
+
+    app_bt_lpm_woke = false;
+    irq_status = cyhal_system_critical_section_enter();
+    if (eAbortSleep != eTaskConfirmSleepModeStatus())
+    {
+        if ((idle_ms > APP_BT_LPM_DEEPSLEEP_LATENCY_MS) && !app_bt_lpm_host_wake_asserted())
+        {
+            result = cyhal_syspm_tickless_deepsleep(&app_bt_lpm_lptimer,
+                                                    idle_ms - APP_BT_LPM_DEEPSLEEP_LATENCY_MS,
+                                                    &actual_ms);
+            if (CY_RSLT_SUCCESS != result)
+            {
+                app_bt_lpm_stats.refused++;
+            }
+        }
+        if (CY_RSLT_SUCCESS != result)
+        {
+            result = cyhal_syspm_tickless_sleep(&app_bt_lpm_lptimer, idle_ms, &actual_ms);
+        }
+        if (CY_RSLT_SUCCESS == result)
+        {
+            vTaskStepTick(pdMS_TO_TICKS(actual_ms));
+        }
+    }
+    cyhal_system_critical_section_exit(irq_status);
+#elif configUSE_TICKLESS_IDLE
+    app_bt_lpm_woke = false;
+    vApplicationSleep(expected_idle_ticks);
+#else
+    (void)expected_idle_ticks;
+    app_bt_lpm_woke = false;
+#endif
+
+    slept_ms = (uint32_t)(xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    if (app_bt_lpm_woke)
+    {
+        cycles = app_bt_cpu_stats_get_counter() - app_bt_lpm_woke_cycles;
+        bucket = 31u - __CLZ(cycles | 1u);
+        bucket = (bucket > APP_BT_LPM_WAKE_FIRST_SHIFT) ? (bucket - APP_BT_LPM_WAKE_FIRST_SHIFT) : 0u;
+        bucket = (bucket < APP_BT_LPM_WAKE_BUCKETS) ? bucket : (APP_BT_LPM_WAKE_BUCKETS - 1u);
+
+        app_bt_lpm_stats.deep_sleep_entries++;
+        app_bt_lpm_stats.deep_sleep_ms += slept_ms;
+        app_bt_lpm_stats.wake_buckets[bucket]++;
+        app_bt_lpm_stats.wake_sum_cycles += cycles;
+        if (cycles > app_bt_lpm_stats.wake_max_cycles)
+        {
+            app_bt_lpm_stats.wake_max_cycles = cycles;
+        }
+        if (app_bt_lpm_woke_bt)
+        {
+            app_bt_lpm_stats.bt_wakeups++;
+        }
+    }
+    else if (0 != slept_ms)
+    {
+        app_bt_lpm_stats.sleep_entries++;
+        app_bt_lpm_stats.sleep_ms += slept_ms;
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the sleep counters
+ *
+ * @param p_stats   Destination
+ *
+ * @return void
+ */
+void app_bt_lpm_get_stats(app_bt_lpm_stats_t *p_stats)
+{
+    vTaskSuspendAll();
+    *p_stats = app_bt_lpm_stats;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_reset
+ *
+ * Function Description:
+ * @brief  Clears the sleep counters
+ *
+ * @return void
+ */
+void app_bt_lpm_reset(void)
+{
+    vTaskSuspendAll();
+    memset(&app_bt_lpm_stats, 0, sizeof(app_bt_lpm_stats));
+    app_bt_lpm_reset_tick = xTaskGetTickCount();
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_print
+ *
+ * Function Description:
+ * @brief  Prints the time spent in each power mode, the sleep entries and
+ *         the mean and longest Deep Sleep wakeup
+ *
+ * @return void
+ */
+void app_bt_lpm_print(void)
+{
+    app_bt_lpm_stats_t stats;
+    uint32_t           total_ms;
+    uint32_t           cycles_per_us = (SystemCoreClock / 1000000u) + 1u;
+
+    app_bt_lpm_get_stats(&stats);
+    total_ms = (uint32_t)(xTaskGetTickCount() - app_bt_lpm_reset_tick) * portTICK_PERIOD_MS;
+    if (0 == total_ms)
+    {
+        return;
+    }
+
+    printf("Power: Deep Sleep %lu.%02lu %%, CPU Sleep %lu.%02lu %% of %lu ms\r\n",
+           (unsigned long)((stats.deep_sleep_ms * 100u) / total_ms),
+           (unsigned long)(((stats.deep_sleep_ms * 10000u) / total_ms) % 100u),
+           (unsigned long)((stats.sleep_ms * 100u) / total_ms),
+           (unsigned long)(((stats.sleep_ms * 10000u) / total_ms) % 100u),
+           (unsigned long)total_ms);
+    printf("  Deep Sleep entries %lu (%lu on BT host wake), CPU Sleep entries %lu, refused %lu\r\n",
+           (unsigned long)stats.deep_sleep_entries, (unsigned long)stats.bt_wakeups,
+           (unsigned long)stats.sleep_entries, (unsigned long)stats.refused);
+    if (0 != stats.deep_sleep_entries)
+    {
+        printf("  wakeup to ready: mean %lu us, max %lu us\r\n",
+               (unsigned long)((stats.wake_sum_cycles / stats.deep_sleep_entries) / cycles_per_us),
+               (unsigned long)(stats.wake_max_cycles / cycles_per_us));
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_put_u32
+ *
+ * Function Description:
+ * @brief  Stores a little endian uint32, saturating larger values
+ *
+ * @param p_buf     Destination
+ * @param value     Value
+ *
+ * @return void
+ */
+static void app_bt_lpm_put_u32(uint8_t *p_buf, uint64_t value)
+{
+    value    = (value > UINT32_MAX) ? UINT32_MAX : value;
+    p_buf[0] = (uint8_t)(value & 0xFF);
+    p_buf[1] = (uint8_t)(value >> 8);
+    p_buf[2] = (uint8_t)(value >> 16);
+    p_buf[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_serialize
+ *
+ * Function Description:
+ * @brief  Builds the binary snapshot described at APP_BT_LPM_VERSION
+ *
+ * @param p_buf     Destination
+ * @param size      Size of p_buf, at least APP_BT_LPM_LEN
+ *
+ * @return uint16_t Bytes written, 0 if p_buf is too small
+ */
+uint16_t app_bt_lpm_serialize(uint8_t *p_buf, uint16_t size)
+{
+    app_bt_lpm_stats_t stats;
+    uint16_t           len = APP_BT_LPM_HEADER_LEN;
+    uint32_t           i;
+    uint8_t            flags = 0;
+
+    if (size < APP_BT_LPM_LEN)
+    {
+        return 0;
+    }
+
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+    flags |= APP_BT_LPM_FLAG_LOW_POWER;
+#endif
+#if configUSE_TICKLESS_IDLE
+    flags |= APP_BT_LPM_FLAG_TICKLESS;
+#endif
+    if (cybsp_bt_platform_cfg.controller_config.sleep_mode.sleep_mode_enabled)
+    {
+        flags |= APP_BT_LPM_FLAG_BT_SLEEP;
+    }
+
+    app_bt_lpm_get_stats(&stats);
+    p_buf[0] = APP_BT_LPM_VERSION;
+    p_buf[1] = APP_BT_LPM_WAKE_BUCKETS;
+    p_buf[2] = APP_BT_LPM_WAKE_FIRST_SHIFT;
+    p_buf[3] = flags;
+    app_bt_lpm_put_u32(&p_buf[4], SystemCoreClock);
+
+    app_bt_lpm_put_u32(&p_buf[len], (uint32_t)(xTaskGetTickCount() - app_bt_lpm_reset_tick) *
+                                    portTICK_PERIOD_MS);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.deep_sleep_ms);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.sleep_ms);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.deep_sleep_entries);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.sleep_entries);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.refused);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.bt_wakeups);
+    len += 4u;
+    app_bt_lpm_put_u32(&p_buf[len], stats.wake_max_cycles);
+    len += 4u;
+    for (i = 0; i < APP_BT_LPM_WAKE_BUCKETS; i++)
+    {
+        p_buf[len++] = (uint8_t)((stats.wake_buckets[i] > UINT16_MAX) ? 0xFF :
+                                 (stats.wake_buckets[i] & 0xFF));
+        p_buf[len++] = (uint8_t)((stats.wake_buckets[i] > UINT16_MAX) ? 0xFF :
+                                 (stats.wake_buckets[i] >> 8));
+    }
+    return len;
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the Power diagnostics characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the snapshot
+ * @param p_len     Returns its length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_lpm_on_read(uint16_t conn_id, uint16_t handle,
+                                          uint8_t **pp_val, uint16_t *p_len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    *p_len  = app_bt_lpm_serialize(app_bt_lpm_value, sizeof(app_bt_lpm_value));
+    *pp_val = app_bt_lpm_value;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the Power characteristic. Writing a single 0
+ *         resets the counters, anything else is refused.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_lpm_validate(uint16_t conn_id, uint16_t handle,
+                                           uint8_t *p_val, uint16_t len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    if (1 != len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    return (0 == p_val[0]) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_VALUE_NOT_ALLOWED;
+}
+
+/**
+ * Function Name:
+ * app_bt_lpm_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the Power characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_lpm_on_write(uint16_t conn_id,
+                                           wiced_bt_gatt_event_data_t *p_data,
+                                           uint16_t handle, uint8_t *p_val,
+                                           uint16_t len)
+{
+    (void)conn_id;
+    (void)p_data;
+    (void)handle;
+    (void)p_val;
+    (void)len;
+
+    app_bt_lpm_reset();
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,144 @@
+/******************************************************************************
+* File Name:   app_bt_lpm.h
+*
+* Description: This file contains the declarations of the tickless Deep Sleep
+*                           hook and its sleep and wakeup statistics
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_LPM_H__
+#define __APP_BT_LPM_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+#include "cybsp.h"
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Time Deep Sleep entry and exit take, in ms. Idle periods not longer
+ *        than this are spent in CPU Sleep. Defaults to the Device
+ *        Configurator "Deep Sleep Latency".
+ */
+#ifndef APP_BT_LPM_DEEPSLEEP_LATENCY_MS
+#if defined(CY_CFG_PWR_DEEPSLEEP_LATENCY)
+#define APP_BT_LPM_DEEPSLEEP_LATENCY_MS     (CY_CFG_PWR_DEEPSLEEP_LATENCY)
+#else
+#define APP_BT_LPM_DEEPSLEEP_LATENCY_MS     (0u)
+#endif
+#endif
+
+/**
+ * @brief Buckets of the wakeup latency histogram. Bucket i counts wakeups
+ *        that took [2^(SHIFT + i), 2^(SHIFT + i + 1)) core cycles from the
+ *        Deep Sleep exit to the scheduler resuming, the first and last
+ *        buckets are open ended.
+ */
+#define APP_BT_LPM_WAKE_BUCKETS             (16u)
+
+/**
+ * @brief log2 of the lower bound of bucket 1, in core cycles
+ */
+#ifndef APP_BT_LPM_WAKE_FIRST_SHIFT
+#define APP_BT_LPM_WAKE_FIRST_SHIFT         (8u)
+#endif
+
+/**
+ * @brief Characteristic snapshot: a header of version, bucket count, first
+ *        shift, flags (APP_BT_LPM_FLAG_*) and the core clock in Hz (uint32),
+ *        then time since reset, time in Deep Sleep and time in CPU Sleep in
+ *        ms, Deep Sleep entries, CPU Sleep entries, refused Deep Sleep
+ *        entries, Deep Sleep exits on BT host wake and the longest wakeup in
+ *        cycles (uint32 each), then the wakeup bucket counts (uint16,
+ *        saturating). Little endian.
+ */
+#define APP_BT_LPM_VERSION                  (1u)
+#define APP_BT_LPM_HEADER_LEN               (8u)
+#define APP_BT_LPM_LEN                      (APP_BT_LPM_HEADER_LEN + 32u + \
+                                             (2u * APP_BT_LPM_WAKE_BUCKETS))
+
+#define APP_BT_LPM_FLAG_LOW_POWER           (0x01u)     /* APP_LOW_POWER build */
+#define APP_BT_LPM_FLAG_TICKLESS            (0x02u)     /* Tickless idle enabled */
+#define APP_BT_LPM_FLAG_BT_SLEEP            (0x04u)     /* Controller sleep with host wake */
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Sleep and wakeup counters since reset
+ */
+typedef struct
+{
+    uint32_t deep_sleep_entries;
+    uint32_t sleep_entries;                     /* CPU Sleep, idle too short or Deep Sleep refused */
+    uint32_t refused;                           /* Deep Sleep refused by a peripheral driver */
+    uint32_t bt_wakeups;                        /* Deep Sleep exits with BT host wake asserted */
+    uint64_t deep_sleep_ms;
+    uint64_t sleep_ms;
+    uint32_t wake_max_cycles;
+    uint64_t wake_sum_cycles;
+    uint32_t wake_buckets[APP_BT_LPM_WAKE_BUCKETS];
+} app_bt_lpm_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+void                   app_bt_lpm_init      (void);
+void                   app_bt_lpm_sleep     (uint32_t expected_idle_ticks);
+void                   app_bt_lpm_get_stats (app_bt_lpm_stats_t *p_stats);
+void                   app_bt_lpm_reset     (void);
+void                   app_bt_lpm_print     (void);
+uint16_t               app_bt_lpm_serialize (uint8_t *p_buf, uint16_t size);
+wiced_bt_gatt_status_t app_bt_lpm_on_read   (uint16_t conn_id, uint16_t handle,
+                                             uint8_t **pp_val, uint16_t *p_len);
+wiced_bt_gatt_status_t app_bt_lpm_validate  (uint16_t conn_id, uint16_t handle,
+                                             uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_lpm_on_write  (uint16_t conn_id,
+                                             wiced_bt_gatt_event_data_t *p_data,
+                                             uint16_t handle, uint8_t *p_val,
+                                             uint16_t len);
+
+#endif      /*__APP_BT_LPM_H__ */
+
+
+/* [] END OF FILE */
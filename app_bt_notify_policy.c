@@ -0,0 +1,332 @@
+/******************************************************************************
+* File Name:   app_bt_notify_policy.c
+*
+* Description: This file implements the notification policy: change threshold,
+*                           critical level crossing, heartbeat and coalescing
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_notify_policy.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* Written by the BT stack task, read by the BAS task */
+static app_bt_notify_policy_cfg_t app_bt_notify_policy_cfg =
+{
+    .threshold_pct  = APP_BT_NOTIFY_POLICY_THRESHOLD_PCT,
+    .critical_pct   = APP_BT_NOTIFY_POLICY_CRITICAL_PCT,
+    .min_interval_s = APP_BT_NOTIFY_POLICY_MIN_INTERVAL_S,
+    .heartbeat_s    = APP_BT_NOTIFY_POLICY_HEARTBEAT_S,
+};
+static volatile bool app_bt_notify_policy_kicked;
+
+/* Only touched by the BAS task */
+static bool     app_bt_notify_policy_have_sent;
+static uint8_t  app_bt_notify_policy_last_level;
+static uint32_t app_bt_notify_policy_last_ms;
+
+/* Statistics */
+static uint32_t app_bt_notify_policy_sent[APP_BT_NOTIFY_POLICY_NUM_REASONS];
+static uint32_t app_bt_notify_policy_suppressed;    /* Updates not worth a send */
+static uint32_t app_bt_notify_policy_coalesced;     /* Updates held back by the minimum interval */
+
+static const char *const app_bt_notify_policy_reason_names[APP_BT_NOTIFY_POLICY_NUM_REASONS] =
+{
+    "none", "first", "threshold", "critical", "heartbeat"
+};
+
+/* Characteristic value, built on each read */
+static uint8_t app_bt_notify_policy_value[APP_BT_NOTIFY_POLICY_LEN];
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_notify_policy_get
+ *
+ * Function Description:
+ * @brief  Copies the current policy parameters
+ *
+ * @param p_cfg     Destination
+ *
+ * @return void
+ */
+void app_bt_notify_policy_get(app_bt_notify_policy_cfg_t *p_cfg)
+{
+    vTaskSuspendAll();
+    *p_cfg = app_bt_notify_policy_cfg;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_policy_kick
+ *
+ * Function Description:
+ * @brief  Makes the next update a send, for instance when a client enables
+ *         notifications and has no value yet
+ *
+ * @return void
+ */
+void app_bt_notify_policy_kick(void)
+{
+    app_bt_notify_policy_kicked = true;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_policy_evaluate
+ *
+ * Function Description:
+ * @brief  Decides whether a new battery level is sent now. A critical level
+ *         crossing goes out at once. A change of at least the threshold, a
+ *         due heartbeat or a kick goes out once the minimum interval since
+ *         the last send has passed; until then updates are coalesced and the
+ *         newest value is the one sent. A send is recorded as done.
+ *
+ * @param level     New battery level in percent
+ * @param now_ms    Current time in ms
+ *
+ * @return app_bt_notify_policy_reason_t  Reason to send, APP_BT_NOTIFY_POLICY_NONE to skip
+ */
+app_bt_notify_policy_reason_t app_bt_notify_policy_evaluate(uint8_t level, uint32_t now_ms)
+{
+    app_bt_notify_policy_reason_t reason = APP_BT_NOTIFY_POLICY_NONE;
+    app_bt_notify_policy_cfg_t    cfg;
+    uint32_t                      elapsed_ms;
+    uint8_t                       last;
+
+    app_bt_notify_policy_get(&cfg);
+    last       = app_bt_notify_policy_last_level;
+    elapsed_ms = now_ms - app_bt_notify_policy_last_ms;
+
+    if (!app_bt_notify_policy_have_sent || app_bt_notify_policy_kicked)
+    {
+        reason = APP_BT_NOTIFY_POLICY_FIRST;
+    }
+    else if ((0 != cfg.critical_pct) &&
+             ((level <= cfg.critical_pct) != (last <= cfg.critical_pct)))
+    {
+        reason = APP_BT_NOTIFY_POLICY_CRITICAL;
+    }
+    else if ((0 != cfg.threshold_pct) && ((uint32_t)abs(level - last) >= cfg.threshold_pct))
+    {
+        reason = APP_BT_NOTIFY_POLICY_THRESHOLD;
+    }
+    else if ((0 != cfg.heartbeat_s) && (elapsed_ms >= (cfg.heartbeat_s * 1000u)))
+    {
+        reason = APP_BT_NOTIFY_POLICY_HEARTBEAT;
+    }
+
+    if (APP_BT_NOTIFY_POLICY_NONE == reason)
+    {
+        app_bt_notify_policy_suppressed++;
+        return APP_BT_NOTIFY_POLICY_NONE;
+    }
+
+    /* Everything but a crossing waits out the minimum interval */
+    if ((APP_BT_NOTIFY_POLICY_CRITICAL != reason) && app_bt_notify_policy_have_sent &&
+        (elapsed_ms < (cfg.min_interval_s * 1000u)))
+    {
+        app_bt_notify_policy_coalesced++;
+        return APP_BT_NOTIFY_POLICY_NONE;
+    }
+
+    app_bt_notify_policy_kicked     = false;
+    app_bt_notify_policy_have_sent  = true;
+    app_bt_notify_policy_last_level = level;
+    app_bt_notify_policy_last_ms    = now_ms;
+    app_bt_notify_policy_sent[reason]++;
+    return reason;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_policy_print
+ *
+ * Function Description:
+ * @brief  Prints the policy and how many updates it sent and held back
+ *
+ * @return void
+ */
+void app_bt_notify_policy_print(void)
+{
+    app_bt_notify_policy_cfg_t cfg;
+    uint32_t                   i;
+
+    app_bt_notify_policy_get(&cfg);
+    printf("Notify policy: threshold %u %%, critical %u %%, min interval %u s, heartbeat %u s\r\n",
+           cfg.threshold_pct, cfg.critical_pct, cfg.min_interval_s, cfg.heartbeat_s);
+    for (i = APP_BT_NOTIFY_POLICY_FIRST; i < APP_BT_NOTIFY_POLICY_NUM_REASONS; i++)
+    {
+        printf("  sent %-9s %8lu\r\n", app_bt_notify_policy_reason_names[i],
+               (unsigned long)app_bt_notify_policy_sent[i]);
+    }
+    printf("  suppressed     %8lu\r\n  coalesced      %8lu\r\n",
+           (unsigned long)app_bt_notify_policy_suppressed,
+           (unsigned long)app_bt_notify_policy_coalesced);
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_policy_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the Notify Policy characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the policy
+ * @param p_len     Returns its length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_notify_policy_on_read(uint16_t conn_id, uint16_t handle,
+                                                    uint8_t **pp_val, uint16_t *p_len)
+{
+    app_bt_notify_policy_cfg_t cfg;
+
+    (void)conn_id;
+    (void)handle;
+
+    app_bt_notify_policy_get(&cfg);
+    app_bt_notify_policy_value[0] = cfg.threshold_pct;
+    app_bt_notify_policy_value[1] = cfg.critical_pct;
+    app_bt_notify_policy_value[2] = (uint8_t)(cfg.min_interval_s & 0xFF);
+    app_bt_notify_policy_value[3] = (uint8_t)(cfg.min_interval_s >> 8);
+    app_bt_notify_policy_value[4] = (uint8_t)(cfg.heartbeat_s & 0xFF);
+    app_bt_notify_policy_value[5] = (uint8_t)(cfg.heartbeat_s >> 8);
+
+    *pp_val = app_bt_notify_policy_value;
+    *p_len  = APP_BT_NOTIFY_POLICY_LEN;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_policy_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the Notify Policy characteristic. Percentages
+ *         must be within 0 to 100 and a heartbeat, when set, may not be
+ *         shorter than the minimum interval.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_notify_policy_validate(uint16_t conn_id, uint16_t handle,
+                                                     uint8_t *p_val, uint16_t len)
+{
+    uint16_t min_interval_s;
+    uint16_t heartbeat_s;
+
+    (void)conn_id;
+    (void)handle;
+
+    if (APP_BT_NOTIFY_POLICY_LEN != len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+
+    min_interval_s = (uint16_t)(p_val[2] | (p_val[3] << 8));
+    heartbeat_s    = (uint16_t)(p_val[4] | (p_val[5] << 8));
+    if ((p_val[0] > 100) || (p_val[1] > 100) ||
+        ((0 != heartbeat_s) && (heartbeat_s < min_interval_s)))
+    {
+        return WICED_BT_GATT_VALUE_NOT_ALLOWED;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_policy_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the Notify Policy characteristic. The new policy
+ *         applies from the next battery level update.
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_notify_policy_on_write(uint16_t conn_id,
+                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                     uint16_t handle, uint8_t *p_val,
+                                                     uint16_t len)
+{
+    app_bt_notify_policy_cfg_t cfg;
+
+    (void)conn_id;
+    (void)p_data;
+    (void)handle;
+    (void)len;
+
+    cfg.threshold_pct  = p_val[0];
+    cfg.critical_pct   = p_val[1];
+    cfg.min_interval_s = (uint16_t)(p_val[2] | (p_val[3] << 8));
+    cfg.heartbeat_s    = (uint16_t)(p_val[4] | (p_val[5] << 8));
+
+    vTaskSuspendAll();
+    app_bt_notify_policy_cfg = cfg;
+    (void)xTaskResumeAll();
+
+    app_bt_notify_policy_print();
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,138 @@
+/******************************************************************************
+* File Name:   app_bt_notify_policy.h
+*
+* Description: This file contains the declarations of the notification policy
+*                           that decides when a battery level change is worth sending
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_NOTIFY_POLICY_H__
+#define __APP_BT_NOTIFY_POLICY_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Default change, in percent, worth a notification. 0 disables it.
+ */
+#ifndef APP_BT_NOTIFY_POLICY_THRESHOLD_PCT
+#define APP_BT_NOTIFY_POLICY_THRESHOLD_PCT      (5u)
+#endif
+
+/**
+ * @brief Default critical level in percent. Crossing it either way is sent
+ *        at once, bypassing coalescing. 0 disables it.
+ */
+#ifndef APP_BT_NOTIFY_POLICY_CRITICAL_PCT
+#define APP_BT_NOTIFY_POLICY_CRITICAL_PCT       (20u)
+#endif
+
+/**
+ * @brief Default shortest time between two sends in seconds. Updates within
+ *        it are coalesced into one send of the newest value.
+ */
+#ifndef APP_BT_NOTIFY_POLICY_MIN_INTERVAL_S
+#define APP_BT_NOTIFY_POLICY_MIN_INTERVAL_S     (5u)
+#endif
+
+/**
+ * @brief Default heartbeat in seconds: the value is resent after this long
+ *        without a send even if unchanged. 0 disables it.
+ */
+#ifndef APP_BT_NOTIFY_POLICY_HEARTBEAT_S
+#define APP_BT_NOTIFY_POLICY_HEARTBEAT_S        (60u)
+#endif
+
+/**
+ * @brief Characteristic value: threshold percent (uint8), critical percent
+ *        (uint8), minimum interval in s (uint16), heartbeat in s (uint16).
+ *        Little endian.
+ */
+#define APP_BT_NOTIFY_POLICY_LEN                (6u)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Policy parameters
+ */
+typedef struct
+{
+    uint8_t  threshold_pct;
+    uint8_t  critical_pct;
+    uint16_t min_interval_s;
+    uint16_t heartbeat_s;
+} app_bt_notify_policy_cfg_t;
+
+/**
+ * @brief Why a value is sent
+ */
+typedef enum
+{
+    APP_BT_NOTIFY_POLICY_NONE,                  /* Not sent */
+    APP_BT_NOTIFY_POLICY_FIRST,                 /* First value, or a new subscriber */
+    APP_BT_NOTIFY_POLICY_THRESHOLD,
+    APP_BT_NOTIFY_POLICY_CRITICAL,
+    APP_BT_NOTIFY_POLICY_HEARTBEAT,
+    APP_BT_NOTIFY_POLICY_NUM_REASONS
+} app_bt_notify_policy_reason_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+app_bt_notify_policy_reason_t app_bt_notify_policy_evaluate (uint8_t level, uint32_t now_ms);
+void                          app_bt_notify_policy_kick     (void);
+void                          app_bt_notify_policy_get      (app_bt_notify_policy_cfg_t *p_cfg);
+void                          app_bt_notify_policy_print    (void);
+wiced_bt_gatt_status_t        app_bt_notify_policy_on_read  (uint16_t conn_id, uint16_t handle,
+                                                             uint8_t **pp_val, uint16_t *p_len);
+wiced_bt_gatt_status_t        app_bt_notify_policy_validate (uint16_t conn_id, uint16_t handle,
+                                                             uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t        app_bt_notify_policy_on_write (uint16_t conn_id,
+                                                             wiced_bt_gatt_event_data_t *p_data,
+                                                             uint16_t handle, uint8_t *p_val,
+                                                             uint16_t len);
+
+#endif      /*__APP_BT_NOTIFY_POLICY_H__ */
+
+
+/* [] END OF FILE */
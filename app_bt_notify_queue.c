@@ -0,0 +1,685 @@
+/******************************************************************************
+* File Name:   app_bt_notify_queue.c
+*
+* Description: This file implements a bounded per connection notification queue
+*                           paced by GATT_APP_BUFFER_TRANSMITTED_EVT and congestion
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_notify_queue.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief State of a queue entry
+ */
+typedef enum
+{
+    APP_BT_NOTIFY_QUEUE_FREE,
+    APP_BT_NOTIFY_QUEUE_PENDING                 /* Waiting for the stack */
+} app_bt_notify_queue_state_t;
+
+/**
+ * @brief One queued value, copied to a PDU buffer when handed to the stack
+ */
+typedef struct
+{
+    uint8_t     value[APP_BT_NOTIFY_QUEUE_MAX_VALUE_LEN];
+    uint16_t    handle;
+    uint16_t    len;
+    TickType_t  queued_tick;                    /* When the newest value was queued */
+    uint32_t    seq;                            /* Queue order */
+    uint8_t     state;                          /* app_bt_notify_queue_state_t */
+} app_bt_notify_queue_entry_t;
+
+/**
+ * @brief Queue of one connection slot
+ */
+typedef struct
+{
+    app_bt_notify_queue_entry_t entries[APP_BT_NOTIFY_QUEUE_DEPTH];
+    uint32_t                    next_seq;
+    uint16_t                    generation;     /* Counts closes, tells the PDUs of an old link */
+    uint8_t                     in_flight;      /* PDUs */
+    bool                        congested;
+    bool                        no_batch;       /* Peer refused a multiple notification */
+} app_bt_notify_queue_t;
+
+/**
+ * @brief A PDU handed to the stack: handle, length, value tuples, sent as a
+ *        Multiple Handle Value Notification or, for a single value, from
+ *        the value of the first tuple. Owned by the stack until
+ *        GATT_APP_BUFFER_TRANSMITTED_EVT returns it, closed link or not.
+ */
+typedef struct
+{
+    uint8_t     data[APP_BT_NOTIFY_QUEUE_PDU_LEN];
+    TickType_t  queued_tick[APP_BT_NOTIFY_QUEUE_DEPTH];
+    uint32_t    seq[APP_BT_NOTIFY_QUEUE_DEPTH];
+    uint16_t    len;
+    uint16_t    generation;                     /* Of the queue when sent */
+    uint8_t     slot;
+    uint8_t     count;                          /* Values carried */
+    bool        batch;
+    bool        in_use;
+} app_bt_notify_queue_pdu_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* The BAS task queues, the BT stack task reports transmissions and
+ * congestion; both drain */
+static app_bt_notify_queue_t       app_bt_notify_queues[APP_BT_MAX_CONNECTIONS];
+static app_bt_notify_queue_pdu_t   app_bt_notify_queue_pdus[APP_BT_NOTIFY_QUEUE_PDUS];
+static app_bt_notify_queue_stats_t app_bt_notify_queue_stats;
+static bool                        app_bt_notify_queue_pdu_wait;   /* A link found no free PDU */
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_notify_queue_claim
+ *
+ * Function Description:
+ * @brief  Moves what goes out next into a free PDU buffer: the oldest
+ *         pending value, or when batching, as many pending values in queue
+ *         order as fit in one Multiple Handle Value Notification. Their
+ *         entries are free again on return. Call with the scheduler
+ *         suspended.
+ *
+ * @param slot      Connection slot
+ * @param batch     Whether the link takes multiple notifications
+ * @param mtu       ATT MTU of the link
+ *
+ * @return app_bt_notify_queue_pdu_t *  PDU to send, NULL if nothing may be sent
+ */
+static app_bt_notify_queue_pdu_t *app_bt_notify_queue_claim(uint8_t slot, bool batch, uint16_t mtu)
+{
+    app_bt_notify_queue_t       *p_queue = &app_bt_notify_queues[slot];
+    app_bt_notify_queue_entry_t *pending[APP_BT_NOTIFY_QUEUE_DEPTH];
+    app_bt_notify_queue_entry_t *p_entry;
+    app_bt_notify_queue_pdu_t   *p_pdu = NULL;
+    uint16_t                     len = 0;
+    uint8_t                      num = 0;
+    uint8_t                      i;
+    uint8_t                      j;
+
+    if (p_queue->congested || (p_queue->in_flight >= APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT))
+    {
+        return NULL;
+    }
+    for (i = 0; (i < APP_BT_NOTIFY_QUEUE_PDUS) && (NULL == p_pdu); i++)
+    {
+        if (!app_bt_notify_queue_pdus[i].in_use)
+        {
+            p_pdu = &app_bt_notify_queue_pdus[i];
+        }
+    }
+    if (NULL == p_pdu)
+    {
+        /* Resumed by the next transmitted PDU of any link */
+        app_bt_notify_queue_pdu_wait = true;
+        return NULL;
+    }
+
+    /* Pending entries, oldest first */
+    for (i = 0; i < APP_BT_NOTIFY_QUEUE_DEPTH; i++)
+    {
+        p_entry = &p_queue->entries[i];
+        if (APP_BT_NOTIFY_QUEUE_PENDING != p_entry->state)
+        {
+            continue;
+        }
+        for (j = num; (j > 0) && ((int32_t)(p_entry->seq - pending[j - 1]->seq) < 0); j--)
+        {
+            pending[j] = pending[j - 1];
+        }
+        pending[j] = p_entry;
+        num++;
+    }
+    if (0 == num)
+    {
+        return NULL;
+    }
+
+    /* Handle, length, value tuples; a batch also has the one byte opcode */
+    for (i = 0; i < num; i++)
+    {
+        p_entry = pending[i];
+        if ((i > 0) && (!batch || ((1u + len + 4u + p_entry->len) > mtu)))
+        {
+            break;
+        }
+        p_pdu->data[len++]     = (uint8_t)(p_entry->handle & 0xFF);
+        p_pdu->data[len++]     = (uint8_t)(p_entry->handle >> 8);
+        p_pdu->data[len++]     = (uint8_t)(p_entry->len & 0xFF);
+        p_pdu->data[len++]     = (uint8_t)(p_entry->len >> 8);
+        memcpy(&p_pdu->data[len], p_entry->value, p_entry->len);
+        len                   += p_entry->len;
+        p_pdu->queued_tick[i]  = p_entry->queued_tick;
+        p_pdu->seq[i]          = p_entry->seq;
+        p_entry->state         = APP_BT_NOTIFY_QUEUE_FREE;
+    }
+
+    p_pdu->len        = len;
+    p_pdu->count      = i;
+    p_pdu->batch      = (i > 1);
+    p_pdu->slot       = slot;
+    p_pdu->generation = p_queue->generation;
+    p_pdu->in_use     = true;
+    p_queue->in_flight++;
+    return p_pdu;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_unclaim
+ *
+ * Function Description:
+ * @brief  Returns the values of a PDU the stack refused to the queue, unless
+ *         a newer value of the same handle came in meanwhile, and frees the
+ *         PDU. Call with the scheduler suspended.
+ *
+ * @param p_pdu     Refused PDU
+ *
+ * @return void
+ */
+static void app_bt_notify_queue_unclaim(app_bt_notify_queue_pdu_t *p_pdu)
+{
+    app_bt_notify_queue_t       *p_queue = &app_bt_notify_queues[p_pdu->slot];
+    app_bt_notify_queue_entry_t *p_free;
+    uint16_t                     handle;
+    uint16_t                     len;
+    uint16_t                     off = 0;
+    uint8_t                      i;
+    uint8_t                      j;
+
+    p_queue->in_flight--;
+    for (i = 0; i < p_pdu->count; i++)
+    {
+        handle = (uint16_t)(p_pdu->data[off] | (p_pdu->data[off + 1] << 8));
+        len    = (uint16_t)(p_pdu->data[off + 2] | (p_pdu->data[off + 3] << 8));
+        p_free = NULL;
+        for (j = 0; j < APP_BT_NOTIFY_QUEUE_DEPTH; j++)
+        {
+            if ((APP_BT_NOTIFY_QUEUE_PENDING == p_queue->entries[j].state) &&
+                (p_queue->entries[j].handle == handle))
+            {
+                app_bt_notify_queue_stats.replaced++;
+                p_free = NULL;
+                break;
+            }
+            if ((NULL == p_free) && (APP_BT_NOTIFY_QUEUE_FREE == p_queue->entries[j].state))
+            {
+                p_free = &p_queue->entries[j];
+            }
+        }
+        if (NULL != p_free)
+        {
+            memcpy(p_free->value, &p_pdu->data[off + 4], len);
+            p_free->handle      = handle;
+            p_free->len         = len;
+            p_free->queued_tick = p_pdu->queued_tick[i];
+            p_free->seq         = p_pdu->seq[i];
+            p_free->state       = APP_BT_NOTIFY_QUEUE_PENDING;
+        }
+        else if (APP_BT_NOTIFY_QUEUE_DEPTH == j)
+        {
+            /* Every entry taken by other handles meanwhile */
+            app_bt_notify_queue_stats.errors++;
+        }
+        off += 4u + len;
+    }
+    p_pdu->in_use = false;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_drain
+ *
+ * Function Description:
+ * @brief  Hands the oldest pending values of a connection to the stack while
+ *         it is not congested, fewer than APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT
+ *         PDUs are outstanding and a PDU buffer is free. When the peer set
+ *         the Multiple Handle Value Notifications client feature, pending
+ *         values are batched into one PDU up to the MTU. Values are claimed
+ *         before the stack is called, so the BAS and BT stack tasks may drain
+ *         at the same time.
+ *
+ * @param slot      Connection slot
+ *
+ * @return void
+ */
+static void app_bt_notify_queue_drain(uint8_t slot)
+{
+    app_bt_notify_queue_t     *p_queue = &app_bt_notify_queues[slot];
+    app_bt_notify_queue_pdu_t *p_pdu;
+    wiced_bt_gatt_status_t     status;
+    uint16_t                   conn_id = app_bt_conn_get_conn_id(slot);
+    uint16_t                   mtu     = app_bt_conn_get_mtu(conn_id);
+    bool                       batch;
+
+    while (true)
+    {
+        batch = !p_queue->no_batch &&
+                (0 != (app_bt_conn_get_client_features(conn_id) & APP_BT_CONN_CLIENT_FEAT_MULTI_NOTIF));
+
+        vTaskSuspendAll();
+        p_pdu = app_bt_notify_queue_claim(slot, batch, mtu);
+        (void)xTaskResumeAll();
+
+        if (NULL == p_pdu)
+        {
+            return;
+        }
+
+        if (p_pdu->batch)
+        {
+            status = wiced_bt_gatt_server_send_multiple_notifications(conn_id, p_pdu->len, p_pdu->data,
+                                                                      (void *)app_bt_notify_queue_transmitted);
+        }
+        else
+        {
+            status = wiced_bt_gatt_server_send_notification(conn_id,
+                                                            (uint16_t)(p_pdu->data[0] | (p_pdu->data[1] << 8)),
+                                                            (uint16_t)(p_pdu->len - 4u), &p_pdu->data[4],
+                                                            (void *)app_bt_notify_queue_transmitted);
+        }
+        if (WICED_BT_GATT_SUCCESS == status)
+        {
+            vTaskSuspendAll();
+            if (p_pdu->batch)
+            {
+                app_bt_notify_queue_stats.batches++;
+                app_bt_notify_queue_stats.batched += p_pdu->count;
+            }
+            (void)xTaskResumeAll();
+            continue;
+        }
+
+        vTaskSuspendAll();
+        if (WICED_BT_GATT_CONGESTED == status)
+        {
+            app_bt_notify_queue_stats.congested++;
+            p_queue->congested = true;
+            app_bt_notify_queue_unclaim(p_pdu);
+        }
+        else if (p_pdu->batch)
+        {
+            /* Send the values one by one from now on */
+            app_bt_notify_queue_stats.batch_refused++;
+            p_queue->no_batch = true;
+            app_bt_notify_queue_unclaim(p_pdu);
+        }
+        else
+        {
+            app_bt_notify_queue_stats.errors++;
+            p_queue->in_flight--;
+            p_pdu->in_use = false;
+        }
+        (void)xTaskResumeAll();
+
+        if (WICED_BT_GATT_CONGESTED == status)
+        {
+            /* Resumed by GATT_CONGESTION_EVT or the next transmitted buffer */
+            return;
+        }
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_put
+ *
+ * Function Description:
+ * @brief  Queues a notification without sending it, so values changed in
+ *         the same tick can leave together at app_bt_notify_queue_flush().
+ *         A value still waiting for the same handle is replaced by the newer
+ *         one, keeping its place in the queue.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Characteristic value handle
+ * @param p_val     Value, copied
+ * @param len       Length of the value
+ *
+ * @return wiced_bt_gatt_status_t  WICED_BT_GATT_SUCCESS once queued,
+ *                                 WICED_BT_GATT_BUSY when the queue is full
+ */
+wiced_bt_gatt_status_t app_bt_notify_queue_put(uint16_t conn_id, uint16_t handle,
+                                               const uint8_t *p_val, uint16_t len)
+{
+    app_bt_notify_queue_t       *p_queue;
+    app_bt_notify_queue_entry_t *p_entry = NULL;
+    app_bt_notify_queue_entry_t *p_free  = NULL;
+    wiced_bt_gatt_status_t       status  = WICED_BT_GATT_SUCCESS;
+    uint8_t                      slot;
+    uint8_t                      i;
+
+    if (len > APP_BT_NOTIFY_QUEUE_MAX_VALUE_LEN)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    slot = app_bt_conn_find_slot(conn_id);
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return WICED_BT_GATT_ILLEGAL_PARAMETER;
+    }
+    p_queue = &app_bt_notify_queues[slot];
+
+    vTaskSuspendAll();
+    for (i = 0; i < APP_BT_NOTIFY_QUEUE_DEPTH; i++)
+    {
+        if ((APP_BT_NOTIFY_QUEUE_PENDING == p_queue->entries[i].state) &&
+            (handle == p_queue->entries[i].handle))
+        {
+            p_entry = &p_queue->entries[i];
+            break;
+        }
+        if ((NULL == p_free) && (APP_BT_NOTIFY_QUEUE_FREE == p_queue->entries[i].state))
+        {
+            p_free = &p_queue->entries[i];
+        }
+    }
+
+    if (NULL != p_entry)
+    {
+        app_bt_notify_queue_stats.replaced++;
+    }
+    else if (NULL != p_free)
+    {
+        p_entry         = p_free;
+        p_entry->handle = handle;
+        p_entry->seq    = p_queue->next_seq++;
+        p_entry->state  = APP_BT_NOTIFY_QUEUE_PENDING;
+    }
+    else
+    {
+        app_bt_notify_queue_stats.overflows++;
+        status = WICED_BT_GATT_BUSY;
+    }
+
+    if (NULL != p_entry)
+    {
+        memcpy(p_entry->value, p_val, len);
+        p_entry->len         = len;
+        p_entry->queued_tick = xTaskGetTickCount();
+        app_bt_notify_queue_stats.queued++;
+    }
+    (void)xTaskResumeAll();
+
+    return status;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_flush
+ *
+ * Function Description:
+ * @brief  Sends what is queued on every connection as far as the links allow
+ *
+ * @return void
+ */
+void app_bt_notify_queue_flush(void)
+{
+    uint8_t slot;
+
+    for (slot = 0; slot < APP_BT_MAX_CONNECTIONS; slot++)
+    {
+        if (0 != app_bt_conn_get_conn_id(slot))
+        {
+            app_bt_notify_queue_drain(slot);
+        }
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_send
+ *
+ * Function Description:
+ * @brief  Queues a notification and sends it as soon as the link allows
+ *
+ * @param conn_id   Connection ID
+ * @param handle    Characteristic value handle
+ * @param p_val     Value, copied
+ * @param len       Length of the value
+ *
+ * @return wiced_bt_gatt_status_t  WICED_BT_GATT_SUCCESS once queued,
+ *                                 WICED_BT_GATT_BUSY when the queue is full
+ */
+wiced_bt_gatt_status_t app_bt_notify_queue_send(uint16_t conn_id, uint16_t handle,
+                                                const uint8_t *p_val, uint16_t len)
+{
+    wiced_bt_gatt_status_t status = app_bt_notify_queue_put(conn_id, handle, p_val, len);
+
+    if (WICED_BT_GATT_SUCCESS == status)
+    {
+        app_bt_notify_queue_drain(app_bt_conn_find_slot(conn_id));
+    }
+    return status;
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_transmitted
+ *
+ * Function Description:
+ * @brief  Passed as the application context of every notification, so
+ *         GATT_APP_BUFFER_TRANSMITTED_EVT calls it like a buffer free
+ *         function. Frees the PDU buffer, single value or batch, and sends
+ *         what is queued behind it, on every link when one was waiting for
+ *         a buffer. A PDU of a closed link is only freed.
+ *
+ * @param p_data    Value or batch PDU handed to the stack
+ *
+ * @return void
+ */
+void app_bt_notify_queue_transmitted(uint8_t *p_data)
+{
+    app_bt_notify_queue_pdu_t *p_pdu;
+    app_bt_notify_queue_t     *p_queue;
+    TickType_t                 now;
+    uint32_t                   delay_ms;
+    uint8_t                    slot = APP_BT_CONN_INVALID_SLOT;
+    uint8_t                    i;
+    bool                       found = false;
+    bool                       wait;
+
+    vTaskSuspendAll();
+    now = xTaskGetTickCount();
+    for (i = 0; (i < APP_BT_NOTIFY_QUEUE_PDUS) && !found; i++)
+    {
+        p_pdu = &app_bt_notify_queue_pdus[i];
+        found = p_pdu->in_use && ((p_pdu->data == p_data) || (&p_pdu->data[4] == p_data));
+    }
+    if (found)
+    {
+        p_queue       = &app_bt_notify_queues[p_pdu->slot];
+        p_pdu->in_use = false;
+        if (p_pdu->generation == p_queue->generation)
+        {
+            slot = p_pdu->slot;
+            p_queue->in_flight--;
+            /* A buffer went out, so the link has room again */
+            p_queue->congested = false;
+            for (i = 0; i < p_pdu->count; i++)
+            {
+                delay_ms = (uint32_t)(now - p_pdu->queued_tick[i]) * portTICK_PERIOD_MS;
+                app_bt_notify_queue_stats.sent++;
+                app_bt_notify_queue_stats.delay_sum_ms += delay_ms;
+                if (delay_ms > app_bt_notify_queue_stats.delay_max_ms)
+                {
+                    app_bt_notify_queue_stats.delay_max_ms = delay_ms;
+                }
+            }
+        }
+    }
+    wait = found && app_bt_notify_queue_pdu_wait;
+    app_bt_notify_queue_pdu_wait = app_bt_notify_queue_pdu_wait && !found;
+    (void)xTaskResumeAll();
+
+    if (wait)
+    {
+        app_bt_notify_queue_flush();
+    }
+    else if (APP_BT_CONN_INVALID_SLOT != slot)
+    {
+        app_bt_notify_queue_drain(slot);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_congestion
+ *
+ * Function Description:
+ * @brief  Tracks GATT_CONGESTION_EVT, the queue is drained again once the
+ *         link clears
+ *
+ * @param conn_id   Connection ID
+ * @param congested WICED_TRUE while the stack is out of buffers for the link
+ *
+ * @return void
+ */
+void app_bt_notify_queue_congestion(uint16_t conn_id, wiced_bool_t congested)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    app_bt_notify_queues[slot].congested = (WICED_TRUE == congested);
+    (void)xTaskResumeAll();
+
+    if (WICED_TRUE != congested)
+    {
+        app_bt_notify_queue_drain(slot);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_close
+ *
+ * Function Description:
+ * @brief  Drops everything queued for a connection. Call on disconnection
+ *         before the slot is released. PDUs the stack still holds stay
+ *         taken until reported transmitted and are not credited to the
+ *         next link of the slot.
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_notify_queue_close(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    memset(app_bt_notify_queues[slot].entries, 0, sizeof(app_bt_notify_queues[slot].entries));
+    app_bt_notify_queues[slot].in_flight = 0;
+    app_bt_notify_queues[slot].congested = false;
+    app_bt_notify_queues[slot].no_batch  = false;
+    app_bt_notify_queues[slot].generation++;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the queue counters
+ *
+ * @param p_stats   Destination
+ *
+ * @return void
+ */
+void app_bt_notify_queue_get_stats(app_bt_notify_queue_stats_t *p_stats)
+{
+    vTaskSuspendAll();
+    *p_stats = app_bt_notify_queue_stats;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_notify_queue_print
+ *
+ * Function Description:
+ * @brief  Prints the queue counters and delays on the UART
+ *
+ * @return void
+ */
+void app_bt_notify_queue_print(void)
+{
+    app_bt_notify_queue_stats_t stats;
+
+    app_bt_notify_queue_get_stats(&stats);
+    printf("Notify queue: queued %lu sent %lu replaced %lu overflows %lu congested %lu errors %lu\r\n",
+           (unsigned long)stats.queued, (unsigned long)stats.sent,
+           (unsigned long)stats.replaced, (unsigned long)stats.overflows,
+           (unsigned long)stats.congested, (unsigned long)stats.errors);
+    printf("  batches %lu carrying %lu values, %lu PDUs saved, refused %lu\r\n",
+           (unsigned long)stats.batches, (unsigned long)stats.batched,
+           (unsigned long)(stats.batched - stats.batches), (unsigned long)stats.batch_refused);
+    printf("  delay avg %lu ms max %lu ms\r\n",
+           (unsigned long)((0 != stats.sent) ? (stats.delay_sum_ms / stats.sent) : 0),
+           (unsigned long)stats.delay_max_ms);
+}
+
+
+/* [] END OF FILE */
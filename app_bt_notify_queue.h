@@ -0,0 +1,135 @@
+/******************************************************************************
+* File Name:   app_bt_notify_queue.h
+*
+* Description: This file contains the declarations of the per connection
+*                           notification queue
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_NOTIFY_QUEUE_H__
+#define __APP_BT_NOTIFY_QUEUE_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+#include "app_bt_conn.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Values waiting per connection, one per handle. Values handed to
+ *        the stack move to a PDU buffer, so a slow link never leaves a
+ *        handle without room.
+ */
+#ifndef APP_BT_NOTIFY_QUEUE_DEPTH
+#define APP_BT_NOTIFY_QUEUE_DEPTH               (4u)
+#endif
+
+/**
+ * @brief Notification PDUs handed to the stack per connection and not yet
+ *        reported by GATT_APP_BUFFER_TRANSMITTED_EVT
+ */
+#ifndef APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT
+#define APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT       (2u)
+#endif
+
+/**
+ * @brief Largest value queued, the default ATT MTU minus the opcode and
+ *        handle
+ */
+#ifndef APP_BT_NOTIFY_QUEUE_MAX_VALUE_LEN
+#define APP_BT_NOTIFY_QUEUE_MAX_VALUE_LEN       (APP_BT_CONN_DEFAULT_MTU - 3u)
+#endif
+
+/**
+ * @brief PDU buffers shared by all connections. Each holds one notification
+ *        or one Multiple Handle Value Notification from the send until
+ *        GATT_APP_BUFFER_TRANSMITTED_EVT returns it, also across a
+ *        disconnection. Separate from the GATT response pool.
+ */
+#ifndef APP_BT_NOTIFY_QUEUE_PDUS
+#define APP_BT_NOTIFY_QUEUE_PDUS                (APP_BT_MAX_CONNECTIONS * APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT)
+#endif
+
+/**
+ * @brief Size of a PDU buffer: the handle, length, value tuples of every
+ *        value of a queue
+ */
+#define APP_BT_NOTIFY_QUEUE_PDU_LEN             (APP_BT_NOTIFY_QUEUE_DEPTH * (4u + APP_BT_NOTIFY_QUEUE_MAX_VALUE_LEN))
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Queue counters, summed over all connections
+ */
+typedef struct
+{
+    uint32_t queued;                            /* Values accepted */
+    uint32_t sent;                              /* Reported transmitted */
+    uint32_t replaced;                          /* Queued values superseded by a newer one */
+    uint32_t overflows;                         /* Values refused, queue full */
+    uint32_t congested;                         /* Sends refused by the stack as congested */
+    uint32_t errors;                            /* Values dropped on another send error */
+    uint32_t batches;                           /* Multiple Handle Value Notifications sent */
+    uint32_t batched;                           /* Values they carried, batched - batches PDUs saved */
+    uint32_t batch_refused;                     /* Batches the stack refused, link falls back */
+    uint32_t delay_max_ms;                      /* Longest queued to transmitted time */
+    uint32_t delay_sum_ms;                      /* Sum over all sent values */
+} app_bt_notify_queue_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_bt_gatt_status_t app_bt_notify_queue_send         (uint16_t conn_id, uint16_t handle,
+                                                         const uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_notify_queue_put          (uint16_t conn_id, uint16_t handle,
+                                                         const uint8_t *p_val, uint16_t len);
+void                   app_bt_notify_queue_flush        (void);
+void                   app_bt_notify_queue_transmitted  (uint8_t *p_data);
+void                   app_bt_notify_queue_congestion   (uint16_t conn_id,
+                                                         wiced_bool_t congested);
+void                   app_bt_notify_queue_close        (uint16_t conn_id);
+void                   app_bt_notify_queue_get_stats    (app_bt_notify_queue_stats_t *p_stats);
+void                   app_bt_notify_queue_print        (void);
+
+#endif      /*__APP_BT_NOTIFY_QUEUE_H__ */
+
+
+/* [] END OF FILE */
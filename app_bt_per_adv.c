@@ -0,0 +1,406 @@
+/******************************************************************************
+* File Name:   app_bt_per_adv.c
+*
+* Description: This file broadcasts the battery level and status on a periodic
+*                           advertising train and accounts for its airtime
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_per_adv.h"
+#include "wiced_bt_uuid.h"
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/* Periodic interval in 1.25 ms and extended interval in 0.625 ms units */
+#define APP_BT_PER_ADV_INTERVAL_UNITS       (((APP_BT_PER_ADV_INTERVAL_MS * 4u) + 2u) / 5u)
+#define APP_BT_PER_ADV_EXT_INTERVAL_UNITS   (((APP_BT_PER_ADV_EXT_INTERVAL_MS * 8u) + 2u) / 5u)
+
+#if (APP_BT_PER_ADV_INTERVAL_UNITS < 6u) || (APP_BT_PER_ADV_INTERVAL_UNITS > 0xFFFFu)
+#error "APP_BT_PER_ADV_INTERVAL_MS out of range"
+#endif
+#if (APP_BT_PER_ADV_EXT_INTERVAL_UNITS < 0x20u) || (APP_BT_PER_ADV_EXT_INTERVAL_UNITS > 0xFFFFFFu)
+#error "APP_BT_PER_ADV_EXT_INTERVAL_MS out of range"
+#endif
+
+/* Mean of the random 0-10 ms advDelay added to each extended advertising event */
+#define APP_BT_PER_ADV_DELAY_MEAN_US        (5000u)
+
+/* On air: preamble (LE 1M), access address, header and CRC */
+#define APP_BT_PER_ADV_PDU_OVERHEAD         (1u + 4u + 2u + 3u)
+#define APP_BT_PER_ADV_US_PER_BYTE_1M       (8u)
+
+/* Extended header of each PDU: length and mode byte, then the flags byte
+ * and the fields present */
+#define APP_BT_PER_ADV_EXT_IND_HDR          (1u + 1u + 2u + 3u)         /* ADI, AuxPtr */
+#define APP_BT_PER_ADV_AUX_ADV_IND_HDR      (1u + 1u + 6u + 2u + 18u)   /* AdvA, ADI, SyncInfo */
+#define APP_BT_PER_ADV_AUX_SYNC_IND_HDR     (1u)                        /* No fields */
+
+/* Position of the fields in the periodic advertising data */
+#define APP_BT_PER_ADV_LEVEL_OFFSET         (4u)
+#define APP_BT_PER_ADV_STATUS_OFFSET        (5u)
+#define APP_BT_PER_ADV_SEQ_OFFSET           (6u)
+
+#define APP_BT_PER_ADV_OK(result)           ((WICED_BT_SUCCESS == (result)) || \
+                                             (WICED_BT_PENDING == (result)))
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+/* Configured advertising elements, serialized for the AUX_ADV_IND */
+static uint8_t  app_bt_per_adv_ext_data[APP_BT_PER_ADV_EXT_DATA_MAX];
+
+/* Battery Service data of the periodic train, rewritten in place */
+static uint8_t  app_bt_per_adv_data[APP_BT_PER_ADV_DATA_LEN];
+
+/* Written by the BAS task, read by others with the scheduler suspended */
+static app_bt_per_adv_stats_t app_bt_per_adv_stats;
+static bool                   app_bt_per_adv_running;
+static TickType_t             app_bt_per_adv_last_tick;
+static uint64_t               app_bt_per_adv_report_ms;
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_per_adv_pdu_us
+ *
+ * Function Description:
+ * @brief  Time a PDU takes on air
+ *
+ * @param payload    PDU payload in bytes
+ * @param secondary  true for the secondary advertising PHY
+ *
+ * @return uint16_t  Transmit time in us
+ */
+static uint16_t app_bt_per_adv_pdu_us(uint32_t payload, bool secondary)
+{
+    if (secondary && APP_BT_PER_ADV_SECONDARY_2M)
+    {
+        /* Two byte preamble, half the time per byte */
+        return (uint16_t)((APP_BT_PER_ADV_PDU_OVERHEAD + 1u + payload) *
+                          (APP_BT_PER_ADV_US_PER_BYTE_1M / 2u));
+    }
+    return (uint16_t)((APP_BT_PER_ADV_PDU_OVERHEAD + payload) * APP_BT_PER_ADV_US_PER_BYTE_1M);
+}
+
+/**
+ * Function Name:
+ * app_bt_per_adv_account
+ *
+ * Function Description:
+ * @brief  Adds the time since the last call to the airtime accounting.
+ *         Extended advertising events recur every interval plus the mean
+ *         advDelay and send ADV_EXT_IND on three channels and one
+ *         AUX_ADV_IND; periodic events send one AUX_SYNC_IND.
+ *
+ * @return void
+ */
+static void app_bt_per_adv_account(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    uint64_t   elapsed_us;
+
+    vTaskSuspendAll();
+    app_bt_per_adv_stats.elapsed_ms += (uint32_t)(now - app_bt_per_adv_last_tick) *
+                                       portTICK_PERIOD_MS;
+    app_bt_per_adv_last_tick = now;
+    elapsed_us = app_bt_per_adv_stats.elapsed_ms * 1000u;
+    app_bt_per_adv_stats.tx_us =
+        (elapsed_us / ((APP_BT_PER_ADV_EXT_INTERVAL_UNITS * 625u) + APP_BT_PER_ADV_DELAY_MEAN_US)) *
+        (app_bt_per_adv_stats.primary_us + app_bt_per_adv_stats.aux_us) +
+        (elapsed_us / (APP_BT_PER_ADV_INTERVAL_UNITS * 1250u)) * app_bt_per_adv_stats.sync_us;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_per_adv_start
+ *
+ * Function Description:
+ * @brief  Starts broadcasting instead of connectable legacy advertising. A
+ *         non-connectable extended advertising set carries the configured
+ *         advertising elements and points scanners at a periodic train,
+ *         which carries the battery level and status. Listeners sync to the
+ *         train and receive every update without a connection.
+ *
+ * @param p_elems   Configured advertising data, cy_bt_adv_packet_data
+ * @param num_elem  Number of elements, CY_BT_ADV_PACKET_DATA_SIZE
+ * @param level     Battery level to start with, in percent
+ * @param status    APP_BT_PER_ADV_STATUS_* of the level source
+ *
+ * @return wiced_result_t  WICED_BT_SUCCESS, or the first error of the stack
+ */
+wiced_result_t app_bt_per_adv_start(const wiced_bt_ble_advert_elem_t *p_elems,
+                                    uint8_t num_elem, uint8_t level, uint8_t status)
+{
+    wiced_bt_ble_ext_adv_duration_config_t duration =
+    {
+        .adv_handle         = APP_BT_PER_ADV_HANDLE,
+        .adv_duration       = 0,                /* Until stopped */
+        .max_ext_adv_events = 0,
+    };
+    wiced_bt_device_address_t peer_addr = { 0 };
+    wiced_bt_ble_ext_adv_phy_t secondary_phy = APP_BT_PER_ADV_SECONDARY_2M ?
+                                               WICED_BT_BLE_EXT_ADV_PHY_2M :
+                                               WICED_BT_BLE_EXT_ADV_PHY_1M;
+    wiced_result_t result;
+    uint16_t       len = 0;
+    uint8_t        i;
+
+    memset(&app_bt_per_adv_stats, 0, sizeof(app_bt_per_adv_stats));
+    app_bt_per_adv_running = false;
+
+    for (i = 0; i < num_elem; i++)
+    {
+        if (len + p_elems[i].len + 2u > sizeof(app_bt_per_adv_ext_data))
+        {
+            printf("Broadcast: advertising element 0x%02x left out\r\n", p_elems[i].advert_type);
+            continue;
+        }
+        app_bt_per_adv_ext_data[len++] = (uint8_t)(p_elems[i].len + 1u);
+        app_bt_per_adv_ext_data[len++] = (uint8_t)p_elems[i].advert_type;
+        memcpy(&app_bt_per_adv_ext_data[len], p_elems[i].p_data, p_elems[i].len);
+        len = (uint16_t)(len + p_elems[i].len);
+    }
+
+    app_bt_per_adv_data[0] = APP_BT_PER_ADV_DATA_LEN - 1u;
+    app_bt_per_adv_data[1] = BTM_BLE_ADVERT_TYPE_SERVICE_DATA;
+    app_bt_per_adv_data[2] = (uint8_t)(UUID_SERVICE_BATTERY & 0xFFu);
+    app_bt_per_adv_data[3] = (uint8_t)(UUID_SERVICE_BATTERY >> 8);
+    if (level <= APP_BT_PER_ADV_LOW_PCT)
+    {
+        status |= APP_BT_PER_ADV_STATUS_LOW;
+    }
+    app_bt_per_adv_data[APP_BT_PER_ADV_LEVEL_OFFSET] = level;
+    app_bt_per_adv_data[APP_BT_PER_ADV_STATUS_OFFSET] = status;
+    app_bt_per_adv_data[APP_BT_PER_ADV_SEQ_OFFSET] = 0;
+
+    /* Periodic advertising requires a non-connectable, non-scannable set */
+    result = wiced_bt_ble_set_ext_adv_parameters_v2(APP_BT_PER_ADV_HANDLE,
+                                                    (wiced_bt_ble_ext_adv_event_property_t)0,
+                                                    APP_BT_PER_ADV_EXT_INTERVAL_UNITS,
+                                                    APP_BT_PER_ADV_EXT_INTERVAL_UNITS,
+                                                    BTM_BLE_DEFAULT_ADVERT_CHNL_MAP,
+                                                    BLE_ADDR_PUBLIC, BLE_ADDR_PUBLIC, peer_addr,
+                                                    BTM_BLE_ADV_POLICY_ACCEPT_CONN_AND_SCAN,
+                                                    127,    /* No Tx power preference */
+                                                    WICED_BT_BLE_EXT_ADV_PHY_1M, 0,
+                                                    secondary_phy, APP_BT_PER_ADV_SID,
+                                                    WICED_BT_BLE_EXT_ADV_SCAN_REQ_NOTIFY_DISABLE,
+                                                    WICED_BT_BLE_EXT_ADV_PHY_OPTIONS_NO_PREFERENCE,
+                                                    WICED_BT_BLE_EXT_ADV_PHY_OPTIONS_NO_PREFERENCE);
+    if (APP_BT_PER_ADV_OK(result))
+    {
+        result = wiced_bt_ble_set_ext_adv_data(APP_BT_PER_ADV_HANDLE, len, app_bt_per_adv_ext_data);
+    }
+    if (APP_BT_PER_ADV_OK(result))
+    {
+        result = wiced_bt_ble_set_periodic_adv_params(APP_BT_PER_ADV_HANDLE,
+                                                      APP_BT_PER_ADV_INTERVAL_UNITS,
+                                                      APP_BT_PER_ADV_INTERVAL_UNITS,
+                                                      (wiced_bt_ble_periodic_adv_prop_t)0);
+    }
+    if (APP_BT_PER_ADV_OK(result))
+    {
+        result = wiced_bt_ble_set_periodic_adv_data(APP_BT_PER_ADV_HANDLE,
+                                                    APP_BT_PER_ADV_DATA_LEN, app_bt_per_adv_data);
+    }
+    /* The train runs before the set that announces it is enabled */
+    if (APP_BT_PER_ADV_OK(result))
+    {
+        result = wiced_bt_ble_start_periodic_adv(APP_BT_PER_ADV_HANDLE, WICED_TRUE);
+    }
+    if (APP_BT_PER_ADV_OK(result))
+    {
+        result = wiced_bt_ble_start_ext_adv(WICED_TRUE, 1, &duration);
+    }
+    if (!APP_BT_PER_ADV_OK(result))
+    {
+        printf("Broadcast: cannot start, error %d\r\n", result);
+        return result;
+    }
+
+    app_bt_per_adv_stats.level = level;
+    app_bt_per_adv_stats.status = status;
+    app_bt_per_adv_stats.ext_data_len = len;
+    app_bt_per_adv_stats.primary_us = (uint16_t)(3u * app_bt_per_adv_pdu_us(APP_BT_PER_ADV_EXT_IND_HDR,
+                                                                           false));
+    app_bt_per_adv_stats.aux_us = app_bt_per_adv_pdu_us(APP_BT_PER_ADV_AUX_ADV_IND_HDR + len, true);
+    app_bt_per_adv_stats.sync_us = app_bt_per_adv_pdu_us(APP_BT_PER_ADV_AUX_SYNC_IND_HDR +
+                                                         APP_BT_PER_ADV_DATA_LEN, true);
+    app_bt_per_adv_stats.tx_us_per_s =
+        (uint32_t)(((uint64_t)(app_bt_per_adv_stats.primary_us + app_bt_per_adv_stats.aux_us) *
+                    1000000u) /
+                   ((APP_BT_PER_ADV_EXT_INTERVAL_UNITS * 625u) + APP_BT_PER_ADV_DELAY_MEAN_US) +
+                   ((uint64_t)app_bt_per_adv_stats.sync_us * 1000000u) /
+                   (APP_BT_PER_ADV_INTERVAL_UNITS * 1250u));
+    app_bt_per_adv_last_tick = xTaskGetTickCount();
+    app_bt_per_adv_report_ms = 0;
+    app_bt_per_adv_running = true;
+    app_bt_per_adv_print();
+    return WICED_BT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_per_adv_update
+ *
+ * Function Description:
+ * @brief  Broadcasts a new level and status. The data is rewritten while the
+ *         train runs and goes out from the next periodic event on, with a
+ *         new sequence number so listeners can tell it from a repeat.
+ *         Unchanged values cost nothing. Also brings the airtime accounting
+ *         up to date and prints it every APP_BT_PER_ADV_REPORT_S.
+ *
+ * @param level   Battery level in percent
+ * @param status  APP_BT_PER_ADV_STATUS_* of the level source
+ *
+ * @return void
+ */
+void app_bt_per_adv_update(uint8_t level, uint8_t status)
+{
+    wiced_result_t result;
+
+    if (!app_bt_per_adv_running)
+    {
+        return;
+    }
+    app_bt_per_adv_account();
+    if ((0u != APP_BT_PER_ADV_REPORT_S) &&
+        (app_bt_per_adv_stats.elapsed_ms - app_bt_per_adv_report_ms >=
+         APP_BT_PER_ADV_REPORT_S * 1000u))
+    {
+        app_bt_per_adv_report_ms = app_bt_per_adv_stats.elapsed_ms;
+        app_bt_per_adv_print();
+    }
+
+    if (level <= APP_BT_PER_ADV_LOW_PCT)
+    {
+        status |= APP_BT_PER_ADV_STATUS_LOW;
+    }
+    if ((level == app_bt_per_adv_stats.level) && (status == app_bt_per_adv_stats.status))
+    {
+        app_bt_per_adv_stats.unchanged++;
+        return;
+    }
+
+    app_bt_per_adv_data[APP_BT_PER_ADV_LEVEL_OFFSET] = level;
+    app_bt_per_adv_data[APP_BT_PER_ADV_STATUS_OFFSET] = status;
+    app_bt_per_adv_data[APP_BT_PER_ADV_SEQ_OFFSET] = (uint8_t)(app_bt_per_adv_stats.seq + 1u);
+    result = wiced_bt_ble_set_periodic_adv_data(APP_BT_PER_ADV_HANDLE, APP_BT_PER_ADV_DATA_LEN,
+                                                app_bt_per_adv_data);
+
+    vTaskSuspendAll();
+    if (APP_BT_PER_ADV_OK(result))
+    {
+        /* A failed value is retried at the next update */
+        app_bt_per_adv_stats.level = level;
+        app_bt_per_adv_stats.status = status;
+        app_bt_per_adv_stats.seq++;
+        app_bt_per_adv_stats.updates++;
+    }
+    else
+    {
+        app_bt_per_adv_stats.failed++;
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_per_adv_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the update counters and the airtime accounting
+ *
+ * @param p_stats  Destination
+ *
+ * @return void
+ */
+void app_bt_per_adv_get_stats(app_bt_per_adv_stats_t *p_stats)
+{
+    vTaskSuspendAll();
+    *p_stats = app_bt_per_adv_stats;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_per_adv_print
+ *
+ * Function Description:
+ * @brief  Prints the broadcast rates, the airtime of each kind of PDU, the
+ *         transmit duty cycle and the update counters
+ *
+ * @return void
+ */
+void app_bt_per_adv_print(void)
+{
+    app_bt_per_adv_stats_t stats;
+
+    app_bt_per_adv_get_stats(&stats);
+    printf("Broadcast: periodic every %lu.%02lu ms, extended every %lu.%03lu ms, level %u, "
+           "status 0x%02x\r\n",
+           (unsigned long)((APP_BT_PER_ADV_INTERVAL_UNITS * 125u) / 100u),
+           (unsigned long)((APP_BT_PER_ADV_INTERVAL_UNITS * 125u) % 100u),
+           (unsigned long)((APP_BT_PER_ADV_EXT_INTERVAL_UNITS * 625u) / 1000u),
+           (unsigned long)((APP_BT_PER_ADV_EXT_INTERVAL_UNITS * 625u) % 1000u),
+           stats.level, stats.status);
+    printf("  airtime: ADV_EXT_IND x3 %u us, AUX_ADV_IND %u us (%u data bytes), "
+           "AUX_SYNC_IND %u us\r\n",
+           stats.primary_us, stats.aux_us, stats.ext_data_len, stats.sync_us);
+    printf("  transmit %lu us/s (%lu.%03lu %% duty), %lu ms over %lu s\r\n",
+           (unsigned long)stats.tx_us_per_s,
+           (unsigned long)(stats.tx_us_per_s / 10000u),
+           (unsigned long)((stats.tx_us_per_s / 10u) % 1000u),
+           (unsigned long)(stats.tx_us / 1000u), (unsigned long)(stats.elapsed_ms / 1000u));
+    printf("  %lu updates, %lu unchanged, %lu failed\r\n",
+           (unsigned long)stats.updates, (unsigned long)stats.unchanged,
+           (unsigned long)stats.failed);
+}
+
+
+/* [] END OF FILE */
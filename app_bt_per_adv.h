@@ -0,0 +1,166 @@
+/******************************************************************************
+* File Name:   app_bt_per_adv.h
+*
+* Description: This file contains the declarations of the extended and periodic
+*                           advertising broadcast of the battery level
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_PER_ADV_H__
+#define __APP_BT_PER_ADV_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_ble.h"
+#include "wiced_bt_dev.h"
+#include "app_bt_notify_policy.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(APP_BT_PERIODIC_ADV) && APP_BT_PERIODIC_ADV && \
+    defined(APP_BT_ADV_BAS) && APP_BT_ADV_BAS
+#error "BAS_BROADCAST and BAS_ADV_DATA both set the advertising data, choose one"
+#endif
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Periodic advertising interval in ms, 8 to 81918. Each event
+ *        repeats the battery level and status to every synced listener.
+ */
+#ifndef APP_BT_PER_ADV_INTERVAL_MS
+#define APP_BT_PER_ADV_INTERVAL_MS          (1000u)
+#endif
+
+/**
+ * @brief Extended advertising interval in ms, 20 or more. Its events only
+ *        let scanners find the train and sync to it, a long interval saves
+ *        airtime at the cost of a slower first sync.
+ */
+#ifndef APP_BT_PER_ADV_EXT_INTERVAL_MS
+#define APP_BT_PER_ADV_EXT_INTERVAL_MS      (1280u)
+#endif
+
+/**
+ * @brief Advertising set handle and Advertising SID
+ */
+#ifndef APP_BT_PER_ADV_HANDLE
+#define APP_BT_PER_ADV_HANDLE               (1u)
+#endif
+#ifndef APP_BT_PER_ADV_SID
+#define APP_BT_PER_ADV_SID                  (1u)
+#endif
+
+/**
+ * @brief Set to 1 to send the AUX_ADV_IND and AUX_SYNC_IND PDUs on LE 2M,
+ *        halving their airtime. Listeners must support LE 2M.
+ */
+#ifndef APP_BT_PER_ADV_SECONDARY_2M
+#define APP_BT_PER_ADV_SECONDARY_2M         (0u)
+#endif
+
+/**
+ * @brief Level in percent at or below which APP_BT_PER_ADV_STATUS_LOW is
+ *        set, the default critical level of the notification policy
+ */
+#ifndef APP_BT_PER_ADV_LOW_PCT
+#define APP_BT_PER_ADV_LOW_PCT              (APP_BT_NOTIFY_POLICY_CRITICAL_PCT)
+#endif
+
+/**
+ * @brief Period of the airtime report on the console, in s. 0 disables it.
+ */
+#ifndef APP_BT_PER_ADV_REPORT_S
+#define APP_BT_PER_ADV_REPORT_S             (600u)
+#endif
+
+/**
+ * @brief Room for the extended advertising data, the configured
+ *        advertising elements. Kept within a single AUX_ADV_IND.
+ */
+#ifndef APP_BT_PER_ADV_EXT_DATA_MAX
+#define APP_BT_PER_ADV_EXT_DATA_MAX         (96u)
+#endif
+
+/**
+ * @brief Periodic advertising data: one Service Data element of the
+ *        Battery Service UUID, little endian, followed by the level in
+ *        percent, the status (APP_BT_PER_ADV_STATUS_*) and a sequence number
+ *        that changes with every new value
+ */
+#define APP_BT_PER_ADV_DATA_LEN             (7u)
+
+#define APP_BT_PER_ADV_STATUS_MEASURED      (0x01u)     /* Level from the battery measurement */
+#define APP_BT_PER_ADV_STATUS_LOW           (0x02u)     /* At or below APP_BT_PER_ADV_LOW_PCT */
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Update counters and airtime accounting since app_bt_per_adv_start()
+ */
+typedef struct
+{
+    uint32_t updates;                           /* Periodic data rewritten */
+    uint32_t unchanged;                         /* Updates skipped, nothing changed */
+    uint32_t failed;                            /* Rewrites the stack refused */
+    uint8_t  level;                             /* Level currently broadcast */
+    uint8_t  status;                            /* Status currently broadcast */
+    uint8_t  seq;                               /* Sequence number currently broadcast */
+    uint16_t ext_data_len;                      /* AUX_ADV_IND advertising data, bytes */
+    uint16_t primary_us;                        /* ADV_EXT_IND on all three channels */
+    uint16_t aux_us;                            /* AUX_ADV_IND */
+    uint16_t sync_us;                           /* AUX_SYNC_IND */
+    uint32_t tx_us_per_s;                       /* Mean transmit time per second */
+    uint64_t elapsed_ms;                        /* Broadcasting, up to the last update */
+    uint64_t tx_us;                             /* Transmit time over elapsed_ms */
+} app_bt_per_adv_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_result_t app_bt_per_adv_start     (const wiced_bt_ble_advert_elem_t *p_elems,
+                                         uint8_t num_elem, uint8_t level, uint8_t status);
+void           app_bt_per_adv_update    (uint8_t level, uint8_t status);
+void           app_bt_per_adv_get_stats (app_bt_per_adv_stats_t *p_stats);
+void           app_bt_per_adv_print     (void);
+
+#endif      /*__APP_BT_PER_ADV_H__ */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,429 @@
+/******************************************************************************
+* File Name:   app_bt_sched.c
+*
+* Description: This file implements the battery level update timer: a FreeRTOS
+*                           software timer, optionally aligned to connection events
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_sched.h"
+#include "wiced_bt_ble.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS header file */
+#include <timers.h>
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Connection event timing of one connection slot
+ */
+typedef struct
+{
+    uint32_t   interval_us;                     /* Events attended, 0 while unknown */
+    TickType_t anchor_tick;                     /* Last tick a connection event was seen */
+    bool       anchor_valid;
+} app_bt_sched_conn_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static TimerHandle_t app_bt_sched_timer;
+static TaskHandle_t  app_bt_sched_task;
+static TickType_t    app_bt_sched_period;
+static TickType_t    app_bt_sched_due;      /* Nominal tick of the next expiry */
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+static StaticTimer_t app_bt_sched_timer_buf;
+#endif
+
+/* Written by the BT stack task, read by the timer task */
+static app_bt_sched_conn_t app_bt_sched_conns[APP_BT_MAX_CONNECTIONS];
+static uint8_t             app_bt_sched_ref_slot = APP_BT_CONN_INVALID_SLOT;
+
+static app_bt_sched_stats_t app_bt_sched_stats;
+
+/*******************************************************************************
+*        Function Prototypes
+*******************************************************************************/
+static void       app_bt_sched_timer_cb (TimerHandle_t timer);
+static TickType_t app_bt_sched_next     (TickType_t now, TickType_t due);
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_sched_init
+ *
+ * Function Description:
+ * @brief  Creates the update timer. It is a FreeRTOS software timer, so with
+ *         tickless idle the device sleeps until it is due and no hardware
+ *         timer or interrupt stays active in between.
+ *
+ * @param task       Task notified on each expiry
+ * @param period_ms  Nominal update period in ms
+ *
+ * @return wiced_bool_t  WICED_TRUE if the timer was created
+ */
+wiced_bool_t app_bt_sched_init(TaskHandle_t task, uint32_t period_ms)
+{
+    app_bt_sched_task   = task;
+    app_bt_sched_period = pdMS_TO_TICKS(period_ms);
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+    app_bt_sched_timer = xTimerCreateStatic("BAS Timer", app_bt_sched_period, pdTRUE, NULL,
+                                            app_bt_sched_timer_cb, &app_bt_sched_timer_buf);
+#else
+    app_bt_sched_timer = xTimerCreate("BAS Timer", app_bt_sched_period, pdTRUE, NULL,
+                                      app_bt_sched_timer_cb);
+#endif
+    return (NULL != app_bt_sched_timer) ? WICED_TRUE : WICED_FALSE;
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_start
+ *
+ * Function Description:
+ * @brief  Starts the update timer
+ *
+ * @return wiced_bool_t  WICED_TRUE if the timer was started
+ */
+wiced_bool_t app_bt_sched_start(void)
+{
+    if (NULL == app_bt_sched_timer)
+    {
+        return WICED_FALSE;
+    }
+
+    app_bt_sched_due = xTaskGetTickCount() + app_bt_sched_period;
+    if (pdPASS != xTimerStart(app_bt_sched_timer, 0))
+    {
+        return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_conn_open
+ *
+ * Function Description:
+ * @brief  Records the interval of a new connection. The connection is
+ *         established at its first connection event, which is taken as the
+ *         first anchor. Call after app_bt_conn_open().
+ *
+ * @param conn_id   Connection ID
+ * @param bd_addr   Peer address
+ *
+ * @return void
+ */
+void app_bt_sched_conn_open(uint16_t conn_id, wiced_bt_device_address_t bd_addr)
+{
+    wiced_bt_ble_conn_params_t params;
+
+    if (WICED_BT_SUCCESS != wiced_bt_ble_get_connection_parameters(bd_addr, &params))
+    {
+        return;
+    }
+    app_bt_sched_conn_update(bd_addr, params.conn_interval, params.conn_latency);
+    app_bt_sched_conn_event(conn_id);
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_conn_update
+ *
+ * Function Description:
+ * @brief  Records new connection parameters. With peripheral latency the
+ *         link layer may skip all but every (latency + 1)th event while idle,
+ *         so updates are aligned to those. The update completes at a
+ *         connection event, so this also sets the anchor.
+ *
+ * @param bd_addr        Peer address
+ * @param conn_interval  Connection interval in 1.25 ms units
+ * @param conn_latency   Peripheral latency in connection events
+ *
+ * @return void
+ */
+void app_bt_sched_conn_update(wiced_bt_device_address_t bd_addr, uint16_t conn_interval,
+                              uint16_t conn_latency)
+{
+    const uint8_t *p_addr;
+    uint16_t       conn_id;
+    uint8_t        slot;
+
+    for (slot = 0; slot < APP_BT_MAX_CONNECTIONS; slot++)
+    {
+        conn_id = app_bt_conn_get_conn_id(slot);
+        p_addr  = app_bt_conn_get_peer_addr(conn_id);
+        if ((0 != conn_id) && (NULL != p_addr) && (0 == memcmp(p_addr, bd_addr, BD_ADDR_LEN)))
+        {
+            vTaskSuspendAll();
+            app_bt_sched_conns[slot].interval_us = conn_interval * 1250uL * (conn_latency + 1uL);
+            (void)xTaskResumeAll();
+
+            app_bt_sched_conn_event(conn_id);
+            return;
+        }
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_conn_event
+ *
+ * Function Description:
+ * @brief  Records that a connection event of a connection just took place,
+ *         for instance because a request of the peer was received in it.
+ *         The connection with the most recent event is the one updates are
+ *         aligned to.
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_sched_conn_event(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    app_bt_sched_conns[slot].anchor_tick  = xTaskGetTickCount();
+    app_bt_sched_conns[slot].anchor_valid = true;
+    if (0 != app_bt_sched_conns[slot].interval_us)
+    {
+        app_bt_sched_ref_slot = slot;
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_conn_close
+ *
+ * Function Description:
+ * @brief  Forgets the timing of a connection. Call before app_bt_conn_close().
+ *
+ * @param conn_id   Connection ID
+ *
+ * @return void
+ */
+void app_bt_sched_conn_close(uint16_t conn_id)
+{
+    uint8_t slot = app_bt_conn_find_slot(conn_id);
+
+    if (APP_BT_CONN_INVALID_SLOT == slot)
+    {
+        return;
+    }
+
+    vTaskSuspendAll();
+    memset(&app_bt_sched_conns[slot], 0, sizeof(app_bt_sched_conns[slot]));
+    if (app_bt_sched_ref_slot == slot)
+    {
+        app_bt_sched_ref_slot = APP_BT_CONN_INVALID_SLOT;
+    }
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_next
+ *
+ * Function Description:
+ * @brief  Returns the time to the next expiry. Without a recent connection
+ *         event the expiry is the nominal one. Otherwise it is moved, by at
+ *         most half a connection interval, to the lead time before the
+ *         connection event nearest to the nominal expiry, so the update is
+ *         queued just before the radio wakes anyway. Nominal expiries stay a
+ *         whole period apart, so the average period does not change.
+ *
+ * @param now       Tick of the current expiry
+ * @param due       Nominal tick of the next expiry
+ *
+ * @return TickType_t  Ticks to the next expiry
+ */
+static TickType_t app_bt_sched_next(TickType_t now, TickType_t due)
+{
+    TickType_t          nominal = due - now;
+#if APP_BT_SCHED_CONN_ALIGN
+    app_bt_sched_conn_t conn;
+    uint64_t            due_us;
+    uint64_t            wake_us;
+    uint32_t            age;
+    uint32_t            shift;
+    TickType_t          next;
+    uint8_t             slot;
+
+    vTaskSuspendAll();
+    slot = app_bt_sched_ref_slot;
+    if (APP_BT_CONN_INVALID_SLOT != slot)
+    {
+        conn = app_bt_sched_conns[slot];
+    }
+    (void)xTaskResumeAll();
+
+    if ((APP_BT_CONN_INVALID_SLOT == slot) || !conn.anchor_valid || (0 == conn.interval_us))
+    {
+        return nominal;
+    }
+
+    age = (uint32_t)(now - conn.anchor_tick);
+    if (age > pdMS_TO_TICKS(APP_BT_SCHED_ANCHOR_MAX_AGE_MS))
+    {
+        app_bt_sched_stats.stale++;
+        return nominal;
+    }
+
+    /* Times relative to the anchor, a whole number of intervals apart from
+     * the connection events */
+    due_us  = (uint64_t)(age + nominal) * portTICK_PERIOD_MS * 1000u;
+    wake_us = ((due_us + APP_BT_SCHED_LEAD_US + (conn.interval_us / 2)) / conn.interval_us) *
+              conn.interval_us;
+    if (wake_us < (APP_BT_SCHED_LEAD_US + ((uint64_t)age * portTICK_PERIOD_MS * 1000u)))
+    {
+        return nominal;
+    }
+
+    /* Ticks round down, waking early rather than missing the event */
+    next = (TickType_t)((wake_us - APP_BT_SCHED_LEAD_US) / (portTICK_PERIOD_MS * 1000u)) - age;
+    if ((next < (app_bt_sched_period / 2)) ||
+        (next > (app_bt_sched_period + (app_bt_sched_period / 2))))
+    {
+        /* Interval too long to be worth aligning to */
+        return nominal;
+    }
+
+    shift = (next > nominal) ? (next - nominal) : (nominal - next);
+    app_bt_sched_stats.aligned++;
+    app_bt_sched_stats.shift_sum_ms += shift * portTICK_PERIOD_MS;
+    if ((shift * portTICK_PERIOD_MS) > app_bt_sched_stats.shift_max_ms)
+    {
+        app_bt_sched_stats.shift_max_ms = shift * portTICK_PERIOD_MS;
+    }
+    return next;
+#else
+    return nominal;
+#endif
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_timer_cb
+ *
+ * Function Description:
+ * @brief  Timer callback, run by the timer task. Notifies the update task
+ *         and sets the time to the next expiry. The period is only changed
+ *         when it differs, so the unaligned timer just reloads.
+ *
+ * @param timer     Update timer
+ *
+ * @return void
+ */
+static void app_bt_sched_timer_cb(TimerHandle_t timer)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t next;
+
+    app_bt_sched_stats.wakeups++;
+    (void)xTaskNotifyGive(app_bt_sched_task);
+
+    /* Restart the nominal sequence if the timer task was held up */
+    app_bt_sched_due += app_bt_sched_period;
+    if ((TickType_t)(app_bt_sched_due - now - 1u) >= (2u * app_bt_sched_period))
+    {
+        app_bt_sched_due = now + app_bt_sched_period;
+    }
+
+    next = app_bt_sched_next(now, app_bt_sched_due);
+    if (next != xTimerGetPeriod(timer))
+    {
+        (void)xTimerChangePeriod(timer, next, 0);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_get_stats
+ *
+ * Function Description:
+ * @brief  Copies the scheduler counters
+ *
+ * @param p_stats   Destination
+ *
+ * @return void
+ */
+void app_bt_sched_get_stats(app_bt_sched_stats_t *p_stats)
+{
+    vTaskSuspendAll();
+    *p_stats = app_bt_sched_stats;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_sched_print
+ *
+ * Function Description:
+ * @brief  Prints how many updates were aligned to connection events
+ *
+ * @return void
+ */
+void app_bt_sched_print(void)
+{
+    app_bt_sched_stats_t stats;
+
+    app_bt_sched_get_stats(&stats);
+    printf("BAS timer: %lu wakeups, %lu aligned (moved avg %lu ms, max %lu ms), %lu stale\r\n",
+           (unsigned long)stats.wakeups, (unsigned long)stats.aligned,
+           (unsigned long)((0 != stats.aligned) ? (stats.shift_sum_ms / stats.aligned) : 0),
+           (unsigned long)stats.shift_max_ms, (unsigned long)stats.stale);
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,114 @@
+/******************************************************************************
+* File Name:   app_bt_sched.h
+*
+* Description: This file contains the declarations of the software timer that
+*                           schedules the battery level updates
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_SCHED_H__
+#define __APP_BT_SCHED_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_dev.h"
+#include "app_bt_conn.h"
+
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Set to 1 to move each wakeup onto a connection event instead of
+ *        keeping the nominal period
+ */
+#ifndef APP_BT_SCHED_CONN_ALIGN
+#define APP_BT_SCHED_CONN_ALIGN                 (0)
+#endif
+
+/**
+ * @brief Time the task needs to queue an update ahead of the connection
+ *        event it is aligned to
+ */
+#ifndef APP_BT_SCHED_LEAD_US
+#define APP_BT_SCHED_LEAD_US                    (2000u)
+#endif
+
+/**
+ * @brief Age after which a connection event estimate is no longer trusted.
+ *        Sleep clock accuracy of both sides is up to 500 ppm each, so after
+ *        10 s the anchor has drifted by up to 10 ms.
+ */
+#ifndef APP_BT_SCHED_ANCHOR_MAX_AGE_MS
+#define APP_BT_SCHED_ANCHOR_MAX_AGE_MS          (10000u)
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Scheduler counters
+ */
+typedef struct
+{
+    uint32_t wakeups;                           /* Timer expiries */
+    uint32_t aligned;                           /* Expiries moved onto a connection event */
+    uint32_t stale;                             /* Alignment skipped, no recent connection event */
+    uint32_t shift_sum_ms;                      /* Time the aligned expiries were moved by */
+    uint32_t shift_max_ms;
+} app_bt_sched_stats_t;
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_bool_t app_bt_sched_init        (TaskHandle_t task, uint32_t period_ms);
+wiced_bool_t app_bt_sched_start       (void);
+void         app_bt_sched_conn_open   (uint16_t conn_id, wiced_bt_device_address_t bd_addr);
+void         app_bt_sched_conn_update (wiced_bt_device_address_t bd_addr, uint16_t conn_interval,
+                                       uint16_t conn_latency);
+void         app_bt_sched_conn_event  (uint16_t conn_id);
+void         app_bt_sched_conn_close  (uint16_t conn_id);
+void         app_bt_sched_get_stats   (app_bt_sched_stats_t *p_stats);
+void         app_bt_sched_print       (void);
+
+#endif      /*__APP_BT_SCHED_H__ */
+
+
+/* [] END OF FILE */
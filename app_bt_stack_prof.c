@@ -0,0 +1,334 @@
+/******************************************************************************
+* File Name:   app_bt_stack_prof.c
+*
+* Description: This file implements the task stack high-water mark profiler. A low
+*                           priority task samples every task and keeps the lowest free stack seen
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_stack_prof.h"
+#include "app_bt_cpu_stats.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Macros
+ ******************************************************************************/
+#define APP_BT_STACK_PROF_TASK_STACK_SIZE   (configMINIMAL_STACK_SIZE * 4)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Profile of one task. Entries stay after the task is deleted so that
+ *        short lived tasks are reported too.
+ */
+typedef struct
+{
+    UBaseType_t task_number;                        /* Unique per task */
+    char        name[configMAX_TASK_NAME_LEN];
+    uint32_t    min_free;                           /* Bytes, lowest seen */
+    uint32_t    last_free;                          /* Bytes, last sample */
+    bool        alive;
+} app_bt_stack_prof_entry_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static app_bt_stack_prof_entry_t app_bt_stack_prof_entries[APP_BT_STACK_PROF_MAX_TASKS];
+static uint8_t                   app_bt_stack_prof_num_entries;
+static uint32_t                  app_bt_stack_prof_incomplete;   /* Samples missing tasks */
+
+/* Used by the sampling task only */
+static TaskStatus_t              app_bt_stack_prof_status[APP_BT_STACK_PROF_MAX_TASKS];
+
+/* Characteristic value, built on each read */
+static uint8_t app_bt_stack_prof_value[APP_BT_STACK_PROF_MAX_TASKS * APP_BT_STACK_PROF_RECORD_LEN];
+
+static TaskHandle_t              app_bt_stack_prof_task_handle;
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+static StackType_t               app_bt_stack_prof_task_stack[APP_BT_STACK_PROF_TASK_STACK_SIZE];
+static StaticTask_t              app_bt_stack_prof_task_tcb;
+#endif
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_stack_prof_task
+ *
+ * Function Description:
+ * @brief  Samples every APP_BT_STACK_PROF_PERIOD_MS and prints the table
+ *         every APP_BT_STACK_PROF_PRINT_PERIODS samples
+ *
+ * @param pvParam   Unused
+ *
+ * @return void
+ */
+static void app_bt_stack_prof_task(void *pvParam)
+{
+    uint32_t samples = 0;
+
+    (void)pvParam;
+
+    while (true)
+    {
+        app_bt_stack_prof_sample();
+        samples++;
+        if ((0 != APP_BT_STACK_PROF_PRINT_PERIODS) &&
+            (0 == (samples % APP_BT_STACK_PROF_PRINT_PERIODS)))
+        {
+            app_bt_stack_prof_print();
+        }
+        vTaskDelay(pdMS_TO_TICKS(APP_BT_STACK_PROF_PERIOD_MS));
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_stack_prof_init
+ *
+ * Function Description:
+ * @brief  Starts the sampling task at the lowest priority above idle
+ *
+ * @return wiced_bool_t WICED_FALSE if the task could not be created
+ */
+wiced_bool_t app_bt_stack_prof_init(void)
+{
+    app_bt_stack_prof_num_entries = 0;
+    app_bt_stack_prof_incomplete  = 0;
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+    app_bt_stack_prof_task_handle = xTaskCreateStatic(app_bt_stack_prof_task, "Stack Prof",
+                                                      APP_BT_STACK_PROF_TASK_STACK_SIZE, NULL,
+                                                      (tskIDLE_PRIORITY + 1),
+                                                      app_bt_stack_prof_task_stack,
+                                                      &app_bt_stack_prof_task_tcb);
+    return (NULL != app_bt_stack_prof_task_handle) ? WICED_TRUE : WICED_FALSE;
+#else
+    return (pdPASS == xTaskCreate(app_bt_stack_prof_task, "Stack Prof",
+                                  APP_BT_STACK_PROF_TASK_STACK_SIZE, NULL,
+                                  (tskIDLE_PRIORITY + 1), &app_bt_stack_prof_task_handle)) ?
+            WICED_TRUE : WICED_FALSE;
+#endif
+}
+
+/**
+ * Function Name:
+ * app_bt_stack_prof_sample
+ *
+ * Function Description:
+ * @brief  Takes the high-water mark of every task and lowers the recorded
+ *         minimum where needed
+ *
+ * @return void
+ */
+void app_bt_stack_prof_sample(void)
+{
+    app_bt_stack_prof_entry_t *p_entry;
+    UBaseType_t                num_tasks;
+    UBaseType_t                i;
+    uint32_t                   free_bytes;
+    uint32_t                   total_run_time;
+    uint8_t                    j;
+
+    /* Fails, returning 0, while there are more tasks than status entries */
+    num_tasks = uxTaskGetSystemState(app_bt_stack_prof_status, APP_BT_STACK_PROF_MAX_TASKS,
+                                     &total_run_time);
+    if (0 == num_tasks)
+    {
+        app_bt_stack_prof_incomplete++;
+        return;
+    }
+
+    vTaskSuspendAll();
+    for (j = 0; j < app_bt_stack_prof_num_entries; j++)
+    {
+        app_bt_stack_prof_entries[j].alive = false;
+    }
+    for (i = 0; i < num_tasks; i++)
+    {
+        free_bytes = (uint32_t)app_bt_stack_prof_status[i].usStackHighWaterMark * sizeof(StackType_t);
+
+        for (j = 0; j < app_bt_stack_prof_num_entries; j++)
+        {
+            if (app_bt_stack_prof_entries[j].task_number == app_bt_stack_prof_status[i].xTaskNumber)
+            {
+                break;
+            }
+        }
+        if (j == app_bt_stack_prof_num_entries)
+        {
+            /* Table taken by tasks seen earlier */
+            if (APP_BT_STACK_PROF_MAX_TASKS == app_bt_stack_prof_num_entries)
+            {
+                app_bt_stack_prof_incomplete++;
+                continue;
+            }
+            p_entry = &app_bt_stack_prof_entries[app_bt_stack_prof_num_entries++];
+            p_entry->task_number = app_bt_stack_prof_status[i].xTaskNumber;
+            strncpy(p_entry->name, app_bt_stack_prof_status[i].pcTaskName, sizeof(p_entry->name) - 1);
+            p_entry->name[sizeof(p_entry->name) - 1] = '\0';
+            p_entry->min_free = free_bytes;
+        }
+
+        p_entry = &app_bt_stack_prof_entries[j];
+        p_entry->last_free = free_bytes;
+        p_entry->alive     = true;
+        if (free_bytes < p_entry->min_free)
+        {
+            p_entry->min_free = free_bytes;
+        }
+    }
+    (void)xTaskResumeAll();
+
+    /* The same snapshot carries the run-time counters */
+    app_bt_cpu_stats_update(app_bt_stack_prof_status, num_tasks, total_run_time);
+}
+
+/**
+ * Function Name:
+ * app_bt_stack_prof_print
+ *
+ * Function Description:
+ * @brief  Prints the profile of every task seen so far on the UART
+ *
+ * @return void
+ */
+void app_bt_stack_prof_print(void)
+{
+    app_bt_stack_prof_entry_t entries[APP_BT_STACK_PROF_MAX_TASKS];
+    uint8_t                   num_entries;
+    uint8_t                   i;
+
+    vTaskSuspendAll();
+    num_entries = app_bt_stack_prof_num_entries;
+    memcpy(entries, app_bt_stack_prof_entries, num_entries * sizeof(entries[0]));
+    (void)xTaskResumeAll();
+
+    printf("Stack usage, free bytes:\r\n");
+    printf("  %-*s %8s %8s\r\n", configMAX_TASK_NAME_LEN, "task", "lowest", "now");
+    for (i = 0; i < num_entries; i++)
+    {
+        printf("  %-*s %8lu %8lu%s\r\n", configMAX_TASK_NAME_LEN, entries[i].name,
+               (unsigned long)entries[i].min_free, (unsigned long)entries[i].last_free,
+               entries[i].alive ? "" : "  (deleted)");
+    }
+    if (0 != app_bt_stack_prof_incomplete)
+    {
+        printf("  %lu tasks not sampled, raise APP_BT_STACK_PROF_MAX_TASKS\r\n",
+               (unsigned long)app_bt_stack_prof_incomplete);
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_stack_prof_serialize
+ *
+ * Function Description:
+ * @brief  Writes one APP_BT_STACK_PROF_RECORD_LEN record per task: the first
+ *         APP_BT_STACK_PROF_NAME_LEN bytes of the name, zero padded, then the
+ *         lowest and the last free byte counts as uint16 little endian
+ *
+ * @param p_buf     Destination
+ * @param size      Size of p_buf, records that do not fit are left out
+ *
+ * @return uint16_t Bytes written
+ */
+uint16_t app_bt_stack_prof_serialize(uint8_t *p_buf, uint16_t size)
+{
+    const app_bt_stack_prof_entry_t *p_entry;
+    uint16_t                         len = 0;
+    uint16_t                         min_free;
+    uint16_t                         last_free;
+    uint8_t                          i;
+
+    vTaskSuspendAll();
+    for (i = 0; (i < app_bt_stack_prof_num_entries) &&
+                ((len + APP_BT_STACK_PROF_RECORD_LEN) <= size); i++)
+    {
+        p_entry   = &app_bt_stack_prof_entries[i];
+        min_free  = (p_entry->min_free > UINT16_MAX) ? UINT16_MAX : (uint16_t)p_entry->min_free;
+        last_free = (p_entry->last_free > UINT16_MAX) ? UINT16_MAX : (uint16_t)p_entry->last_free;
+
+        memset(&p_buf[len], 0, APP_BT_STACK_PROF_NAME_LEN);
+        strncpy((char *)&p_buf[len], p_entry->name, APP_BT_STACK_PROF_NAME_LEN);
+        len += APP_BT_STACK_PROF_NAME_LEN;
+        p_buf[len++] = (uint8_t)(min_free & 0xFF);
+        p_buf[len++] = (uint8_t)(min_free >> 8);
+        p_buf[len++] = (uint8_t)(last_free & 0xFF);
+        p_buf[len++] = (uint8_t)(last_free >> 8);
+    }
+    (void)xTaskResumeAll();
+
+    return len;
+}
+
+/**
+ * Function Name:
+ * app_bt_stack_prof_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the Stack Usage diagnostics characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the profile records
+ * @param p_len     Returns their length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_stack_prof_on_read(uint16_t conn_id, uint16_t handle,
+                                                 uint8_t **pp_val, uint16_t *p_len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    *p_len  = app_bt_stack_prof_serialize(app_bt_stack_prof_value, sizeof(app_bt_stack_prof_value));
+    *pp_val = app_bt_stack_prof_value;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+
+/* [] END OF FILE */
@@ -0,0 +1,99 @@
+/******************************************************************************
+* File Name:   app_bt_stack_prof.h
+*
+* Description: This file contains the declarations of the task stack high-water
+*                           mark profiler
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_STACK_PROF_H__
+#define __APP_BT_STACK_PROF_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_gatt.h"
+#include "wiced_bt_dev.h"
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Number of tasks tracked, including the Bluetooth stack and OTA tasks
+ */
+#ifndef APP_BT_STACK_PROF_MAX_TASKS
+#define APP_BT_STACK_PROF_MAX_TASKS         (16u)
+#endif
+
+/**
+ * @brief Sampling period in milliseconds
+ */
+#ifndef APP_BT_STACK_PROF_PERIOD_MS
+#define APP_BT_STACK_PROF_PERIOD_MS         (1000u)
+#endif
+
+/**
+ * @brief The table is printed on the UART every this many samples, 0 never
+ */
+#ifndef APP_BT_STACK_PROF_PRINT_PERIODS
+#define APP_BT_STACK_PROF_PRINT_PERIODS     (60u)
+#endif
+
+/**
+ * @brief Task name bytes in each characteristic record
+ */
+#define APP_BT_STACK_PROF_NAME_LEN          (8u)
+
+/**
+ * @brief Size of one characteristic record: name, lowest free bytes ever and
+ *        free bytes at the last sample, little endian
+ */
+#define APP_BT_STACK_PROF_RECORD_LEN        (APP_BT_STACK_PROF_NAME_LEN + 4u)
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+wiced_bool_t           app_bt_stack_prof_init      (void);
+void                   app_bt_stack_prof_sample    (void);
+void                   app_bt_stack_prof_print     (void);
+uint16_t               app_bt_stack_prof_serialize (uint8_t *p_buf, uint16_t size);
+wiced_bt_gatt_status_t app_bt_stack_prof_on_read   (uint16_t conn_id, uint16_t handle,
+                                                    uint8_t **pp_val, uint16_t *p_len);
+
+#endif      /*__APP_BT_STACK_PROF_H__ */
+
+
+/* [] END OF FILE */
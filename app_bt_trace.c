@@ -0,0 +1,436 @@
+/******************************************************************************
+* File Name:   app_bt_trace.c
+*
+* Description: This file implements the deferred binary trace: a lock-free RAM
+*                           ring filled on the hot paths and drained by a low priority task
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "app_bt_trace.h"
+
+#if APP_BT_TRACE_ENABLE
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+/* FreeRTOS header file */
+#include <FreeRTOS.h>
+#include <task.h>
+
+/******************************************************************************
+ *                                Macros
+ ******************************************************************************/
+#define APP_BT_TRACE_MASK                   (APP_BT_TRACE_ENTRIES - 1u)
+#define APP_BT_TRACE_TASK_STACK_SIZE        (configMINIMAL_STACK_SIZE * 4)
+
+#if (APP_BT_TRACE_ENTRIES & APP_BT_TRACE_MASK)
+#error "APP_BT_TRACE_ENTRIES must be a power of two"
+#endif
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Ring slot. seq is the claiming position + 1 once the record is
+ *        complete, so the reader never sees a half written record.
+ */
+typedef struct
+{
+    atomic_uint         seq;
+    app_bt_trace_rec_t  rec;
+} app_bt_trace_slot_t;
+
+/*******************************************************************************
+*        Variable Definitions
+*******************************************************************************/
+static app_bt_trace_slot_t  app_bt_trace_ring[APP_BT_TRACE_ENTRIES];
+static atomic_uint          app_bt_trace_head;      /* Next position to claim */
+static atomic_uint          app_bt_trace_tail;      /* Next position to drain */
+static atomic_uint          app_bt_trace_dropped;
+
+static app_bt_trace_sink_t  app_bt_trace_sink;
+static TaskHandle_t         app_bt_trace_task_handle;
+
+/* Newest records of the GATT sink, read through the Trace characteristic */
+static app_bt_trace_rec_t   app_bt_trace_gatt_window[APP_BT_TRACE_GATT_RECORDS];
+static uint32_t             app_bt_trace_gatt_seq;  /* Records the GATT sink received */
+static uint8_t              app_bt_trace_gatt_value[APP_BT_TRACE_GATT_HEADER_LEN +
+                                                    (APP_BT_TRACE_GATT_RECORDS *
+                                                     sizeof(app_bt_trace_rec_t))];
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+static StackType_t          app_bt_trace_task_stack[APP_BT_TRACE_TASK_STACK_SIZE];
+static StaticTask_t         app_bt_trace_task_tcb;
+#endif
+
+/****************************************************************************
+ *                              FUNCTION DEFINITIONS
+ ***************************************************************************/
+/**
+ * Function Name:
+ * app_bt_trace_uart_sink
+ *
+ * Function Description:
+ * @brief  Default sink, prints each record as one hex line that
+ *         scripts/app_bt_trace_decode.py picks out of the UART log
+ *
+ * @param p_rec     Record
+ *
+ * @return void
+ */
+static void app_bt_trace_uart_sink(const app_bt_trace_rec_t *p_rec)
+{
+    const uint8_t *p = (const uint8_t *)p_rec;
+    char           line[4 + (2 * sizeof(*p_rec)) + 3];
+    uint8_t        i;
+    int            n;
+
+    n = snprintf(line, sizeof(line), "TRC ");
+    for (i = 0; i < sizeof(*p_rec); i++)
+    {
+        n += snprintf(&line[n], sizeof(line) - (size_t)n, "%02X", p[i]);
+    }
+    printf("%s\r\n", line);
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_gatt_sink
+ *
+ * Function Description:
+ * @brief  Sink selected through the Trace characteristic, keeps the newest
+ *         APP_BT_TRACE_GATT_RECORDS records for app_bt_trace_on_read()
+ *
+ * @param p_rec     Record
+ *
+ * @return void
+ */
+static void app_bt_trace_gatt_sink(const app_bt_trace_rec_t *p_rec)
+{
+    vTaskSuspendAll();
+    app_bt_trace_gatt_window[app_bt_trace_gatt_seq % APP_BT_TRACE_GATT_RECORDS] = *p_rec;
+    app_bt_trace_gatt_seq++;
+    (void)xTaskResumeAll();
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_task
+ *
+ * Function Description:
+ * @brief  Drains the ring to the sink every APP_BT_TRACE_DRAIN_MS
+ *
+ * @param pvParam   Unused
+ *
+ * @return void
+ */
+static void app_bt_trace_task(void *pvParam)
+{
+    (void)pvParam;
+
+    printf("TRC v%u tick_hz %u\r\n", (unsigned int)APP_BT_TRACE_VERSION,
+           (unsigned int)configTICK_RATE_HZ);
+
+    while (true)
+    {
+        vTaskDelay(pdMS_TO_TICKS(APP_BT_TRACE_DRAIN_MS));
+        (void)app_bt_trace_drain();
+    }
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_init
+ *
+ * Function Description:
+ * @brief  Empties the ring and starts the drain task at the lowest priority
+ *         above idle, with the UART sink
+ *
+ * @return wiced_bool_t WICED_FALSE if the task could not be created
+ */
+wiced_bool_t app_bt_trace_init(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < APP_BT_TRACE_ENTRIES; i++)
+    {
+        atomic_init(&app_bt_trace_ring[i].seq, 0u);
+    }
+    atomic_init(&app_bt_trace_head, 0u);
+    atomic_init(&app_bt_trace_tail, 0u);
+    atomic_init(&app_bt_trace_dropped, 0u);
+    app_bt_trace_sink = app_bt_trace_uart_sink;
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+    app_bt_trace_task_handle = xTaskCreateStatic(app_bt_trace_task, "Trace Task",
+                                                 APP_BT_TRACE_TASK_STACK_SIZE, NULL,
+                                                 (tskIDLE_PRIORITY + 1),
+                                                 app_bt_trace_task_stack, &app_bt_trace_task_tcb);
+    return (NULL != app_bt_trace_task_handle) ? WICED_TRUE : WICED_FALSE;
+#else
+    return (pdPASS == xTaskCreate(app_bt_trace_task, "Trace Task", APP_BT_TRACE_TASK_STACK_SIZE,
+                                  NULL, (tskIDLE_PRIORITY + 1), &app_bt_trace_task_handle)) ?
+            WICED_TRUE : WICED_FALSE;
+#endif
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_set_sink
+ *
+ * Function Description:
+ * @brief  Routes drained records elsewhere, for instance to a GATT
+ *         characteristic
+ *
+ * @param p_sink    Sink, NULL restores the UART sink
+ *
+ * @return void
+ */
+void app_bt_trace_set_sink(app_bt_trace_sink_t p_sink)
+{
+    app_bt_trace_sink = (NULL != p_sink) ? p_sink : app_bt_trace_uart_sink;
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_put
+ *
+ * Function Description:
+ * @brief  Appends a record without blocking. Any number of tasks may trace
+ *         concurrently; when the ring is full the record is counted as
+ *         dropped instead.
+ *
+ * @param evt       Event
+ * @param arg       Event specific argument
+ * @param len       Length, event specific
+ * @param p_addr    Address, event specific
+ *
+ * @return void
+ */
+void app_bt_trace_put(app_bt_trace_evt_t evt, uint8_t arg, uint16_t len, const void *p_addr)
+{
+    app_bt_trace_slot_t *p_slot;
+    unsigned int         head = atomic_load_explicit(&app_bt_trace_head, memory_order_relaxed);
+
+    do
+    {
+        if ((head - atomic_load_explicit(&app_bt_trace_tail, memory_order_acquire)) >=
+            APP_BT_TRACE_ENTRIES)
+        {
+            atomic_fetch_add_explicit(&app_bt_trace_dropped, 1u, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&app_bt_trace_head, &head, head + 1u,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed));
+
+    p_slot = &app_bt_trace_ring[head & APP_BT_TRACE_MASK];
+    p_slot->rec.tick = (uint32_t)xTaskGetTickCount();
+    p_slot->rec.evt  = (uint8_t)evt;
+    p_slot->rec.arg  = arg;
+    p_slot->rec.len  = len;
+    p_slot->rec.addr = (uint32_t)(uintptr_t)p_addr;
+    atomic_store_explicit(&p_slot->seq, head + 1u, memory_order_release);
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_drain
+ *
+ * Function Description:
+ * @brief  Hands the completed records to the sink, oldest first, preceded by
+ *         a DROPPED record if any were lost. Called by the drain task.
+ *
+ * @return uint32_t Number of records drained
+ */
+uint32_t app_bt_trace_drain(void)
+{
+    app_bt_trace_slot_t *p_slot;
+    app_bt_trace_rec_t   rec;
+    unsigned int         tail = atomic_load_explicit(&app_bt_trace_tail, memory_order_relaxed);
+    unsigned int         dropped;
+    uint32_t             count = 0;
+
+    dropped = atomic_exchange_explicit(&app_bt_trace_dropped, 0u, memory_order_relaxed);
+    if (0 != dropped)
+    {
+        rec.tick = (uint32_t)xTaskGetTickCount();
+        rec.evt  = APP_BT_TRACE_EVT_DROPPED;
+        rec.arg  = 0;
+        rec.len  = (dropped > UINT16_MAX) ? UINT16_MAX : (uint16_t)dropped;
+        rec.addr = 0;
+        app_bt_trace_sink(&rec);
+    }
+
+    while (tail != atomic_load_explicit(&app_bt_trace_head, memory_order_relaxed))
+    {
+        p_slot = &app_bt_trace_ring[tail & APP_BT_TRACE_MASK];
+
+        /* Claimed but still being written, pick it up next time */
+        if (atomic_load_explicit(&p_slot->seq, memory_order_acquire) != (tail + 1u))
+        {
+            break;
+        }
+        rec = p_slot->rec;
+        tail++;
+        atomic_store_explicit(&app_bt_trace_tail, tail, memory_order_release);
+
+        app_bt_trace_sink(&rec);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_on_read
+ *
+ * Function Description:
+ * @brief  Read hook of the Trace diagnostics characteristic. Returns the
+ *         newest records of the GATT sink; the sequence number in the
+ *         header lets a client polling the value drop the records it
+ *         already has.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param pp_val    Returns the records
+ * @param p_len     Returns their length
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_trace_on_read(uint16_t conn_id, uint16_t handle,
+                                            uint8_t **pp_val, uint16_t *p_len)
+{
+    uint8_t  *p = app_bt_trace_gatt_value;
+    uint32_t  first;
+    uint32_t  count;
+    uint32_t  i;
+
+    (void)conn_id;
+    (void)handle;
+
+    vTaskSuspendAll();
+    count = (app_bt_trace_gatt_seq < APP_BT_TRACE_GATT_RECORDS) ? app_bt_trace_gatt_seq :
+                                                                  APP_BT_TRACE_GATT_RECORDS;
+    first = app_bt_trace_gatt_seq - count;
+
+    *p++ = (uint8_t)APP_BT_TRACE_VERSION;
+    *p++ = (uint8_t)count;
+    *p++ = (uint8_t)(configTICK_RATE_HZ & 0xFF);
+    *p++ = (uint8_t)((configTICK_RATE_HZ >> 8) & 0xFF);
+    *p++ = (uint8_t)(first & 0xFF);
+    *p++ = (uint8_t)((first >> 8) & 0xFF);
+    *p++ = (uint8_t)((first >> 16) & 0xFF);
+    *p++ = (uint8_t)(first >> 24);
+    for (i = 0; i < count; i++)
+    {
+        /* The packed record is already in wire order */
+        memcpy(p, &app_bt_trace_gatt_window[(first + i) % APP_BT_TRACE_GATT_RECORDS],
+               sizeof(app_bt_trace_rec_t));
+        p += sizeof(app_bt_trace_rec_t);
+    }
+    (void)xTaskResumeAll();
+
+    *pp_val = app_bt_trace_gatt_value;
+    *p_len  = (uint16_t)(p - app_bt_trace_gatt_value);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_validate
+ *
+ * Function Description:
+ * @brief  Validate hook of the Trace characteristic. A single byte selects
+ *         the sink: 1 for the characteristic, 0 for the UART.
+ *
+ * @param conn_id   Connection ID
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value to be written
+ * @param len       Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_trace_validate(uint16_t conn_id, uint16_t handle,
+                                             uint8_t *p_val, uint16_t len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    if (1 != len)
+    {
+        return WICED_BT_GATT_INVALID_ATTR_LEN;
+    }
+    return (p_val[0] <= 1) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_VALUE_NOT_ALLOWED;
+}
+
+/**
+ * Function Name:
+ * app_bt_trace_on_write
+ *
+ * Function Description:
+ * @brief  Write hook of the Trace characteristic
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request, NULL for local writes
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_trace_on_write(uint16_t conn_id,
+                                             wiced_bt_gatt_event_data_t *p_data,
+                                             uint16_t handle, uint8_t *p_val,
+                                             uint16_t len)
+{
+    (void)conn_id;
+    (void)p_data;
+    (void)handle;
+    (void)len;
+
+    printf("TRC records to the %s\r\n", (0 != p_val[0]) ? "Trace characteristic" : "UART");
+    app_bt_trace_set_sink((0 != p_val[0]) ? app_bt_trace_gatt_sink : NULL);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+#endif /* APP_BT_TRACE_ENABLE */
+
+
+/* [] END OF FILE */
@@ -0,0 +1,154 @@
+/******************************************************************************
+* File Name:   app_bt_trace.h
+*
+* Description: This file contains the declarations of the deferred binary trace
+*                           used on the Bluetooth hot paths
+*
+* Related Document: See Readme.md
+*
+********************************************************************************
+* Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+* an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+*
+* This software, including source code, documentation and related
+* materials ("Software") is owned by Cypress Semiconductor Corporation
+* or one of its affiliates ("Cypress") and is protected by and subject to
+* worldwide patent protection (United States and foreign),
+* United States copyright laws and international treaty provisions.
+* Therefore, you may use this Software only as provided in the license
+* agreement accompanying the software package from which you
+* obtained this Software ("EULA").
+* If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+* non-transferable license to copy, modify, and compile the Software
+* source code solely for use in connection with Cypress's
+* integrated circuit products.  Any reproduction, modification, translation,
+* compilation, or representation of this Software except as specified
+* above is prohibited without the express written permission of Cypress.
+*
+* Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+* EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+* reserves the right to make changes to the Software without notice. Cypress
+* does not assume any liability arising out of the application or use of the
+* Software or any product or circuit described in the Software. Cypress does
+* not authorize its products for use in any products where a malfunction or
+* failure of the Cypress product may reasonably be expected to result in
+* significant property damage, injury or death ("High Risk Product"). By
+* including Cypress's product in a High Risk Product, the manufacturer
+* of such system or application assumes all risk of such use and in doing
+* so agrees to indemnify Cypress against all liability.
+*******************************************************************************/
+
+#ifndef __APP_BT_TRACE_H__
+#define __APP_BT_TRACE_H__
+
+/******************************************************************************
+ *                                INCLUDES
+ ******************************************************************************/
+#include "wiced_bt_dev.h"
+#include "wiced_bt_gatt.h"
+#include <stdint.h>
+
+/******************************************************************************
+ *                                Constants
+ ******************************************************************************/
+/**
+ * @brief Set to 0 to compile the trace points out
+ */
+#ifndef APP_BT_TRACE_ENABLE
+#define APP_BT_TRACE_ENABLE                 (1)
+#endif
+
+/**
+ * @brief Number of records the ring holds, a power of two
+ */
+#ifndef APP_BT_TRACE_ENTRIES
+#define APP_BT_TRACE_ENTRIES                (64u)
+#endif
+
+/**
+ * @brief Period of the drain task in milliseconds
+ */
+#ifndef APP_BT_TRACE_DRAIN_MS
+#define APP_BT_TRACE_DRAIN_MS               (100u)
+#endif
+
+/**
+ * @brief Record layout version, printed in the stream header for the decoder
+ */
+#define APP_BT_TRACE_VERSION                (1u)
+
+/**
+ * @brief Records the Trace characteristic holds, the newest ones
+ */
+#ifndef APP_BT_TRACE_GATT_RECORDS
+#define APP_BT_TRACE_GATT_RECORDS           (16u)
+#endif
+
+/**
+ * @brief Trace characteristic value: a header of version, record count,
+ *        tick rate in Hz (uint16) and the sequence number of the first
+ *        record (uint32), then the records oldest first. Little endian.
+ */
+#define APP_BT_TRACE_GATT_HEADER_LEN        (8u)
+
+/******************************************************************************
+ *                                Types
+ ******************************************************************************/
+/**
+ * @brief Trace events. Keep in line with scripts/app_bt_trace_decode.py.
+ */
+typedef enum
+{
+    APP_BT_TRACE_EVT_DROPPED        = 0x00, /* len: records lost to a full ring */
+    APP_BT_TRACE_EVT_ALLOC          = 0x01, /* arg: block class */
+    APP_BT_TRACE_EVT_FREE           = 0x02, /* arg: block class */
+    APP_BT_TRACE_EVT_ALLOC_FALLBACK = 0x03,
+    APP_BT_TRACE_EVT_FREE_FALLBACK  = 0x04,
+    APP_BT_TRACE_EVT_ALLOC_FAIL     = 0x05,
+} app_bt_trace_evt_t;
+
+/**
+ * @brief Binary record, 12 bytes little endian on the wire
+ */
+typedef struct __attribute__((packed))
+{
+    uint32_t    tick;       /* FreeRTOS tick count */
+    uint8_t     evt;        /* app_bt_trace_evt_t */
+    uint8_t     arg;
+    uint16_t    len;
+    uint32_t    addr;
+} app_bt_trace_rec_t;
+
+/**
+ * @brief Receives drained records, from the drain task
+ */
+typedef void (*app_bt_trace_sink_t)(const app_bt_trace_rec_t *p_rec);
+
+/****************************************************************************
+ *                              FUNCTION DECLARATIONS
+ ***************************************************************************/
+#if APP_BT_TRACE_ENABLE
+wiced_bool_t           app_bt_trace_init     (void);
+void                   app_bt_trace_set_sink (app_bt_trace_sink_t p_sink);
+void                   app_bt_trace_put      (app_bt_trace_evt_t evt, uint8_t arg, uint16_t len,
+                                              const void *p_addr);
+uint32_t               app_bt_trace_drain    (void);
+wiced_bt_gatt_status_t app_bt_trace_on_read  (uint16_t conn_id, uint16_t handle,
+                                              uint8_t **pp_val, uint16_t *p_len);
+wiced_bt_gatt_status_t app_bt_trace_validate (uint16_t conn_id, uint16_t handle,
+                                              uint8_t *p_val, uint16_t len);
+wiced_bt_gatt_status_t app_bt_trace_on_write (uint16_t conn_id,
+                                              wiced_bt_gatt_event_data_t *p_data,
+                                              uint16_t handle, uint8_t *p_val,
+                                              uint16_t len);
+
+#define APP_BT_TRACE(evt, arg, len, p_addr)     app_bt_trace_put((evt), (arg), (len), (p_addr))
+#else
+#define APP_BT_TRACE(evt, arg, len, p_addr)
+#endif
+
+#endif      /*__APP_BT_TRACE_H__ */
+
+
+/* [] END OF FILE */
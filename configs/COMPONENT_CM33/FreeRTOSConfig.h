@@ -88,6 +88,8 @@ extern uint32_t SystemCoreClock;
 
 /* Memory allocation related definitions. */
 #define configSUPPORT_STATIC_ALLOCATION         1
+/* Stays 1 even in the APP_STATIC_ALLOC build: the Bluetooth porting layer,
+ * the RTOS abstraction and the OTA agent create their objects dynamically */
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 #define configTOTAL_HEAP_SIZE                   ((size_t )(50*1024))
 #define configAPPLICATION_ALLOCATED_HEAP        0
@@ -100,10 +102,17 @@ extern uint32_t SystemCoreClock;
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
+/* The run-time counter is the DWT cycle counter, see app_bt_cpu_stats.c. It
+ * wraps every 2^32 core cycles, so only per-window differences are used. */
+extern void     app_bt_cpu_stats_timer_init( void );
+extern uint32_t app_bt_cpu_stats_get_counter( void );
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    app_bt_cpu_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()            app_bt_cpu_stats_get_counter()
+
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         1
@@ -141,7 +150,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        1
@@ -172,12 +181,24 @@ standard names - or at least those used in the unmodified vector table. */
 #define HEAP_ALLOCATION_TYPE5                   (5)     /* heap_5.c*/
 #define NO_HEAP_ALLOCATION                      (0)
 
-#define configHEAP_ALLOCATION_SCHEME            (HEAP_ALLOCATION_TYPE3)
+/* pvPortMalloc/vPortFree are provided by app_bt_heap.c on top of the C
+ * library heap, as heap_3 does, so that RTOS and malloc usage is accounted
+ * together. configTOTAL_HEAP_SIZE is not used by either. */
+#define configHEAP_ALLOCATION_SCHEME            (NO_HEAP_ALLOCATION)
+
+/* APP_LOW_POWER=1 builds enter System Deep Sleep from tickless idle whatever
+ * the Device Configurator idle power mode, see app_bt_lpm.c.
+ */
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+
+extern void app_bt_lpm_sleep( uint32_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xIdleTime ) app_bt_lpm_sleep( xIdleTime )
+#define configUSE_TICKLESS_IDLE                 2
 
 /* Check if the ModusToolbox Device Configurator Power personality parameter
  * "System Idle Power Mode" is set to either "CPU Sleep" or "System Deep Sleep".
  */
-#if defined(CY_CFG_PWR_SYS_IDLE_MODE) && \
+#elif defined(CY_CFG_PWR_SYS_IDLE_MODE) && \
     ((CY_CFG_PWR_SYS_IDLE_MODE == CY_CFG_PWR_MODE_SLEEP) || \
     (CY_CFG_PWR_SYS_IDLE_MODE == CY_CFG_PWR_MODE_DEEPSLEEP) || \
     (CY_CFG_PWR_SYS_IDLE_MODE == CY_CFG_PWR_MODE_DEEPSLEEP_RAM))
@@ -188,9 +209,10 @@ standard names - or at least those used in the unmodified vector table. */
  * The Low Power Assistant library provides additional portable configuration layer
  * for low-power features supported by the PSoC 6 devices:
  * https://github.com/Infineon/lpa
+ * app_bt_lpm_sleep() counts the sleeps around vApplicationSleep.
  */
-extern void vApplicationSleep( uint32_t xExpectedIdleTime );
-#define portSUPPRESS_TICKS_AND_SLEEP( xIdleTime ) vApplicationSleep( xIdleTime )
+extern void app_bt_lpm_sleep( uint32_t xExpectedIdleTime );
+#define portSUPPRESS_TICKS_AND_SLEEP( xIdleTime ) app_bt_lpm_sleep( xIdleTime )
 #define configUSE_TICKLESS_IDLE                 2
 
 #else
@@ -58,6 +58,25 @@
 #include "GeneratedSource/cycfg_gatt_db.h"
 #include "GeneratedSource/cycfg_bt_settings.h"
 #include "app_bt_utils.h"
+#include "app_bt_gatt_db.h"
+#include "app_bt_gatt_cache.h"
+#include "app_bt_gatt_prep_write.h"
+#include "app_bt_conn.h"
+#include "app_bt_buf_pool.h"
+#include "app_bt_trace.h"
+#include "app_bt_heap.h"
+#include "app_bt_stack_prof.h"
+#include "app_bt_cpu_stats.h"
+#include "app_bt_att_latency.h"
+#include "app_bt_notify_policy.h"
+#include "app_bt_notify_queue.h"
+#include "app_bt_indicate.h"
+#include "app_bt_sched.h"
+#include "app_bt_lpm.h"
+#include "app_bt_history.h"
+#include "app_bas_adc.h"
+#include "app_bt_adv_bas.h"
+#include "app_bt_per_adv.h"
 #include "wiced_bt_ble.h"
 #include "wiced_bt_uuid.h"
 #include "wiced_memory.h"
@@ -107,11 +126,19 @@ typedef void (*pfn_free_buffer_t)(uint8_t *);
  */
 #define ADV_LED_PWM_FREQUENCY (1)
 
+/**
+ * @brief Stack depth of the BAS task, in words
+ */
+#define BAS_TASK_STACK_SIZE       (configMINIMAL_STACK_SIZE * 4)
+
 /**
  * @brief Update rate of Battery level
  */
+#define BATTERY_LEVEL_UPDATE_PERIOD_MS (1000u)
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
 #define BATTERY_LEVEL_UPDATE_MS   (9999u)
 #define BATTERY_LEVEL_UPDATE_FREQ (10000)
+#endif
 
 /**
  * @brief PWM Duty Cycle of LED's for different states
@@ -137,10 +164,12 @@ typedef enum
 /*******************************************************************************
 *        Variable Definitions
 *******************************************************************************/
+#if !(defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER)
 /**
  * @brief PWM Handle for controlling advertising LED
  */
 static cyhal_pwm_t adv_led_pwm;
+#endif
 
 /**
  * @brief FreeRTOS variable to store handle of task created to update and send dummy
@@ -148,11 +177,36 @@ static cyhal_pwm_t adv_led_pwm;
  */
 TaskHandle_t bas_task_handle;
 
+#if defined(APP_BAS_MEAS_ADC) && APP_BAS_MEAS_ADC
+/**
+ * @brief Set once the battery measurement source is up
+ */
+static bool app_bas_meas_ok;
+#endif
+
+/**
+ * @brief Broadcast status of the battery level source
+ */
+#if defined(APP_BAS_MEAS_ADC) && APP_BAS_MEAS_ADC
+#define APP_BAS_SOURCE_STATUS   (app_bas_meas_ok ? APP_BT_PER_ADV_STATUS_MEASURED : 0u)
+#else
+#define APP_BAS_SOURCE_STATUS   (0u)
+#endif
+
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+/**
+ * @brief Storage of the BAS task in the static allocation build
+ */
+static StackType_t  bas_task_stack[BAS_TASK_STACK_SIZE];
+static StaticTask_t bas_task_tcb;
+#endif
+
 /**
  * @brief variable to track connection and advertising state
  */
 static app_bt_adv_conn_mode_t app_bt_adv_conn_state = APP_BT_ADV_OFF_CONN_OFF;
 
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
 /**
  * @brief Variable for 5 sec timer object
  */
@@ -170,6 +224,7 @@ const cyhal_timer_cfg_t bas_timer_cfg =
         .is_continuous = true,                 /* Run timer indefinitely */
         .value = 0                             /* Initial value of counter */
 };
+#endif
 /*******************************************************************************
 *        Function Prototypes
 *******************************************************************************/
@@ -197,8 +252,20 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler           (wiced_bt_ga
                                                                      uint16_t *p_error_handle);
 static wiced_bt_gatt_status_t app_bt_gatt_event_callback            (wiced_bt_gatt_evt_t event,
                                                                      wiced_bt_gatt_event_data_t *p_event_data);
-static wiced_bt_gatt_status_t app_bt_set_value                      (uint16_t attr_handle, 
-                                                                     uint8_t *p_val, 
+static wiced_bt_gatt_status_t app_bt_set_value                      (uint16_t conn_id,
+                                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                                     uint16_t attr_handle,
+                                                                     uint8_t *p_val,
+                                                                     uint16_t len);
+/* Attribute hooks for the Battery Service */
+static wiced_bt_gatt_status_t app_bt_bas_cccd_validate              (uint16_t conn_id,
+                                                                     uint16_t handle,
+                                                                     uint8_t *p_val,
+                                                                     uint16_t len);
+static wiced_bt_gatt_status_t app_bt_bas_cccd_on_write              (uint16_t conn_id,
+                                                                     wiced_bt_gatt_event_data_t *p_data,
+                                                                     uint16_t handle,
+                                                                     uint8_t *p_val,
                                                                      uint16_t len);
 /* Callback function for Bluetooth stack management type events */
 static wiced_bt_dev_status_t  app_bt_management_callback            (wiced_bt_management_evt_t event,
@@ -212,52 +279,54 @@ static void                   app_bt_batt_level_init                (void);
 
 /* Task to send notifications with dummy battery values */
 void bas_task(void *pvParam);
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
 /* HAL timer callback registered when timer reaches terminal count */
 void bas_timer_callb(void *callback_arg, cyhal_timer_event_t event);
+#endif
 
 /******************************************************************************
- *                          Function Definitions
+ *                          Attribute Hooks
  ******************************************************************************/
-
-/**
- * Function Name:
- * app_bt_alloc_buffer
- *
- * Function Description:
- * @brief  This Function allocates the buffer of requested length
- *
- * @param len            Length of the buffer
- *
- * @return uint8_t*      pointer to allocated buffer
- */
-static uint8_t *app_bt_alloc_buffer(uint16_t len)
+/* Client configuration descriptors kept per connection in app_bt_conn */
+static const uint16_t app_bt_cccd_handles[] =
 {
-    uint8_t *p = (uint8_t *)malloc(len);
-    cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "%s() len %d alloc %p \r\n", __FUNCTION__,
-               len, p);
-    return p;
-}
+    HDLD_BAS_BATTERY_LEVEL_CLIENT_CHAR_CONFIG,
+    HDLD_HISTORY_RECORDS_CLIENT_CHAR_CONFIG,
+};
 
-/**
- * Function Name:
- * app_bt_free_buffer
- *
- * Function Description:
- * @brief  This Function frees the buffer requested
- *
- * @param p_data         pointer to the buffer to be freed
- *
- * @return void
- */
-static void app_bt_free_buffer(uint8_t *p_data)
+/* Attributes needing more than a plain store/load of app_gatt_db_ext_attr_tbl */
+static const app_bt_gatt_attr_hooks_t app_bt_gatt_attr_hooks[] =
 {
-    if (p_data != NULL)
-    {
-        cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "%s()        free:%p \r\n",
-                   __FUNCTION__, p_data);
-        free(p_data);
-    }
-}
+    /* handle,                                  flags, p_validate,               p_on_write,               p_on_read */
+    { HDLD_BAS_BATTERY_LEVEL_CLIENT_CHAR_CONFIG, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_bas_cccd_validate, app_bt_bas_cccd_on_write, app_bt_conn_cccd_on_read },
+    { HDLC_GATT_CLIENT_SUPPORTED_FEATURES_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_conn_client_features_validate, app_bt_conn_client_features_on_write,
+      app_bt_conn_client_features_on_read },
+    { HDLC_DIAGNOSTICS_STACK_USAGE_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      NULL, NULL, app_bt_stack_prof_on_read },
+    { HDLC_DIAGNOSTICS_CPU_LOAD_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_cpu_stats_validate, app_bt_cpu_stats_on_write, app_bt_cpu_stats_on_read },
+    { HDLC_DIAGNOSTICS_ATT_LATENCY_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_att_latency_validate, app_bt_att_latency_on_write, app_bt_att_latency_on_read },
+    { HDLC_DIAGNOSTICS_NOTIFY_POLICY_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_notify_policy_validate, app_bt_notify_policy_on_write, app_bt_notify_policy_on_read },
+    { HDLC_DIAGNOSTICS_POWER_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_lpm_validate, app_bt_lpm_on_write, app_bt_lpm_on_read },
+#if APP_BT_TRACE_ENABLE
+    { HDLC_DIAGNOSTICS_TRACE_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_trace_validate, app_bt_trace_on_write, app_bt_trace_on_read },
+#endif
+    { HDLC_HISTORY_RECORDS_VALUE, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_history_validate, app_bt_history_on_write, app_bt_history_on_read },
+    { HDLD_HISTORY_RECORDS_CLIENT_CHAR_CONFIG, APP_BT_GATT_ATTR_FLAG_NO_STORE,
+      app_bt_history_cccd_validate, app_bt_history_cccd_on_write, app_bt_conn_cccd_on_read },
+    APP_BT_OTA_GATT_ATTR_HOOKS,
+};
+
+/******************************************************************************
+ *                          Function Definitions
+ ******************************************************************************/
 
 /**
  * Function Name:
@@ -328,6 +397,9 @@ int main()
     /* Initialising the HCI UART for Host contol */
     cybt_platform_config_init(&cybsp_bt_platform_cfg);
 
+    /* Sleep counters and, with APP_LOW_POWER=1, tickless Deep Sleep */
+    app_bt_lpm_init();
+
     /* set default values for battery server context */
     app_bt_initialize_default_values();
 
@@ -335,6 +407,12 @@ int main()
     cyhal_wdt_init(&wdt_obj, cyhal_wdt_get_max_timeout_ms());
     cyhal_wdt_free(&wdt_obj);
 
+    /* GATT response buffers come from fixed MTU sized blocks */
+    if (WICED_TRUE != app_bt_buf_pool_init(wiced_bt_cfg_settings.p_ble_cfg->ble_max_rx_pdu_size))
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_WARNING, "GATT buffer pool has no MTU sized blocks\r\n");
+    }
+
     /* Register call back and configuration with stack */
     result = wiced_bt_stack_init(app_bt_management_callback, &wiced_bt_cfg_settings);
 
@@ -346,13 +424,34 @@ int main()
     }
 
     /*Create battery service task*/
-    rtos_result = xTaskCreate(bas_task, "BAS Task", (configMINIMAL_STACK_SIZE * 4),
+#if defined(APP_BT_STATIC_ALLOC) && APP_BT_STATIC_ALLOC
+    bas_task_handle = xTaskCreateStatic(bas_task, "BAS Task", BAS_TASK_STACK_SIZE, NULL,
+                                        (configMAX_PRIORITIES - 3), bas_task_stack, &bas_task_tcb);
+    rtos_result = (NULL != bas_task_handle) ? pdPASS : pdFAIL;
+#else
+    rtos_result = xTaskCreate(bas_task, "BAS Task", BAS_TASK_STACK_SIZE,
                                 NULL, (configMAX_PRIORITIES - 3), &bas_task_handle);
+#endif
     if(pdPASS != rtos_result)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR,"BAS task creation failed\n");
     }
 
+#if APP_BT_TRACE_ENABLE
+    /* Buffer alloc/free records are printed from a low priority task */
+    if (WICED_TRUE != app_bt_trace_init())
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR,"Trace task creation failed\n");
+    }
+#endif
+
+    /* Stack high-water marks of every task, on the UART and the Diagnostics
+     * service */
+    if (WICED_TRUE != app_bt_stack_prof_init())
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR,"Stack profiler task creation failed\n");
+    }
+
     /* Start the FreeRTOS scheduler */
     vTaskStartScheduler();
 
@@ -394,6 +493,9 @@ wiced_result_t app_bt_management_callback(wiced_bt_management_evt_t event,
 
         if (WICED_BT_SUCCESS == p_event_data->enabled.status)
         {
+            /* Account what the stack allocates from its own task */
+            (void)app_bt_heap_set_task_tag(APP_BT_HEAP_TAG_BT_STACK);
+
             /* Initialize the application */
             wiced_bt_set_local_bdaddr((uint8_t *)cy_bt_device_address, BLE_ADDR_PUBLIC);
             /* Bluetooth is enabled */
@@ -490,6 +592,12 @@ wiced_result_t app_bt_management_callback(wiced_bt_management_evt_t event,
                   p_event_data->ble_connection_param_update.supervision_timeout);
         cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "ble_connection_param_update.status              : %d\r\n\n",
                    p_event_data->ble_connection_param_update.status);
+        if (0 == p_event_data->ble_connection_param_update.status)
+        {
+            app_bt_sched_conn_update(p_event_data->ble_connection_param_update.bd_addr,
+                                     p_event_data->ble_connection_param_update.conn_interval,
+                                     p_event_data->ble_connection_param_update.conn_latency);
+        }
         result = WICED_BT_SUCCESS;
         break;
 
@@ -506,7 +614,7 @@ wiced_result_t app_bt_management_callback(wiced_bt_management_evt_t event,
             cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Advertisement stopped\r\n");
 
             /* Check connection status after advertisement stops */
-            if (battery_server_context.bt_conn_id == 0)
+            if (0 == app_bt_conn_count())
             {
                 app_bt_adv_conn_state = APP_BT_ADV_OFF_CONN_OFF;
             }
@@ -517,9 +625,11 @@ wiced_result_t app_bt_management_callback(wiced_bt_management_evt_t event,
         }
         else
         {
-            /* Advertisement Started */
+            /* Advertisement Started; the LED keeps showing connected while
+             * other centrals are still being accepted */
             cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Advertisement started\r\n");
-            app_bt_adv_conn_state = APP_BT_ADV_ON_CONN_OFF;
+            app_bt_adv_conn_state = (0 == app_bt_conn_count()) ? APP_BT_ADV_ON_CONN_OFF :
+                                                                 APP_BT_ADV_OFF_CONN_ON;
         }
 
         /* Update Advertisement LED to reflect the updated state */
@@ -556,8 +666,15 @@ static void app_bt_init(void)
     wiced_bt_gatt_status_t status = WICED_BT_GATT_ERROR;
     wiced_result_t result;
 
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+    /* A running PWM keeps the peripheral clock on and the device out of
+     * Deep Sleep, drive the Advertising LED as a plain GPIO instead */
+    cy_result = cyhal_gpio_init(ADV_LED_GPIO, CYHAL_GPIO_DIR_OUTPUT,
+                                CYHAL_GPIO_DRIVE_STRONG, CYBSP_LED_STATE_OFF);
+#else
     /* Initialize the PWM used for Advertising LED */
     cy_result = cyhal_pwm_init(&adv_led_pwm, ADV_LED_GPIO, NULL);
+#endif
 
     /* PWM init failed. Stop program execution */
     if (CY_RSLT_SUCCESS != cy_result)
@@ -566,38 +683,84 @@ static void app_bt_init(void)
         CY_ASSERT(0);
     }
 
+#if defined(APP_BAS_MEAS_ADC) && APP_BAS_MEAS_ADC
+    /* Battery level measured through the ADC instead of the demo countdown */
+    app_bas_meas_ok = app_bas_meas_init(&app_bas_adc_source);
+    if (!app_bas_meas_ok)
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Battery measurement init failed, keeping the demo level\r\n");
+    }
+#endif
+
     /* Disable pairing for this application */
     wiced_bt_set_pairable_mode(WICED_TRUE, 0);
 
     /* Set Advertisement Data */
+#if defined(APP_BT_PERIODIC_ADV) && APP_BT_PERIODIC_ADV
+    /* Set with the extended advertising set below; once extended
+     * advertising commands are used the controller refuses legacy ones */
+#elif defined(APP_BT_ADV_BAS) && APP_BT_ADV_BAS
+    /* With the battery level as Battery Service data, for scanners that
+     * only need the level and never connect */
+    app_bt_adv_bas_init(cy_bt_adv_packet_data, CY_BT_ADV_PACKET_DATA_SIZE,
+                        app_bas_battery_level[0]);
+#else
     wiced_bt_ble_set_raw_advertisement_data(CY_BT_ADV_PACKET_DATA_SIZE,
                                             cy_bt_adv_packet_data);
+#endif
 
     /* Register with BT stack to receive GATT callback */
     status = wiced_bt_gatt_register(app_bt_gatt_event_callback);
     cy_log_msg(CYLF_DEF, CY_LOG_INFO, "GATT event Handler registration status: %s \r\n",
                get_bt_gatt_status_name(status));
 
+    /* Per connection state, including the client configuration descriptors */
+    app_bt_conn_init(app_bt_cccd_handles,
+                     sizeof(app_bt_cccd_handles) / sizeof(app_bt_cccd_handles[0]));
+    app_bt_history_init(HDLC_HISTORY_RECORDS_VALUE, HDLD_HISTORY_RECORDS_CLIENT_CHAR_CONFIG);
+
+    /* Index the external attribute table before the stack can query it */
+    result = app_bt_gatt_db_index_init(app_bt_gatt_attr_hooks,
+                                       sizeof(app_bt_gatt_attr_hooks) / sizeof(app_bt_gatt_attr_hooks[0]));
+    if (WICED_BT_SUCCESS != result)
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR, "GATT database exceeds APP_BT_GATT_DB_MAX_HANDLE \r\n");
+        CY_ASSERT(0);
+    }
+
     /* Initialize GATT Database */
     status = wiced_bt_gatt_db_init(gatt_database, gatt_database_len, NULL);
     cy_log_msg(CYLF_DEF, CY_LOG_INFO, "GATT database initialization status: %s \r\n",
                get_bt_gatt_status_name(status));
 
+#if defined(APP_BT_PERIODIC_ADV) && APP_BT_PERIODIC_ADV
+    /* Broadcast the battery level on a periodic advertising train instead;
+     * listeners sync to it and no connection is ever made */
+    result = app_bt_per_adv_start(cy_bt_adv_packet_data, CY_BT_ADV_PACKET_DATA_SIZE,
+                                  app_bas_battery_level[0], APP_BAS_SOURCE_STATUS);
+#else
     /* Start Undirected Bluetooth LE Advertisements on device startup.
      * The corresponding parameters are contained in 'app_bt_cfg.c' */
     result = wiced_bt_start_advertisements(BTM_BLE_ADVERT_UNDIRECTED_HIGH, 0, NULL);
+#endif
     if (WICED_BT_SUCCESS != result)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Advertisement cannot start because of error: %d \r\n",
                    result);
         CY_ASSERT(0);
     }
+#if defined(APP_BT_PERIODIC_ADV) && APP_BT_PERIODIC_ADV
+    /* No advertising state events for extended advertising, blink the LED here */
+    app_bt_adv_conn_state = APP_BT_ADV_ON_CONN_OFF;
+    app_bt_adv_led_update();
+#endif
 
     cy_log_msg(CYLF_DEF, CY_LOG_INFO,"***********************************************\r\n");
     cy_log_msg(CYLF_DEF, CY_LOG_INFO,"**Discover device with \"Battery Server\" name*\r\n");
     cy_log_msg(CYLF_DEF, CY_LOG_INFO,"***********************************************\r\n\n");
 
 }
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
 /*
  Function name:
  bas_timer_callb
@@ -617,6 +780,7 @@ void bas_timer_callb(void *callback_arg, cyhal_timer_event_t event)
     vTaskNotifyGiveFromISR(bas_task_handle, &xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
+#endif
 
 /*
  Function name:
@@ -632,11 +796,18 @@ void bas_timer_callb(void *callback_arg, cyhal_timer_event_t event)
  */
 void bas_task(void *pvParam)
 {
-
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
     cy_rslt_t cy_result = CY_RSLT_SUCCESS;
+#endif
+    app_bt_notify_policy_reason_t reason;
+    uint32_t subscribed;
+    uint32_t indicate;
+    uint8_t level;
+    uint8_t slot;
 
 
 
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
     /* Initialize the HAL timer used to count seconds */
     cy_result = cyhal_timer_init(&bas_timer_obj, NC, NULL);
     if (CY_RSLT_SUCCESS != cy_result)
@@ -653,6 +824,13 @@ void bas_task(void *pvParam)
     /* Register for a callback whenever timer reaches terminal count */
     cyhal_timer_register_callback(&bas_timer_obj, bas_timer_callb, NULL);
     cyhal_timer_enable_event(&bas_timer_obj, CYHAL_TIMER_IRQ_TERMINAL_COUNT, 3, true);
+#else
+    /* Software timer, the device sleeps between updates in tickless idle */
+    if (WICED_TRUE != app_bt_sched_init(bas_task_handle, BATTERY_LEVEL_UPDATE_PERIOD_MS))
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR,"BAS timer init failed !\n");
+    }
+#endif
 
     /* Start battery level timer */
     app_bt_batt_level_init();
@@ -660,31 +838,93 @@ void bas_task(void *pvParam)
     while(true)
     {
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        level = app_bas_battery_level[0];
+#if defined(APP_BAS_MEAS_ADC) && APP_BAS_MEAS_ADC
+        if (app_bas_meas_ok)
+        {
+            /* One DMA batch, filtered and mapped to State of Charge */
+            level = app_bas_meas_sample();
+        }
+        else
+#endif
         /* Battery level is read from gatt db and is reduced by 2 percent
         * by default and initialized again to 100 once it reaches 0*/
-        if (0 == app_bas_battery_level[0])
+        if (0 == level)
         {
-            app_bas_battery_level[0] = 100;
+            level = 100;
         }
         else
         {
-            app_bas_battery_level[0] = app_bas_battery_level[0] - BATTERY_LEVEL_CHANGE;
+            level = level - BATTERY_LEVEL_CHANGE;
         }
+        /* Stored through the database so that cached read responses see it */
+        app_bt_gatt_db_write(0, NULL, HDLC_BAS_BATTERY_LEVEL_VALUE, &level, sizeof(level));
+        /* Kept on the device for clients that connect only now and then */
+        app_bt_history_add(app_bas_battery_level[0]);
+#if defined(APP_BT_ADV_BAS) && APP_BT_ADV_BAS
+        /* Advertised in place, advertising keeps running */
+        app_bt_adv_bas_update(app_bas_battery_level[0]);
+#endif
+#if defined(APP_BT_PERIODIC_ADV) && APP_BT_PERIODIC_ADV
+        /* Synced listeners get it at the next periodic advertising event */
+        app_bt_per_adv_update(app_bas_battery_level[0], APP_BAS_SOURCE_STATUS);
+#endif
 
-        if (battery_server_context.bt_conn_id)
+        /* Retry refused indications and time out unconfirmed ones */
+        app_bt_indicate_poll();
+
+        /* Update every connection that enabled notifications or indications,
+         * one bit per slot */
+        subscribed = app_bt_conn_cccd_subscribers(HDLD_BAS_BATTERY_LEVEL_CLIENT_CHAR_CONFIG,
+                                                  GATT_CLIENT_CONFIG_NOTIFICATION |
+                                                  GATT_CLIENT_CONFIG_INDICATION);
+        indicate = app_bt_conn_cccd_subscribers(HDLD_BAS_BATTERY_LEVEL_CLIENT_CHAR_CONFIG,
+                                                GATT_CLIENT_CONFIG_INDICATION);
+        reason = APP_BT_NOTIFY_POLICY_NONE;
+        if (0 != subscribed)
+        {
+            reason = app_bt_notify_policy_evaluate(app_bas_battery_level[0],
+                                                   xTaskGetTickCount() * portTICK_PERIOD_MS);
+        }
+        if (APP_BT_NOTIFY_POLICY_NONE == reason)
         {
-            if (app_bas_battery_level_client_char_config[0] & GATT_CLIENT_CONFIG_NOTIFICATION)
+            /* Not worth the airtime under the current policy */
+            subscribed = 0;
+        }
+        else if (APP_BT_NOTIFY_POLICY_CRITICAL != reason)
+        {
+            /* Only critical alerts are confirmed where notifications are also on */
+            indicate &= ~app_bt_conn_cccd_subscribers(HDLD_BAS_BATTERY_LEVEL_CLIENT_CHAR_CONFIG,
+                                                      GATT_CLIENT_CONFIG_NOTIFICATION);
+        }
+        if (0 != subscribed)
+        {
+            cy_log_msg(CYLF_DEF, CY_LOG_NOTICE,"================================================\r\n");
+            cy_log_msg(CYLF_DEF, CY_LOG_NOTICE,"Sending Notification: Battery level: %u\r\n",
+                    app_bas_battery_level[0]);
+            cy_log_msg(CYLF_DEF, CY_LOG_NOTICE,"================================================\r\n");
+        }
+        while (0 != subscribed)
+        {
+            slot = (uint8_t)__CLZ(__RBIT(subscribed));
+            subscribed &= subscribed - 1;
+
+            if (0 != (indicate & (1u << slot)))
             {
-                wiced_bt_gatt_server_send_notification(battery_server_context.bt_conn_id,
-                                                    HDLC_BAS_BATTERY_LEVEL_VALUE,
-                                                    app_bas_battery_level_len,
-                                                    app_bas_battery_level,NULL);
-                cy_log_msg(CYLF_DEF, CY_LOG_NOTICE,"================================================\r\n");
-                cy_log_msg(CYLF_DEF, CY_LOG_NOTICE,"Sending Notification: Battery level: %u\r\n",
-                        app_bas_battery_level[0]);
-                cy_log_msg(CYLF_DEF, CY_LOG_NOTICE,"================================================\r\n");
+                app_bt_indicate_send(app_bt_conn_get_conn_id(slot),
+                                     HDLC_BAS_BATTERY_LEVEL_VALUE,
+                                     app_bas_battery_level,
+                                     app_bas_battery_level_len);
+                continue;
             }
+            /* Queued per connection, a busy link gets the newest level later */
+            app_bt_notify_queue_put(app_bt_conn_get_conn_id(slot),
+                                    HDLC_BAS_BATTERY_LEVEL_VALUE,
+                                    app_bas_battery_level,
+                                    app_bas_battery_level_len);
         }
+        /* Values queued this tick leave together, batched where the peer allows */
+        app_bt_notify_queue_flush();
     }
 }
 /**
@@ -718,6 +958,8 @@ static wiced_bt_gatt_status_t app_bt_gatt_event_callback(wiced_bt_gatt_evt_t eve
         break;
 
     case GATT_ATTRIBUTE_REQUEST_EVT:
+        /* Requests arrive in a connection event of their link */
+        app_bt_sched_conn_event(p_event_data->attribute_request.conn_id);
         status = app_bt_server_event_handler (p_event_data, 
                                               &error_handle);
         if(status != WICED_BT_GATT_SUCCESS)
@@ -732,8 +974,8 @@ static wiced_bt_gatt_status_t app_bt_gatt_event_callback(wiced_bt_gatt_evt_t eve
         /* GATT buffer request, typically sized to max of bearer mtu - 1 */
     case GATT_GET_RESPONSE_BUFFER_EVT:
         cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "%s() GATT_GET_RESPONSE_BUFFER_EVT\r\n", __func__);
-        p_event_data->buffer_request.buffer.p_app_rsp_buffer = app_bt_alloc_buffer(p_event_data->buffer_request.len_requested);
-        p_event_data->buffer_request.buffer.p_app_ctxt = (void *)app_bt_free_buffer;
+        p_event_data->buffer_request.buffer.p_app_rsp_buffer = app_bt_buf_pool_alloc(p_event_data->buffer_request.len_requested);
+        p_event_data->buffer_request.buffer.p_app_ctxt = (void *)app_bt_buf_pool_free;
         status = WICED_BT_GATT_SUCCESS;
         break;
         /* GATT buffer transmitted event,  check \ref wiced_bt_gatt_buffer_transmitted_t*/
@@ -742,7 +984,8 @@ static wiced_bt_gatt_status_t app_bt_gatt_event_callback(wiced_bt_gatt_evt_t eve
         {
             pfn_free_buffer_t pfn_free = (pfn_free_buffer_t)p_event_data->buffer_xmitted.p_app_ctxt;
 
-            /* If the buffer is dynamic, the context will point to a function to free it. */
+            /* If the buffer is dynamic, the context will point to a function to free it.
+             * Notifications from app_bt_notify_queue release their queue entry this way. */
             if (pfn_free)
                 pfn_free(p_event_data->buffer_xmitted.p_app_data);
 
@@ -750,6 +993,16 @@ static wiced_bt_gatt_status_t app_bt_gatt_event_callback(wiced_bt_gatt_evt_t eve
         }
         break;
 
+    case GATT_CONGESTION_EVT:
+        cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "%s() GATT_CONGESTION_EVT conn %u congested %u\r\n", __func__,
+                   p_event_data->congestion.conn_id, p_event_data->congestion.congested);
+        app_bt_notify_queue_congestion(p_event_data->congestion.conn_id,
+                                       p_event_data->congestion.congested);
+        app_bt_history_congestion(p_event_data->congestion.conn_id,
+                                  p_event_data->congestion.congested);
+        status = WICED_BT_GATT_SUCCESS;
+        break;
+
     default:
         cy_log_msg(CYLF_DEF, CY_LOG_INFO, " Unhandled GATT Event \r\n");
         status = WICED_BT_GATT_ERROR;
@@ -787,16 +1040,32 @@ static wiced_bt_gatt_status_t app_bt_connect_event_handler (wiced_bt_gatt_connec
             print_bd_address(p_conn_status->bd_addr);
             cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Connection ID '%d'\r\n", p_conn_status->conn_id);
 
-            /* Store the connection ID and peer BD Address */
-            battery_server_context.bt_conn_id = p_conn_status->conn_id;
-            memcpy(battery_server_context.bt_peer_addr, p_conn_status->bd_addr, BD_ADDR_LEN);
+            /* Store the connection ID and peer BD Address in a free slot */
+            if (APP_BT_CONN_INVALID_SLOT == app_bt_conn_open(p_conn_status->conn_id,
+                                                             p_conn_status->bd_addr))
+            {
+                cy_log_msg(CYLF_DEF, CY_LOG_ERR, "No free connection slot, disconnecting\r\n");
+                wiced_bt_gatt_disconnect(p_conn_status->conn_id);
+                return WICED_BT_GATT_SUCCESS;
+            }
+
+            /* Connection events this update timer can align to */
+            app_bt_sched_conn_open(p_conn_status->conn_id, p_conn_status->bd_addr);
+
+            /* The stack stops advertising on connection; resume while
+             * further centrals can still be accepted */
+            if (app_bt_conn_count() < APP_BT_MAX_CONNECTIONS)
+            {
+                result = wiced_bt_start_advertisements(BTM_BLE_ADVERT_UNDIRECTED_HIGH, 0, NULL);
+                if (WICED_BT_SUCCESS != result)
+                {
+                    cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Advertisement cannot start because of error: %d \r\n",
+                               result);
+                }
+            }
 
             /* Update the adv/conn state */
             app_bt_adv_conn_state = APP_BT_ADV_OFF_CONN_ON;
-            /* Save BT connection ID in application data structure */
-            battery_server_context.bt_conn_id = p_conn_status->conn_id;
-            /* Save BT peer ADDRESS in application data structure */
-            memcpy(battery_server_context.bt_peer_addr, p_conn_status->bd_addr, BD_ADDR_LEN);
         }
         else
         {
@@ -806,20 +1075,46 @@ static wiced_bt_gatt_status_t app_bt_connect_event_handler (wiced_bt_gatt_connec
             cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Connection ID '%d', Reason '%s'\r\n", p_conn_status->conn_id,
                        get_bt_gatt_disconn_reason_name(p_conn_status->reason));
 
-            /* Set the connection id to zero to indicate disconnected state */
-            battery_server_context.bt_conn_id = 0;
+            /* Drop any long write the peer left pending and free its slot */
+            app_bt_gatt_prep_write_clear(p_conn_status->conn_id);
+            app_bt_notify_queue_close(p_conn_status->conn_id);
+            app_bt_indicate_close(p_conn_status->conn_id);
+            app_bt_history_close(p_conn_status->conn_id);
+            app_bt_sched_conn_close(p_conn_status->conn_id);
+            app_bt_conn_close(p_conn_status->conn_id);
+            app_bt_heap_print_stats();
+            app_bt_att_latency_print();
+            app_bt_notify_policy_print();
+            app_bt_notify_queue_print();
+            app_bt_indicate_print();
+            app_bt_history_print();
+            app_bt_sched_print();
+            app_bt_lpm_print();
+#if defined(APP_BT_ADV_BAS) && APP_BT_ADV_BAS
+            app_bt_adv_bas_print();
+#endif
+
+            /* The OTA session belonged to this peer */
+            if (battery_server_context.bt_conn_id == p_conn_status->conn_id)
+            {
+                battery_server_context.bt_conn_id = 0;
+            }
 
-            /* Restart the advertisements */
-            result = wiced_bt_start_advertisements(BTM_BLE_ADVERT_UNDIRECTED_HIGH, 0, NULL);
-            if (WICED_BT_SUCCESS != result)
+            /* Restart the advertisements if the table was full */
+            if (BTM_BLE_ADVERT_OFF == wiced_bt_ble_get_current_advert_mode())
             {
-                cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Advertisement cannot start because of error: %d \r\n",
-                           result);
-                CY_ASSERT(0);
+                result = wiced_bt_start_advertisements(BTM_BLE_ADVERT_UNDIRECTED_HIGH, 0, NULL);
+                if (WICED_BT_SUCCESS != result)
+                {
+                    cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Advertisement cannot start because of error: %d \r\n",
+                               result);
+                    CY_ASSERT(0);
+                }
             }
 
             /* Update the adv/conn state */
-            app_bt_adv_conn_state = APP_BT_ADV_ON_CONN_OFF;
+            app_bt_adv_conn_state = (0 == app_bt_conn_count()) ? APP_BT_ADV_ON_CONN_OFF :
+                                                                 APP_BT_ADV_OFF_CONN_ON;
         }
 
         /* Update Advertisement LED to reflect the updated state */
@@ -848,6 +1143,7 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler (wiced_bt_gatt_event_d
 {
     wiced_bt_gatt_status_t status = WICED_BT_GATT_SUCCESS;
     wiced_bt_gatt_attribute_request_t   *p_att_req = &p_data->attribute_request;
+    uint32_t                             start = app_bt_att_latency_start();
 
     switch (p_att_req->opcode)
     {
@@ -892,15 +1188,35 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler (wiced_bt_gatt_event_d
 
     case GATT_REQ_PREPARE_WRITE:
         cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "  %s() GATT_REQ_PREPARE_WRITE\r\n", __func__);
-        status = WICED_BT_GATT_SUCCESS;
+        {
+            wiced_bt_gatt_write_req_t *p_write_request = &p_att_req->data.write_req;
+            uint8_t *p_echo;
+
+            /* Stage the fragment, it is only written to the GATT DB on execute */
+            *p_error_handle = p_write_request->handle;
+            status = app_bt_gatt_prep_write_queue(p_att_req->conn_id, p_write_request, &p_echo);
+            if (status == WICED_BT_GATT_SUCCESS)
+            {
+                wiced_bt_gatt_server_send_prepare_write_rsp(p_att_req->conn_id, p_att_req->opcode,
+                                                            p_write_request->handle,
+                                                            p_write_request->offset,
+                                                            p_write_request->val_len,
+                                                            p_echo, NULL);
+            }
+        }
         break;
 
     case GATT_REQ_EXECUTE_WRITE:
         cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "  %s() GATTS_REQ_TYPE_WRITE_EXEC\r\n",
                    __func__);
-        wiced_bt_gatt_server_send_execute_write_rsp(p_att_req->conn_id, 
-                                                    p_att_req->opcode);
-        status = WICED_BT_GATT_SUCCESS;
+        status = app_bt_gatt_prep_write_execute(p_att_req->conn_id,
+                                                p_att_req->data.exec_write_req,
+                                                app_bt_set_value, p_error_handle);
+        if (status == WICED_BT_GATT_SUCCESS)
+        {
+            wiced_bt_gatt_server_send_execute_write_rsp(p_att_req->conn_id, 
+                                                        p_att_req->opcode);
+        }
         break;
 
     case GATT_REQ_MTU:
@@ -911,12 +1227,21 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler (wiced_bt_gatt_event_d
                                                    wiced_bt_cfg_settings.p_ble_cfg->ble_max_rx_pdu_size);
         cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "    Set MTU size to: %d  status: 0x%d\r\n",
                     p_att_req->data.remote_mtu, status);
+        app_bt_conn_set_mtu(p_att_req->conn_id,
+                            MIN(p_att_req->data.remote_mtu,
+                                wiced_bt_cfg_settings.p_ble_cfg->ble_max_rx_pdu_size));
         break;
 
     case GATT_HANDLE_VALUE_CONF: /* Value confirmation */
         cy_log_msg(CYLF_DEF, CY_LOG_DEBUG, "  %s() GATTS_REQ_TYPE_CONF\r\n",
                    __func__);
         cy_ota_agent_state_t ota_lib_state;
+        if (WICED_TRUE == app_bt_indicate_confirm(p_att_req->conn_id, p_att_req->data.handle))
+        {
+            /* Battery level indication, not an OTA one */
+            status = WICED_BT_GATT_SUCCESS;
+            break;
+        }
         cy_ota_get_state(battery_server_context.ota_context, &ota_lib_state);
         if ((ota_lib_state == CY_OTA_STATE_OTA_COMPLETE) && /* Check if we completed the download before rebooting */
             (battery_server_context.reboot_at_end != 0))
@@ -944,6 +1269,8 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler (wiced_bt_gatt_event_d
         status = WICED_BT_GATT_ERROR;
         break;
     }
+
+    app_bt_att_latency_record(p_att_req->opcode, start);
     return status;
 }
 
@@ -954,7 +1281,8 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler (wiced_bt_gatt_event_d
  * Function Description:
  * @brief  The function is invoked when GATTS_REQ_TYPE_WRITE is received from the
  *         client device and is invoked GATT Server Event Callback function. This
- *         handles "Write Requests" received from Client device.
+ *         handles "Write Requests" received from Client device. OTA writes reach
+ *         the OTA library through the hooks in APP_BT_OTA_GATT_ATTR_HOOKS.
  *
  * @param p_write_req   Pointer to Bluetooth LE GATT write request
  *
@@ -963,30 +1291,18 @@ static wiced_bt_gatt_status_t app_bt_server_event_handler (wiced_bt_gatt_event_d
 static wiced_bt_gatt_status_t app_bt_write_handler(wiced_bt_gatt_event_data_t *p_data, 
                                                    uint16_t *p_error_handle)
 {
-    wiced_bt_gatt_write_req_t *p_write_req = &p_data->attribute_request.data.write_req;;
-    cy_rslt_t result;
+    wiced_bt_gatt_write_req_t *p_write_req = &p_data->attribute_request.data.write_req;
 
     *p_error_handle = p_write_req->handle;
 
     CY_ASSERT(( NULL != p_data ) && (NULL != p_write_req));
 
-    switch (p_write_req->handle)
-    {
-    case HDLD_OTA_FW_UPGRADE_SERVICE_OTA_UPGRADE_CONTROL_POINT_CLIENT_CHAR_CONFIG:
-    case HDLC_OTA_FW_UPGRADE_SERVICE_OTA_UPGRADE_CONTROL_POINT_VALUE:
-    case HDLC_OTA_FW_UPGRADE_SERVICE_OTA_UPGRADE_DATA_VALUE:
-        /*Call OTA write handler to handle OTA related writes*/
-        result = app_bt_ota_write_handler(p_data, p_error_handle);
-        return (result == CY_RSLT_SUCCESS) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_ERROR;
-
-    default:
-        /* Handle normal (non-OTA) indication confirmation requests here */
-        /* Attempt to perform the Write Request */
-        return app_bt_set_value(p_write_req->handle,
-                                p_write_req->p_val,
-                                p_write_req->val_len);
-        break;
-    }
+    /* Attempt to perform the Write Request */
+    return app_bt_set_value(p_data->attribute_request.conn_id,
+                            p_data,
+                            p_write_req->handle,
+                            p_write_req->p_val,
+                            p_write_req->val_len);
 }
 
 /**
@@ -995,62 +1311,32 @@ static wiced_bt_gatt_status_t app_bt_write_handler(wiced_bt_gatt_event_data_t *p
  *
  * Function Description:
  * @brief  The function is invoked by app_bt_write_handler to set a value
- *         to GATT DB.
+ *         to GATT DB. Attribute specific handling is done by the hooks
+ *         registered in app_bt_gatt_attr_hooks.
  *
+ * @param conn_id      Connection ID
+ * @param p_data       Originating GATT request, NULL for local writes
  * @param attr_handle  GATT attribute handle
  * @param p_val        Pointer to Bluetooth LE GATT write request value
  * @param len          length of GATT write request
  *
  * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
  */
-static wiced_bt_gatt_status_t app_bt_set_value(uint16_t attr_handle, 
+static wiced_bt_gatt_status_t app_bt_set_value(uint16_t conn_id,
+                                               wiced_bt_gatt_event_data_t *p_data,
+                                               uint16_t attr_handle,
                                                uint8_t *p_val,
                                                uint16_t len)
 {
-    wiced_bt_gatt_status_t status = WICED_BT_GATT_INVALID_HANDLE;
+    wiced_bt_gatt_status_t status;
 
     cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "%s() handle : 0x%x (%d)\r\n", __func__,
                attr_handle, attr_handle);
 
-    for (int i = 0; i < app_gatt_db_ext_attr_tbl_size; i++)
+    status = app_bt_gatt_db_write(conn_id, p_data, attr_handle, p_val, len);
+    if (WICED_BT_GATT_INVALID_ATTR_LEN == status)
     {
-        /* Check for a matching handle entry */
-        if (app_gatt_db_ext_attr_tbl[i].handle == attr_handle)
-        {
-            /* Detected a matching handle in the external lookup table */
-            if (app_gatt_db_ext_attr_tbl[i].max_len >= len)
-            {
-                /* Value fits within the supplied buffer; copy over the value */
-                app_gatt_db_ext_attr_tbl[i].cur_len = len;
-                memset(app_gatt_db_ext_attr_tbl[i].p_data, 0x00, app_gatt_db_ext_attr_tbl[i].max_len);
-                memcpy(app_gatt_db_ext_attr_tbl[i].p_data, p_val, app_gatt_db_ext_attr_tbl[i].cur_len);
-
-                if (memcmp(app_gatt_db_ext_attr_tbl[i].p_data, p_val, app_gatt_db_ext_attr_tbl[i].cur_len) == 0)
-                {
-                    status = WICED_BT_GATT_SUCCESS;
-                }
-
-                if(app_gatt_db_ext_attr_tbl[i].handle == HDLD_BAS_BATTERY_LEVEL_CLIENT_CHAR_CONFIG)
-                {
-                    if (GATT_CLIENT_CONFIG_NOTIFICATION == app_bas_battery_level_client_char_config[0])
-                    {
-                        cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Battery Server Notifications Enabled \r\n");
-                    }
-                    else
-                    {
-                        cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Battery Server Notifications Disabled \r\n");
-                    }
-
-                }
-            }
-            else
-            {
-                /* Value to write will not fit within the table */
-                status = WICED_BT_GATT_INVALID_ATTR_LEN;
-                cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Invalid attribute length\r\n");
-            }
-            break;
-        }
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Invalid attribute length\r\n");
     }
     if (WICED_BT_GATT_SUCCESS != status)
     {
@@ -1058,6 +1344,96 @@ static wiced_bt_gatt_status_t app_bt_set_value(uint16_t attr_handle,
     }
     return status;
 }
+
+/**
+ * Function Name:
+ * app_bt_bas_cccd_validate
+ *
+ * Function Description:
+ * @brief  Validate hook for the Battery Level CCCD. The characteristic
+ *         supports notifications and indications, any other bit is rejected.
+ *
+ * @param conn_id      Connection ID
+ * @param handle       GATT attribute handle
+ * @param p_val        Pointer to the value to be written
+ * @param len          Length of the value to be written
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+static wiced_bt_gatt_status_t app_bt_bas_cccd_validate(uint16_t conn_id,
+                                                       uint16_t handle,
+                                                       uint8_t *p_val,
+                                                       uint16_t len)
+{
+    (void)conn_id;
+    (void)handle;
+
+    if ((0 == len) ||
+        (0 != (p_val[0] & ~(GATT_CLIENT_CONFIG_NOTIFICATION | GATT_CLIENT_CONFIG_INDICATION))) ||
+        ((len > 1) && (0 != p_val[1])))
+    {
+        return WICED_BT_GATT_CCC_CFG_ERR;
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/**
+ * Function Name:
+ * app_bt_bas_cccd_on_write
+ *
+ * Function Description:
+ * @brief  Write hook for the Battery Level CCCD. Stores the value for the
+ *         writing connection and reports the new notification state when
+ *         it changes.
+ *
+ * @param conn_id      Connection ID
+ * @param p_data       Originating GATT request, NULL for local writes
+ * @param handle       GATT attribute handle
+ * @param p_val        Pointer to the value written
+ * @param len          Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  Bluetooth LE GATT status
+ */
+static wiced_bt_gatt_status_t app_bt_bas_cccd_on_write(uint16_t conn_id,
+                                                       wiced_bt_gatt_event_data_t *p_data,
+                                                       uint16_t handle,
+                                                       uint8_t *p_val,
+                                                       uint16_t len)
+{
+    wiced_bt_gatt_status_t status;
+    wiced_bool_t changed;
+    uint16_t value = p_val[0];
+
+    (void)p_data;
+
+    if (len > 1)
+    {
+        value |= (uint16_t)(p_val[1] << 8);
+    }
+
+    /* Each client has its own copy of the descriptor */
+    status = app_bt_conn_cccd_set(conn_id, handle, value, &changed);
+    if ((WICED_BT_GATT_SUCCESS != status) || !changed)
+    {
+        /* Nothing to report when the client rewrites the current setting */
+        return status;
+    }
+
+    if (0 != value)
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Battery Server Notifications %s, Indications %s \r\n",
+                (0 != (value & GATT_CLIENT_CONFIG_NOTIFICATION)) ? "Enabled" : "Disabled",
+                (0 != (value & GATT_CLIENT_CONFIG_INDICATION)) ? "Enabled" : "Disabled");
+        /* The new subscriber gets the current level at the next update */
+        app_bt_notify_policy_kick();
+    }
+    else
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "Battery Server Notifications and Indications Disabled \r\n");
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
 /**
  * Function Name:
  * app_bt_batt_level_init
@@ -1069,12 +1445,20 @@ static wiced_bt_gatt_status_t app_bt_set_value(uint16_t attr_handle,
  */
 static void app_bt_batt_level_init(void)
 {
+#if defined(APP_BT_BAS_HAL_TIMER) && APP_BT_BAS_HAL_TIMER
     /* Start the timer */
     if (CY_RSLT_SUCCESS != cyhal_timer_start(&bas_timer_obj))
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR,"BAS timer start failed !");
         CY_ASSERT(0);
     }
+#else
+    if (WICED_TRUE != app_bt_sched_start())
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR,"BAS timer start failed !");
+        CY_ASSERT(0);
+    }
+#endif
 }
 
 /**
@@ -1089,6 +1473,11 @@ static void app_bt_batt_level_init(void)
  */
 static void app_bt_adv_led_update(void)
 {
+#if defined(APP_BT_LOW_POWER) && APP_BT_LOW_POWER
+    /* No blinking without the PWM: LED ON for connected state, OFF otherwise */
+    cyhal_gpio_write(ADV_LED_GPIO, (APP_BT_ADV_OFF_CONN_ON == app_bt_adv_conn_state) ?
+                                   CYBSP_LED_STATE_ON : CYBSP_LED_STATE_OFF);
+#else
     cy_rslt_t cy_result = CY_RSLT_SUCCESS;
 
     /* Stop the advertising led pwm */
@@ -1138,30 +1527,7 @@ static void app_bt_adv_led_update(void)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "Failed to start PWM !!\r\n");
     }
-}
-
-/**
- * Function Name:
- * app_bt_find_by_handle
- *
- * Function Description:
- * @brief  Find attribute description by handle
- *
- * @param handle    handle to look up
- *
- * @return gatt_db_lookup_table_t   pointer containing handle data
- */
-static gatt_db_lookup_table_t *app_bt_find_by_handle(uint16_t handle)
-{
-    int i;
-    for (i = 0; i < app_gatt_db_ext_attr_tbl_size; i++)
-    {
-        if (app_gatt_db_ext_attr_tbl[i].handle == handle)
-        {
-            return (&app_gatt_db_ext_attr_tbl[i]);
-        }
-    }
-    return NULL;
+#endif
 }
 
 /**
@@ -1184,33 +1550,33 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_handler(uint16_t conn_id,
                                                            uint16_t len_requested, 
                                                            uint16_t *p_error_handle)
 {
-    gatt_db_lookup_table_t *puAttribute;
     uint16_t attr_len_to_copy, to_send;
     uint8_t *from;
+    uint8_t *p_attr_val;
 
     *p_error_handle = p_read_req->handle;
 
-    if ((puAttribute = app_bt_find_by_handle(p_read_req->handle)) == NULL)
+    if (app_bt_gatt_db_read(conn_id, p_read_req->handle, &p_attr_val,
+                            &attr_len_to_copy) != WICED_BT_GATT_SUCCESS)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s()  Attribute not found, Handle: 0x%04x\r\n",
                     __func__, p_read_req->handle);
         return WICED_BT_GATT_INVALID_HANDLE;
     }
 
-    attr_len_to_copy = puAttribute->cur_len;
     cy_log_msg(CYLF_DEF, CY_LOG_NOTICE, "%s() conn_id: %d handle:0x%04x offset:%d len:%d\r\n", __func__,
                conn_id, p_read_req->handle, p_read_req->offset, attr_len_to_copy);
 
-    if (p_read_req->offset >= puAttribute->cur_len)
+    if (p_read_req->offset >= attr_len_to_copy)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s() offset:%d larger than attribute length:%d\r\n", __func__,
-                   p_read_req->offset, puAttribute->cur_len);
+                   p_read_req->offset, attr_len_to_copy);
 
         return WICED_BT_GATT_INVALID_OFFSET;
     }
 
     to_send = MIN(len_requested, attr_len_to_copy - p_read_req->offset);
-    from = puAttribute->p_data + p_read_req->offset;
+    from = p_attr_val + p_read_req->offset;
     return wiced_bt_gatt_server_send_read_handle_rsp(conn_id, opcode, to_send, from, NULL); /* No need for context, as buff not allocated */
 }
 
@@ -1234,13 +1600,33 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_by_type_handler(uint16_t conn
                                                                    uint16_t len_requested, 
                                                                    uint16_t *p_error_handle)
 {
-    gatt_db_lookup_table_t *puAttribute;
+    uint8_t *p_attr_val;
+    uint16_t attr_len;
     uint16_t last_handle = 0;
     uint16_t attr_handle = p_read_req->s_handle;
-    uint8_t *p_rsp = app_bt_alloc_buffer(len_requested);
+    app_bt_gatt_cache_key_t cache_key;
+    pfn_free_buffer_t pfn_free = app_bt_gatt_cache_release;
+    uint16_t cached_len;
+    uint8_t *p_rsp;
     uint8_t pair_len = 0;
     int used = 0;
 
+    /* Repeat of an earlier request: hand out the prebuilt response */
+    app_bt_gatt_cache_key_read_by_type(&cache_key, opcode, p_read_req, len_requested);
+    if ((p_rsp = app_bt_gatt_cache_lookup(&cache_key, &cached_len, &pair_len)) != NULL)
+    {
+        wiced_bt_gatt_server_send_read_by_type_rsp(conn_id, opcode, pair_len, cached_len,
+                                                   p_rsp, (void *)pfn_free);
+        return WICED_BT_GATT_SUCCESS;
+    }
+
+    /* Build in a cache entry if one is free, on the heap otherwise */
+    if ((p_rsp = app_bt_gatt_cache_reserve(&cache_key)) == NULL)
+    {
+        p_rsp = app_bt_buf_pool_alloc(len_requested);
+        pfn_free = app_bt_buf_pool_free;
+    }
+
     if (p_rsp == NULL)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s() No memory, len_requested: %d!!\r\n",
@@ -1254,18 +1640,19 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_by_type_handler(uint16_t conn
     {
         *p_error_handle = attr_handle;
         last_handle = attr_handle;
-        attr_handle = wiced_bt_gatt_find_handle_by_type(attr_handle, 
-                                                        p_read_req->e_handle,
-                                                        &p_read_req->uuid);
+        attr_handle = app_bt_gatt_db_find_handle_by_type(attr_handle,
+                                                         p_read_req->e_handle,
+                                                         &p_read_req->uuid);
 
         if (attr_handle == 0)
             break;
 
-        if ((puAttribute = app_bt_find_by_handle(attr_handle)) == NULL)
+        if (app_bt_gatt_db_read(conn_id, attr_handle, &p_attr_val,
+                                &attr_len) != WICED_BT_GATT_SUCCESS)
         {
             cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s()  found type but no attribute for %d \r\n",
                        __func__, last_handle);
-            app_bt_free_buffer(p_rsp);
+            pfn_free(p_rsp);
             return WICED_BT_GATT_INVALID_HANDLE;
         }
 
@@ -1274,13 +1661,14 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_by_type_handler(uint16_t conn
                                                                       len_requested - used,
                                                                       &pair_len,
                                                                       attr_handle,
-                                                                      puAttribute->cur_len,
-                                                                      puAttribute->p_data);
+                                                                      attr_len,
+                                                                      p_attr_val);
             if (filled == 0)
             {
                 break;
             }
             used += filled;
+            app_bt_gatt_cache_track(p_rsp, attr_handle);
         }
 
         /* Increment starting handle for next search to one past current */
@@ -1294,13 +1682,14 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_by_type_handler(uint16_t conn
                    __func__, p_read_req->s_handle, p_read_req->e_handle,
                    p_read_req->uuid.uu.uuid16);
 
-        app_bt_free_buffer(p_rsp);
+        pfn_free(p_rsp);
         return WICED_BT_GATT_INVALID_HANDLE;
     }
 
     /* Send the response */
+    app_bt_gatt_cache_commit(p_rsp, (uint16_t)used, pair_len);
     wiced_bt_gatt_server_send_read_by_type_rsp(conn_id, opcode, pair_len, used,
-                                               p_rsp, (void *)app_bt_free_buffer);
+                                               p_rsp, (void *)pfn_free);
 
     return WICED_BT_GATT_SUCCESS;
 }
@@ -1325,13 +1714,34 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_multi_handler(uint16_t conn_i
                                                                  uint16_t len_requested, 
                                                                  uint16_t *p_error_handle)
 {
-    gatt_db_lookup_table_t *puAttribute;
-    uint8_t *p_rsp = app_bt_alloc_buffer(len_requested);
+    uint8_t *p_attr_val;
+    uint16_t attr_len;
+    app_bt_gatt_cache_key_t cache_key;
+    pfn_free_buffer_t pfn_free = app_bt_gatt_cache_release;
+    uint16_t cached_len;
+    uint8_t pair_len;
+    uint8_t *p_rsp;
     int used = 0;
     int xx;
     uint16_t handle = wiced_bt_gatt_get_handle_from_stream(p_read_req->p_handle_stream, 0);
     *p_error_handle = handle;
 
+    /* Repeat of an earlier request: hand out the prebuilt response */
+    app_bt_gatt_cache_key_read_multi(&cache_key, opcode, p_read_req, len_requested);
+    if ((p_rsp = app_bt_gatt_cache_lookup(&cache_key, &cached_len, &pair_len)) != NULL)
+    {
+        wiced_bt_gatt_server_send_read_multiple_rsp(conn_id, opcode, cached_len, p_rsp,
+                                                    (void *)pfn_free);
+        return WICED_BT_GATT_SUCCESS;
+    }
+
+    /* Build in a cache entry if one is free, on the heap otherwise */
+    if ((p_rsp = app_bt_gatt_cache_reserve(&cache_key)) == NULL)
+    {
+        p_rsp = app_bt_buf_pool_alloc(len_requested);
+        pfn_free = app_bt_buf_pool_free;
+    }
+
     if (p_rsp == NULL)
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s() No memory len_requested: %d!!\r\n",
@@ -1345,25 +1755,27 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_multi_handler(uint16_t conn_i
     {
         handle = wiced_bt_gatt_get_handle_from_stream(p_read_req->p_handle_stream, xx);
         *p_error_handle = handle;
-        if ((puAttribute = app_bt_find_by_handle(handle)) == NULL)
+        if (app_bt_gatt_db_read(conn_id, handle, &p_attr_val,
+                                &attr_len) != WICED_BT_GATT_SUCCESS)
         {
             cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s()  no handle 0x%04x\r\n",
                        __func__, handle);
-            app_bt_free_buffer(p_rsp);
+            pfn_free(p_rsp);
             return WICED_BT_GATT_ERR_UNLIKELY;
         }
 
         {
             int filled = wiced_bt_gatt_put_read_multi_rsp_in_stream(opcode, p_rsp + used,
                                                                     len_requested - used,
-                                                                    puAttribute->handle,
-                                                                    puAttribute->cur_len,
-                                                                    puAttribute->p_data);
+                                                                    handle,
+                                                                    attr_len,
+                                                                    p_attr_val);
             if (!filled)
             {
                 break;
             }
             used += filled;
+            app_bt_gatt_cache_track(p_rsp, handle);
         }
     }
 
@@ -1371,12 +1783,14 @@ static wiced_bt_gatt_status_t app_bt_gatt_req_read_multi_handler(uint16_t conn_i
     {
         cy_log_msg(CYLF_DEF, CY_LOG_ERR, "%s() no attr found\r\n", __func__);
 
+        pfn_free(p_rsp);
         return WICED_BT_GATT_INVALID_HANDLE;
     }
 
     /* Send the response */
+    app_bt_gatt_cache_commit(p_rsp, (uint16_t)used, 0);
     wiced_bt_gatt_server_send_read_multiple_rsp(conn_id, opcode, used, p_rsp,
-                                                (void *)app_bt_free_buffer);
+                                                (void *)pfn_free);
 
     return WICED_BT_GATT_SUCCESS;
 }
@@ -42,10 +42,13 @@
 #include "cycfg_gatt_db.h"
 #include "ota.h"
 #include "cyabs_rtos.h"
+#include <string.h>
 
 /* OTA related header files */
 #include "cy_ota_api.h"
 #include "ota_context.h"
+#include "app_bt_conn.h"
+#include "app_bt_heap.h"
 
 /* FreeRTOS header file */
 #include <FreeRTOS.h>
@@ -176,6 +179,68 @@ wiced_bt_gatt_status_t app_bt_ota_write_handler(wiced_bt_gatt_event_data_t *p_da
     return WICED_BT_GATT_REQ_NOT_SUPPORTED;
 }
 
+/**
+ * Function Name:
+ * app_bt_ota_on_write
+ *
+ * Function Description:
+ * @brief  Attribute write hook registered for the OTA service handles through
+ *         APP_BT_OTA_GATT_ATTR_HOOKS. Passes the request on to
+ *         app_bt_ota_write_handler.
+ *
+ * @param conn_id   Connection ID
+ * @param p_data    Originating GATT request
+ * @param handle    GATT attribute handle
+ * @param p_val     Pointer to the value written
+ * @param len       Length of the value written
+ *
+ * @return wiced_bt_gatt_status_t  BLE GATT status
+ */
+wiced_bt_gatt_status_t app_bt_ota_on_write(uint16_t conn_id, wiced_bt_gatt_event_data_t *p_data,
+                                           uint16_t handle, uint8_t *p_val, uint16_t len)
+{
+    uint16_t error_handle;
+    const uint8_t *p_peer_addr;
+    wiced_bt_gatt_status_t status;
+    app_bt_heap_tag_t prev_tag;
+
+    (void)handle;
+    (void)p_val;
+    (void)len;
+
+    /* The OTA library needs the original request, local writes are refused */
+    if (NULL == p_data)
+    {
+        return WICED_BT_GATT_WRITE_NOT_PERMIT;
+    }
+
+    /* Only one central can drive an update; the first to write owns it
+     * until it disconnects */
+    if ((0 != battery_server_context.bt_conn_id) &&
+        (conn_id != battery_server_context.bt_conn_id))
+    {
+        cy_log_msg(CYLF_DEF, CY_LOG_ERR, "OTA busy with connection %d\r\n",
+                   battery_server_context.bt_conn_id);
+        return WICED_BT_GATT_ERROR;
+    }
+    if (0 == battery_server_context.bt_conn_id)
+    {
+        battery_server_context.bt_conn_id = conn_id;
+        p_peer_addr = app_bt_conn_get_peer_addr(conn_id);
+        if (NULL != p_peer_addr)
+        {
+            memcpy(battery_server_context.bt_peer_addr, p_peer_addr, BD_ADDR_LEN);
+        }
+    }
+
+    /* The OTA library allocates from the stack task */
+    prev_tag = app_bt_heap_set_task_tag(APP_BT_HEAP_TAG_OTA);
+    status = app_bt_ota_write_handler(p_data, &error_handle);
+    (void)app_bt_heap_set_task_tag(prev_tag);
+
+    return (status == WICED_BT_GATT_SUCCESS) ? WICED_BT_GATT_SUCCESS : WICED_BT_GATT_ERROR;
+}
+
 /**
  * Function Name:
  * app_bt_ota_init
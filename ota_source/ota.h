@@ -46,6 +46,22 @@
 #include "wiced_bt_gatt.h"
 #include "cycfg_gatt_db.h"
 #include "ota_context.h"
+#include "app_bt_gatt_db.h"
+
+/*******************************************************************************
+*        Macro Definitions
+*******************************************************************************/
+/**
+ * @brief Attribute hook entries for the OTA service. The OTA library consumes
+ *        these writes directly, so nothing is stored in the attribute table.
+ */
+#define APP_BT_OTA_GATT_ATTR_HOOKS                                                      \
+    { HDLD_OTA_FW_UPGRADE_SERVICE_OTA_UPGRADE_CONTROL_POINT_CLIENT_CHAR_CONFIG,         \
+      APP_BT_GATT_ATTR_FLAG_NO_STORE, NULL, app_bt_ota_on_write, NULL },               \
+    { HDLC_OTA_FW_UPGRADE_SERVICE_OTA_UPGRADE_CONTROL_POINT_VALUE,                      \
+      APP_BT_GATT_ATTR_FLAG_NO_STORE, NULL, app_bt_ota_on_write, NULL },               \
+    { HDLC_OTA_FW_UPGRADE_SERVICE_OTA_UPGRADE_DATA_VALUE,                               \
+      APP_BT_GATT_ATTR_FLAG_NO_STORE, NULL, app_bt_ota_on_write, NULL }
 
 /*******************************************************************************
 *        Variable Definitions
@@ -58,6 +74,8 @@ extern app_context_t battery_server_context;
  * Function prototype
  ******************************************************************************/
 wiced_bt_gatt_status_t app_bt_ota_write_handler(wiced_bt_gatt_event_data_t *p_data, uint16_t *p_error_handle);
+wiced_bt_gatt_status_t app_bt_ota_on_write(uint16_t conn_id, wiced_bt_gatt_event_data_t *p_data,
+                                           uint16_t handle, uint8_t *p_val, uint16_t len);
 void app_bt_initialize_default_values(void);
 
 #endif /* #define OTA_H_ */
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Compares reading the battery level from advertising data with connect-and-read.
+
+Monte Carlo model of one poll at the link layer, LE 1M PHY:
+
+    adv      BAS_ADV_DATA=1. A passive scanner waits for one ADV_IND carrying
+             the Battery Service data (app_bt_adv_bas.c) and is done.
+    connect  The central waits for an ADV_IND, sends CONNECT_IND and runs the
+             ATT exchanges of --flow, then terminates the link:
+
+                 cached    Read Request on the known Battery Level handle
+                 uuid      Read By Type Request for the Battery Level UUID
+                 discover  MTU exchange, Battery Service discovery,
+                           characteristic discovery and the read
+
+The advertiser sends on channels 37, 38 and 39 every --adv-interval-ms plus
+the random 0-10 ms advDelay. The scanner listens for --scan-window-ms of
+every --scan-interval-ms, one channel per interval in turn, and loses a PDU
+with probability --per. On a connection each request goes out at a
+connection event and its response --rsp-events events later, with empty
+PDUs in between; the LL version and feature exchanges run alongside.
+
+Bytes on air include the preamble, access address, header and CRC of every
+PDU of both sides, airtime adds the 150 us inter frame space within events.
+Latency runs from the start of the poll to the value at the scanner.
+
+    python3 scripts/app_adv_bas_bench.py
+    python3 scripts/app_adv_bas_bench.py --adv-interval-ms 1280 --flow cached
+    python3 scripts/app_adv_bas_bench.py --scan-window-ms 100 --conn-interval-ms 7.5
+
+The level costs every advertising PDU five bytes whether anyone reads it or
+not; the break-even line gives the poll rate above which that is cheaper than
+serving the same polls over connections.
+"""
+
+import argparse
+import random
+import sys
+
+US_PER_BYTE = 8.0               # LE 1M PHY
+T_IFS_US = 150.0
+PDU_OVERHEAD = 1 + 4 + 2 + 3    # preamble, access address, header, CRC
+ADV_A = 6                       # AdvA in front of the advertising data
+CONNECT_IND = 34                # InitA, AdvA, LLData
+L2CAP = 4
+BAS_DATA = 2 + 3                # element length and type, UUID, level
+
+# ATT request and response lengths per exchange
+FLOWS = {
+    "cached": [(3, 2)],
+    "uuid": [(7, 5)],
+    "discover": [(3, 3), (9, 5), (7, 9), (7, 5), (3, 2)],
+}
+# LL control PDUs run alongside: version indications, feature request and response
+LL_CONTROL = [6, 6, 9, 9]
+LL_TERMINATE = 2
+
+
+def pdu_bytes(payload):
+    return PDU_OVERHEAD + payload
+
+
+def first_adv_rx(rng, args, t0, adv_size):
+    """Time (ms) an ADV_IND of adv_size bytes is received after a poll starting at t0."""
+    adv_ms = adv_size * US_PER_BYTE / 1000.0
+    t = t0 - rng.uniform(0.0, args.adv_interval_ms + 10.0)
+    while True:
+        for channel in range(3):
+            end = t + channel * args.channel_gap_us / 1000.0 + adv_ms
+            if end >= t0:
+                scan = int(end // args.scan_interval_ms)
+                listening = end - scan * args.scan_interval_ms <= args.scan_window_ms
+                if listening and scan % 3 == channel and rng.random() >= args.per:
+                    return end
+        t += args.adv_interval_ms + rng.uniform(0.0, 10.0)
+
+
+def poll_adv(rng, args):
+    t0 = rng.uniform(0.0, 10000.0)
+    size = pdu_bytes(ADV_A + args.adv_data_len + BAS_DATA)
+    latency = first_adv_rx(rng, args, t0, size) - t0
+    return latency, size, size * US_PER_BYTE
+
+
+def poll_connect(rng, args):
+    t0 = rng.uniform(0.0, 10000.0)
+    size = pdu_bytes(ADV_A + args.adv_data_len)
+    t = first_adv_rx(rng, args, t0, size)
+    size += pdu_bytes(CONNECT_IND)
+    airtime = size * US_PER_BYTE + T_IFS_US
+    # transmitWindowOffset and window of the first event
+    t += 1.25 + rng.uniform(0.0, args.conn_interval_ms)
+
+    # PDU sizes of each connection event, alternating central and peripheral
+    events = []
+    for req, rsp in FLOWS[args.flow]:
+        events.append([pdu_bytes(L2CAP + req), pdu_bytes(0)])
+        for _ in range(args.rsp_events - 1):
+            events.append([pdu_bytes(0), pdu_bytes(0)])
+        events.append([pdu_bytes(0), pdu_bytes(L2CAP + rsp)])
+    done = len(events)
+    for n, ctrl in enumerate(LL_CONTROL):
+        while len(events) <= n // 2:
+            events.append([pdu_bytes(0), pdu_bytes(0)])
+        # One more exchange in the event, sent with the More Data bit
+        events[n // 2] += [pdu_bytes(ctrl), pdu_bytes(0)]
+    events.append([pdu_bytes(LL_TERMINATE), pdu_bytes(0)])
+
+    latency = t + (done - 1) * args.conn_interval_ms - t0
+    for pdus in events:
+        size += sum(pdus)
+        airtime += sum(pdus) * US_PER_BYTE + (len(pdus) - 1) * T_IFS_US
+    return latency, size, airtime
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def run(poll, rng, args):
+    results = [poll(rng, args) for _ in range(args.runs)]
+    latencies = [r[0] for r in results]
+    return {
+        "bytes": sum(r[1] for r in results) / len(results),
+        "airtime_us": sum(r[2] for r in results) / len(results),
+        "mean_ms": sum(latencies) / len(latencies),
+        "p95_ms": percentile(latencies, 95),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--adv-interval-ms", type=float, default=100.0)
+    parser.add_argument("--adv-data-len", type=int, default=19,
+                        help="advertising data without the level; Flags and the name by default")
+    parser.add_argument("--channel-gap-us", type=float, default=500.0,
+                        help="start to start of the PDUs of an advertising event")
+    parser.add_argument("--scan-interval-ms", type=float, default=100.0)
+    parser.add_argument("--scan-window-ms", type=float, default=30.0)
+    parser.add_argument("--per", type=float, default=0.0, help="advertising PDU loss rate")
+    parser.add_argument("--conn-interval-ms", type=float, default=30.0)
+    parser.add_argument("--rsp-events", type=int, default=1,
+                        help="connection events from a request to its response")
+    parser.add_argument("--flow", choices=sorted(FLOWS), default="discover")
+    parser.add_argument("--runs", type=int, default=5000)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    if args.scan_window_ms > args.scan_interval_ms or args.rsp_events < 1:
+        parser.error("scan window beyond the interval or no response event")
+
+    rng = random.Random(args.seed)
+    adv = run(poll_adv, rng, args)
+    conn = run(poll_connect, rng, args)
+    print("advertising every %.1f ms, scanning %.1f of %.1f ms, connection interval %.2f ms, "
+          "%s flow" % (args.adv_interval_ms, args.scan_window_ms, args.scan_interval_ms,
+                       args.conn_interval_ms, args.flow))
+    print("%-17s %8s %11s %10s %10s" % ("poll", "bytes", "airtime us", "mean ms", "p95 ms"))
+    for name, r in (("advertising data", adv), ("connect and read", conn)):
+        print("%-17s %8.0f %11.0f %10.1f %10.1f" %
+              (name, r["bytes"], r["airtime_us"], r["mean_ms"], r["p95_ms"]))
+
+    # Five more bytes in each of the three PDUs of every advertising event
+    standing_us = 3600000.0 / (args.adv_interval_ms + 5.0) * 3 * BAS_DATA * US_PER_BYTE
+    print("the level adds %.0f ms of airtime per hour of advertising" % (standing_us / 1000.0))
+    print("break-even at %.0f polls per hour, %.1fx less airtime per poll, %.1fx lower latency"
+          % (standing_us / conn["airtime_us"], conn["airtime_us"] / adv["airtime_us"],
+             conn["mean_ms"] / adv["mean_ms"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""
+Replays a battery voltage trace through app_bas_meas.c on the host.
+
+Builds the pipeline unchanged with the host C compiler, feeds the trace to
+it through app_bas_meas_trace_source one APP_BAS_MEAS_BATCH at a time, and
+reports the State of Charge it produces and the time a batch takes.
+
+The trace is a text file with one battery voltage in mV per line; CSV lines
+use the last column and lines starting with '#' are skipped. Without
+--trace a discharge from --start-mv to --end-mv is synthesized, with
+Gaussian noise and dips under radio load, and the result is compared with
+the level of the clean voltage.
+
+    python3 scripts/app_bas_meas_bench.py
+    python3 scripts/app_bas_meas_bench.py --dip-prob 0.2 -D APP_BAS_MEAS_IIR_SHIFT=0
+    python3 scripts/app_bas_meas_bench.py --trace battery.csv --print
+
+Host time says little about the CM4 or CM33 cycle count, but it tracks the
+relative cost of the batch size and filter settings.
+"""
+
+import argparse
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+DRIVER = r"""
+#include "app_bas_meas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int32_t *load(const char *path, uint32_t *p_count)
+{
+    FILE    *f = fopen(path, "rb");
+    long     size;
+    int32_t *p_buf;
+
+    if (NULL == f)
+    {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    p_buf = malloc((size_t)size + sizeof(int32_t));
+    *p_count = (uint32_t)(fread(p_buf, sizeof(int32_t), (size_t)size / sizeof(int32_t), f));
+    fclose(f);
+    return p_buf;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t             count;
+    uint32_t             ref_count = 0;
+    int32_t             *p_trace = load(argv[1], &count);
+    int32_t             *p_ref = (argc > 3) ? load(argv[3], &ref_count) : NULL;
+    int                  repeat = atoi(argv[2]);
+    app_bas_meas_stats_t stats;
+    struct timespec      t0, t1;
+    uint32_t             batch;
+    int                  i;
+
+    if (NULL == p_trace)
+    {
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < repeat; i++)
+    {
+        app_bas_meas_trace_set(p_trace, count);
+        app_bas_meas_init(&app_bas_meas_trace_source);
+        do
+        {
+            app_bas_meas_sample();
+            app_bas_meas_get_stats(&stats);
+        } while (0 == stats.failed);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    printf("time %lld %u %u\n",
+           (long long)(t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec),
+           stats.batches, (unsigned)APP_BAS_MEAS_BATCH);
+
+    app_bas_meas_trace_set(p_trace, count);
+    app_bas_meas_init(&app_bas_meas_trace_source);
+    for (batch = 0; ; batch++)
+    {
+        app_bas_meas_sample();
+        app_bas_meas_get_stats(&stats);
+        if (0 != stats.failed)
+        {
+            break;
+        }
+        printf("batch %u %u %d %d %d\n", batch, stats.level, stats.median_uv, stats.filtered_uv,
+               (batch < ref_count) ? app_bas_meas_ocv_to_pct(p_ref[batch]) : -1);
+    }
+    return 0;
+}
+"""
+
+
+def load_trace(path):
+    values = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith("#"):
+                continue
+            try:
+                values.append(float(line.split(",")[-1]))
+            except ValueError:
+                continue  # header line
+    return values
+
+
+def synthesize(args, batch):
+    """Noisy samples in mV and the clean voltage of each batch."""
+    rng = random.Random(args.seed)
+    batches = int(args.hours * 3600.0 * 1000.0 / args.period_ms)
+    samples = []
+    clean = []
+    for n in range(batches):
+        # Mildly curved discharge, the OCV table carries the real shape
+        x = n / max(1, batches - 1)
+        mv = args.start_mv + (args.end_mv - args.start_mv) * (0.8 * x + 0.2 * x ** 3)
+        clean.append(mv)
+        for _ in range(batch):
+            v = mv + rng.gauss(0.0, args.noise_mv)
+            if rng.random() < args.dip_prob:
+                v -= args.dip_mv
+            samples.append(v)
+    return samples, clean
+
+
+def build(args, tmp):
+    driver = os.path.join(tmp, "driver.c")
+    exe = os.path.join(tmp, "driver")
+    with open(driver, "w") as f:
+        f.write(DRIVER)
+    cmd = ([args.cc] + args.cflags.split() + ["-I", REPO] + ["-D" + d for d in args.define] +
+           ["-o", exe, driver, os.path.join(REPO, "app_bas_meas.c")])
+    subprocess.run(cmd, check=True)
+    # The batch size the pipeline was built with
+    probe = os.path.join(tmp, "probe.c")
+    with open(probe, "w") as f:
+        f.write('#include "app_bas_meas.h"\n#include <stdio.h>\n'
+                'int main(void) { printf("%u\\n", (unsigned)APP_BAS_MEAS_BATCH); return 0; }\n')
+    subprocess.run([args.cc, "-I", REPO] + ["-D" + d for d in args.define] +
+                   ["-o", probe + ".exe", probe], check=True)
+    batch = int(subprocess.run([probe + ".exe"], check=True, capture_output=True,
+                               text=True).stdout)
+    return exe, batch
+
+
+def write_uv(path, values_mv):
+    with open(path, "wb") as f:
+        f.write(struct.pack("<%ui" % len(values_mv), *(int(round(v * 1000.0)) for v in values_mv)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--trace", help="recorded trace, one voltage in mV per line")
+    parser.add_argument("--hours", type=float, default=24.0, help="synthetic trace length")
+    parser.add_argument("--period-ms", type=float, default=1000.0, help="synthetic batch period")
+    parser.add_argument("--start-mv", type=float, default=4200.0)
+    parser.add_argument("--end-mv", type=float, default=3300.0)
+    parser.add_argument("--noise-mv", type=float, default=8.0, help="sample noise, 1 sigma")
+    parser.add_argument("--dip-mv", type=float, default=150.0, help="drop under radio load")
+    parser.add_argument("--dip-prob", type=float, default=0.05,
+                        help="share of samples taken under radio load")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--repeat", type=int, default=20, help="timed passes over the trace")
+    parser.add_argument("-D", "--define", action="append", default=[],
+                        help="pipeline option, e.g. APP_BAS_MEAS_IIR_SHIFT=4")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cflags", default="-O2 -std=gnu11")
+    parser.add_argument("--print", action="store_true", help="print every batch")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe, batch = build(args, tmp)
+        trace = os.path.join(tmp, "trace.bin")
+        cmd = [exe, trace, str(args.repeat)]
+        if args.trace:
+            write_uv(trace, load_trace(args.trace))
+        else:
+            samples, clean = synthesize(args, batch)
+            write_uv(trace, samples)
+            write_uv(os.path.join(tmp, "ref.bin"), clean)
+            cmd.append(os.path.join(tmp, "ref.bin"))
+        out = subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+
+    rows = []
+    ns = 0
+    for line in out.splitlines():
+        fields = line.split()
+        if fields[0] == "time":
+            ns = int(fields[1])
+        else:
+            rows.append([int(x) for x in fields[1:]])
+            if args.print:
+                print("%6u %3u%% median %7.1f mV filtered %7.1f mV" %
+                      (rows[-1][0], rows[-1][1], rows[-1][2] / 1000.0, rows[-1][3] / 1000.0))
+    if not rows:
+        print("trace shorter than one batch of %u" % batch)
+        return 1
+
+    levels = [r[1] for r in rows]
+    rises = sum(1 for a, b in zip(levels, levels[1:]) if b > a)
+    jumps = max((abs(b - a) for a, b in zip(levels, levels[1:])), default=0)
+    print("%u batches of %u samples, level %u%% -> %u%%" % (len(rows), batch, levels[0], levels[-1]))
+    print("level rises %u, largest step %u%%" % (rises, jumps))
+    if rows[0][4] >= 0:
+        errors = [abs(r[1] - r[4]) for r in rows]
+        print("error against the clean voltage: mean %.2f%%, max %u%%" %
+              (sum(errors) / len(errors), max(errors)))
+    batches = len(rows) * args.repeat
+    print("%.0f ns per batch, %.1f ns per sample on this host" %
+          (ns / batches, ns / (batches * batch)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+"""
+Host simulation of the battery level update wakeups and charge.
+
+Compares the three ways the BAS task can be woken once per period while a
+central is connected:
+
+    hal      cyhal_timer interrupt (BAS_TIMER=HAL). A running TCPWM counter
+             needs clk_peri, so the system idles in CPU Sleep, not Deep Sleep
+             (--hal-idle deepsleep models a HAL timer that would not).
+    tickless FreeRTOS software timer with tickless idle, nominal period.
+    aligned  software timer moved onto connection events (BAS_SCHED_ALIGN=1).
+
+Each update keeps the CPU active for --update-ms, the notification goes out
+at the next connection event and the controller reports it back over HCI
+--hci-ms later, waking the CPU once more for --hci-irq-ms. Activity closer
+together than --ds-min-ms is served from CPU Sleep, as tickless idle does
+not enter Deep Sleep for shorter idle times. With peripheral latency the
+controller only attends every (latency + 1)th event unless data is pending,
+so a notification queued before a skipped event costs an extra radio event.
+
+The central's clock drifts by --drift-ppm against the local one, and the
+aligned scheduler only learns the connection event timing at connection and
+from requests of the peer (--peer-rx-s), the same as on the device.
+
+    python3 scripts/app_bas_sched_sim.py
+    python3 scripts/app_bas_sched_sim.py --interval-ms 50 --latency 4 --peer-rx-s 5
+
+Currents and charges default to rough PSoC 6 and CYW43xxx figures; pass the
+numbers of the actual board for a meaningful absolute result. The relative
+comparison holds for any set.
+"""
+
+import argparse
+import math
+import sys
+
+MODES = ("hal", "tickless", "aligned")
+
+
+def bas_wakeups(mode, args, anchor0, event_us):
+    """Times (s) the BAS task is woken, following app_bt_sched_next()."""
+    period = args.period_ms / 1000.0
+    times = []
+    if mode != "aligned":
+        t = period
+        while t < args.duration_s:
+            times.append(t)
+            t += period
+        return times
+
+    # Local estimate: nominal interval, anchor refreshed by peer requests
+    interval_us = args.interval_ms * 1000.0 * (args.latency + 1)
+    peer_rx = []
+    if args.peer_rx_s > 0:
+        t = args.peer_rx_s
+        while t < args.duration_s:
+            peer_rx.append(t)
+            t += args.peer_rx_s
+
+    # Requests reach the host --hci-ms after the event they arrived in
+    stats = {"aligned": 0, "stale": 0}
+    anchor = event_us(anchor0) + args.hci_ms * 1000.0
+    tick = math.floor(period * 1000)
+    t_ms = tick
+    due = tick
+    while t_ms / 1000.0 < args.duration_s:
+        times.append(t_ms / 1000.0)
+        # A peer request is seen in the first true connection event after it
+        while peer_rx and peer_rx[0] <= t_ms / 1000.0:
+            anchor = event_us(peer_rx.pop(0) * 1e6) + args.hci_ms * 1000.0
+        anchor_ms = math.floor(anchor / 1000.0)
+        age = t_ms - anchor_ms
+        due += tick
+        nxt = due - t_ms
+        if age > args.anchor_max_age_ms:
+            stats["stale"] += 1
+        else:
+            due_us = (age + nxt) * 1000
+            wake_us = ((due_us + args.lead_us + interval_us // 2) // interval_us) * interval_us
+            if wake_us >= args.lead_us + age * 1000:
+                cand = math.floor((wake_us - args.lead_us) / 1000) - age
+                if tick // 2 <= cand <= tick + tick // 2:
+                    nxt = cand
+                    stats["aligned"] += 1
+        t_ms += nxt
+    bas_wakeups.stats = stats
+    return times
+
+
+def simulate(mode, args):
+    # True connection events, drifting against the local clock
+    true_interval = args.interval_ms * 1e-3 * (1.0 + args.drift_ppm * 1e-6)
+    first_event = 0.0123
+    attend_every = args.latency + 1
+
+    def event_index_at_or_after(t):
+        return max(0, math.ceil((t - first_event) / true_interval - 1e-9))
+
+    def event_time(n):
+        return first_event + n * true_interval
+
+    def event_us(t_us):
+        """Host time (us) of the first connection event at or after t_us."""
+        n = event_index_at_or_after(t_us / 1e6)
+        # The host can only see events the controller attends
+        n = int(math.ceil(n / attend_every) * attend_every)
+        return event_time(n) * 1e6
+
+    bas_wakeups.stats = {"aligned": 0, "stale": 0}
+    wakes = bas_wakeups(mode, args, first_event * 1e6, event_us)
+
+    bursts = []
+    forced_events = 0
+    latency_sum = 0.0
+    for w in wakes:
+        end = w + args.update_ms / 1000.0
+        bursts.append((w, end))
+        n = event_index_at_or_after(end)
+        if n % attend_every:
+            forced_events += 1
+        tx = event_time(n)
+        latency_sum += tx - w
+        irq = tx + args.hci_ms / 1000.0
+        bursts.append((irq, irq + args.hci_irq_ms / 1000.0))
+    bursts.sort()
+
+    # Merge activity, classify the gaps in between
+    active = 0.0
+    cpu_sleep = 0.0
+    deep_sleep = 0.0
+    wakeups = 0
+    ds_exits = 0
+    t = 0.0
+    for start, stop in bursts:
+        if start > t:
+            gap = start - t
+            if (mode != "hal" or args.hal_idle == "deepsleep") and gap >= args.ds_min_ms / 1000.0:
+                deep_sleep += gap
+                ds_exits += 1
+            else:
+                cpu_sleep += gap
+            wakeups += 1
+        if stop > t:
+            active += stop - max(start, t)
+            t = stop
+    tail = args.duration_s - t
+    if (mode != "hal" or args.hal_idle == "deepsleep") and tail >= args.ds_min_ms / 1000.0:
+        deep_sleep += tail
+    else:
+        cpu_sleep += tail
+
+    events = int(args.duration_s / true_interval)
+    radio_events = events // attend_every + forced_events
+    charge_cpu = (active * args.active_ma + cpu_sleep * args.sleep_ma +
+                  deep_sleep * args.deep_sleep_ua / 1000.0) * 1000.0 + ds_exits * args.wake_uc
+    charge_radio = radio_events * args.event_uc + len(wakes) * args.tx_uc
+
+    return {
+        "mode": mode,
+        "updates": len(wakes),
+        "wakeups": wakeups,
+        "ds_exits": ds_exits,
+        "radio": radio_events,
+        "forced": forced_events,
+        "latency_ms": 1000.0 * latency_sum / max(1, len(wakes)),
+        "aligned": bas_wakeups.stats["aligned"],
+        "cpu_uc": charge_cpu,
+        "radio_uc": charge_radio,
+        "avg_ua": (charge_cpu + charge_radio) / args.duration_s,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--duration-s", type=float, default=600.0)
+    parser.add_argument("--period-ms", type=int, default=1000, help="BAS update period")
+    parser.add_argument("--interval-ms", type=float, default=30.0, help="connection interval")
+    parser.add_argument("--latency", type=int, default=0, help="peripheral latency, events")
+    parser.add_argument("--drift-ppm", type=float, default=70.0,
+                        help="central clock against the local clock")
+    parser.add_argument("--peer-rx-s", type=float, default=0.0,
+                        help="period of requests from the peer, 0 for none")
+    parser.add_argument("--lead-us", type=int, default=2000, help="APP_BT_SCHED_LEAD_US")
+    parser.add_argument("--anchor-max-age-ms", type=int, default=10000,
+                        help="APP_BT_SCHED_ANCHOR_MAX_AGE_MS")
+    parser.add_argument("--update-ms", type=float, default=0.4, help="CPU time of one update")
+    parser.add_argument("--hci-ms", type=float, default=1.0,
+                        help="connection event to completion report on the host")
+    parser.add_argument("--hci-irq-ms", type=float, default=0.2,
+                        help="CPU time handling the completion report")
+    parser.add_argument("--ds-min-ms", type=float, default=2.0,
+                        help="shortest idle time spent in Deep Sleep")
+    parser.add_argument("--hal-idle", choices=("sleep", "deepsleep"), default="sleep",
+                        help="idle state while the HAL timer runs")
+    parser.add_argument("--active-ma", type=float, default=2.5)
+    parser.add_argument("--sleep-ma", type=float, default=1.0, help="CPU Sleep")
+    parser.add_argument("--deep-sleep-ua", type=float, default=8.0)
+    parser.add_argument("--wake-uc", type=float, default=0.1, help="charge of a Deep Sleep exit")
+    parser.add_argument("--event-uc", type=float, default=3.0, help="charge of a connection event")
+    parser.add_argument("--tx-uc", type=float, default=1.0, help="extra charge of a notification")
+    args = parser.parse_args()
+
+    results = [simulate(mode, args) for mode in MODES]
+    print("%.0f s, period %u ms, interval %.2f ms, latency %u, drift %.0f ppm, peer requests %s"
+          % (args.duration_s, args.period_ms, args.interval_ms, args.latency, args.drift_ppm,
+             ("every %.1f s" % args.peer_rx_s) if args.peer_rx_s else "none"))
+    print("%-9s %8s %8s %8s %8s %8s %8s %8s %10s %10s %8s" %
+          ("mode", "updates", "aligned", "wakeups", "DS exits", "radio", "forced",
+           "lat ms", "CPU uC", "radio uC", "avg uA"))
+    for r in results:
+        print("%-9s %8u %8u %8u %8u %8u %8u %8.1f %10.0f %10.0f %8.1f" %
+              (r["mode"], r["updates"], r["aligned"], r["wakeups"], r["ds_exits"], r["radio"],
+               r["forced"], r["latency_ms"], r["cpu_uc"], r["radio_uc"], r["avg_ua"]))
+    base = results[0]["avg_ua"]
+    for r in results[1:]:
+        print("%-9s %+.1f %% average current against hal" %
+              (r["mode"], 100.0 * (r["avg_ua"] - base) / base))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""
+Checks the advertising payloads app_bt_adv_bas.c hands to the stack.
+
+Builds app_bt_adv_bas.c on the host (see app_host.py) with a driver that
+records every wiced_bt_ble_set_raw_advertisement_data() and
+wiced_bt_ble_set_raw_scan_response_data() call. Each case configures
+advertising data with app_bt_adv_bas_init(), then runs a sequence of
+app_bt_adv_bas_update() calls as bas_task() would, with repeated levels and
+writes the stack refuses.
+
+    design    The advertising data of design.cybt: flags, the complete name
+              "Battery Server", the 128-bit service UUID and the appearance,
+              more than fits next to the service data.
+    name      Flags and the name only, which fits as is.
+    longname  Flags and a 25 character name, which has to be shortened.
+    random    --cases configurations of random elements and lengths, some
+              with more elements than APP_BT_ADV_BAS_MAX_ELEMS.
+
+Checks, per case: both payloads fit 31 bytes, the Battery Service data is
+the last advertising element and carries the level, the flags stay in the
+advertising data, every configured element is kept in order, shortened with
+the complete name in the scan response where it fits, moved to the scan response (in
+any order) or counted as left out, nothing is moved when everything fits, and the stats
+agree. Every accepted update rewrites only the level byte, refused ones are
+counted and retried, repeated levels are skipped.
+
+    python3 scripts/app_bt_adv_bas_check.py
+    python3 scripts/app_bt_adv_bas_check.py --cases 2000 --seed 7
+    python3 scripts/app_bt_adv_bas_check.py -D APP_BT_ADV_BAS_NAME_MIN=8
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import random
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_adv_bas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static wiced_bt_ble_advert_elem_t elems[32];
+static uint8_t                    data[32][32];
+static int                        refuse;
+
+static void dump(const char *p_name, uint8_t n, const wiced_bt_ble_advert_elem_t *p)
+{
+    printf("%s ", p_name);
+    for (uint8_t i = 0; i < n; i++)
+    {
+        printf("%02x%02x", (unsigned)(p[i].len + 1u), p[i].advert_type);
+        for (uint16_t j = 0; j < p[i].len; j++)
+        {
+            printf("%02x", p[i].p_data[j]);
+        }
+    }
+    printf("\n");
+}
+
+wiced_result_t wiced_bt_ble_set_raw_advertisement_data(uint8_t n, wiced_bt_ble_advert_elem_t *p)
+{
+    if (refuse)
+    {
+        printf("refused\n");
+        return WICED_BT_ERROR;
+    }
+    dump("adv", n, p);
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_raw_scan_response_data(uint8_t n, wiced_bt_ble_advert_elem_t *p)
+{
+    dump("scan", n, p);
+    return WICED_BT_SUCCESS;
+}
+
+/* argv: level, then e<type>:<hex> elements and u<level> or r<level> updates,
+ * r for a write the stack refuses */
+int main(int argc, char **argv)
+{
+    app_bt_adv_bas_stats_t stats;
+    uint8_t                n = 0;
+    unsigned               value;
+    int                    i;
+
+    for (i = 2; (i < argc) && ('e' == argv[i][0]); i++, n++)
+    {
+        char *p = strchr(argv[i], ':') + 1;
+
+        elems[n].advert_type = (wiced_bt_ble_advert_type_t)strtoul(&argv[i][1], NULL, 16);
+        elems[n].len = (uint16_t)(strlen(p) / 2u);
+        for (uint16_t j = 0; j < elems[n].len; j++)
+        {
+            sscanf(&p[2u * j], "%2x", &value);
+            data[n][j] = (uint8_t)value;
+        }
+        elems[n].p_data = data[n];
+    }
+    printf("init %d\n", (int)app_bt_adv_bas_init(elems, n, (uint8_t)atoi(argv[1])));
+    for (; i < argc; i++)
+    {
+        refuse = ('r' == argv[i][0]);
+        app_bt_adv_bas_update((uint8_t)atoi(&argv[i][1]));
+    }
+    app_bt_adv_bas_get_stats(&stats);
+    printf("result %lu %lu %lu %u %u %u %u %u %d\n", (unsigned long)stats.updates,
+           (unsigned long)stats.unchanged, (unsigned long)stats.failed, stats.level,
+           stats.adv_len, stats.scan_rsp_len, stats.moved, stats.dropped, (int)stats.shortened);
+    return 0;
+}
+"""
+
+PAYLOAD_MAX = 31
+MAX_ELEMS = 8
+FLAGS = 0x01
+NAME_SHORT = 0x08
+NAME_COMPLETE = 0x09
+SERVICE_DATA = 0x16
+BAS_UUID = bytes([0x0F, 0x18])
+
+
+def parse(hex_payload):
+    """Elements (type, data) of an advertising payload."""
+    raw, elems = bytes.fromhex(hex_payload), []
+    while raw:
+        n = raw[0]
+        elems.append((raw[1], raw[2:1 + n]))
+        raw = raw[1 + n:]
+    return elems
+
+
+def size(elems):
+    return sum(2 + len(d) for _, d in elems)
+
+
+def design_case():
+    uuid = bytes.fromhex("66984d87820644caac8d2a7ea4ab45f4")[::-1]
+    return [(FLAGS, b"\x06"), (NAME_COMPLETE, b"Battery Server"), (0x07, uuid), (0x19, b"\x00\x00")]
+
+
+def random_case(rng):
+    elems = [(FLAGS, b"\x06")] if rng.random() < 0.8 else []
+    for _ in range(rng.randint(0, MAX_ELEMS + 1)):
+        kind = rng.choice([NAME_COMPLETE, 0x03, 0x07, 0x19, 0xFF, 0x0A])
+        if kind == NAME_COMPLETE:
+            value = bytes(rng.choice(b"ABCDEFGHIJKLMNOP") for _ in range(rng.randint(1, 26)))
+        else:
+            value = bytes(rng.randrange(256) for _ in range(rng.randint(1, 20)))
+        elems.append((kind, value))
+    return elems
+
+
+def updates(rng, level, count):
+    """Update tokens, and the advertised level, stats and writes they should give."""
+    tokens, writes, updated, unchanged, failed = [], [], 0, 0, 0
+    for _ in range(count):
+        new = level if rng.random() < 0.3 else rng.randint(0, 100)
+        refused = new != level and rng.random() < 0.2
+        tokens.append("%s%d" % ("r" if refused else "u", new))
+        if new == level:
+            unchanged += 1
+        elif refused:
+            failed += 1
+        else:
+            updated += 1
+            level = new
+            writes.append(new)
+    return tokens, writes, (updated, unchanged, failed, level)
+
+
+def check(exe, config, level, rng, count):
+    """Runs one case, returns its table fields and the problems found."""
+    tokens, writes, expected = updates(rng, level, count)
+    out = run(exe, level, *["e%02x:%s" % (t, d.hex()) for t, d in config], *tokens).splitlines()
+    problems = []
+    advs = [parse(line.split(" ", 1)[1] if " " in line else "") for line in out if line.startswith("adv")]
+    scans = [parse(line.split(" ", 1)[1] if " " in line else "") for line in out if line.startswith("scan")]
+    result = [int(v) for v in out[-1].split()[1:]]
+    init = int(next(line for line in out if line.startswith("init")).split()[1])
+    if init != 0 or not advs:
+        return (0, 0, 0, 0, False), ["app_bt_adv_bas_init() returned %d" % init]
+    adv, scan = advs[0], scans[0] if scans else []
+
+    if size(adv) > PAYLOAD_MAX or size(scan) > PAYLOAD_MAX:
+        problems.append("payloads of %d and %d bytes" % (size(adv), size(scan)))
+    if adv[-1] != (SERVICE_DATA, BAS_UUID + bytes([level])):
+        problems.append("last advertising element %02x %s" % (adv[-1][0], adv[-1][1].hex()))
+    if any(t == FLAGS for t, _ in config) and not any(t == FLAGS for t, _ in adv):
+        problems.append("flags not advertised")
+
+    # Each configured element: kept in order, shortened, moved to the scan
+    # response, where the order does not matter, or left out
+    kept, rest, moved, dropped, shortened = 0, list(scan), 0, 0, False
+    for t, d in config:
+        a = adv[kept] if kept < len(adv) - 1 else None
+        if a == (t, d):
+            kept += 1
+        elif t == NAME_COMPLETE and a and a[0] == NAME_SHORT and d.startswith(a[1]):
+            kept += 1
+            if (t, d) in rest:
+                rest.remove((t, d))
+            shortened = True
+        elif (t, d) in rest:
+            rest.remove((t, d))
+            moved += 1
+        else:
+            dropped += 1
+    if kept != len(adv) - 1 or rest:
+        problems.append("elements out of order or altered")
+    if size(config) + 2 + len(BAS_UUID) + 1 <= PAYLOAD_MAX and len(config) < MAX_ELEMS and (moved or dropped or shortened):
+        problems.append("elements moved although everything fits")
+    stats = result[4:]
+    if stats != [size(adv), size(scan), moved, dropped, int(shortened)]:
+        problems.append("stats %s, payloads give %s" % (stats, [size(adv), size(scan), moved, dropped,
+                                                                int(shortened)]))
+
+    # Updates rewrite the level in place and nothing else
+    for new, written in zip(writes, advs[1:]):
+        if written != adv[:-1] + [(SERVICE_DATA, BAS_UUID + bytes([new]))]:
+            problems.append("update to %d wrote %s" % (new, written))
+            break
+    if len(advs) - 1 != len(writes) or result[:4] != list(expected):
+        problems.append("updates, unchanged, failed, level %s, expected %s" % (result[:4], list(expected)))
+    return (len(config), size(adv), size(scan), moved, dropped), problems
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--cases", type=int, default=300, help="random configurations")
+    parser.add_argument("--updates", type=int, default=40, help="updates per case")
+    parser.add_argument("--seed", type=int, default=1)
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    cases = [("design", design_case()),
+             ("name", [(FLAGS, b"\x06"), (NAME_COMPLETE, b"Battery Server")]),
+             ("longname", [(FLAGS, b"\x06"), (NAME_COMPLETE, b"A very long device name!!")])]
+    cases += [("random", random_case(rng)) for _ in range(args.cases)]
+
+    failed = 0
+    totals = [0, 0]
+    print("%-8s %5s %4s %5s %5s %8s" % ("case", "elems", "adv", "scan", "moved", "left out"))
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_adv_bas.c"], DRIVER)
+        for name, config in cases:
+            fields, problems = check(exe, config, rng.randint(0, 100), rng, args.updates)
+            failed += bool(problems)
+            if name != "random":
+                print("%-8s %5d %4d %5d %5d %8d" % ((name,) + fields))
+            else:
+                totals = [a + b for a, b in zip(totals, fields[3:])]
+            for text in problems:
+                print("%-8s FAIL %s" % (name, text))
+    print("%d random cases, %d elements moved, %d left out" %
+          (args.cases, totals[0], totals[1]))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
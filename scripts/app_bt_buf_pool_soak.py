@@ -0,0 +1,299 @@
+#!/usr/bin/env python3
+"""
+Soak test of the GATT response buffers: app_bt_buf_pool.c against malloc.
+
+Builds app_bt_buf_pool.c, app_bt_heap.c and app_bt_trace.c on the host (see
+app_host.py) with APP_BT_HEAP_WRAP_MALLOC=1, so that the C library heap the
+modules see is __real__malloc_r() and __real__free_r() of the driver: a first-fit
+allocator with address ordered free list and coalescing, as newlib-nano
+uses, over a --heap-kb arena. The same pseudo-random workload then runs
+twice, each in a fresh process:
+
+    malloc  Every response buffer comes from app_bt_heap_alloc(), as
+            app_bt_alloc_buffer() did before the pool.
+    pool    Every response buffer comes from app_bt_buf_pool_alloc(), which
+            falls back to the heap once a class is exhausted.
+
+The workload, per round: --burst responses, a share --small-pct of them of
+up to 32 bytes (reads, write and MTU responses), the others up to --mtu
+bytes (read by type, read multiple, long reads), each held by the stack for
+one to three rounds. Alongside, the application keeps long-lived blocks of
+16 to 256 bytes that live for thousands of rounds, as log lines, timers and
+OTA state do, and are what the response buffers fragment the heap around.
+
+For each path the table gives the response allocations, those the pool sent
+to the heap and those that failed, the allocation latency in host ns (p50,
+p99, max) and in free chunks walked (max), and at the end of the run the
+free heap, its largest block, the number of free chunks and the
+fragmentation, 1 - largest / free. The worst fragmentation seen at any
+round is reported too.
+
+    python3 scripts/app_bt_buf_pool_soak.py
+    python3 scripts/app_bt_buf_pool_soak.py --rounds 2000000 --mtu 247
+    python3 scripts/app_bt_buf_pool_soak.py --heap-kb 24 --burst 6
+
+Exits non-zero if the pool path fails an allocation the malloc path served.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_buf_pool.h"
+#include "app_bt_heap.h"
+#include <reent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HDR             (8u)
+#define MIN_CHUNK       (16u)
+#define ALIGN8(x)       (((x) + 7u) & ~7u)
+#define MAX_LIVE        (256)
+#define MAX_APP         (64)
+#define SAMPLES         (1u << 20)
+
+/* newlib-nano style first fit heap, free chunks address ordered */
+typedef struct chunk
+{
+    uint32_t      size;                 /* Including the header */
+    uint32_t      pad;
+    struct chunk *p_next;               /* While free */
+} chunk_t;
+
+static uint8_t  *heap;
+static chunk_t  *free_list;
+static uint32_t  walked;
+
+void *__real__malloc_r(struct _reent *p_reent, size_t size)
+{
+    uint32_t  need = ALIGN8((uint32_t)size + HDR);
+    chunk_t **pp = &free_list;
+    chunk_t  *p;
+    chunk_t  *p_tail;
+
+    need = (need < MIN_CHUNK) ? MIN_CHUNK : need;
+    walked = 0;
+    for (; (p = *pp) != NULL; pp = &p->p_next)
+    {
+        walked++;
+        if (p->size < need)
+        {
+            continue;
+        }
+        if ((p->size - need) >= MIN_CHUNK)
+        {
+            p_tail         = (chunk_t *)((uint8_t *)p + need);
+            p_tail->size   = p->size - need;
+            p_tail->p_next = p->p_next;
+            *pp            = p_tail;
+            p->size        = need;
+        }
+        else
+        {
+            *pp = p->p_next;
+        }
+        return (uint8_t *)p + HDR;
+    }
+    return NULL;
+}
+
+void __real__free_r(struct _reent *p_reent, void *ptr)
+{
+    chunk_t  *p = (chunk_t *)((uint8_t *)ptr - HDR);
+    chunk_t **pp = &free_list;
+    chunk_t  *p_prev = NULL;
+
+    while ((NULL != *pp) && (*pp < p))
+    {
+        p_prev = *pp;
+        pp = &(*pp)->p_next;
+    }
+    p->p_next = *pp;
+    *pp = p;
+    if ((NULL != p->p_next) && ((uint8_t *)p + p->size == (uint8_t *)p->p_next))
+    {
+        p->size  += p->p_next->size;
+        p->p_next = p->p_next->p_next;
+    }
+    if ((NULL != p_prev) && ((uint8_t *)p_prev + p_prev->size == (uint8_t *)p))
+    {
+        p_prev->size  += p->size;
+        p_prev->p_next = p->p_next;
+    }
+}
+
+static void heap_stats(uint32_t *p_free, uint32_t *p_largest, uint32_t *p_chunks)
+{
+    *p_free = *p_largest = *p_chunks = 0;
+    for (chunk_t *p = free_list; NULL != p; p = p->p_next)
+    {
+        *p_free += p->size;
+        *p_largest = (p->size > *p_largest) ? p->size : *p_largest;
+        (*p_chunks)++;
+    }
+}
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+static long long now_ns(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct { uint8_t *p; long due; } held_t;
+
+int main(int argc, char **argv)
+{
+    int                 pool = (0 == strcmp(argv[1], "pool"));
+    long                rounds = atol(argv[2]);
+    uint32_t            heap_size = (uint32_t)atoi(argv[3]) * 1024u;
+    int                 burst = atoi(argv[4]);
+    uint32_t            small_pct = (uint32_t)atoi(argv[5]);
+    uint16_t            mtu = (uint16_t)atoi(argv[6]);
+    static held_t       live[MAX_LIVE];
+    static held_t       app[MAX_APP];
+    static long long    ns[SAMPLES];
+    uint32_t            samples = 0, walk_max = 0;
+    long                allocs = 0, failures = 0;
+    uint32_t            free_bytes, largest, chunks;
+    double              frag, frag_max = 0;
+    app_bt_buf_pool_stats_t stats;
+
+    (void)argc;
+    heap = aligned_alloc(8, heap_size);
+    free_list = (chunk_t *)heap;
+    free_list->size = heap_size;
+    free_list->p_next = NULL;
+
+    if (pool)
+    {
+        app_bt_buf_pool_init(mtu);
+    }
+
+    for (long r = 0; r < rounds; r++)
+    {
+        /* Responses the stack is done with */
+        for (int i = 0; i < MAX_LIVE; i++)
+        {
+            if ((NULL != live[i].p) && (live[i].due <= r))
+            {
+                pool ? app_bt_buf_pool_free(live[i].p) : app_bt_heap_free(live[i].p);
+                live[i].p = NULL;
+            }
+        }
+        /* Long-lived application blocks come and go */
+        int a = (int)rnd(MAX_APP);
+        if ((NULL != app[a].p) && (app[a].due <= r))
+        {
+            app_bt_heap_free(app[a].p);
+            app[a].p = NULL;
+        }
+        if ((NULL == app[a].p) && (0 == rnd(8)))
+        {
+            app[a].p   = app_bt_heap_alloc(APP_BT_HEAP_TAG_APP, 16 + rnd(241));
+            app[a].due = r + 1000 + rnd(20000);
+        }
+
+        for (int b = 0; b < burst; b++)
+        {
+            uint16_t  len = (rnd(100) < small_pct) ? (uint16_t)(1 + rnd(32)) : (uint16_t)(33 + rnd(mtu - 32));
+            uint8_t  *p;
+            long long t0 = now_ns();
+
+            walked = 0;
+            p = pool ? app_bt_buf_pool_alloc(len) : app_bt_heap_alloc(APP_BT_HEAP_TAG_GATT_RSP, len);
+            ns[samples++ & (SAMPLES - 1)] = now_ns() - t0;
+            walk_max = (walked > walk_max) ? walked : walk_max;
+            allocs++;
+            if (NULL == p)
+            {
+                failures++;
+                continue;
+            }
+            for (int i = 0; i < MAX_LIVE; i++)
+            {
+                if (NULL == live[i].p)
+                {
+                    live[i].p   = p;
+                    live[i].due = r + 1 + rnd(3);
+                    break;
+                }
+            }
+        }
+
+        if (0 == (r % 1000))
+        {
+            heap_stats(&free_bytes, &largest, &chunks);
+            frag = (0 != free_bytes) ? 1.0 - (double)largest / free_bytes : 0.0;
+            frag_max = (frag > frag_max) ? frag : frag_max;
+        }
+    }
+
+    samples = (samples < SAMPLES) ? samples : SAMPLES;
+    qsort(ns, samples, sizeof(ns[0]), cmp_ll);
+    heap_stats(&free_bytes, &largest, &chunks);
+    frag = (0 != free_bytes) ? 1.0 - (double)largest / free_bytes : 0.0;
+    memset(&stats, 0, sizeof(stats));
+    if (pool)
+    {
+        app_bt_buf_pool_get_stats(&stats);
+    }
+    printf("result %ld %lu %ld %lld %lld %lld %u %u %u %u %.3f %.3f\n", allocs,
+           (unsigned long)stats.fallback_allocs, failures, ns[samples / 2], ns[(samples * 99) / 100],
+           ns[samples - 1], walk_max, free_bytes, largest, chunks, frag, frag_max);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--rounds", type=int, default=500000)
+    parser.add_argument("--heap-kb", type=int, default=32)
+    parser.add_argument("--burst", type=int, default=3, help="responses per round")
+    parser.add_argument("--small-pct", type=int, default=60, help="share of responses up to 32 bytes")
+    parser.add_argument("--mtu", type=int, default=247)
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    results = {}
+    print("%-7s %9s %9s %8s %7s %7s %8s %6s %7s %8s %7s %6s %9s" %
+          ("path", "allocs", "fallback", "failed", "p50 ns", "p99 ns", "max ns", "walk",
+           "free", "largest", "chunks", "frag", "frag max"))
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_buf_pool.c", "app_bt_heap.c", "app_bt_trace.c"], DRIVER,
+                    ["APP_BT_HEAP_WRAP_MALLOC=1"])
+        for path in ("malloc", "pool"):
+            f = run(exe, path, args.rounds, args.heap_kb, args.burst, args.small_pct, args.mtu).split()
+            results[path] = int(f[3])
+            print("%-7s %9s %9s %8s %7s %7s %8s %6s %7s %8s %7s %5.0f%% %8.0f%%" %
+                  (path, f[1], f[2] if path == "pool" else "-", f[3], f[4], f[5], f[6], f[7], f[8],
+                   f[9], f[10], float(f[11]) * 100, float(f[12]) * 100))
+    if results["pool"] > results["malloc"]:
+        print("FAIL: the pool path failed %d allocations, malloc %d" % (results["pool"], results["malloc"]))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""
+Load test of the connection table with N simulated centrals.
+
+Builds app_bt_conn.c and app_bt_notify_queue.c on the host (see
+app_host.py), once per --slots value as APP_BT_MAX_CONNECTIONS. The driver
+plays --centrals centrals against the connection handling of
+app_bt_connect_event_handler() and the fan-out of bas_task():
+
+    connect     While advertising, the next waiting central connects and
+                gets a slot from app_bt_conn_open(), or is disconnected when
+                the table is full. Advertising resumes while slots are free.
+    subscribe   Each central exchanges MTU, enables Battery Level
+                notifications and, every other one, the Multiple Handle
+                Value Notifications client feature.
+    tick        The level changes and is queued for every subscribed slot
+                with app_bt_notify_queue_put(), one pass over the subscriber
+                bitmap, then app_bt_notify_queue_flush(). The stack model
+                then transmits every buffer it holds, as a connection event
+                would, and each central keeps the last level it got.
+    churn       With probability --churn per tick a connected central
+                disconnects and goes back to waiting.
+
+At the end of every tick each subscribed central must hold the new level.
+Advertising must be on exactly while slots are free, so no central should
+ever find the table full. The table gives per --centrals count the
+connections accepted and refused, the notifications
+delivered and PDUs they took, the centrals that missed a level, and the
+host time of the fan-out per tick.
+
+    python3 scripts/app_bt_conn_load_test.py
+    python3 scripts/app_bt_conn_load_test.py --centrals 1 3 8 --slots 3 8
+    python3 scripts/app_bt_conn_load_test.py --churn 0.2 --ticks 20000
+
+Exits non-zero if a central misses a level or advertising is wrong.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_conn.h"
+#include "app_bt_notify_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BAS_LEVEL_HANDLE    (0x002Au)
+#define BAS_CCCD_HANDLE     (0x002Bu)
+#define MAX_CENTRALS        (64)
+#define MAX_HELD            (4 * MAX_CENTRALS)
+
+static const uint16_t cccd_handles[] = { BAS_CCCD_HANDLE };
+
+typedef struct
+{
+    uint16_t conn_id;               /* 0 while waiting to connect */
+    uint8_t  last;                  /* Last level received */
+    uint32_t received;
+} central_t;
+
+static central_t central[MAX_CENTRALS + 1];
+static uint8_t  *held[MAX_HELD];    /* Buffers the stack holds */
+static int       num_held;
+static long      pdus;
+static int       advertising;
+
+static central_t *central_of(uint16_t conn_id)
+{
+    return &central[conn_id & 0xFF];
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t conn_id, uint16_t handle,
+                                                              uint16_t len, uint8_t *p_val, void *p_ctx)
+{
+    (void)handle; (void)len; (void)p_ctx;
+    central_of(conn_id)->last = p_val[0];
+    central_of(conn_id)->received++;
+    held[num_held++] = p_val;
+    pdus++;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_multiple_notifications(uint16_t conn_id, uint16_t len,
+                                                                        uint8_t *p_val, void *p_ctx)
+{
+    (void)p_ctx;
+    /* Handle, length, value tuples */
+    for (uint16_t i = 0; i + 4 <= len; i += 4 + (p_val[i + 2] | (p_val[i + 3] << 8)))
+    {
+        central_of(conn_id)->last = p_val[i + 4];
+        central_of(conn_id)->received++;
+    }
+    held[num_held++] = p_val;
+    pdus++;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/* One connection event on every link: everything held goes out */
+static void transmit(void)
+{
+    uint8_t *p;
+
+    while (num_held > 0)
+    {
+        p = held[--num_held];
+        app_bt_notify_queue_transmitted(p);
+    }
+}
+
+/* As app_bt_connect_event_handler() on connection */
+static int connect(int c, int *p_refused)
+{
+    uint8_t  addr[6] = { 0x00, 0xA0, 0x50, 0x00, 0x00, (uint8_t)c };
+    uint16_t conn_id = (uint16_t)(0x0100 | c);
+    uint8_t  features = APP_BT_CONN_CLIENT_FEAT_MULTI_NOTIF;
+    uint8_t  cccd[2] = { GATT_CLIENT_CONFIG_NOTIFICATION, 0 };
+    wiced_bool_t changed;
+
+    if (APP_BT_CONN_INVALID_SLOT == app_bt_conn_open(conn_id, addr))
+    {
+        (*p_refused)++;
+        return 0;
+    }
+    central[c].conn_id = conn_id;
+    app_bt_conn_set_mtu(conn_id, 247);
+    if (0 == (c % 2))
+    {
+        app_bt_conn_client_features_on_write(conn_id, NULL, 0, &features, 1);
+    }
+    app_bt_conn_cccd_set(conn_id, BAS_CCCD_HANDLE, cccd[0], &changed);
+    advertising = (app_bt_conn_count() < APP_BT_MAX_CONNECTIONS);
+    return 1;
+}
+
+/* As app_bt_connect_event_handler() on disconnection */
+static void disconnect(int c)
+{
+    app_bt_notify_queue_close(central[c].conn_id);
+    app_bt_conn_close(central[c].conn_id);
+    central[c].conn_id = 0;
+    advertising = 1;
+}
+
+/* The fan-out of bas_task() */
+static void fan_out(uint8_t level)
+{
+    uint32_t subscribed = app_bt_conn_cccd_subscribers(BAS_CCCD_HANDLE, GATT_CLIENT_CONFIG_NOTIFICATION);
+    uint8_t  slot;
+
+    while (0 != subscribed)
+    {
+        slot = (uint8_t)__builtin_ctz(subscribed);
+        subscribed &= subscribed - 1;
+        app_bt_notify_queue_put(app_bt_conn_get_conn_id(slot), BAS_LEVEL_HANDLE, &level, 1);
+    }
+    app_bt_notify_queue_flush();
+}
+
+static long long elapsed(struct timespec *p_t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (long long)(t1.tv_sec - p_t0->tv_sec) * 1000000000LL + (t1.tv_nsec - p_t0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    int             centrals = atoi(argv[1]);
+    int             ticks = atoi(argv[2]);
+    double          churn = atof(argv[3]);
+    int             accepted = 0, refused = 0, missed = 0, adv_wrong = 0;
+    int             next = 1;
+    uint8_t         level = 100;
+    long            delivered = 0;
+    long long       fan_out_ns = 0;
+    struct timespec t0;
+
+    (void)argc;
+    srand(1);
+    app_bt_conn_init(cccd_handles, 1);
+    advertising = 1;
+
+    for (int t = 0; t < ticks; t++)
+    {
+        /* Waiting centrals connect one per tick while advertising */
+        if (advertising)
+        {
+            for (int tries = 0; tries < centrals; tries++, next = (next % centrals) + 1)
+            {
+                if (0 == central[next].conn_id)
+                {
+                    accepted += connect(next, &refused);
+                    next = (next % centrals) + 1;
+                    break;
+                }
+            }
+        }
+        /* A connected central leaves */
+        if ((rand() / (RAND_MAX + 1.0)) < churn)
+        {
+            int c = 1 + rand() % centrals;
+            if (0 != central[c].conn_id)
+            {
+                disconnect(c);
+            }
+        }
+        if (advertising != (app_bt_conn_count() < APP_BT_MAX_CONNECTIONS))
+        {
+            adv_wrong++;
+        }
+
+        level = (0 == level) ? 100 : (uint8_t)(level - 1);
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        fan_out(level);
+        fan_out_ns += elapsed(&t0);
+        transmit();
+
+        for (int c = 1; c <= centrals; c++)
+        {
+            if ((0 != central[c].conn_id) && (central[c].last != level))
+            {
+                missed++;
+            }
+        }
+    }
+    for (int c = 1; c <= centrals; c++)
+    {
+        delivered += central[c].received;
+    }
+    printf("result %d %d %ld %ld %d %d %lld\n", accepted, refused, delivered, pdus, missed, adv_wrong,
+           fan_out_ns / ticks);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--centrals", type=int, nargs="+", default=[1, 2, 3, 4, 8, 16])
+    parser.add_argument("--slots", type=int, nargs="+", default=[3],
+                        help="APP_BT_MAX_CONNECTIONS builds")
+    parser.add_argument("--ticks", type=int, default=5000)
+    parser.add_argument("--churn", type=float, default=0.05, help="disconnect probability per tick")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    if max(args.centrals) > 64 or max(args.slots) > 32:
+        parser.error("at most 64 centrals and 32 slots")
+
+    failed = 0
+    print("%5s %8s %9s %8s %10s %8s %7s %9s %11s" %
+          ("slots", "centrals", "accepted", "refused", "delivered", "pdus", "missed", "adv wrong",
+           "fan-out ns"))
+    with tempfile.TemporaryDirectory() as tmp:
+        for slots in args.slots:
+            exe = build(args, tmp, ["app_bt_conn.c", "app_bt_notify_queue.c"], DRIVER,
+                        ["APP_BT_MAX_CONNECTIONS=%d" % slots])
+            for centrals in args.centrals:
+                f = run(exe, centrals, args.ticks, args.churn).split()
+                missed, adv_wrong = int(f[5]), int(f[6])
+                failed += missed != 0 or adv_wrong != 0
+                print("%5d %8d %9s %8s %10s %8s %7s %9s %11s" %
+                      (slots, centrals, f[1], f[2], f[3], f[4], f[5], f[6], f[7]))
+    if failed:
+        print("FAIL: a central missed a level or advertising did not follow the free slots")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
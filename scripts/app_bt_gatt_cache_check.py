@@ -0,0 +1,332 @@
+#!/usr/bin/env python3
+"""
+Checks that cached read responses of app_bt_gatt_cache.c follow the values.
+
+Builds app_bt_gatt_db.c and app_bt_gatt_cache.c on the host (see
+app_host.py) with a driver that serves Read By Type and Read Multiple
+Requests the way app_bt_gatt_req_read_by_type_handler() and
+app_bt_gatt_req_read_multi_handler() do: cache lookup, else build the
+response in a reserved entry, tracking every attribute, and commit.
+
+    bas     Every --ticks round runs one bas_task() update of the Battery
+            Level, which stores the new level through app_bt_gatt_db_write(),
+            then reads the level twice by type and by handle list. The first
+            read after a tick must carry the new level, the second must be a
+            cache hit.
+    multi   Reads two handle lists of the same length one after the other;
+            the second must get its own values, not the cached response of
+            the first. The lists are picked so that a 32-bit FNV-1a hash of
+            the handles, as a key might use, is the same for both.
+    wrap    Caches the level, then writes it 65536 times, cycling through
+            three values, with nothing reading in between. The next read
+            must carry the last value even though a 16-bit generation would
+            be back where the cached response left it.
+
+    python3 scripts/app_bt_gatt_cache_check.py
+    python3 scripts/app_bt_gatt_cache_check.py --ticks 500
+
+Prints one line per check and exits non-zero if any fails.
+"""
+
+import argparse
+import random
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_gatt_db.h"
+#include "app_bt_gatt_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ATTRS                   (511u)
+#define BAS_LEVEL_HANDLE        (0x002Au)
+#define BATTERY_LEVEL_CHANGE    (2u)
+
+static uint8_t         values[ATTRS + 1];
+gatt_db_lookup_table_t app_gatt_db_ext_attr_tbl[ATTRS];
+const uint16_t         app_gatt_db_ext_attr_tbl_size = ATTRS;
+
+static uint16_t uuid_of(uint16_t handle)
+{
+    return (BAS_LEVEL_HANDLE == handle) ? 0x2A19 : (uint16_t)(0x2B00 + handle);
+}
+
+uint16_t wiced_bt_gatt_find_handle_by_type(uint16_t s_handle, uint16_t e_handle, wiced_bt_uuid_t *p_uuid)
+{
+    for (uint16_t handle = s_handle; (handle <= ATTRS) && (handle <= e_handle); handle++)
+    {
+        if ((0 != handle) && (uuid_of(handle) == p_uuid->uu.uuid16))
+        {
+            return handle;
+        }
+    }
+    return 0;
+}
+
+static int hits;
+
+/* As app_bt_gatt_req_read_by_type_handler() */
+static uint16_t read_by_type(uint16_t uuid16, uint8_t *p_out)
+{
+    wiced_bt_gatt_read_by_type_t req = { 1, 0xFFFF, { LEN_UUID_16, { .uuid16 = uuid16 } } };
+    app_bt_gatt_cache_key_t      key;
+    uint8_t                      scratch[64];
+    uint8_t                     *p_rsp;
+    uint8_t                     *p_val;
+    uint8_t                      pair_len = 0;
+    uint16_t                     len = 0;
+    uint16_t                     attr_len;
+    uint16_t                     handle = 1;
+    int                          filled;
+
+    app_bt_gatt_cache_key_read_by_type(&key, GATT_REQ_READ_BY_TYPE, &req, sizeof(scratch));
+    if ((p_rsp = app_bt_gatt_cache_lookup(&key, &len, &pair_len)) != NULL)
+    {
+        hits++;
+    }
+    else
+    {
+        p_rsp = app_bt_gatt_cache_reserve(&key);
+        p_rsp = (NULL != p_rsp) ? p_rsp : scratch;
+        while ((handle = app_bt_gatt_db_find_handle_by_type(handle, req.e_handle, &req.uuid)) != 0)
+        {
+            app_bt_gatt_db_read(1, handle, &p_val, &attr_len);
+            filled = wiced_bt_gatt_put_read_by_type_rsp_in_stream(p_rsp + len, sizeof(scratch) - len,
+                                                                  &pair_len, handle, attr_len, p_val);
+            if (0 == filled)
+            {
+                break;
+            }
+            len += filled;
+            app_bt_gatt_cache_track(p_rsp, handle);
+            handle++;
+        }
+        app_bt_gatt_cache_commit(p_rsp, len, pair_len);
+    }
+    memcpy(p_out, p_rsp, len);
+    app_bt_gatt_cache_release(p_rsp);
+    return len;
+}
+
+/* As app_bt_gatt_req_read_multi_handler() */
+static uint16_t read_multi(const uint16_t *p_handles, int num_handles, uint8_t *p_out)
+{
+    wiced_bt_gatt_read_multiple_req_t req;
+    app_bt_gatt_cache_key_t           key;
+    uint8_t                           stream[2 * ATTRS];
+    uint8_t                           scratch[64];
+    uint8_t                          *p_rsp;
+    uint8_t                          *p_val;
+    uint8_t                           pair_len = 0;
+    uint16_t                          len = 0;
+    uint16_t                          attr_len;
+    uint16_t                          handle;
+
+    for (int i = 0; i < num_handles; i++)
+    {
+        stream[2 * i]     = (uint8_t)p_handles[i];
+        stream[2 * i + 1] = (uint8_t)(p_handles[i] >> 8);
+    }
+    req.num_handles = num_handles;
+    req.p_handle_stream = stream;
+
+    app_bt_gatt_cache_key_read_multi(&key, GATT_REQ_READ_MULTI, &req, sizeof(scratch));
+    if ((p_rsp = app_bt_gatt_cache_lookup(&key, &len, &pair_len)) != NULL)
+    {
+        hits++;
+    }
+    else
+    {
+        p_rsp = app_bt_gatt_cache_reserve(&key);
+        p_rsp = (NULL != p_rsp) ? p_rsp : scratch;
+        for (int i = 0; i < num_handles; i++)
+        {
+            handle = wiced_bt_gatt_get_handle_from_stream(stream, i);
+            app_bt_gatt_db_read(1, handle, &p_val, &attr_len);
+            len += wiced_bt_gatt_put_read_multi_rsp_in_stream(GATT_REQ_READ_MULTI, p_rsp + len,
+                                                              sizeof(scratch) - len, handle,
+                                                              attr_len, p_val);
+            app_bt_gatt_cache_track(p_rsp, handle);
+        }
+        app_bt_gatt_cache_commit(p_rsp, len, pair_len);
+    }
+    memcpy(p_out, p_rsp, len);
+    app_bt_gatt_cache_release(p_rsp);
+    return len;
+}
+
+/* The level update of bas_task() */
+static uint8_t bas_tick(void)
+{
+    uint8_t level = values[BAS_LEVEL_HANDLE];
+
+    if (0 == level)
+    {
+        level = 100;
+    }
+    else
+    {
+        level = level - BATTERY_LEVEL_CHANGE;
+    }
+    app_bt_gatt_db_write(0, NULL, BAS_LEVEL_HANDLE, &level, sizeof(level));
+    return level;
+}
+
+static int check_bas(int ticks)
+{
+    const uint16_t list[] = { 0x0010, BAS_LEVEL_HANDLE, 0x0011 };
+    uint8_t        rsp[64];
+    uint8_t        level;
+    int            stale = 0;
+    int            missed = 0;
+
+    for (int t = 0; t < ticks; t++)
+    {
+        level = bas_tick();
+        for (int pass = 0; pass < 2; pass++)
+        {
+            hits = 0;
+            /* Handle and value pair, the level after the handle */
+            if ((3 != read_by_type(0x2A19, rsp)) || (rsp[2] != level))
+            {
+                stale++;
+            }
+            /* One byte per handle, the level second */
+            if ((3 != read_multi(list, 3, rsp)) || (rsp[1] != level))
+            {
+                stale++;
+            }
+            missed += (1 == pass) ? 2 - hits : 0;
+        }
+    }
+    printf("bas %d %d %d\n", ticks, stale, missed);
+    return 0;
+}
+
+static int check_wrap(void)
+{
+    uint8_t  rsp[64];
+    uint8_t  level = 0;
+
+    read_by_type(0x2A19, rsp);
+    for (uint32_t n = 1; n <= 0x10000u; n++)
+    {
+        level = (uint8_t)(10 + (n % 3));
+        app_bt_gatt_db_write(0, NULL, BAS_LEVEL_HANDLE, &level, sizeof(level));
+    }
+    read_by_type(0x2A19, rsp);
+    printf("wrap %d %d\n", level, rsp[2]);
+    return 0;
+}
+
+static int check_multi(int count, char **pp_handles)
+{
+    uint16_t lists[2][APP_BT_GATT_CACHE_MAX_ATTRS] = { { 0 } };
+    uint8_t  rsp[64];
+    int      num_handles = count / 2;
+    int      wrong = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        lists[i / num_handles][i % num_handles] = (uint16_t)strtol(pp_handles[i], NULL, 0);
+    }
+    for (int l = 0; l < 2; l++)
+    {
+        read_multi(lists[l], num_handles, rsp);
+        /* Every value is the low byte of its handle */
+        for (int i = 0; i < num_handles; i++)
+        {
+            wrong += (rsp[i] != (uint8_t)lists[l][i]);
+        }
+    }
+    printf("multi %d\n", wrong);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    for (uint16_t i = 0; i < ATTRS; i++)
+    {
+        app_gatt_db_ext_attr_tbl[i].handle  = (uint16_t)(i + 1);
+        app_gatt_db_ext_attr_tbl[i].max_len = 1;
+        app_gatt_db_ext_attr_tbl[i].cur_len = 1;
+        app_gatt_db_ext_attr_tbl[i].p_data  = &values[i + 1];
+        values[i + 1] = (uint8_t)(i + 1);
+    }
+    values[BAS_LEVEL_HANDLE] = 100;
+    app_bt_gatt_db_index_init(NULL, 0);
+
+    if (0 == strcmp(argv[1], "bas"))
+    {
+        return check_bas(atoi(argv[2]));
+    }
+    if (0 == strcmp(argv[1], "wrap"))
+    {
+        return check_wrap();
+    }
+    if (0 == strcmp(argv[1], "multi"))
+    {
+        return check_multi(argc - 2, &argv[2]);
+    }
+    return 1;
+}
+"""
+
+
+def fnv1a(handles):
+    h = 2166136261
+    for handle in handles:
+        for byte in (handle & 0xFF, handle >> 8):
+            h = ((h ^ byte) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def colliding_lists(attrs=511, count=3):
+    """Two lists of count handles from 1..attrs with the same FNV-1a hash."""
+    rng = random.Random(1)
+    seen = {}
+    while True:
+        handles = tuple(rng.randrange(1, attrs + 1) for _ in range(count))
+        h = fnv1a(handles)
+        if h in seen and seen[h] != handles:
+            return seen[h], handles
+        seen[h] = handles
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--ticks", type=int, default=120, help="bas_task updates")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_gatt_db.c", "app_bt_gatt_cache.c"], DRIVER)
+
+        f = run(exe, "bas", args.ticks).split()
+        ticks, stale, missed = int(f[1]), int(f[2]), int(f[3])
+        ok = stale == 0 and missed == 0
+        failed += not ok
+        print("%-4s bas: %d ticks, %d stale responses after a tick, %d repeat reads not cached" %
+              ("ok" if ok else "FAIL", ticks, stale, missed))
+
+        f = run(exe, "wrap").split()
+        ok = f[1] == f[2]
+        failed += not ok
+        print("%-4s wrap: level %s after 65536 writes, read %s" % ("ok" if ok else "FAIL", f[1], f[2]))
+
+        first, second = colliding_lists()
+        wrong = int(run(exe, "multi", *(first + second)).split()[1])
+        failed += wrong != 0
+        print("%-4s multi: %s then %s, %d wrong values" %
+              ("ok" if wrong == 0 else "FAIL", "/".join("0x%04x" % h for h in first),
+               "/".join("0x%04x" % h for h in second), wrong))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Times attribute lookups of app_bt_gatt_db.c against the linear table scan.
+
+Builds app_bt_gatt_db.c on the host (see app_host.py) once per database
+size, over a generated app_gatt_db_ext_attr_tbl of that many attributes with
+one hook on every fourth handle, as a GATT database has on its client
+configuration descriptors. Each build looks up the same pseudo-random
+handles, a tenth of them missing from the table, through
+app_bt_gatt_db_find_by_handle() and app_bt_gatt_db_find_hooks(), and
+through the scan over both tables they replace, and checks that both
+answers agree.
+
+    python3 scripts/app_bt_gatt_db_bench.py
+    python3 scripts/app_bt_gatt_db_bench.py --attrs 10 100 500 --lookups 2000000
+    python3 scripts/app_bt_gatt_db_bench.py --attrs 600 -D APP_BT_GATT_DB_MAX_HANDLE=0x3FF
+
+A database with handles above APP_BT_GATT_DB_MAX_HANDLE is reported as
+rejected, as app_bt_gatt_db_index_init() refuses it. Host time says little
+about the CM4 or CM33 cycle count, but the scan grows with the database and
+the index does not.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_gatt_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint8_t                  values[ATTRS];
+gatt_db_lookup_table_t          app_gatt_db_ext_attr_tbl[ATTRS];
+const uint16_t                  app_gatt_db_ext_attr_tbl_size = ATTRS;
+static app_bt_gatt_attr_hooks_t hooks[(ATTRS + 3) / 4];
+
+/* The lookups as they were before the index */
+static gatt_db_lookup_table_t *scan_attr(uint16_t handle)
+{
+    for (uint16_t i = 0; i < app_gatt_db_ext_attr_tbl_size; i++)
+    {
+        if (app_gatt_db_ext_attr_tbl[i].handle == handle)
+        {
+            return &app_gatt_db_ext_attr_tbl[i];
+        }
+    }
+    return NULL;
+}
+
+static const app_bt_gatt_attr_hooks_t *scan_hooks(uint16_t handle)
+{
+    for (uint16_t i = 0; i < sizeof(hooks) / sizeof(hooks[0]); i++)
+    {
+        if (hooks[i].handle == handle)
+        {
+            return &hooks[i];
+        }
+    }
+    return NULL;
+}
+
+static long long elapsed(struct timespec *p_t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (long long)(t1.tv_sec - p_t0->tv_sec) * 1000000000LL + (t1.tv_nsec - p_t0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    long             lookups = atol(argv[1]);
+    uint16_t        *p_handles = malloc((size_t)lookups * sizeof(uint16_t));
+    uint32_t         seed = 1;
+    uintptr_t        sink = 0;
+    struct timespec  t0;
+    long long        index_ns;
+    long long        scan_ns;
+
+    (void)argc;
+    for (uint16_t i = 0; i < ATTRS; i++)
+    {
+        app_gatt_db_ext_attr_tbl[i].handle  = (uint16_t)(i + 1);
+        app_gatt_db_ext_attr_tbl[i].max_len = 1;
+        app_gatt_db_ext_attr_tbl[i].cur_len = 1;
+        app_gatt_db_ext_attr_tbl[i].p_data  = &values[i];
+        if (0 == (i % 4))
+        {
+            hooks[i / 4].handle = (uint16_t)(i + 1);
+        }
+    }
+    if (WICED_BT_SUCCESS != app_bt_gatt_db_index_init(hooks, sizeof(hooks) / sizeof(hooks[0])))
+    {
+        printf("rejected\n");
+        return 0;
+    }
+
+    for (long n = 0; n < lookups; n++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        p_handles[n] = (uint16_t)(1 + (seed >> 8) % (ATTRS + ATTRS / 10 + 1));
+        if ((app_bt_gatt_db_find_by_handle(p_handles[n]) != scan_attr(p_handles[n])) ||
+            (app_bt_gatt_db_find_hooks(p_handles[n]) != scan_hooks(p_handles[n])))
+        {
+            printf("mismatch at handle 0x%04x\n", p_handles[n]);
+            return 0;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long n = 0; n < lookups; n++)
+    {
+        sink += (uintptr_t)app_bt_gatt_db_find_by_handle(p_handles[n]);
+        sink += (uintptr_t)app_bt_gatt_db_find_hooks(p_handles[n]);
+    }
+    index_ns = elapsed(&t0);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long n = 0; n < lookups; n++)
+    {
+        sink += (uintptr_t)scan_attr(p_handles[n]);
+        sink += (uintptr_t)scan_hooks(p_handles[n]);
+    }
+    scan_ns = elapsed(&t0);
+
+    printf("time %lld %lld %u\n", index_ns, scan_ns, (unsigned)(sink & 1));
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--attrs", type=int, nargs="+", default=[10, 50, 100, 250, 500],
+                        help="database sizes to build")
+    parser.add_argument("--lookups", type=int, default=1000000)
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    print("%7s %14s %14s %9s" % ("attrs", "index ns/op", "scan ns/op", "speed-up"))
+    with tempfile.TemporaryDirectory() as tmp:
+        for attrs in args.attrs:
+            exe = build(args, tmp, ["app_bt_gatt_db.c"], DRIVER, ["ATTRS=%d" % attrs])
+            lines = run(exe, args.lookups).splitlines()
+            fields = lines[-1].split()
+            if fields[0] == "rejected":
+                print("%7d  rejected: %s" % (attrs, lines[0].strip()))
+                continue
+            if fields[0] != "time":
+                print("%7d  %s" % (attrs, " ".join(fields)))
+                return 1
+            index_ns = int(fields[1]) / args.lookups
+            scan_ns = int(fields[2]) / args.lookups
+            print("%7d %14.1f %14.1f %8.1fx" % (attrs, index_ns, scan_ns, scan_ns / index_ns))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""
+Decodes History Records notifications of app_bt_history.c.
+
+Takes the notification values as hex, one per line, as logged by a client
+such as nRF Connect or bluetoothctl, and prints one "seconds,level" line per
+sample. The record of a sample is its number n, the level at n * period
+seconds of uptime; the period is read from the characteristic (--period).
+
+    python3 scripts/app_bt_history_decode.py notifications.txt
+    python3 scripts/app_bt_history_decode.py --period 60 --seq < notifications.txt
+
+The last line of a complete download is the end marker, reported on stderr
+with the sample number to resume from.
+"""
+
+import argparse
+import re
+import sys
+
+# Keep in line with app_bt_history.h
+HEADER_LEN = 5
+END = 0xFF
+CODE_RUN_MAX = 0x7F
+CODE_ABS = 0xC0
+
+HEX_RE = re.compile(r"(?:0x)?([0-9A-Fa-f]{2})")
+
+
+def decode(pdu):
+    """Yields (sample number, level) of one record notification."""
+    seq = int.from_bytes(pdu[0:4], "little")
+    level = pdu[4]
+    if level == END:
+        raise EOFError(seq)
+    yield seq, level
+    i = HEADER_LEN
+    while i < len(pdu):
+        code = pdu[i]
+        i += 1
+        if code <= CODE_RUN_MAX:
+            for _ in range(code + 1):
+                seq += 1
+                yield seq, level
+            continue
+        if code == CODE_ABS:
+            level = pdu[i]
+            i += 1
+        elif code < CODE_ABS:
+            delta = code & 0x3F
+            level += delta - 0x40 if delta & 0x20 else delta
+        else:
+            raise ValueError("reserved code 0x%02X" % code)
+        seq += 1
+        yield seq, level
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("file", nargs="?", help="notification values, stdin by default")
+    parser.add_argument("--period", type=int, default=60, help="APP_BT_HISTORY_PERIOD_S")
+    parser.add_argument("--seq", action="store_true", help="print sample numbers, not seconds")
+    args = parser.parse_args()
+
+    src = open(args.file) if args.file else sys.stdin
+    last = None
+    for line in src:
+        pdu = bytes(int(b, 16) for b in HEX_RE.findall(line.replace("-", " ")))
+        if len(pdu) < HEADER_LEN:
+            continue
+        try:
+            for seq, level in decode(pdu):
+                if last is not None and seq > last + 1:
+                    print("# gap of %u samples" % (seq - last - 1), file=sys.stderr)
+                last = seq
+                print("%u,%u" % (seq if args.seq else seq * args.period, level))
+        except EOFError as end:
+            print("# end, resume from sample %u" % end.args[0], file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""
+Records a battery history with app_bt_history.c and downloads it back.
+
+Builds app_bt_history.c and app_bt_conn.c on the host (see app_host.py),
+without the GATT response pool: the stream owns its PDU buffers. The driver
+calls app_bt_history_add() once per second for --periods periods of
+APP_BT_HISTORY_PERIOD_S, with a level that wanders and now and then jumps,
+then reads the range from the characteristic and runs these downloads
+through app_bt_history_on_write(). The stack model holds every notification
+until the connection event, then reports it with
+app_bt_history_transmitted(); every --congest-every-th send is refused with
+WICED_BT_GATT_CONGESTED and resumed by app_bt_history_congestion().
+
+    full      From sample 0, so from the oldest kept, at --mtu.
+    range     The time range of samples oldest + 100 to oldest + 250.
+    resume    From 500 samples before the newest, at the default MTU.
+    current   From the newest + 1: only the end marker.
+    handover  A download is cut by a disconnection while its PDUs are with
+              the stack, and another central starts one before they are
+              reported transmitted.
+
+The records are decoded with scripts/app_bt_history_decode.py. The table
+gives per download the MTU, the notifications, the samples, the bytes per
+sample and the congested sends.
+
+Checks, per download: the samples are the expected range without a gap,
+every level is the one recorded, the end marker gives the sample to resume
+from, no notification exceeds the MTU, and no PDU buffer is handed to the
+stack again while it still holds it.
+
+    python3 scripts/app_bt_history_sim.py
+    python3 scripts/app_bt_history_sim.py --mtu 65 --congest-every 2
+    python3 scripts/app_bt_history_sim.py -D APP_BT_HISTORY_PDU_LEN=100 --periods 20000
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_bt_history_decode import decode
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_conn.h"
+#include "app_bt_history.h"
+#include <FreeRTOS.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VALUE_HANDLE    (0x0040u)
+#define CCCD_HANDLE     (0x0041u)
+#define MAX_HELD        (64)
+
+extern TickType_t app_host_tick;
+
+static const uint16_t cccd_handles[] = { CCCD_HANDLE };
+
+/* Notifications the stack holds, oldest first */
+static uint8_t  *held[MAX_HELD];
+static int       num_held;
+static int       held_max;
+static int       congest_every;
+static long      sends;
+static long      reused;
+static long      oversize;
+static bool      ended;
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t conn_id, uint16_t handle,
+                                                              uint16_t len, uint8_t *p_val, void *p_ctx)
+{
+    (void)handle; (void)p_ctx;
+    if ((0 != congest_every) && (0 == (++sends % congest_every)))
+    {
+        return WICED_BT_GATT_CONGESTED;
+    }
+    for (int i = 0; i < num_held; i++)
+    {
+        reused += (held[i] == p_val);
+    }
+    oversize += (len > app_bt_conn_get_mtu(conn_id) - 3u);
+    ended = ended || ((5u == len) && (0xFFu == p_val[4]));
+    held[num_held++] = p_val;
+    held_max = (num_held > held_max) ? num_held : held_max;
+    printf("pdu %04x ", conn_id);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        printf("%02x", p_val[i]);
+    }
+    printf("\n");
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/* Connection events: the stack reports up to n held buffers */
+static void transmit(int n)
+{
+    uint8_t *p;
+
+    for (; (n > 0) && (num_held > 0); n--)
+    {
+        p = held[0];
+        memmove(&held[0], &held[1], (size_t)(--num_held) * sizeof(held[0]));
+        app_bt_history_transmitted(p);
+    }
+}
+
+static void connect(uint16_t conn_id, uint16_t mtu)
+{
+    uint8_t      addr[6] = { 0x00, 0xA0, 0x50, 0x00, 0x00, (uint8_t)conn_id };
+    wiced_bool_t changed;
+
+    app_bt_conn_open(conn_id, addr);
+    app_bt_conn_set_mtu(conn_id, mtu);
+    app_bt_conn_cccd_set(conn_id, CCCD_HANDLE, GATT_CLIENT_CONFIG_NOTIFICATION, &changed);
+}
+
+static void command(uint16_t conn_id, uint8_t op, uint32_t a, uint32_t b, uint16_t len)
+{
+    uint8_t v[9] = { op, (uint8_t)a, (uint8_t)(a >> 8), (uint8_t)(a >> 16), (uint8_t)(a >> 24),
+                     (uint8_t)b, (uint8_t)(b >> 8), (uint8_t)(b >> 16), (uint8_t)(b >> 24) };
+
+    ended = false;
+    if (WICED_BT_GATT_SUCCESS == app_bt_history_validate(conn_id, VALUE_HANDLE, v, len))
+    {
+        app_bt_history_on_write(conn_id, NULL, VALUE_HANDLE, v, len);
+    }
+}
+
+/* Runs the stack until the end marker is out and transmitted */
+static void finish(uint16_t conn_id)
+{
+    for (int i = 0; (i < 100000) && (!ended || (num_held > 0)); i++)
+    {
+        transmit(2);
+        app_bt_history_congestion(conn_id, WICED_FALSE);
+    }
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t  periods = (uint32_t)atol(argv[1]);
+    uint16_t  mtu = (uint16_t)atoi(argv[2]);
+    uint32_t  seed = 3, oldest, newest;
+    int       level = 100;
+    uint8_t  *p_info;
+    uint16_t  info_len;
+    app_bt_history_stats_t stats;
+
+    (void)argc;
+    congest_every = atoi(argv[3]);
+    app_bt_conn_init(cccd_handles, 1);
+    app_bt_history_init(VALUE_HANDLE, CCCD_HANDLE);
+
+    printf("truth ");
+    for (uint32_t s = 0; s < periods * APP_BT_HISTORY_PERIOD_S; s++)
+    {
+        app_host_tick = (TickType_t)(s * 1000u);
+        if (0 == (s % APP_BT_HISTORY_PERIOD_S))
+        {
+            seed = seed * 1103515245u + 12345u;
+            level += ((seed >> 8) % 2) ? 0 : (int)((seed >> 12) % 3) - 1;
+            level  = (0 == (seed >> 16) % 200) ? (int)((seed >> 4) % 101) : level;
+            level  = (level < 0) ? 100 : (level > 100) ? 0 : level;
+            printf("%02x", level);
+        }
+        app_bt_history_add((uint8_t)level);
+    }
+    app_bt_history_on_read(0x0001, VALUE_HANDLE, &p_info, &info_len);
+    oldest = get_u32(&p_info[4]);
+    newest = get_u32(&p_info[8]);
+    printf("\ninfo %lu %lu\n", (unsigned long)oldest, (unsigned long)newest);
+
+    connect(0x0001, mtu);
+    printf("begin full %u\n", mtu);
+    command(0x0001, APP_BT_HISTORY_CMD_FROM_SEQ, 0, 0, 5);
+    finish(0x0001);
+
+    printf("begin range %u\n", mtu);
+    command(0x0001, APP_BT_HISTORY_CMD_TIME_RANGE, (oldest + 100) * APP_BT_HISTORY_PERIOD_S - 30,
+            (oldest + 250) * APP_BT_HISTORY_PERIOD_S + APP_BT_HISTORY_PERIOD_S - 1, 9);
+    finish(0x0001);
+
+    app_bt_conn_set_mtu(0x0001, APP_BT_CONN_DEFAULT_MTU);
+    printf("begin resume %u\n", APP_BT_CONN_DEFAULT_MTU);
+    command(0x0001, APP_BT_HISTORY_CMD_FROM_SEQ, newest - 500, 0, 5);
+    finish(0x0001);
+
+    printf("begin current %u\n", APP_BT_CONN_DEFAULT_MTU);
+    command(0x0001, APP_BT_HISTORY_CMD_FROM_SEQ, newest + 1, 0, 5);
+    finish(0x0001);
+
+    /* Cut off with every buffer in flight, the slot goes to the next central */
+    app_bt_conn_set_mtu(0x0001, mtu);
+    congest_every = 0;
+    printf("begin handover %u\n", mtu);
+    command(0x0001, APP_BT_HISTORY_CMD_FROM_SEQ, 0, 0, 5);
+    app_bt_history_close(0x0001);
+    app_bt_conn_close(0x0001);
+    connect(0x0002, mtu);
+    command(0x0002, APP_BT_HISTORY_CMD_FROM_SEQ, newest - 300, 0, 5);
+    finish(0x0002);
+
+    app_bt_history_get_stats(&stats);
+    printf("result %ld %ld %d %lu\n", reused, oversize, held_max, (unsigned long)stats.congested);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--periods", type=int, default=6000, help="samples recorded")
+    parser.add_argument("--mtu", type=int, default=247, help="ATT MTU of the full and range downloads")
+    parser.add_argument("--congest-every", type=int, default=3, help="refuse every nth send, 0 for never")
+    parser.add_argument("--max-in-flight", type=int, default=4,
+                        help="APP_BT_HISTORY_MAX_IN_FLIGHT of the build, for the check")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_history.c", "app_bt_conn.c"], DRIVER)
+        out = run(exe, args.periods, args.mtu, args.congest_every)
+
+    truth, oldest, newest = b"", 0, 0
+    downloads = []
+    for line in out.splitlines():
+        word, _, rest = line.partition(" ")
+        if word == "truth":
+            truth = bytes.fromhex(rest)
+        elif word == "info":
+            oldest, newest = (int(v) for v in rest.split())
+        elif word == "begin":
+            name, mtu = rest.split()
+            downloads.append({"name": name, "mtu": int(mtu), "pdus": []})
+        elif word == "pdu" and downloads:
+            conn_id, data = rest.split()
+            downloads[-1]["pdus"].append((conn_id, bytes.fromhex(data)))
+        elif word == "result":
+            reused, oversize, held_max, congested = (int(v) for v in rest.split())
+
+    expected = {
+        "full": (oldest, newest),
+        "range": (oldest + 100, oldest + 250),
+        "resume": (newest - 500, newest),
+        "current": (newest + 1, newest),
+        "handover": (newest - 300, newest),
+    }
+
+    failed = 0
+    print("%-9s %4s %6s %8s %12s" % ("download", "mtu", "pdus", "samples", "bytes/sample"))
+    for d in downloads:
+        first, last = expected[d["name"]]
+        # The cut off download of the first central is not checked
+        pdus = [pdu for conn_id, pdu in d["pdus"] if d["name"] != "handover" or conn_id == "0002"]
+        samples, end, size = [], None, 0
+        for pdu in pdus:
+            size += len(pdu)
+            try:
+                samples.extend(decode(pdu))
+            except EOFError as e:
+                end = e.args[0]
+        seqs = [seq for seq, _ in samples]
+        problems = []
+        if seqs != list(range(first, last + 1)):
+            problems.append("samples %s to %s, %d of them, expected %d to %d" %
+                            (seqs[0] if seqs else "-", seqs[-1] if seqs else "-", len(seqs), first, last))
+        wrong = sum(1 for seq, level in samples if seq >= len(truth) or truth[seq] != level)
+        if wrong:
+            problems.append("%d levels differ from the recording" % wrong)
+        if end != last + 1:
+            problems.append("end marker %s, expected %d" % (end, last + 1))
+        print("%-9s %4d %6d %8d %12.2f" % (d["name"], d["mtu"], len(pdus), len(samples),
+                                          size / len(samples) if samples else 0))
+        for text in problems:
+            failed += 1
+            print("%-9s FAIL %s" % ("", text))
+
+    print("%d congested sends, at most %d PDUs in flight" % (congested, held_max))
+    for ok, text in ((reused == 0, "%d PDU buffers handed over while the stack held them" % reused),
+                     (oversize == 0, "%d notifications longer than the MTU allows" % oversize),
+                     (held_max <= args.max_in_flight, "more than %d PDUs in flight" % args.max_in_flight)):
+        if not ok:
+            failed += 1
+            print("FAIL %s" % text)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
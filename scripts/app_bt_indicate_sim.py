@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""
+Drives app_bt_indicate.c with centrals that confirm late, early or never.
+
+Builds app_bt_indicate.c and app_bt_conn.c on the host (see app_host.py).
+--centrals centrals are connected and the Battery Level changes every
+--period-ms; each change is indicated with app_bt_indicate_send() and
+app_bt_indicate_poll() runs, as bas_task() does. The stack model refuses a
+send with WICED_BT_GATT_BUSY --busy-pct of the time. Otherwise the central
+confirms one or two connection intervals later through
+app_bt_indicate_confirm(), as GATT_HANDLE_VALUE_CONF does, except that:
+
+    early   One send in four is confirmed before
+            wiced_bt_gatt_server_send_indication() returns, as when the BT
+            stack task runs the confirmation first.
+    silent  The last --silent centrals never confirm.
+
+The table gives, per connection interval, the indications sent and
+confirmed, the values replaced by a newer one while waiting, the refused
+sends, the timeouts, the values dropped on timed out links and the longest
+round trip, followed by the round trip histogram of the last run.
+
+Checks, per run:
+
+    overlap     No central ever gets an indication while one is unconfirmed.
+    early       No confirmation is rejected, early ones included.
+    silent      A silent central gets exactly one indication, which times
+                out after APP_BT_INDICATE_TIMEOUT_MS; later sends to it are
+                refused with WICED_BT_GATT_WRONG_STATE.
+    newest      Every other central ends with the newest level confirmed.
+
+    python3 scripts/app_bt_indicate_sim.py
+    python3 scripts/app_bt_indicate_sim.py --interval-ms 30 500 --busy-pct 20
+    python3 scripts/app_bt_indicate_sim.py --centrals 3 --silent 0
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_conn.h"
+#include "app_bt_indicate.h"
+#include <FreeRTOS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEVEL_HANDLE    (0x002Au)
+#define MAX_CENTRALS    (APP_BT_MAX_CONNECTIONS)
+
+extern TickType_t app_host_tick;
+
+static const uint16_t cccd_handles[] = { LEVEL_HANDLE + 1 };
+
+typedef struct
+{
+    uint16_t   conn_id;
+    int        silent;
+    int        outstanding;         /* Indication not yet confirmed */
+    TickType_t due;                 /* When the confirmation comes */
+    uint8_t    value;               /* Value of the outstanding indication */
+    uint8_t    confirmed;           /* Last value confirmed */
+    long       sends;
+} central_t;
+
+static central_t central[MAX_CENTRALS];
+static int       num_centrals;
+static int       interval_ms;
+static int       busy_pct;
+static long      overlaps;
+static long      rejected;
+static long      early;
+static uint32_t  seed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+static central_t *central_of(uint16_t conn_id)
+{
+    for (int c = 0; c < num_centrals; c++)
+    {
+        if (central[c].conn_id == conn_id)
+        {
+            return &central[c];
+        }
+    }
+    return NULL;
+}
+
+static void confirm(central_t *p_c)
+{
+    p_c->outstanding = 0;
+    p_c->confirmed   = p_c->value;
+    if (WICED_TRUE != app_bt_indicate_confirm(p_c->conn_id, LEVEL_HANDLE))
+    {
+        rejected++;
+    }
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_indication(uint16_t conn_id, uint16_t handle,
+                                                            uint16_t len, uint8_t *p_val, void *p_ctx)
+{
+    central_t *p_c = central_of(conn_id);
+
+    (void)handle; (void)len; (void)p_ctx;
+    if (rnd(100) < (uint32_t)busy_pct)
+    {
+        return WICED_BT_GATT_BUSY;
+    }
+    overlaps += p_c->outstanding;
+    p_c->outstanding = 1;
+    p_c->value       = p_val[0];
+    p_c->sends++;
+    p_c->due         = app_host_tick + (TickType_t)(interval_ms * (1 + (int)rnd(2)));
+    if (!p_c->silent && (0 == rnd(4)))
+    {
+        early++;
+        confirm(p_c);
+    }
+    return WICED_BT_GATT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    int       period_ms = atoi(argv[2]);
+    int       silent = atoi(argv[4]);
+    long      duration_ms = atol(argv[6]) * 1000L;
+    uint8_t   addr[6] = { 0x00, 0xA0, 0x50, 0x00, 0x00, 0x00 };
+    uint8_t   level = 100;
+    long      silent_sends = 0, wrong_state = 0, stale = 0;
+    long      t;
+    app_bt_indicate_stats_t stats;
+
+    (void)argc;
+    interval_ms  = atoi(argv[1]);
+    num_centrals = atoi(argv[3]);
+    busy_pct     = atoi(argv[5]);
+    app_bt_conn_init(cccd_handles, 1);
+    for (int c = 0; c < num_centrals; c++)
+    {
+        addr[5]            = (uint8_t)c;
+        central[c].conn_id = (uint16_t)(0x8001 + c);
+        central[c].silent  = (c >= num_centrals - silent);
+        app_bt_conn_open(central[c].conn_id, addr);
+    }
+
+    /* Updates, then a second of polls for the last values to go out */
+    for (t = 0; t < duration_ms + 1000; t++)
+    {
+        app_host_tick = (TickType_t)t;
+        for (int c = 0; c < num_centrals; c++)
+        {
+            if (central[c].outstanding && !central[c].silent && (central[c].due <= app_host_tick))
+            {
+                confirm(&central[c]);
+            }
+        }
+        if (0 != (t % period_ms))
+        {
+            continue;
+        }
+        if (t < duration_ms)
+        {
+            level = (0 == level) ? 100 : (uint8_t)(level - 1);
+            for (int c = 0; c < num_centrals; c++)
+            {
+                wrong_state += (WICED_BT_GATT_WRONG_STATE ==
+                                app_bt_indicate_send(central[c].conn_id, LEVEL_HANDLE, &level, 1));
+            }
+        }
+        app_bt_indicate_poll();
+    }
+
+    for (int c = 0; c < num_centrals; c++)
+    {
+        if (central[c].silent)
+        {
+            silent_sends += central[c].sends;
+        }
+        else
+        {
+            stale += (central[c].confirmed != level);
+        }
+    }
+    app_bt_indicate_get_stats(&stats);
+    printf("result %lu %lu %lu %lu %lu %lu %lu %ld %ld %ld %ld %ld %ld\n",
+           (unsigned long)stats.sent, (unsigned long)stats.confirmed, (unsigned long)stats.replaced,
+           (unsigned long)stats.refused, (unsigned long)stats.timeouts, (unsigned long)stats.dropped,
+           (unsigned long)stats.rtt_max_ms, overlaps, rejected, early, silent_sends, wrong_state, stale);
+    app_bt_indicate_print();
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--interval-ms", type=int, nargs="+", default=[8, 30, 100, 500],
+                        help="connection intervals to run")
+    parser.add_argument("--period-ms", type=int, default=1000, help="Battery Level update period")
+    parser.add_argument("--centrals", type=int, default=3, help="connected centrals, at most 3")
+    parser.add_argument("--silent", type=int, default=1, help="centrals that never confirm")
+    parser.add_argument("--busy-pct", type=int, default=10, help="sends the stack refuses")
+    parser.add_argument("--seconds", type=int, default=120, help="simulated time with updates")
+    parser.add_argument("--timeout-ms", type=int, default=30000,
+                        help="APP_BT_INDICATE_TIMEOUT_MS of the build, for the check")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    if args.centrals > 3 or args.silent > args.centrals:
+        parser.error("at most 3 centrals, and no more silent ones")
+
+    failed = 0
+    histogram = ""
+    print("%8s %6s %9s %8s %7s %8s %7s %7s" %
+          ("interval", "sent", "confirmed", "replaced", "refused", "timeouts", "dropped", "rtt max"))
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_indicate.c", "app_bt_conn.c"], DRIVER)
+        for interval in args.interval_ms:
+            out = run(exe, interval, args.period_ms, args.centrals, args.silent, args.busy_pct,
+                      args.seconds)
+            f = out.split("\n", 1)[0].split()
+            histogram = out.split("\n", 1)[1]
+            overlaps, rejected, early, silent_sends, wrong_state, stale = (int(v) for v in f[8:14])
+            timeouts = int(f[5])
+            print("%8d %6s %9s %8s %7s %8s %7s %7s" % (interval, f[1], f[2], f[3], f[4], f[5], f[6], f[7]))
+
+            checks = [
+                ("overlap", overlaps == 0, "%d indications sent while one was unconfirmed" % overlaps),
+                ("early", rejected == 0, "%d confirmations rejected, %d came early" % (rejected, early)),
+                ("newest", stale == 0, "%d centrals end on an old level" % stale),
+            ]
+            if args.silent and args.seconds * 1000 > args.timeout_ms + args.period_ms:
+                ok = silent_sends == args.silent and timeouts == args.silent and wrong_state > 0
+                checks.append(("silent", ok, "%d indications to %d silent centrals, %d timeouts, "
+                               "%d sends refused after" % (silent_sends, args.silent, timeouts, wrong_state)))
+            for name, ok, text in checks:
+                failed += not ok
+                if not ok:
+                    print("%8s FAIL %s: %s" % ("", name, text))
+    print(histogram.rstrip().replace("\r", ""))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,300 @@
+#!/usr/bin/env python3
+"""
+Drives the tickless sleep hook of app_bt_lpm.c against a Deep Sleep HAL model.
+
+Builds app_bt_lpm.c on the host (see app_host.py) with APP_BT_LOW_POWER=1 and
+APP_BT_LPM_DEEPSLEEP_LATENCY_MS=--ds-latency-ms. The driver plays the idle
+task: whenever nothing is ready it calls app_bt_lpm_sleep() with the time to
+the next battery update, due every --update-ms. The controller asserts BT
+host wake every --bt-ms for --assert-ms, at times the scheduler does not
+know, and each wakeup keeps the CPU busy for --busy-ms.
+
+The HAL model behind cyhal_syspm_tickless_deepsleep() refuses Deep Sleep
+--refuse-pct of the time, as a busy peripheral driver does. Otherwise it
+sleeps until the low power timer or host wake, calls the registered Deep
+Sleep callback and spends --wake-us, give or take half, before returning,
+as clock and regulator restore do. CPU Sleep ends at the timer, host wake
+or its release.
+
+The table gives, per --bt-ms, the share of time in Deep Sleep and in CPU
+Sleep, the entries of each, the refused Deep Sleep entries, the exits on
+host wake and the mean and longest wakeup to ready time. The UART report of
+the last run follows.
+
+Checks, per run:
+
+    counters  Entries, refusals, host wake exits and time per mode equal the
+              model.
+    latency   The wakeup buckets add up to the Deep Sleep entries and the
+              longest wakeup is the model's.
+    snapshot  The Power diagnostics characteristic decodes to the same
+              counters, bucket counts saturating at 65535.
+    time      Deep Sleep, CPU Sleep and busy time add up to the run.
+
+    python3 scripts/app_bt_lpm_sim.py
+    python3 scripts/app_bt_lpm_sim.py --bt-ms 7 30 100 --ds-latency-ms 2
+    python3 scripts/app_bt_lpm_sim.py --refuse-pct 20 --wake-us 800
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import struct
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_lpm.h"
+#include "cybsp_bt_config.h"
+#include "cyhal.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HOST_WAKE_PIN   (7)
+
+extern TickType_t app_host_tick;
+
+const cybt_platform_config_t cybsp_bt_platform_cfg =
+{
+    .controller_config.sleep_mode =
+    {
+        .sleep_mode_enabled   = true,
+        .device_wakeup_pin    = 6,
+        .host_wakeup_pin      = HOST_WAKE_PIN,
+        .device_wake_polarity = CYBT_WAKE_ACTIVE_LOW,
+        .host_wake_polarity   = CYBT_WAKE_ACTIVE_LOW,
+    },
+};
+
+static cyhal_syspm_callback_data_t *p_cb;
+static uint32_t cycles;             /* Core cycle counter */
+static long     bt_ms;
+static long     assert_ms;
+static int      refuse_pct;
+static uint32_t wake_cycles;
+static uint32_t seed = 1;
+
+/* What the model saw */
+static long     ds_entries, ds_ms, sl_entries, sl_ms, refused, bt_wakeups;
+static uint32_t wake_max;
+
+static uint32_t rnd(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+static long now(void)
+{
+    return (long)app_host_tick;
+}
+
+static int host_wake(long t)
+{
+    return (t % bt_ms) < assert_ms;
+}
+
+static long next_bt(long t)
+{
+    return (t / bt_ms + 1) * bt_ms;
+}
+
+uint32_t app_bt_cpu_stats_get_counter(void)
+{
+    return cycles;
+}
+
+bool cyhal_gpio_read(cyhal_gpio_t pin)
+{
+    /* Active low */
+    return (HOST_WAKE_PIN == pin) ? !host_wake(now()) : true;
+}
+
+void cyhal_syspm_register_callback(cyhal_syspm_callback_data_t *p)
+{
+    p_cb = p;
+}
+
+cy_rslt_t cyhal_syspm_tickless_deepsleep(cyhal_lptimer_t *p, uint32_t ms, uint32_t *p_slept)
+{
+    long     wake = now() + (long)ms;
+    uint32_t wake_time = wake_cycles / 2 + rnd(wake_cycles + 1);
+
+    (void)p;
+    if (rnd(100) < (uint32_t)refuse_pct)
+    {
+        refused++;
+        return CYHAL_SYSPM_RSLT_ERR_PM_PENDING;
+    }
+    wake = (next_bt(now()) < wake) ? next_bt(now()) : wake;
+    *p_slept = (uint32_t)(wake - now());
+    ds_entries++;
+    ds_ms += *p_slept;
+
+    /* Woken: the callback first, at the host wake level after the sleep */
+    app_host_tick = (TickType_t)wake;
+    bt_wakeups += host_wake(wake);
+    p_cb->callback(CYHAL_SYSPM_CB_CPU_DEEPSLEEP, CYHAL_SYSPM_AFTER_TRANSITION, p_cb->args);
+    app_host_tick = (TickType_t)(wake - (long)*p_slept);
+    cycles += wake_time;
+    wake_max = (wake_time > wake_max) ? wake_time : wake_max;
+    return CY_RSLT_SUCCESS;
+}
+
+cy_rslt_t cyhal_syspm_tickless_sleep(cyhal_lptimer_t *p, uint32_t ms, uint32_t *p_slept)
+{
+    long t = now();
+    long wake = t + (long)ms;
+    long edge = host_wake(t) ? (t / bt_ms) * bt_ms + assert_ms : next_bt(t);
+
+    (void)p;
+    wake = (edge < wake) ? edge : wake;
+    *p_slept = (uint32_t)(wake - t);
+    if (0 != *p_slept)
+    {
+        sl_entries++;
+        sl_ms += *p_slept;
+    }
+    return CY_RSLT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    long     duration_ms = atol(argv[1]) * 1000L;
+    long     update_ms = atol(argv[2]);
+    long     busy_ms = atol(argv[5]);
+    long     next_update;
+    long     busy = 0;
+    long     t;
+    uint8_t  snap[APP_BT_LPM_LEN];
+    uint16_t len;
+    app_bt_lpm_stats_t stats;
+
+    (void)argc;
+    bt_ms       = atol(argv[3]);
+    assert_ms   = atol(argv[4]);
+    refuse_pct  = atoi(argv[6]);
+    wake_cycles = (uint32_t)(atol(argv[7]) * (SystemCoreClock / 1000000u));
+    app_bt_lpm_init();
+    next_update = update_ms;
+
+    while ((t = now()) < duration_ms)
+    {
+        /* Work on the battery update and on each host wake */
+        if ((t >= next_update) || ((t % bt_ms) == 0))
+        {
+            next_update += (t >= next_update) ? update_ms : 0;
+            app_host_tick += (TickType_t)busy_ms;
+            busy += busy_ms;
+            cycles += (uint32_t)busy_ms * (SystemCoreClock / 1000u);
+            continue;
+        }
+        app_bt_lpm_sleep((uint32_t)(next_update - t));
+        if (now() == t)
+        {
+            /* No sleep, the idle task spins for a tick */
+            app_host_tick++;
+            busy++;
+        }
+    }
+
+    app_bt_lpm_get_stats(&stats);
+    printf("model %ld %ld %ld %ld %ld %ld %lu %ld %ld\n", ds_entries, ds_ms, sl_entries, sl_ms, refused,
+           bt_wakeups, (unsigned long)wake_max, busy, now());
+    printf("stats %lu %llu %lu %llu %lu %lu %lu %llu", (unsigned long)stats.deep_sleep_entries,
+           (unsigned long long)stats.deep_sleep_ms, (unsigned long)stats.sleep_entries,
+           (unsigned long long)stats.sleep_ms, (unsigned long)stats.refused, (unsigned long)stats.bt_wakeups,
+           (unsigned long)stats.wake_max_cycles, (unsigned long long)stats.wake_sum_cycles);
+    for (uint32_t i = 0; i < APP_BT_LPM_WAKE_BUCKETS; i++)
+    {
+        printf(" %lu", (unsigned long)stats.wake_buckets[i]);
+    }
+    len = app_bt_lpm_serialize(snap, sizeof(snap));
+    printf("\nsnapshot ");
+    for (uint16_t i = 0; i < len; i++)
+    {
+        printf("%02x", snap[i]);
+    }
+    printf("\n");
+    app_bt_lpm_print();
+    return 0;
+}
+"""
+
+
+def decode(hex_text):
+    """Decodes the Power diagnostics characteristic, see APP_BT_LPM_VERSION."""
+    data = bytes.fromhex(hex_text)
+    version, buckets, shift, flags, clock = struct.unpack_from("<BBBBI", data, 0)
+    fields = struct.unpack_from("<8I", data, 8)
+    counts = struct.unpack_from("<%dH" % buckets, data, 40)
+    names = ("total_ms", "deep_sleep_ms", "sleep_ms", "deep_sleep_entries", "sleep_entries",
+             "refused", "bt_wakeups", "wake_max_cycles")
+    snap = dict(zip(names, fields))
+    snap.update(version=version, shift=shift, flags=flags, clock=clock, buckets=list(counts))
+    return snap
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--bt-ms", type=int, nargs="+", default=[15, 50, 250, 1000],
+                        help="host wake periods to run, as connection events with HCI traffic")
+    parser.add_argument("--assert-ms", type=int, default=2, help="host wake asserted per event")
+    parser.add_argument("--busy-ms", type=int, default=1, help="CPU active per wakeup")
+    parser.add_argument("--update-ms", type=int, default=1000, help="battery update period")
+    parser.add_argument("--refuse-pct", type=int, default=5, help="Deep Sleep entries a driver refuses")
+    parser.add_argument("--wake-us", type=int, default=300, help="mean Deep Sleep wakeup to ready time")
+    parser.add_argument("--ds-latency-ms", type=int, default=0, help="APP_BT_LPM_DEEPSLEEP_LATENCY_MS")
+    parser.add_argument("--seconds", type=int, default=3600, help="simulated time")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    failed = 0
+    report = ""
+    print("%6s %7s %7s %9s %9s %7s %8s %8s %8s" %
+          ("bt ms", "DS %", "sleep %", "DS", "sleep", "refused", "bt wake", "wake us", "max us"))
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_lpm.c"], DRIVER,
+                    ["APP_BT_LOW_POWER=1", "APP_BT_LPM_DEEPSLEEP_LATENCY_MS=%d" % args.ds_latency_ms])
+        for bt_ms in args.bt_ms:
+            out = run(exe, args.seconds, args.update_ms, bt_ms, args.assert_ms, args.busy_ms,
+                      args.refuse_pct, args.wake_us)
+            lines = out.splitlines()
+            model = [int(v) for v in lines[0].split()[1:]]
+            stats = [int(v) for v in lines[1].split()[1:]]
+            snap = decode(lines[2].split()[1])
+            report = "\n".join(lines[3:])
+            ds_n, ds_ms, sl_n, sl_ms, refused, bt_wake, wake_max, busy, total = model
+            mhz = snap["clock"] // 1000000
+            print("%6d %6.2f%% %6.2f%% %9d %9d %7d %8d %8.0f %8.0f" %
+                  (bt_ms, ds_ms * 100.0 / total, sl_ms * 100.0 / total, stats[0], stats[2], stats[4],
+                   stats[5], stats[7] / max(stats[0], 1) / mhz, stats[6] / mhz))
+
+            checks = [
+                ("counters", stats[0:6] == [ds_n, ds_ms, sl_n, sl_ms, refused, bt_wake],
+                 "module %s, model %s" % (stats[0:6], [ds_n, ds_ms, sl_n, sl_ms, refused, bt_wake])),
+                ("latency", sum(stats[8:]) == stats[0] and stats[6] == wake_max,
+                 "%d in the buckets, %d entries, longest %d of %d cycles" %
+                 (sum(stats[8:]), stats[0], stats[6], wake_max)),
+                ("snapshot", [snap["deep_sleep_entries"], snap["deep_sleep_ms"], snap["sleep_entries"],
+                              snap["sleep_ms"], snap["refused"], snap["bt_wakeups"],
+                              snap["wake_max_cycles"]] == stats[0:7] and snap["buckets"] == [min(v, 0xFFFF) for v in stats[8:]] and
+                 snap["total_ms"] == total,
+                 "characteristic %s" % snap),
+                ("time", ds_ms + sl_ms + busy == total,
+                 "%d + %d + %d ms of %d" % (ds_ms, sl_ms, busy, total)),
+            ]
+            for name, ok, text in checks:
+                failed += not ok
+                if not ok:
+                    print("%6s FAIL %s: %s" % ("", name, text))
+    print(report.replace("\r", ""))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,340 @@
+#!/usr/bin/env python3
+"""
+Drives the batching and the PDU buffers of app_bt_notify_queue.c with churn.
+
+Builds app_bt_notify_queue.c and app_bt_conn.c on the host (see
+app_host.py). --centrals centrals connect with --mtu; each tick --handles
+characteristics change on every link, are queued with
+app_bt_notify_queue_put() and leave at app_bt_notify_queue_flush(), as in
+bas_task(). The stack model holds every PDU it accepts, in any number, and
+transmits up to --pdus-per-tick of them per tick, oldest first, reporting
+each through app_bt_notify_queue_transmitted(). The peers differ per mode:
+
+    single  No peer sets the Multiple Handle Value Notifications client
+            feature; every value takes a PDU.
+    batch   Every peer sets it; values of a tick share PDUs up to the MTU.
+    refused Every peer sets it but the stack refuses the first multiple
+            notification of each link, which then falls back to single
+            values.
+
+With probability --churn per tick a central disconnects while the stack still
+holds its PDUs, app_bt_notify_queue_close() runs, and a new central takes the
+slot at once. The held PDUs of the old link are transmitted later, as the
+stack reports them after a disconnection.
+
+The table gives, per mode, the values delivered, the PDUs they took and those
+batching saved, the batches refused, the links closed with PDUs in flight
+and the most PDUs any link held at once.
+
+Checks, per mode:
+
+    in-flight   No link ever holds more than APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT
+                PDUs, so a PDU of a closed link is never credited to the next
+                link of the slot.
+    sent        The sent counter equals the values transmitted on open links.
+    newest      Once the stack is idle, every central holds the newest value
+                of every handle.
+    leak        Then every link can again take
+                APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT PDUs at once, so no buffer
+                was lost to a closed link.
+
+    python3 scripts/app_bt_notify_batch_sim.py
+    python3 scripts/app_bt_notify_batch_sim.py --mtu 247 --handles 8 -D APP_BT_NOTIFY_QUEUE_DEPTH=8
+    python3 scripts/app_bt_notify_batch_sim.py --churn 0.2 --pdus-per-tick 1
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+MODES = ["single", "batch", "refused"]
+
+DRIVER = r"""
+#include "app_bt_conn.h"
+#include "app_bt_notify_queue.h"
+#include <FreeRTOS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FIRST_HANDLE    (0x0030u)
+#define MAX_HANDLES     (16)
+#define MAX_HELD        (256)
+
+extern TickType_t app_host_tick;
+
+static const uint16_t cccd_handles[] = { FIRST_HANDLE + 1 };
+
+typedef struct
+{
+    uint16_t conn_id;               /* Current link of the central */
+    uint16_t received[MAX_HANDLES]; /* Last value per handle */
+    int      held;                  /* PDUs the stack holds for the link */
+    int      refused;               /* A multiple notification was refused */
+} central_t;
+
+/* PDUs the stack holds, oldest first, with the link they were sent on */
+static struct { uint16_t conn_id; uint16_t handle; uint16_t len; uint8_t *p_data; int values; } held[MAX_HELD];
+static int       num_held;
+static central_t central[APP_BT_MAX_CONNECTIONS];
+static int       num_centrals;
+static int       refuse;
+static uint16_t  link_mtu;
+static int       held_max;
+static long      pdus;
+static long      sent_open;         /* Values transmitted on open links */
+static uint16_t  next_conn_id = 0x8001;
+static uint32_t  seed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+static central_t *central_of(uint16_t conn_id)
+{
+    for (int c = 0; c < num_centrals; c++)
+    {
+        if (central[c].conn_id == conn_id)
+        {
+            return &central[c];
+        }
+    }
+    return NULL;
+}
+
+/* handle is 0 for a multiple notification */
+static void hold(uint16_t conn_id, uint16_t handle, uint16_t len, uint8_t *p_data, int values)
+{
+    central_t *p_c = central_of(conn_id);
+
+    held[num_held].conn_id = conn_id;
+    held[num_held].handle  = handle;
+    held[num_held].len     = len;
+    held[num_held].p_data  = p_data;
+    held[num_held].values  = values;
+    num_held++;
+    pdus++;
+    p_c->held++;
+    held_max = (p_c->held > held_max) ? p_c->held : held_max;
+}
+
+/* The central reads the values when they are transmitted */
+static void deliver(central_t *p_c, uint16_t handle, const uint8_t *p_val)
+{
+    p_c->received[handle - FIRST_HANDLE] = (uint16_t)(p_val[0] | (p_val[1] << 8));
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t conn_id, uint16_t handle,
+                                                              uint16_t len, uint8_t *p_val, void *p_ctx)
+{
+    (void)p_ctx;
+    hold(conn_id, handle, len, p_val, 1);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_multiple_notifications(uint16_t conn_id, uint16_t len,
+                                                                        uint8_t *p_val, void *p_ctx)
+{
+    central_t *p_c = central_of(conn_id);
+    int        values = 0;
+
+    (void)p_ctx;
+    if (refuse && !p_c->refused)
+    {
+        p_c->refused = 1;
+        return WICED_BT_GATT_REQ_NOT_SUPPORTED;
+    }
+    for (uint16_t i = 0; i + 4 <= len; i += 4 + (p_val[i + 2] | (p_val[i + 3] << 8)))
+    {
+        values++;
+    }
+    hold(conn_id, 0, len, p_val, values);
+    return WICED_BT_GATT_SUCCESS;
+}
+
+static void transmit(int n)
+{
+    central_t *p_c;
+    uint8_t   *p;
+
+    for (; (n > 0) && (num_held > 0); n--)
+    {
+        p   = held[0].p_data;
+        p_c = central_of(held[0].conn_id);
+        /* The PDUs of a closed link never reach a central */
+        if (NULL != p_c)
+        {
+            p_c->held--;
+            sent_open += held[0].values;
+            if (0 != held[0].handle)
+            {
+                deliver(p_c, held[0].handle, p);
+            }
+            for (uint16_t i = 0; (0 == held[0].handle) && (i + 4 <= held[0].len);
+                 i += 4 + (p[i + 2] | (p[i + 3] << 8)))
+            {
+                deliver(p_c, (uint16_t)(p[i] | (p[i + 1] << 8)), &p[i + 4]);
+            }
+        }
+        memmove(&held[0], &held[1], (size_t)(--num_held) * sizeof(held[0]));
+        app_bt_notify_queue_transmitted(p);
+    }
+}
+
+static void connect(central_t *p_c, int multi)
+{
+    uint8_t      addr[6] = { 0x00, 0xA0, 0x50, 0x00, 0x00, (uint8_t)next_conn_id };
+    uint8_t      features = APP_BT_CONN_CLIENT_FEAT_MULTI_NOTIF;
+    wiced_bool_t changed;
+
+    memset(p_c, 0, sizeof(*p_c));
+    p_c->conn_id = next_conn_id++;
+    app_bt_conn_open(p_c->conn_id, addr);
+    app_bt_conn_set_mtu(p_c->conn_id, link_mtu);
+    if (multi)
+    {
+        app_bt_conn_client_features_on_write(p_c->conn_id, NULL, 0, &features, 1);
+    }
+    app_bt_conn_cccd_set(p_c->conn_id, FIRST_HANDLE + 1, GATT_CLIENT_CONFIG_NOTIFICATION, &changed);
+}
+
+int main(int argc, char **argv)
+{
+    int       multi = (0 != strcmp(argv[1], "single"));
+    int       handles = atoi(argv[4]);
+    long      ticks = atol(argv[5]);
+    int       per_tick = atoi(argv[6]);
+    double    churn = atof(argv[7]);
+    uint16_t  newest[MAX_HANDLES] = { 0 };
+    uint16_t  counter = 0;
+    uint8_t   value[2];
+    long      closed_in_flight = 0;
+    int       stale = 0, burst = 0;
+    app_bt_notify_queue_stats_t stats;
+
+    (void)argc;
+    refuse       = (0 == strcmp(argv[1], "refused"));
+    num_centrals = atoi(argv[2]);
+    link_mtu     = (uint16_t)atoi(argv[3]);
+    app_bt_conn_init(cccd_handles, 1);
+    for (int c = 0; c < num_centrals; c++)
+    {
+        connect(&central[c], multi);
+    }
+
+    for (long t = 0; (t < ticks) || (num_held > 0); t++)
+    {
+        app_host_tick = (TickType_t)t;
+        if (t < ticks)
+        {
+            if ((rnd(10000) / 10000.0) < churn)
+            {
+                central_t *p_c = &central[rnd((uint32_t)num_centrals)];
+
+                closed_in_flight += (p_c->held > 0);
+                app_bt_notify_queue_close(p_c->conn_id);
+                app_bt_conn_close(p_c->conn_id);
+                connect(p_c, multi);
+            }
+            for (int h = 0; h < handles; h++)
+            {
+                newest[h] = ++counter;
+                value[0]  = (uint8_t)counter;
+                value[1]  = (uint8_t)(counter >> 8);
+                for (int c = 0; c < num_centrals; c++)
+                {
+                    app_bt_notify_queue_put(central[c].conn_id, (uint16_t)(FIRST_HANDLE + h), value,
+                                            sizeof(value));
+                }
+            }
+            app_bt_notify_queue_flush();
+        }
+        transmit(per_tick);
+    }
+    for (int c = 0; c < num_centrals; c++)
+    {
+        for (int h = 0; h < handles; h++)
+        {
+            stale += (central[c].received[h] != newest[h]);
+        }
+    }
+    app_bt_notify_queue_get_stats(&stats);
+
+    /* Every link fills its PDUs, nothing is transmitted */
+    for (uint32_t n = 0; n < APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT; n++)
+    {
+        for (int h = 0; h < MAX_HANDLES; h++)
+        {
+            for (int c = 0; c < num_centrals; c++)
+            {
+                app_bt_notify_queue_put(central[c].conn_id, (uint16_t)(FIRST_HANDLE + h), value, sizeof(value));
+            }
+            app_bt_notify_queue_flush();
+        }
+    }
+    burst = num_held;
+
+    printf("result %lu %ld %lu %lu %ld %d %ld %d %d\n", (unsigned long)stats.sent, pdus,
+           (unsigned long)(stats.batched - stats.batches), (unsigned long)stats.batch_refused,
+           closed_in_flight, held_max, sent_open, stale, burst);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--modes", nargs="+", choices=MODES, default=MODES, help="peer behaviours to run")
+    parser.add_argument("--centrals", type=int, default=3, help="connected centrals, at most 3")
+    parser.add_argument("--mtu", type=int, default=23, help="ATT MTU of every link")
+    parser.add_argument("--handles", type=int, default=4, help="characteristics changing every tick")
+    parser.add_argument("--ticks", type=int, default=20000, help="ticks with updates")
+    parser.add_argument("--pdus-per-tick", type=int, default=2, help="PDUs the stack transmits per tick")
+    parser.add_argument("--churn", type=float, default=0.02, help="disconnect probability per tick")
+    parser.add_argument("--max-in-flight", type=int, default=2,
+                        help="APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT of the build, for the checks")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    if args.centrals > 3 or args.handles > 16:
+        parser.error("at most 3 centrals and 16 handles")
+
+    failed = 0
+    print("%-8s %9s %7s %7s %8s %7s %6s" %
+          ("mode", "delivered", "pdus", "saved", "refused", "closed", "held"))
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_notify_queue.c", "app_bt_conn.c"], DRIVER)
+        for mode in args.modes:
+            f = run(exe, mode, args.centrals, args.mtu, args.handles, args.ticks, args.pdus_per_tick,
+                    args.churn).split()
+            sent, pdus, saved, refused, closed, held = (int(v) for v in f[1:7])
+            sent_open, stale, burst = (int(v) for v in f[7:10])
+            print("%-8s %9d %7d %7d %8d %7d %6d" % (mode, sent, pdus, saved, refused, closed, held))
+
+            checks = [
+                ("in-flight", held <= args.max_in_flight,
+                 "a link held %d PDUs, at most %d" % (held, args.max_in_flight)),
+                ("sent", sent_open == sent,
+                 "%d values counted sent, %d transmitted on open links" % (sent, sent_open)),
+                ("newest", stale == 0, "%d handles end on an old value" % stale),
+                ("leak", burst == args.centrals * args.max_in_flight,
+                 "%d PDUs taken at once, expected %d" % (burst, args.centrals * args.max_in_flight)),
+            ]
+            if mode == "refused":
+                checks.append(("refused", refused >= args.centrals,
+                               "%d batches refused by %d centrals" % (refused, args.centrals)))
+            for name, ok, text in checks:
+                failed += not ok
+                if not ok:
+                    print("%-8s FAIL %s: %s" % ("", name, text))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
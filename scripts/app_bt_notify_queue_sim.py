@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""
+Drives app_bt_notify_queue.c against a model of a congested link.
+
+Builds app_bt_notify_queue.c and app_bt_conn.c on the host (see
+app_host.py). One central is connected, without the Multiple Handle Value Notifications feature, and
+--handles characteristics each change every --period-ms, queued with
+app_bt_notify_queue_send() as bas_task() does. The stack model holds at
+most --buffers notifications per link and refuses more with
+WICED_BT_GATT_CONGESTED, as the controller does when it runs out of
+buffers. Every connection interval it transmits up to --pdus-per-event of
+them, oldest first. For each one it reports GATT_APP_BUFFER_TRANSMITTED_EVT
+through app_bt_notify_queue_transmitted(), and GATT_CONGESTION_EVT through
+app_bt_notify_queue_congestion() once a refused link has room again.
+
+The central keeps the last value it received per handle, read from the
+buffer when it is transmitted. After --seconds of updates the link runs on
+until the queue is empty. The table gives, per connection interval, the
+values queued, those sent, those replaced by a newer value of the same
+handle before they left, the overflows and the congested sends, the mean
+and the longest time from queued to transmitted, and the most PDUs the
+stack held at once.
+
+    python3 scripts/app_bt_notify_queue_sim.py
+    python3 scripts/app_bt_notify_queue_sim.py --interval-ms 15 100 --handles 8
+    python3 scripts/app_bt_notify_queue_sim.py -D APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT=4 --max-in-flight 4
+
+Exits non-zero if the central does not end with the newest value of every
+handle, or if the stack ever held more than APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT
+notifications. With more --handles than APP_BT_NOTIFY_QUEUE_DEPTH the queue
+refuses values with WICED_BT_GATT_BUSY, and the handles left on a refused
+value are reported but do not fail.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_conn.h"
+#include "app_bt_notify_queue.h"
+#include <FreeRTOS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CONN_ID         (0x8001u)
+#define FIRST_HANDLE    (0x0030u)
+#define MAX_HANDLES     (16)
+#define MAX_HELD        (64)
+
+extern TickType_t app_host_tick;
+
+static const uint16_t cccd_handles[] = { FIRST_HANDLE + 1 };
+
+/* Notifications the stack holds, oldest first */
+static struct { uint16_t handle; uint8_t *p_val; } held[MAX_HELD];
+static int       num_held;
+static int       held_max;
+static int       buffers;
+static int       refused;           /* Congestion reported, not yet cleared */
+static uint16_t  received[MAX_HANDLES];
+
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t conn_id, uint16_t handle,
+                                                              uint16_t len, uint8_t *p_val, void *p_ctx)
+{
+    (void)conn_id; (void)len; (void)p_ctx;
+    if (num_held >= buffers)
+    {
+        refused = 1;
+        return WICED_BT_GATT_CONGESTED;
+    }
+    held[num_held].handle = handle;
+    held[num_held].p_val  = p_val;
+    num_held++;
+    held_max = (num_held > held_max) ? num_held : held_max;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/* One connection event */
+static void transmit(int pdus)
+{
+    uint8_t *p_val;
+
+    for (; (pdus > 0) && (num_held > 0); pdus--)
+    {
+        /* The value leaves the buffer now */
+        received[held[0].handle - FIRST_HANDLE] = (uint16_t)(held[0].p_val[0] | (held[0].p_val[1] << 8));
+        p_val = held[0].p_val;
+        memmove(&held[0], &held[1], (size_t)(--num_held) * sizeof(held[0]));
+        app_bt_notify_queue_transmitted(p_val);
+    }
+    if (refused && (num_held < buffers))
+    {
+        refused = 0;
+        app_bt_notify_queue_congestion(CONN_ID, WICED_FALSE);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int       interval_ms = atoi(argv[1]);
+    int       period_ms = atoi(argv[2]);
+    int       handles = atoi(argv[3]);
+    int       pdus = atoi(argv[4]);
+    long      duration_ms = atol(argv[6]) * 1000L;
+    uint8_t   addr[6] = { 0x00, 0xA0, 0x50, 0x00, 0x00, 0x01 };
+    uint16_t  newest[MAX_HANDLES] = { 0 };
+    uint16_t  counter = 0;
+    uint8_t   value[2];
+    int       stale = 0;
+    long      t;
+    app_bt_notify_queue_stats_t stats;
+
+    (void)argc;
+    buffers = atoi(argv[5]);
+    app_bt_conn_init(cccd_handles, 1);
+    app_bt_conn_open(CONN_ID, addr);
+
+    for (t = 0; (t < duration_ms) || (num_held > 0); t++)
+    {
+        app_host_tick = (TickType_t)t;
+        if ((t < duration_ms) && (0 == (t % period_ms)))
+        {
+            for (int h = 0; h < handles; h++)
+            {
+                newest[h] = ++counter;
+                value[0]  = (uint8_t)counter;
+                value[1]  = (uint8_t)(counter >> 8);
+                app_bt_notify_queue_send(CONN_ID, (uint16_t)(FIRST_HANDLE + h), value, sizeof(value));
+            }
+        }
+        if (0 == (t % interval_ms))
+        {
+            transmit(pdus);
+        }
+    }
+    for (int h = 0; h < handles; h++)
+    {
+        stale += (received[h] != newest[h]);
+    }
+
+    app_bt_notify_queue_get_stats(&stats);
+    printf("result %lu %lu %lu %lu %lu %lu %lu %d %d\n", (unsigned long)stats.queued,
+           (unsigned long)stats.sent, (unsigned long)stats.replaced, (unsigned long)stats.overflows,
+           (unsigned long)stats.congested,
+           (unsigned long)((0 != stats.sent) ? stats.delay_sum_ms / stats.sent : 0),
+           (unsigned long)stats.delay_max_ms, held_max, stale);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--interval-ms", type=int, nargs="+", default=[8, 15, 30, 50, 100],
+                        help="connection intervals to run")
+    parser.add_argument("--period-ms", type=int, default=20, help="update period of every handle")
+    parser.add_argument("--handles", type=int, default=4, help="notifying characteristics, at most 16")
+    parser.add_argument("--pdus-per-event", type=int, default=2, help="notifications sent per connection event")
+    parser.add_argument("--buffers", type=int, default=3, help="controller buffers of the link")
+    parser.add_argument("--seconds", type=int, default=60, help="simulated time with updates")
+    parser.add_argument("--depth", type=int, default=4,
+                        help="APP_BT_NOTIFY_QUEUE_DEPTH of the build, for the check")
+    parser.add_argument("--max-in-flight", type=int, default=2,
+                        help="APP_BT_NOTIFY_QUEUE_MAX_IN_FLIGHT of the build, for the check")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    if args.handles > 16:
+        parser.error("at most 16 handles")
+
+    failed = 0
+    print("%8s %8s %8s %9s %9s %9s %8s %8s %5s" %
+          ("interval", "queued", "sent", "replaced", "overflow", "congested", "avg ms", "max ms", "held"))
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_notify_queue.c", "app_bt_conn.c"], DRIVER)
+        for interval in args.interval_ms:
+            f = run(exe, interval, args.period_ms, args.handles, args.pdus_per_event, args.buffers,
+                    args.seconds).split()
+            overflows, held, stale = int(f[4]), int(f[8]), int(f[9])
+            note = ""
+            if stale and overflows and args.handles > args.depth:
+                # More handles than the queue holds, the caller was told BUSY
+                note += "  %d handles end on a refused value" % stale
+            elif stale:
+                note += "  FAIL: %d handles end on an old value" % stale
+                failed += 1
+            if held > args.max_in_flight:
+                note += "  FAIL: more than %d in flight" % args.max_in_flight
+                failed += 1
+            print("%8d %8s %8s %9s %9s %9s %8s %8s %5s%s" %
+                  (interval, f[1], f[2], f[3], f[4], f[5], f[6], f[7], f[8], note))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
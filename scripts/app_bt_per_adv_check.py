@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+"""
+Checks the periodic advertising broadcast of app_bt_per_adv.c.
+
+Builds app_bt_per_adv.c on the host (see app_host.py) with a driver that
+records every extended and periodic advertising call to the stack, starts
+the broadcast with the advertising data of design.cybt plus a --mfr-len byte
+manufacturer element, then calls app_bt_per_adv_update() every --update-s
+for --hours as bas_task() would: the level drains by one percent every
+--drain-s, the status drops APP_BT_PER_ADV_STATUS_MEASURED now and then, and
+every --refuse-every-th periodic data write is refused. The tick counter
+starts --wrap-s before it wraps.
+
+Checks:
+
+    start     The set is non-connectable and non-scannable, the intervals
+              are the configured ones in 1.25 ms and 0.625 ms units, and
+              the train is started before the set that announces it.
+    ext data  The configured elements in order, those that do not fit
+              APP_BT_PER_ADV_EXT_DATA_MAX left out.
+    train     Each periodic data write carries the Battery Service UUID, the
+              level and status of the update, LOW at or below
+              APP_BT_PER_ADV_LOW_PCT, and the next sequence number. Repeats
+              write nothing, refused values are retried at the next update,
+              and the counters agree.
+    airtime   The PDU times match the PDU sizes worked out here, and the
+              transmit time over the run is within 0.2 % of an event by event
+              count with random advDelay.
+
+    python3 scripts/app_bt_per_adv_check.py
+    python3 scripts/app_bt_per_adv_check.py -D APP_BT_PER_ADV_INTERVAL_MS=100 -D APP_BT_PER_ADV_SECONDARY_2M=1
+    python3 scripts/app_bt_per_adv_check.py --mfr-len 80 --refuse-every 3 --hours 72
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import random
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_per_adv.h"
+#include <FreeRTOS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern TickType_t app_host_tick;
+
+static int refuse_every;
+static int writes;
+
+static void dump(const uint8_t *p, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        printf("%02x", p[i]);
+    }
+    printf("\n");
+}
+
+wiced_result_t wiced_bt_ble_set_ext_adv_parameters_v2(wiced_bt_ble_ext_adv_handle_t h, wiced_bt_ble_ext_adv_event_property_t prop,
+                                                      uint32_t int_min, uint32_t int_max, uint8_t chnl_map,
+                                                      uint8_t own_type, uint8_t peer_type, wiced_bt_device_address_t peer,
+                                                      uint8_t policy, int8_t tx_power,
+                                                      wiced_bt_ble_ext_adv_phy_t phy1, uint8_t skip, wiced_bt_ble_ext_adv_phy_t phy2,
+                                                      uint8_t sid, uint8_t notify, wiced_bt_ble_ext_adv_phy_options_t o1,
+                                                      wiced_bt_ble_ext_adv_phy_options_t o2)
+{
+    (void)chnl_map; (void)own_type; (void)peer_type; (void)peer; (void)policy; (void)tx_power;
+    (void)skip; (void)notify; (void)o1; (void)o2;
+    printf("call params %u %u %lu %lu %u %u %u\n", h, prop, (unsigned long)int_min,
+           (unsigned long)int_max, phy1, phy2, sid);
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_ext_adv_data(wiced_bt_ble_ext_adv_handle_t h, uint16_t len, uint8_t *p)
+{
+    printf("call ext_data %u ", h);
+    dump(p, len);
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_periodic_adv_params(wiced_bt_ble_ext_adv_handle_t h, uint16_t int_min,
+                                                    uint16_t int_max, wiced_bt_ble_periodic_adv_prop_t prop)
+{
+    printf("call per_params %u %u %u %u\n", h, int_min, int_max, prop);
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_set_periodic_adv_data(wiced_bt_ble_ext_adv_handle_t h, uint16_t len, uint8_t *p)
+{
+    if ((0 != refuse_every) && (0 == (++writes % refuse_every)))
+    {
+        printf("refused %lu\n", (unsigned long)app_host_tick);
+        return WICED_BT_ERROR;
+    }
+    printf("call per_data %u ", h);
+    dump(p, len);
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_ble_start_periodic_adv(wiced_bt_ble_ext_adv_handle_t h, uint8_t enable)
+{
+    printf("call start_per %u %u\n", h, enable);
+    return WICED_BT_PENDING;
+}
+
+wiced_result_t wiced_bt_ble_start_ext_adv(uint8_t enable, uint8_t num, wiced_bt_ble_ext_adv_duration_config_t *p)
+{
+    printf("call start_ext %u %u %u %u %u\n", enable, num, p->adv_handle, p->adv_duration,
+           p->max_ext_adv_events);
+    return WICED_BT_SUCCESS;
+}
+
+/* argv: seconds, update period s, drain period s, refuse every, seconds
+ * before the tick wraps, seed, then the advertising elements as
+ * <type>:<hex> */
+int main(int argc, char **argv)
+{
+    static wiced_bt_ble_advert_elem_t elems[16];
+    static uint8_t                    data[16][255];
+    uint32_t seconds = (uint32_t)atol(argv[1]);
+    uint32_t update_s = (uint32_t)atol(argv[2]);
+    uint32_t drain_s = (uint32_t)atol(argv[3]);
+    uint32_t seed = (uint32_t)atol(argv[6]);
+    uint8_t  n = 0;
+    uint8_t  level = 100, status;
+    unsigned value;
+    app_bt_per_adv_stats_t stats;
+
+    refuse_every = atoi(argv[4]);
+    app_host_tick = (TickType_t)(0u - (uint32_t)atol(argv[5]) * 1000u);
+    for (int i = 7; i < argc; i++, n++)
+    {
+        char *p = strchr(argv[i], ':') + 1;
+
+        elems[n].advert_type = (wiced_bt_ble_advert_type_t)strtoul(argv[i], NULL, 16);
+        elems[n].len = (uint16_t)(strlen(p) / 2u);
+        for (uint16_t j = 0; j < elems[n].len; j++)
+        {
+            sscanf(&p[2u * j], "%2x", &value);
+            data[n][j] = (uint8_t)value;
+        }
+        elems[n].p_data = data[n];
+    }
+    printf("config %u %u %u %u %u %u %u\n", APP_BT_PER_ADV_INTERVAL_MS, APP_BT_PER_ADV_EXT_INTERVAL_MS,
+           APP_BT_PER_ADV_SECONDARY_2M, APP_BT_PER_ADV_HANDLE, APP_BT_PER_ADV_SID,
+           APP_BT_PER_ADV_LOW_PCT, APP_BT_PER_ADV_EXT_DATA_MAX);
+
+    printf("start %d\n", (int)app_bt_per_adv_start(elems, n, level, APP_BT_PER_ADV_STATUS_MEASURED));
+    for (uint32_t s = update_s; s <= seconds; s += update_s)
+    {
+        app_host_tick += update_s * 1000u;
+        level  = (uint8_t)((s / drain_s < 100u) ? 100u - s / drain_s : 0u);
+        seed   = seed * 1103515245u + 12345u;
+        status = (0 == (seed >> 16) % 10) ? 0 : APP_BT_PER_ADV_STATUS_MEASURED;
+        printf("update %lu %u %u\n", (unsigned long)app_host_tick, level, status);
+        app_bt_per_adv_update(level, status);
+    }
+
+    app_bt_per_adv_get_stats(&stats);
+    printf("result %lu %lu %lu %u %u %u %u %u %u %u %lu %llu %llu\n",
+           (unsigned long)stats.updates, (unsigned long)stats.unchanged, (unsigned long)stats.failed,
+           stats.level, stats.status, stats.seq, stats.ext_data_len, stats.primary_us, stats.aux_us,
+           stats.sync_us, (unsigned long)stats.tx_us_per_s, (unsigned long long)stats.elapsed_ms,
+           (unsigned long long)stats.tx_us);
+    return 0;
+}
+"""
+
+STATUS_MEASURED = 0x01
+STATUS_LOW = 0x02
+PDU_OVERHEAD = 1 + 4 + 2 + 3        # preamble, access address, header, CRC on LE 1M
+EXT_IND_HDR = 1 + 1 + 2 + 3         # length and mode, flags, ADI, AuxPtr
+AUX_ADV_IND_HDR = 1 + 1 + 6 + 2 + 18  # length and mode, flags, AdvA, ADI, SyncInfo
+AUX_SYNC_IND_HDR = 1                # length and mode, no fields
+PER_DATA_LEN = 7
+
+
+def pdu_us(payload, two_m):
+    return (PDU_OVERHEAD + 1 + payload) * 4 if two_m else (PDU_OVERHEAD + payload) * 8
+
+
+def design_elements(mfr_len):
+    uuid = bytes.fromhex("66984d87820644caac8d2a7ea4ab45f4")[::-1]
+    elems = [(0x01, b"\x06"), (0x09, b"Battery Server"), (0x07, uuid), (0x19, b"\x00\x00")]
+    if mfr_len:
+        elems.append((0xFF, bytes(range(mfr_len))))
+    return elems
+
+
+def event_count_tx_us(elapsed_ms, ext_units, per_units, ext_us, sync_us, rng):
+    """Transmit time counted event by event, advDelay drawn at random."""
+    total, t = 0, rng.uniform(0.0, ext_units * 625.0)
+    while t < elapsed_ms * 1000.0:
+        total += ext_us
+        t += ext_units * 625.0 + rng.uniform(0.0, 10000.0)
+    return total + int(elapsed_ms * 1000 // (per_units * 1250)) * sync_us
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--hours", type=float, default=24.0, help="broadcast time")
+    parser.add_argument("--update-s", type=int, default=10, help="bas_task() update period")
+    parser.add_argument("--drain-s", type=int, default=600, help="seconds per percent of level")
+    parser.add_argument("--refuse-every", type=int, default=7, help="refuse every nth data write, 0 for never")
+    parser.add_argument("--wrap-s", type=int, default=3600, help="seconds from the start to the tick wrap")
+    parser.add_argument("--mfr-len", type=int, default=40, help="manufacturer data bytes, 0 for none")
+    parser.add_argument("--seed", type=int, default=1)
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    elems = design_elements(args.mfr_len)
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_per_adv.c"], DRIVER)
+        out = run(exe, int(args.hours * 3600), args.update_s, args.drain_s, args.refuse_every,
+                  args.wrap_s, args.seed, *["%02x:%s" % (t, d.hex()) for t, d in elems])
+
+    calls, updates, refused = [], [], set()
+    for line in out.splitlines():
+        f = line.split()
+        if f[0] == "config":
+            per_ms, ext_ms, two_m, handle, sid, low_pct, ext_max = (int(v) for v in f[1:])
+        elif f[0] == "call":
+            calls.append(f[1:])
+        elif f[0] == "update":
+            updates.append(tuple(int(v) for v in f[1:]))
+        elif f[0] == "refused":
+            refused.add(int(f[1]))
+        elif f[0] == "result":
+            result = [int(v) for v in f[1:]]
+    per_units = (per_ms * 4 + 2) // 5
+    ext_units = (ext_ms * 8 + 2) // 5
+    problems = {"start": [], "ext data": [], "train": [], "airtime": []}
+
+    # Start: the sequence and the parameters of each call
+    names = [c[0] for c in calls[:6]]
+    if names != ["params", "ext_data", "per_params", "per_data", "start_per", "start_ext"]:
+        problems["start"].append("calls %s" % " ".join(names))
+    else:
+        p = [int(v) for v in calls[0][1:]]
+        if p != [handle, 0, ext_units, ext_units, 1, 2 if two_m else 1, sid]:
+            problems["start"].append("set parameters %s" % p)
+        if [int(v) for v in calls[2][1:]] != [handle, per_units, per_units, 0]:
+            problems["start"].append("periodic parameters %s" % calls[2][1:])
+        if calls[4][1:] != [str(handle), "1"] or calls[5][1:] != ["1", "1", str(handle), "0", "0"]:
+            problems["start"].append("enable %s, %s" % (calls[4][1:], calls[5][1:]))
+
+    # Extended advertising data: the elements that fit, in order
+    expected = b""
+    for t, d in elems:
+        if len(expected) + len(d) + 2 <= ext_max:
+            expected += bytes([len(d) + 1, t]) + d
+    ext_data = bytes.fromhex(calls[1][2]) if len(calls) > 1 and len(calls[1]) > 2 else b""
+    if ext_data != expected:
+        problems["ext data"].append("%d bytes, expected %d" % (len(ext_data), len(expected)))
+
+    # Train: one write per new value, retried after a refusal
+    writes = [bytes.fromhex(c[2]) for c in calls if c[0] == "per_data"]
+    level, status, seq = 100, STATUS_MEASURED | (STATUS_LOW if 100 <= low_pct else 0), 0
+    want = [bytes([6, 0x16, 0x0F, 0x18, level, status, seq])]
+    counts = [0, 0, 0]
+    for tick, new_level, new_status in updates:
+        new_status |= STATUS_LOW if new_level <= low_pct else 0
+        if (new_level, new_status) == (level, status):
+            counts[1] += 1
+        elif tick in refused:
+            counts[2] += 1
+        else:
+            counts[0] += 1
+            level, status, seq = new_level, new_status, (seq + 1) & 0xFF
+            want.append(bytes([6, 0x16, 0x0F, 0x18, level, status, seq]))
+    if writes != want:
+        first = next((i for i, (a, b) in enumerate(zip(writes, want)) if a != b), min(len(writes), len(want)))
+        problems["train"].append("%d writes, expected %d, first difference at write %d" %
+                                 (len(writes), len(want), first))
+    if result[:6] != counts + [level, status, seq]:
+        problems["train"].append("updates, unchanged, failed, level, status, seq %s, expected %s" %
+                                 (result[:6], counts + [level, status, seq]))
+
+    # Airtime: PDU sizes, then the total against an event by event count
+    ext_len, primary_us, aux_us, sync_us, tx_us_per_s, elapsed_ms, tx_us = result[6:]
+    pdus = [len(expected), 3 * pdu_us(EXT_IND_HDR, False), pdu_us(AUX_ADV_IND_HDR + len(expected), two_m),
+            pdu_us(AUX_SYNC_IND_HDR + PER_DATA_LEN, two_m)]
+    if [ext_len, primary_us, aux_us, sync_us] != pdus:
+        problems["airtime"].append("data bytes and PDU times %s, expected %s" %
+                                   ([ext_len, primary_us, aux_us, sync_us], pdus))
+    run_ms = updates[-1][0] - updates[0][0] + args.update_s * 1000 if updates else 0
+    run_ms = (run_ms + (1 << 32)) % (1 << 32)
+    if elapsed_ms != run_ms:
+        problems["airtime"].append("elapsed %d ms, the run took %d ms" % (elapsed_ms, run_ms))
+    counted = event_count_tx_us(elapsed_ms, ext_units, per_units, primary_us + aux_us, sync_us,
+                                random.Random(args.seed))
+    if counted and abs(tx_us - counted) > counted / 500:
+        problems["airtime"].append("transmit %d us, counted %d us" % (tx_us, counted))
+    per_s = (primary_us + aux_us) * 1e6 / (ext_units * 625 + 5000) + sync_us * 1e6 / (per_units * 1250)
+    if abs(tx_us_per_s - per_s) > 1:
+        problems["airtime"].append("%d us/s, expected %.1f" % (tx_us_per_s, per_s))
+
+    print("periodic every %.2f ms, extended every %.3f ms, secondary PHY LE %s" %
+          (per_units * 1.25, ext_units * 0.625, "2M" if two_m else "1M"))
+    print("%d updates: %d written, %d unchanged, %d refused" % (len(updates), counts[0], counts[1], counts[2]))
+    print("airtime: ADV_EXT_IND x3 %d us, AUX_ADV_IND %d us, AUX_SYNC_IND %d us, %d us/s (%.3f %% duty)" %
+          (primary_us, aux_us, sync_us, tx_us_per_s, tx_us_per_s / 1e4))
+    print("         %d ms over %.1f h, counted %d ms" % (tx_us // 1000, elapsed_ms / 3.6e6, counted // 1000))
+    failed = 0
+    for check, texts in problems.items():
+        failed += len(texts)
+        print("%-4s %s" % ("ok" if not texts else "FAIL", check))
+        for text in texts:
+            print("       %s" % text)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+Times long writes through app_bt_gatt_prep_write.c and checks they are atomic.
+
+Builds app_bt_gatt_prep_write.c and app_bt_gatt_db.c on the host (see
+app_host.py) with a driver that serves Prepare Write and Execute Write
+Requests the way app_bt_gatt_req_handler() does, committing through
+app_bt_gatt_db_write() as app_bt_set_value() does.
+
+A long write of --len bytes is split by the client into Prepare Write
+Requests of MTU - 5 bytes each and one Execute Write Request. The client
+waits for each response before the next request, so every request takes a
+connection event at best. For each --mtu the table gives the requests, the
+ATT bytes both ways (the Prepare Write Response echoes the fragment), the
+time on the link at --conn-interval-ms and the resulting throughput, and
+the host time app_bt_gatt_prep_write_queue() and _execute() take for the
+whole value.
+
+Then the atomicity checks run:
+
+    hooked      A prepared write to an attribute with hooks is refused with
+                WRITE_NOT_PERMIT at prepare time, and its hook never runs.
+    rollback    A queue of two values, the second longer than its attribute,
+                fails on execute and leaves the first value untouched.
+
+    python3 scripts/app_bt_prep_write_bench.py
+    python3 scripts/app_bt_prep_write_bench.py --len 512 --mtu 23 185 247
+    python3 scripts/app_bt_prep_write_bench.py --conn-interval-ms 7.5
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_gatt_db.h"
+#include "app_bt_gatt_prep_write.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LONG_HANDLE     (0x0001u)
+#define SHORT_HANDLE    (0x0002u)
+#define HOOKED_HANDLE   (0x0003u)
+#define OTHER_HANDLE    (0x0004u)
+#define CONN_ID         (0x8001u)
+
+static uint8_t         long_value[APP_BT_GATT_PREP_WRITE_ARENA_SIZE];
+static uint8_t         short_value[16];
+static uint8_t         hooked_value[2];
+static uint8_t         other_value[8];
+gatt_db_lookup_table_t app_gatt_db_ext_attr_tbl[] =
+{
+    { LONG_HANDLE,   sizeof(long_value),   0, long_value   },
+    { SHORT_HANDLE,  sizeof(short_value),  0, short_value  },
+    { HOOKED_HANDLE, sizeof(hooked_value), 0, hooked_value },
+    { OTHER_HANDLE,  sizeof(other_value),  0, other_value  },
+};
+const uint16_t app_gatt_db_ext_attr_tbl_size = sizeof(app_gatt_db_ext_attr_tbl) / sizeof(app_gatt_db_ext_attr_tbl[0]);
+
+static int hook_calls;
+
+static wiced_bt_gatt_status_t hooked_on_write(uint16_t conn_id, wiced_bt_gatt_event_data_t *p_data,
+                                              uint16_t handle, uint8_t *p_val, uint16_t len)
+{
+    (void)conn_id; (void)p_data; (void)handle; (void)p_val; (void)len;
+    hook_calls++;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+static const app_bt_gatt_attr_hooks_t hooks[] =
+{
+    { HOOKED_HANDLE, 0, NULL, hooked_on_write, NULL },
+};
+
+/* As app_bt_set_value() */
+static wiced_bt_gatt_status_t commit(uint16_t conn_id, wiced_bt_gatt_event_data_t *p_data,
+                                     uint16_t handle, uint8_t *p_val, uint16_t len)
+{
+    return app_bt_gatt_db_write(conn_id, p_data, handle, p_val, len);
+}
+
+/* Prepare Write Requests of up to frag bytes from offset 0, then execute */
+static wiced_bt_gatt_status_t long_write(uint16_t handle, uint8_t *p_val, uint16_t len, uint16_t frag,
+                                         int *p_requests)
+{
+    wiced_bt_gatt_write_req_t req;
+    wiced_bt_gatt_status_t    status;
+    uint16_t                  error_handle;
+    uint8_t                  *p_echo;
+
+    *p_requests = 0;
+    for (uint16_t offset = 0; offset < len; offset += frag)
+    {
+        req.handle  = handle;
+        req.offset  = offset;
+        req.val_len = ((len - offset) < frag) ? (uint16_t)(len - offset) : frag;
+        req.p_val   = p_val + offset;
+        (*p_requests)++;
+        status = app_bt_gatt_prep_write_queue(CONN_ID, &req, &p_echo);
+        if (WICED_BT_GATT_SUCCESS != status)
+        {
+            /* The client gives up and cancels the queue */
+            app_bt_gatt_prep_write_execute(CONN_ID, GATT_PREP_WRITE_CANCEL, commit, &error_handle);
+            return status;
+        }
+        if (0 != memcmp(p_echo, req.p_val, req.val_len))
+        {
+            return WICED_BT_GATT_ERROR;
+        }
+    }
+    (*p_requests)++;
+    return app_bt_gatt_prep_write_execute(CONN_ID, GATT_PREP_WRITE_EXEC, commit, &error_handle);
+}
+
+static long long elapsed(struct timespec *p_t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (long long)(t1.tv_sec - p_t0->tv_sec) * 1000000000LL + (t1.tv_nsec - p_t0->tv_nsec);
+}
+
+static int bench(uint16_t len, uint16_t mtu, int repeat)
+{
+    uint8_t         value[APP_BT_GATT_PREP_WRITE_ARENA_SIZE];
+    int             requests = 0;
+    int             status = 0;
+    struct timespec t0;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        value[i] = (uint8_t)(i * 7);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; (r < repeat) && (0 == status); r++)
+    {
+        value[0] = (uint8_t)r;
+        status = long_write(LONG_HANDLE, value, len, (uint16_t)(mtu - 5), &requests);
+    }
+    if ((0 == status) && (app_gatt_db_ext_attr_tbl[0].cur_len != len || 0 != memcmp(long_value, value, len)))
+    {
+        status = WICED_BT_GATT_ERROR;
+    }
+    printf("bench %d %d %lld\n", status, requests, elapsed(&t0) / repeat);
+    return 0;
+}
+
+static int check_hooked(void)
+{
+    uint8_t value[2] = { 0x01, 0x00 };
+    int     requests;
+
+    hook_calls = 0;
+    printf("hooked 0x%02x %d\n", long_write(HOOKED_HANDLE, value, sizeof(value), 18, &requests), hook_calls);
+    return 0;
+}
+
+static int check_rollback(void)
+{
+    uint8_t                   first[4] = { 0xA1, 0xA2, 0xA3, 0xA4 };
+    uint8_t                   second[sizeof(other_value) + 1] = { 0 };
+    uint8_t                   before[sizeof(short_value)];
+    uint16_t                  before_len = app_gatt_db_ext_attr_tbl[1].cur_len;
+    wiced_bt_gatt_write_req_t req;
+    wiced_bt_gatt_status_t    status;
+    uint16_t                  error_handle;
+    uint8_t                  *p_echo;
+
+    memcpy(before, short_value, sizeof(before));
+    req = (wiced_bt_gatt_write_req_t){ SHORT_HANDLE, 0, sizeof(first), first };
+    app_bt_gatt_prep_write_queue(CONN_ID, &req, &p_echo);
+    req = (wiced_bt_gatt_write_req_t){ OTHER_HANDLE, 0, sizeof(second), second };
+    app_bt_gatt_prep_write_queue(CONN_ID, &req, &p_echo);
+    status = app_bt_gatt_prep_write_execute(CONN_ID, GATT_PREP_WRITE_EXEC, commit, &error_handle);
+
+    printf("rollback 0x%02x 0x%04x %d\n", status, error_handle,
+           (before_len == app_gatt_db_ext_attr_tbl[1].cur_len) && (0 == memcmp(before, short_value, sizeof(before))));
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    app_bt_gatt_db_index_init(hooks, sizeof(hooks) / sizeof(hooks[0]));
+
+    if (0 == strcmp(argv[1], "bench"))
+    {
+        return bench((uint16_t)atoi(argv[2]), (uint16_t)atoi(argv[3]), atoi(argv[4]));
+    }
+    if (0 == strcmp(argv[1], "hooked"))
+    {
+        return check_hooked();
+    }
+    if (0 == strcmp(argv[1], "rollback"))
+    {
+        return check_rollback();
+    }
+    return 1;
+}
+"""
+
+WRITE_NOT_PERMIT = 0x03
+INVALID_ATTR_LEN = 0x0D
+OTHER_HANDLE = 0x0004
+L2CAP = 4
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--len", type=int, default=512, help="value length, up to the arena size")
+    parser.add_argument("--mtu", type=int, nargs="+", default=[23, 65, 185, 247])
+    parser.add_argument("--conn-interval-ms", type=float, default=30.0)
+    parser.add_argument("--repeat", type=int, default=20000, help="timed long writes")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(args, tmp, ["app_bt_gatt_db.c", "app_bt_gatt_prep_write.c"], DRIVER)
+
+        print("%6s %6s %9s %10s %10s %10s %12s" %
+              ("len", "mtu", "requests", "att bytes", "link ms", "bytes/s", "host ns"))
+        for mtu in args.mtu:
+            f = run(exe, "bench", args.len, mtu, args.repeat).split()
+            status, requests, host_ns = int(f[1]), int(f[2]), int(f[3])
+            if status != 0:
+                print("%6d %6d long write failed with status 0x%02x" % (args.len, mtu, status))
+                return 1
+            frags = requests - 1
+            # Prepare Write Request and its echo carry handle and offset, execute the flag
+            att_bytes = 2 * (frags * 5 + args.len) + 2 + 1 + 2 * L2CAP * requests
+            link_ms = requests * args.conn_interval_ms
+            print("%6d %6d %9d %10d %10.1f %10.0f %12s" %
+                  (args.len, mtu, requests, att_bytes, link_ms, args.len * 1000.0 / link_ms, host_ns))
+
+        f = run(exe, "hooked").split()
+        status, calls = int(f[1], 0), int(f[2])
+        ok = status == WRITE_NOT_PERMIT and calls == 0
+        failed += not ok
+        print("%-4s hooked: prepare status 0x%02x, %d hook calls" % ("ok" if ok else "FAIL", status, calls))
+
+        f = run(exe, "rollback").split()
+        status, handle, intact = int(f[1], 0), int(f[2], 0), int(f[3])
+        ok = status == INVALID_ATTR_LEN and handle == OTHER_HANDLE and intact
+        failed += not ok
+        print("%-4s rollback: execute status 0x%02x on 0x%04x, first value %s" %
+              ("ok" if ok else "FAIL", status, handle, "untouched" if intact else "written"))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
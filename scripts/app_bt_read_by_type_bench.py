@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""
+Times Read By Type discovery through the type index of app_bt_gatt_db.c.
+
+Builds app_bt_gatt_db.c on the host (see app_host.py) once per database
+size. The driver stands in for the stack database with a list of that many
+attributes: a primary service declaration every 25 handles and then
+characteristics of three attributes each, the declaration, the value and a
+client configuration descriptor. The last value is the Battery Level.
+wiced_bt_gatt_find_handle_by_type() walks that list from the first
+attribute on every call, as the stack does, and counts the attributes it
+visits.
+
+A discovery is the sequence of Read By Type Requests a client sends for one
+type over the whole handle range, each answered with as many handle and
+value pairs as fit in --mtu, the next starting one past the last handle
+returned. It runs as app_bt_gatt_req_read_by_type_handler() does, once with
+app_bt_gatt_db_find_handle_by_type() and once with the stack lookup the
+index replaced:
+
+    characteristic  0x2803, characteristic discovery, a third of the database
+    battery         0x2A19, Read Using Characteristic UUID, a single match
+
+    python3 scripts/app_bt_read_by_type_bench.py
+    python3 scripts/app_bt_read_by_type_bench.py --attrs 100 500 --mtu 247
+    python3 scripts/app_bt_read_by_type_bench.py --attrs 1000 -D APP_BT_GATT_DB_MAX_HANDLE=0x3FF
+
+A type with more handles than APP_BT_GATT_DB_UUID_INDEX_HANDLES left is not
+indexed and goes to the stack, and the "index visit" column shows its walks.
+The first discovery also pays for building the entry of its type, one walk
+of the list, which the "build" column counts separately.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+TYPES = {"characteristic": 0x2803, "battery": 0x2A19}
+
+DRIVER = r"""
+#include "app_bt_gatt_db.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+gatt_db_lookup_table_t app_gatt_db_ext_attr_tbl[1];
+const uint16_t         app_gatt_db_ext_attr_tbl_size = 0;
+
+static uint16_t types[ATTRS + 1];
+static long     visited;
+
+uint16_t wiced_bt_gatt_find_handle_by_type(uint16_t s_handle, uint16_t e_handle, wiced_bt_uuid_t *p_uuid)
+{
+    for (uint16_t handle = 1; (handle <= ATTRS) && (handle <= e_handle); handle++)
+    {
+        visited++;
+        if ((handle >= s_handle) && (types[handle] == p_uuid->uu.uuid16))
+        {
+            return handle;
+        }
+    }
+    return 0;
+}
+
+typedef uint16_t (*find_t)(uint16_t, uint16_t, wiced_bt_uuid_t *);
+
+/* One discovery: requests of up to per_rsp matches until nothing is left */
+static int discover(find_t find, wiced_bt_uuid_t *p_uuid, int per_rsp, int *p_requests)
+{
+    uint16_t s_handle = 1;
+    uint16_t handle;
+    int      found = 0;
+    int      in_rsp;
+
+    *p_requests = 0;
+    do
+    {
+        (*p_requests)++;
+        in_rsp = 0;
+        handle = s_handle;
+        while ((in_rsp < per_rsp) && ((handle = find(handle, 0xFFFF, p_uuid)) != 0))
+        {
+            in_rsp++;
+            s_handle = ++handle;
+        }
+        found += in_rsp;
+    } while (in_rsp == per_rsp);
+    return found;
+}
+
+static long long elapsed(struct timespec *p_t0)
+{
+    struct timespec t1;
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return (long long)(t1.tv_sec - p_t0->tv_sec) * 1000000000LL + (t1.tv_nsec - p_t0->tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    wiced_bt_uuid_t uuid = { .len = LEN_UUID_16, .uu.uuid16 = (uint16_t)strtol(argv[1], NULL, 0) };
+    int             pair_len = atoi(argv[2]);
+    int             mtu = atoi(argv[3]);
+    int             repeat = atoi(argv[4]);
+    int             per_rsp = (mtu - 2) / pair_len;
+    int             found_index, found_stack = 0, requests;
+    long            build_visits, index_visits, stack_visits;
+    long long       index_ns, stack_ns;
+    struct timespec t0;
+
+    (void)argc;
+    for (uint16_t handle = 1, k = 0; handle <= ATTRS; handle++)
+    {
+        if (1 == (handle % 25))
+        {
+            types[handle] = 0x2800;
+            k = 0;
+            continue;
+        }
+        types[handle] = (0 == (k % 3)) ? 0x2803 : (1 == (k % 3)) ? (uint16_t)(0x2A00 + handle) : 0x2902;
+        k++;
+    }
+    /* The last characteristic value is the Battery Level */
+    for (uint16_t handle = ATTRS; handle > 0; handle--)
+    {
+        if ((types[handle] != 0x2800) && (types[handle] != 0x2803) && (types[handle] != 0x2902))
+        {
+            types[handle] = 0x2A19;
+            break;
+        }
+    }
+    app_bt_gatt_db_index_init(NULL, 0);
+
+    visited = 0;
+    found_index = discover(app_bt_gatt_db_find_handle_by_type, &uuid, per_rsp, &requests);
+    build_visits = visited;
+
+    visited = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < repeat; i++)
+    {
+        discover(app_bt_gatt_db_find_handle_by_type, &uuid, per_rsp, &requests);
+    }
+    index_ns = elapsed(&t0) / repeat;
+    index_visits = visited / repeat;
+
+    visited = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < repeat; i++)
+    {
+        found_stack = discover(wiced_bt_gatt_find_handle_by_type, &uuid, per_rsp, &requests);
+    }
+    stack_ns = elapsed(&t0) / repeat;
+    stack_visits = visited / repeat;
+
+    printf("result %d %d %d %ld %ld %ld %lld %lld\n", found_index, found_stack, requests,
+           build_visits, index_visits, stack_visits, index_ns, stack_ns);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--attrs", type=int, nargs="+", default=[10, 50, 100, 250, 500],
+                        help="database sizes to build")
+    parser.add_argument("--type", choices=sorted(TYPES), nargs="+",
+                        default=["characteristic", "battery"])
+    parser.add_argument("--mtu", type=int, default=23)
+    parser.add_argument("--repeat", type=int, default=2000, help="timed discoveries")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    # Handle and value: properties, value handle and 16-bit UUID, or the level
+    pair_len = {"characteristic": 2 + 5, "battery": 2 + 1}
+    print("%-15s %6s %8s %9s %7s %12s %12s %12s %12s" %
+          ("type", "attrs", "matches", "requests", "build", "index visit", "stack visit",
+           "index ns", "stack ns"))
+    with tempfile.TemporaryDirectory() as tmp:
+        for attrs in args.attrs:
+            exe = build(args, tmp, ["app_bt_gatt_db.c"], DRIVER, ["ATTRS=%d" % attrs])
+            for name in args.type:
+                f = run(exe, TYPES[name], pair_len[name], args.mtu, args.repeat).split()
+                found_index, found_stack, requests = int(f[1]), int(f[2]), int(f[3])
+                if found_index != found_stack:
+                    print("%-15s %6d index found %d, stack %d" % (name, attrs, found_index, found_stack))
+                    return 1
+                # Visits during the timed runs mean the type did not fit in the index
+                index_visits = int(f[5]) if int(f[5]) else "-"
+                print("%-15s %6d %8d %9d %7s %12s %12s %12s %12s" %
+                      (name, attrs, found_index, requests, f[4], index_visits, f[6], f[7], f[8]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""
+Runs app_bt_sched.c against a software timer and a connection event model.
+
+Builds app_bt_sched.c and app_bt_conn.c on the host (see app_host.py), once
+as is and once with APP_BT_SCHED_CONN_ALIGN=1. The driver plays the FreeRTOS
+timer task: an auto-reload timer whose expiry calls the callback, reloads
+from the previous expiry and restarts from now on xTimerChangePeriod(), as
+in timers.c. A central connects after --open-ms with --interval-ms and
+--latency; its connection events drift by --drift-ppm against the local
+clock. Every --peer-rx-s a request of the peer arrives in a connection
+event and app_bt_sched_conn_event() runs, as the GATT handlers do. The
+central disconnects two thirds through --seconds. Then the timer task is
+held up for two and a half periods once.
+
+The table gives, per build and connection interval, the wakeups, those
+aligned to a connection event and those left nominal for a stale anchor,
+the mean period, the mean and largest shift off the nominal time, and the
+aligned wakeups that missed the lead window before an event.
+
+Checks:
+
+    period  The mean period while connected is the nominal one, within half
+            a connection interval over the run.
+    nominal Without alignment, and after the disconnection, every wakeup
+            that was not moved is exactly one period after the one before.
+    window  Every aligned wakeup falls APP_BT_SCHED_LEAD_US, plus one tick
+            and the drift over the anchor age, before a connection event.
+    stale   Without peer requests (--peer-rx-s 0) the wakeups go back to
+            nominal once the anchor is older than
+            APP_BT_SCHED_ANCHOR_MAX_AGE_MS.
+    holdup  After the timer task was held up, the next wakeup comes at most
+            one period later.
+
+    python3 scripts/app_bt_sched_check.py
+    python3 scripts/app_bt_sched_check.py --interval-ms 30 --latency 4 --drift-ppm 100
+    python3 scripts/app_bt_sched_check.py --peer-rx-s 0
+
+Exits non-zero if a check fails.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+DRIVER = r"""
+#include "app_bt_conn.h"
+#include "app_bt_sched.h"
+#include "wiced_bt_ble.h"
+#include <FreeRTOS.h>
+#include <timers.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CONN_ID     (0x8001u)
+
+extern TickType_t app_host_tick;
+
+static const uint16_t cccd_handles[] = { 0x002Bu };
+static uint8_t        peer[6] = { 0x00, 0xA0, 0x50, 0x00, 0x00, 0x01 };
+
+/* The update timer */
+static TimerCallbackFunction_t timer_cb;
+static TickType_t              timer_period;
+static TickType_t              timer_expiry;
+static int                     timer_running;
+
+/* The link */
+static uint16_t conn_interval;      /* 1.25 ms units */
+static uint16_t conn_latency;
+static double   event0_us;          /* First connection event, local time */
+static double   event_us;           /* Interval in local time, with drift */
+
+TimerHandle_t xTimerCreate(const char *n, TickType_t p, UBaseType_t r, void *id, TimerCallbackFunction_t cb)
+{
+    (void)n; (void)r; (void)id;
+    timer_period = p;
+    timer_cb     = cb;
+    return (TimerHandle_t)&timer_cb;
+}
+
+BaseType_t xTimerStart(TimerHandle_t t, TickType_t w)
+{
+    (void)t; (void)w;
+    timer_running = 1;
+    timer_expiry  = app_host_tick + timer_period;
+    return pdPASS;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t p, TickType_t w)
+{
+    (void)t; (void)w;
+    timer_period = p;
+    timer_expiry = app_host_tick + p;
+    return pdPASS;
+}
+
+TickType_t xTimerGetPeriod(TimerHandle_t t)
+{
+    (void)t;
+    return timer_period;
+}
+
+wiced_result_t wiced_bt_ble_get_connection_parameters(wiced_bt_device_address_t bda, wiced_bt_ble_conn_params_t *p)
+{
+    (void)bda;
+    p->conn_interval = conn_interval;
+    p->conn_latency  = conn_latency;
+    return WICED_BT_SUCCESS;
+}
+
+/* Local time from a connection event to the next one the peripheral attends */
+static double to_event_us(double t_us)
+{
+    double attended = event_us * (conn_latency + 1);
+    double k = (t_us - event0_us) / attended;
+    long   n = (long)k;
+
+    if (k > (double)n)
+    {
+        n++;
+    }
+    return event0_us + n * attended - t_us;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t  period_ms = (uint32_t)atoi(argv[1]);
+    long      open_ms = atol(argv[4]);
+    long      peer_rx_ms = atol(argv[5]) * 1000L;
+    double    drift_ppm = atof(argv[6]);
+    long      duration_ms = atol(argv[7]) * 1000L;
+    long      close_ms = duration_ms * 2 / 3;
+    long      holdup_ms = duration_ms + 2 * (long)period_ms;
+    double    tol_us = APP_BT_SCHED_LEAD_US + 1000.0 * portTICK_PERIOD_MS +
+                       APP_BT_SCHED_ANCHOR_MAX_AGE_MS * drift_ppm / 1000.0;
+    double    d_us;
+    long      next_rx = -1;
+    long      t, last = -1, first_conn = -1, last_conn = -1;
+    long      conn_wakeups = 0, misses = 0, off_nominal = 0, stale_aligned = 0, holdup_gap = 0;
+    long      held_at = -1;
+    int       connected = 0;
+    int       shifted = 0;          /* Recent wakeups moved off the nominal time */
+    uint32_t  aligned;
+    app_bt_sched_stats_t stats;
+
+    (void)argc;
+    conn_interval = (uint16_t)atoi(argv[2]);
+    conn_latency  = (uint16_t)atoi(argv[3]);
+    event_us      = conn_interval * 1250.0 * (1.0 + drift_ppm / 1e6);
+    app_bt_conn_init(cccd_handles, 1);
+    app_bt_sched_init((TaskHandle_t)1, period_ms);
+    app_bt_sched_start();
+
+    for (t = 0; t < holdup_ms + 3 * (long)period_ms; t++)
+    {
+        app_host_tick = (TickType_t)t;
+        if (t == open_ms)
+        {
+            /* Connection complete at the first connection event */
+            event0_us = t * 1000.0;
+            app_bt_conn_open(CONN_ID, peer);
+            app_bt_sched_conn_open(CONN_ID, peer);
+            connected = 1;
+            next_rx   = (peer_rx_ms > 0) ? t + peer_rx_ms : -1;
+        }
+        if (connected && (t == close_ms))
+        {
+            app_bt_sched_conn_close(CONN_ID);
+            app_bt_conn_close(CONN_ID);
+            connected = 0;
+        }
+        if (connected && (next_rx >= 0) && (t >= next_rx))
+        {
+            /* The request is reported in the tick after the event it came in */
+            d_us = to_event_us(t * 1000.0);
+            if ((0.0 == d_us) || (event_us * (conn_latency + 1) - d_us < 1000.0))
+            {
+                app_bt_sched_conn_event(CONN_ID);
+                next_rx += peer_rx_ms;
+            }
+        }
+
+        if (!timer_running || (timer_expiry != (TickType_t)t))
+        {
+            continue;
+        }
+        if ((holdup_ms <= t) && (held_at < 0))
+        {
+            /* The timer task is held up */
+            held_at      = t;
+            timer_expiry = (TickType_t)(t + (long)period_ms * 5 / 2);
+            continue;
+        }
+
+        app_bt_sched_get_stats(&stats);
+        aligned = stats.aligned;
+        timer_expiry += timer_period;
+        timer_cb((TimerHandle_t)&timer_cb);
+        app_bt_sched_get_stats(&stats);
+
+        if ((held_at >= 0) && (0 == holdup_gap))
+        {
+            holdup_gap = (long)(timer_expiry - (TickType_t)t);
+        }
+        else if ((last >= 0) && (held_at < 0) && (0 == shifted) && (t - last != (long)period_ms))
+        {
+            off_nominal++;
+        }
+        /* Bit 0: this wakeup was moved, bit 1: the one before */
+        shifted = ((shifted << 1) | (stats.aligned != aligned)) & 3;
+        if (connected && (t > open_ms))
+        {
+            first_conn = (first_conn < 0) ? t : first_conn;
+            last_conn  = t;
+            conn_wakeups++;
+        }
+        if (APP_BT_SCHED_CONN_ALIGN && connected && (stats.aligned != aligned))
+        {
+            /* The expiry just set lands ahead of an event */
+            d_us = to_event_us((double)timer_expiry * 1000.0);
+            misses += (d_us < 0.0) || (d_us > tol_us);
+        }
+        if ((peer_rx_ms <= 0) && (t > open_ms + (long)APP_BT_SCHED_ANCHOR_MAX_AGE_MS + (long)period_ms) &&
+            connected && (stats.aligned != aligned))
+        {
+            stale_aligned++;
+        }
+        last = t;
+    }
+
+    app_bt_sched_get_stats(&stats);
+    printf("result %lu %lu %lu %.3f %lu %lu %ld %ld %ld %ld %ld\n",
+           (unsigned long)stats.wakeups, (unsigned long)stats.aligned, (unsigned long)stats.stale,
+           (conn_wakeups > 1) ? (double)(last_conn - first_conn) / (conn_wakeups - 1) : 0.0,
+           (unsigned long)((0 != stats.aligned) ? stats.shift_sum_ms / stats.aligned : 0),
+           (unsigned long)stats.shift_max_ms, misses, off_nominal, stale_aligned, holdup_gap, conn_wakeups);
+    return 0;
+}
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--interval-ms", type=float, nargs="+", default=[7.5, 30, 100, 400],
+                        help="connection intervals to run, multiples of 1.25 ms")
+    parser.add_argument("--latency", type=int, default=0, help="peripheral latency")
+    parser.add_argument("--period-ms", type=int, default=1000, help="update period, as bas_task() uses")
+    parser.add_argument("--open-ms", type=int, default=1234, help="connection time")
+    parser.add_argument("--peer-rx-s", type=int, default=5, help="seconds between peer requests, 0 for none")
+    parser.add_argument("--drift-ppm", type=float, default=50, help="clock drift of the central")
+    parser.add_argument("--seconds", type=int, default=600, help="simulated time")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    failed = 0
+    print("%-8s %8s %8s %8s %6s %10s %9s %9s %7s" %
+          ("build", "interval", "wakeups", "aligned", "stale", "period ms", "shift ms", "shift max", "misses"))
+    with tempfile.TemporaryDirectory() as tmp:
+        builds = [("nominal", build(args, tmp, ["app_bt_sched.c", "app_bt_conn.c"], DRIVER, name="nominal")),
+                  ("aligned", build(args, tmp, ["app_bt_sched.c", "app_bt_conn.c"], DRIVER,
+                                    ["APP_BT_SCHED_CONN_ALIGN=1"], name="aligned"))]
+        for name, exe in builds:
+            for interval in args.interval_ms:
+                units = int(round(interval / 1.25))
+                f = run(exe, args.period_ms, units, args.latency, args.open_ms, args.peer_rx_s,
+                        args.drift_ppm, args.seconds).split()
+                wakeups, aligned, stale = int(f[1]), int(f[2]), int(f[3])
+                mean = float(f[4])
+                misses, off_nominal, stale_aligned, holdup_gap, conn_wakeups = (int(v) for v in f[7:12])
+                print("%-8s %8.2f %8d %8d %6d %10.3f %9s %9s %7d" %
+                      (name, units * 1.25, wakeups, aligned, stale, mean, f[5], f[6], misses))
+
+                attended = units * 1.25 * (args.latency + 1)
+                checks = [
+                    ("period", abs(mean - args.period_ms) * (conn_wakeups - 1) <= attended / 2 + 1,
+                     "mean period %.3f ms over %d wakeups" % (mean, conn_wakeups)),
+                    ("nominal", off_nominal == 0, "%d wakeups off the nominal period" % off_nominal),
+                    ("window", misses == 0, "%d aligned wakeups missed the lead window" % misses),
+                    ("holdup", 0 < holdup_gap <= args.period_ms,
+                     "next wakeup %d ms after the held up one" % holdup_gap),
+                ]
+                if args.peer_rx_s == 0 and name == "aligned":
+                    checks.append(("stale", stale_aligned == 0 and stale > 0,
+                                   "%d aligned on an old anchor, %d stale" % (stale_aligned, stale)))
+                for check, ok, text in checks:
+                    failed += not ok
+                    if not ok:
+                        print("%-8s FAIL %s: %s" % ("", check, text))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
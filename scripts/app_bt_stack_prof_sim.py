@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+Simulates a run of the stack profiler and prints its summary table.
+
+Builds app_bt_stack_prof.c and app_bt_cpu_stats.c on the host (see
+app_host.py). The driver plays the scheduler behind uxTaskGetSystemState()
+for the task set of the application: the Bluetooth stack threads, the timer
+daemon, the idle task, the BAS, trace and profiler tasks and, with --ota,
+the OTA agent. Every simulated second each task uses a random depth of its
+stack, now and then its peak depth, and the FreeRTOS high-water mark of the
+task falls accordingly. app_bt_stack_prof_sample() runs once per second, as
+its task does. Halfway through, a short lived task runs and is deleted.
+
+At the end the driver prints the table of app_bt_stack_prof_print(), the
+UART report, and reads the characteristic value through
+app_bt_stack_prof_on_read(). The summary gives per task the stack size, the
+lowest free bytes the characteristic reported, the deepest use the model
+reached and a size with --margin-pct headroom over that use, as a starting
+point for the stack sizes in main.c and the BT configuration.
+
+    python3 scripts/app_bt_stack_prof_sim.py
+    python3 scripts/app_bt_stack_prof_sim.py --seconds 3600 --ota
+    python3 scripts/app_bt_stack_prof_sim.py -D APP_BT_STACK_PROF_MAX_TASKS=6
+
+Exits non-zero if a reported lowest differs from the model or a task that
+fits in the table is missing.
+"""
+
+import argparse
+import sys
+import tempfile
+
+from app_host import add_build_args, build, run
+
+# Name, stack in StackType_t words, typical and peak depth in bytes
+TASKS = [
+    ("IDLE",       128,  120,  200),
+    ("Tmr Svc",    256,  240,  620),
+    ("CYBT_BT_Ta", 1024, 1400, 3300),
+    ("CYBT_HCI_T", 512,  600,  1500),
+    ("BAS Task",   512,  420,  1250),
+    ("Trace Task", 512,  300,  700),
+    ("Stack Prof", 512,  700,  1100),
+]
+OTA_TASKS = [
+    ("OTA Agent",  1536, 1800, 4900),
+]
+SHORT_LIVED = ("Bond Save", 256, 300, 560)
+
+DRIVER = r"""
+#include "app_bt_stack_prof.h"
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SIM_TASKS   (32)
+
+typedef struct
+{
+    char        name[configMAX_TASK_NAME_LEN];
+    uint32_t    words;
+    uint32_t    typical;
+    uint32_t    peak;
+    uint32_t    deepest;            /* Bytes, deepest use so far */
+    UBaseType_t number;
+    int         alive;
+} sim_task_t;
+
+static sim_task_t tasks[MAX_SIM_TASKS];
+static int        num_tasks;
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(uint32_t n)
+{
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 8) % n;
+}
+
+/* Only the tasks alive now, as the kernel does */
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *p_status, UBaseType_t max, uint32_t *p_total)
+{
+    UBaseType_t n = 0;
+
+    for (int i = 0; i < num_tasks; i++)
+    {
+        n += tasks[i].alive;
+    }
+    if (n > max)
+    {
+        return 0;
+    }
+    n = 0;
+    for (int i = 0; i < num_tasks; i++)
+    {
+        if (tasks[i].alive)
+        {
+            memset(&p_status[n], 0, sizeof(p_status[n]));
+            p_status[n].pcTaskName           = tasks[i].name;
+            p_status[n].xTaskNumber          = tasks[i].number;
+            p_status[n].usStackHighWaterMark = (uint16_t)((tasks[i].words * sizeof(StackType_t) -
+                                                           tasks[i].deepest) / sizeof(StackType_t));
+            n++;
+        }
+    }
+    *p_total = 0;
+    return n;
+}
+
+/* One second of work: mostly the typical depth, the peak one time in 500 */
+static void run_second(void)
+{
+    uint32_t depth;
+
+    for (int i = 0; i < num_tasks; i++)
+    {
+        if (!tasks[i].alive)
+        {
+            continue;
+        }
+        depth = (0 == rnd(500)) ? tasks[i].peak : tasks[i].typical / 2 + rnd(tasks[i].typical / 2 + 1);
+        tasks[i].deepest = (depth > tasks[i].deepest) ? depth : tasks[i].deepest;
+    }
+}
+
+static void add_task(char **argv, int alive)
+{
+    sim_task_t *p = &tasks[num_tasks];
+
+    strncpy(p->name, argv[0], sizeof(p->name) - 1);
+    p->words   = (uint32_t)atoi(argv[1]);
+    p->typical = (uint32_t)atoi(argv[2]);
+    p->peak    = (uint32_t)atoi(argv[3]);
+    p->number  = (UBaseType_t)(++num_tasks);
+    p->alive   = alive;
+}
+
+int main(int argc, char **argv)
+{
+    int       seconds = atoi(argv[1]);
+    int       short_lived;
+    uint8_t  *p_val;
+    uint16_t  len;
+
+    num_tasks = 0;
+    for (int a = 2; a + 3 < argc; a += 4)
+    {
+        add_task(&argv[a], 1);
+    }
+    /* The last task is the short lived one */
+    short_lived = num_tasks - 1;
+    tasks[short_lived].alive = 0;
+
+    for (int s = 0; s < seconds; s++)
+    {
+        if (s == seconds / 2)
+        {
+            tasks[short_lived].alive = 1;
+        }
+        run_second();
+        app_bt_stack_prof_sample();
+        if (s == seconds / 2 + 5)
+        {
+            tasks[short_lived].alive = 0;
+        }
+    }
+
+    app_bt_stack_prof_print();
+
+    app_bt_stack_prof_on_read(0, 0, &p_val, &len);
+    for (uint16_t off = 0; off + APP_BT_STACK_PROF_RECORD_LEN <= len; off += APP_BT_STACK_PROF_RECORD_LEN)
+    {
+        printf("record %.*s|%u %u\n", APP_BT_STACK_PROF_NAME_LEN, (char *)&p_val[off],
+               p_val[off + APP_BT_STACK_PROF_NAME_LEN] | (p_val[off + APP_BT_STACK_PROF_NAME_LEN + 1] << 8),
+               p_val[off + APP_BT_STACK_PROF_NAME_LEN + 2] | (p_val[off + APP_BT_STACK_PROF_NAME_LEN + 3] << 8));
+    }
+    for (int i = 0; i < num_tasks; i++)
+    {
+        printf("model %s|%u %u\n", tasks[i].name, tasks[i].words, tasks[i].deepest);
+    }
+    return 0;
+}
+"""
+
+NAME_LEN = 8
+WORD = 4
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--seconds", type=int, default=600, help="simulated run time, one sample per second")
+    parser.add_argument("--ota", action="store_true", help="include the OTA agent")
+    parser.add_argument("--margin-pct", type=int, default=25, help="headroom of the suggested size")
+    add_build_args(parser)
+    args = parser.parse_args()
+
+    tasks = TASKS + (OTA_TASKS if args.ota else []) + [SHORT_LIVED]
+    argv = [str(args.seconds)]
+    for task in tasks:
+        argv += [str(field) for field in task]
+
+    with tempfile.TemporaryDirectory() as tmp:
+        # The CPU load report shares the snapshot; keep its table out of the output
+        exe = build(args, tmp, ["app_bt_stack_prof.c", "app_bt_cpu_stats.c"], DRIVER,
+                    ["APP_BT_CPU_STATS_PRINT_WINDOWS=0"])
+        out = run(exe, *argv)
+
+    records, model = {}, {}
+    for line in out.splitlines():
+        if line.startswith("record "):
+            name, values = line[len("record "):].split("|")
+            records[name.rstrip("\0")] = [int(v) for v in values.split()]
+        elif line.startswith("model "):
+            name, values = line[len("model "):].split("|")
+            model[name] = [int(v) for v in values.split()]
+        else:
+            print(line.rstrip("\r"))
+
+    failed = 0
+    print()
+    print("%-16s %8s %8s %8s %6s %10s" % ("task", "stack", "lowest", "deepest", "used", "suggested"))
+    for name, _, _, _ in tasks:
+        words, deepest = model[name]
+        size = words * WORD
+        suggested = -(-deepest * (100 + args.margin_pct) // 100 // WORD) * WORD
+        record = records.get(name[:NAME_LEN])
+        if record is None:
+            print("%-16s %8d %8s %8d %5.0f%% %10d  not in the characteristic" %
+                  (name, size, "-", deepest, deepest * 100.0 / size, suggested))
+            continue
+        # The high-water mark counts whole stack words
+        lowest = record[0]
+        ok = lowest == (size - deepest) // WORD * WORD
+        failed += not ok
+        print("%-16s %8d %8d %8d %5.0f%% %10d%s" %
+              (name, size, lowest, deepest, deepest * 100.0 / size, suggested,
+               "" if ok else "  FAIL: model has %d free" % ((size - deepest) // WORD * WORD)))
+    if len(records) < len(tasks) and "tasks not sampled" not in out:
+        print("FAIL: %d of %d tasks reported and none counted as not sampled" % (len(records), len(tasks)))
+        failed += 1
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Decodes the deferred binary trace of app_bt_trace.c.
+
+The drain task prints one "TRC <hex>" line per 12 byte record, preceded by a
+"TRC v<version> tick_hz <rate>" header, in between the regular log output.
+Feed a UART capture to this script to get the records back as text:
+
+    python3 scripts/app_bt_trace_decode.py uart.log
+    cat /dev/ttyACM0 | python3 scripts/app_bt_trace_decode.py
+
+Writing 0x01 to the Trace characteristic of the Diagnostics service sends the
+records there instead, and 0x00 back to the UART. Each read of the
+characteristic returns an 8 byte header (version, record count, tick rate,
+sequence number of the first record) and the newest records. With --gatt
+the input is one read per line in hex, spaces, dashes and 0x prefixes
+allowed, as a client app logs them; records seen in an earlier read are
+skipped and gaps between reads are reported:
+
+    python3 scripts/app_bt_trace_decode.py --gatt reads.txt
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+TRACE_VERSION = 1
+
+# Keep in line with app_bt_trace_evt_t in app_bt_trace.h
+EVENTS = {
+    0x00: "DROPPED",
+    0x01: "ALLOC",
+    0x02: "FREE",
+    0x03: "ALLOC_FALLBACK",
+    0x04: "FREE_FALLBACK",
+    0x05: "ALLOC_FAIL",
+}
+
+# app_bt_buf_pool_class_t
+POOL_CLASSES = {0: "small", 1: "large"}
+
+RECORD = struct.Struct("<IBBHI")
+GATT_HEADER = struct.Struct("<BBHI")
+
+HEADER_RE = re.compile(r"TRC v(\d+) tick_hz (\d+)")
+RECORD_RE = re.compile(r"TRC ([0-9A-Fa-f]{%d})\b" % (2 * RECORD.size))
+
+
+def format_record(tick, evt, arg, length, addr, tick_hz):
+    name = EVENTS.get(evt, "EVT_0x%02X" % evt)
+    when = "%10.3f" % (tick * 1000.0 / tick_hz)
+    if evt == 0x00:
+        return "%s ms  %-14s %u records lost" % (when, name, length)
+    if evt in (0x01, 0x02):
+        return "%s ms  %-14s 0x%08X len %4u (%s)" % (when, name, addr, length,
+                                                    POOL_CLASSES.get(arg, arg))
+    return "%s ms  %-14s 0x%08X len %4u" % (when, name, addr, length)
+
+
+def track(live, evt, addr, length):
+    if evt in (0x01, 0x03):
+        live[addr] = length
+    elif evt in (0x02, 0x04):
+        live.pop(addr, None)
+
+
+def report_live(live, out):
+    if live:
+        out.write("--- %u buffers not freed at end of capture ---\n" % len(live))
+        for addr, length in sorted(live.items()):
+            out.write("    0x%08X len %u\n" % (addr, length))
+
+
+def decode(lines, out, tick_hz):
+    live = {}
+    for line in lines:
+        m = HEADER_RE.search(line)
+        if m:
+            if int(m.group(1)) != TRACE_VERSION:
+                sys.stderr.write("unsupported trace version %s\n" % m.group(1))
+                return 1
+            tick_hz = int(m.group(2))
+            live.clear()
+            out.write("--- trace start, %u Hz tick ---\n" % tick_hz)
+            continue
+        m = RECORD_RE.search(line)
+        if not m:
+            continue
+        tick, evt, arg, length, addr = RECORD.unpack(bytes.fromhex(m.group(1)))
+        out.write(format_record(tick, evt, arg, length, addr, tick_hz) + "\n")
+        track(live, evt, addr, length)
+    report_live(live, out)
+    return 0
+
+
+def decode_gatt(lines, out):
+    live = {}
+    next_seq = None
+    for line in lines:
+        try:
+            data = bytes.fromhex(re.sub(r"[^0-9A-Fa-f]", "", re.sub(r"0[xX]", "", line)))
+        except ValueError:
+            continue
+        if len(data) < GATT_HEADER.size:
+            continue
+        version, count, tick_hz, first = GATT_HEADER.unpack_from(data)
+        if version != TRACE_VERSION:
+            sys.stderr.write("unsupported trace version %u\n" % version)
+            return 1
+        if len(data) != GATT_HEADER.size + count * RECORD.size:
+            sys.stderr.write("read of %u bytes does not hold %u records, skipped\n" %
+                             (len(data), count))
+            continue
+        if next_seq is not None and first > next_seq:
+            out.write("--- %u records missed between reads ---\n" % (first - next_seq))
+        for i in range(count):
+            seq = first + i
+            if next_seq is not None and seq < next_seq:
+                continue
+            tick, evt, arg, length, addr = RECORD.unpack_from(data, GATT_HEADER.size + i * RECORD.size)
+            out.write(format_record(tick, evt, arg, length, addr, tick_hz) + "\n")
+            track(live, evt, addr, length)
+        next_seq = max(next_seq or 0, first + count)
+    report_live(live, out)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="UART capture, stdin if omitted")
+    parser.add_argument("--tick-hz", type=int, default=1000,
+                        help="tick rate if the capture misses the header")
+    parser.add_argument("--gatt", action="store_true",
+                        help="input is Trace characteristic reads in hex, one per line")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, "r", errors="replace") as f:
+            return decode_gatt(f, sys.stdout) if args.gatt else decode(f, sys.stdout, args.tick_hz)
+    return decode_gatt(sys.stdin, sys.stdout) if args.gatt else decode(sys.stdin, sys.stdout, args.tick_hz)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
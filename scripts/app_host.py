@@ -0,0 +1,607 @@
+#!/usr/bin/env python3
+"""
+Builds the shared app_*.c modules for the host, for the benchmarks and checks.
+
+The modules are compiled unchanged with the host C compiler against minimal
+stand-ins for the FreeRTOS, HAL and BTSTACK headers defined below. Every SDK
+function they call has a weak default in SUPPORT that does nothing and
+succeeds; a driver defines its own version where it needs to see or steer
+the calls. app_host_tick is what xTaskGetTickCount() returns.
+
+The stand-ins carry only what the modules use, with the values of the SDK
+where they matter on the air (opcodes, status codes, UUID lengths). They
+live here rather than in the tree so that ModusToolbox never picks them up.
+
+Not meant to be run on its own; the scripts import it:
+
+    from app_host import REPO, add_build_args, build, run
+"""
+
+import os
+import subprocess
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+STUBS = {
+    "FreeRTOS.h": r"""
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct { void *p[24]; } StaticTask_t;
+#define pdPASS                                  1
+#define pdFAIL                                  0
+#define pdTRUE                                  1
+#define pdFALSE                                 0
+#define portMAX_DELAY                           0xFFFFFFFFu
+#define portTICK_PERIOD_MS                      1u
+#define pdMS_TO_TICKS(ms)                       ((TickType_t)(ms))
+#define configTICK_RATE_HZ                      1000u
+#define configMINIMAL_STACK_SIZE                128u
+#define configMAX_PRIORITIES                    7
+#define configMAX_TASK_NAME_LEN                 16
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
+#define configUSE_MALLOC_FAILED_HOOK            1
+#define tskIDLE_PRIORITY                        0
+#define traceMALLOC(p, size)
+#define traceFREE(p, size)
+typedef struct
+{
+    TaskHandle_t xHandle;
+    const char  *pcTaskName;
+    UBaseType_t  xTaskNumber;
+    int          eCurrentState;
+    UBaseType_t  uxCurrentPriority;
+    UBaseType_t  uxBasePriority;
+    uint32_t     ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    uint16_t     usStackHighWaterMark;
+} TaskStatus_t;
+""",
+    "task.h": r"""
+#pragma once
+#include "FreeRTOS.h"
+#define taskSCHEDULER_NOT_STARTED 1
+#define taskSCHEDULER_RUNNING     2
+typedef enum { eAbortSleep, eStandardSleep, eNoTasksWaitingTimeout } eSleepModeStatus;
+BaseType_t   xTaskCreate(TaskFunction_t, const char *, uint16_t, void *, UBaseType_t, TaskHandle_t *);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t,
+                               StackType_t *, StaticTask_t *);
+void         vTaskDelay(TickType_t);
+TickType_t   xTaskGetTickCount(void);
+BaseType_t   xTaskGetSchedulerState(void);
+void        *pvTaskGetThreadLocalStoragePointer(TaskHandle_t, BaseType_t);
+void         vTaskSetThreadLocalStoragePointer(TaskHandle_t, BaseType_t, void *);
+void         vTaskSuspendAll(void);
+BaseType_t   xTaskResumeAll(void);
+UBaseType_t  uxTaskGetSystemState(TaskStatus_t *, UBaseType_t, uint32_t *);
+BaseType_t   xTaskNotifyGive(TaskHandle_t);
+eSleepModeStatus eTaskConfirmSleepModeStatus(void);
+void         vTaskStepTick(TickType_t);
+""",
+    "timers.h": r"""
+#pragma once
+#include "FreeRTOS.h"
+typedef void *TimerHandle_t;
+typedef struct { void *p[12]; } StaticTimer_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+TimerHandle_t xTimerCreate(const char *, TickType_t, UBaseType_t, void *, TimerCallbackFunction_t);
+TimerHandle_t xTimerCreateStatic(const char *, TickType_t, UBaseType_t, void *,
+                                 TimerCallbackFunction_t, StaticTimer_t *);
+BaseType_t    xTimerStart(TimerHandle_t, TickType_t);
+BaseType_t    xTimerStop(TimerHandle_t, TickType_t);
+BaseType_t    xTimerChangePeriod(TimerHandle_t, TickType_t, TickType_t);
+TickType_t    xTimerGetPeriod(TimerHandle_t);
+void         *pvTimerGetTimerID(TimerHandle_t);
+""",
+    "semphr.h": r"""
+#pragma once
+#include "FreeRTOS.h"
+typedef void *SemaphoreHandle_t;
+typedef struct { void *p[10]; } StaticSemaphore_t;
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *);
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t, TickType_t);
+BaseType_t        xSemaphoreGiveFromISR(SemaphoreHandle_t, BaseType_t *);
+#define portYIELD_FROM_ISR(x) (void)(x)
+""",
+    "cyhal.h": r"""
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+typedef uint32_t cy_rslt_t;
+#define CY_RSLT_SUCCESS                  0u
+#define CYHAL_SYSPM_RSLT_ERR_PM_PENDING  0x04020B04u
+#define CY_ASSERT(x)                     do { if (!(x)) { __builtin_trap(); } } while (0)
+typedef int cyhal_gpio_t;
+#define NC                               (-1)
+#define CYBSP_A0                         10
+bool cyhal_gpio_read(cyhal_gpio_t);
+typedef struct { int unused; } cyhal_lptimer_t;
+cy_rslt_t cyhal_lptimer_init(cyhal_lptimer_t *);
+typedef enum { CYHAL_SYSPM_CB_CPU_SLEEP = 1, CYHAL_SYSPM_CB_CPU_DEEPSLEEP = 2 } cyhal_syspm_callback_state_t;
+typedef enum { CYHAL_SYSPM_CHECK_READY = 1, CYHAL_SYSPM_CHECK_FAIL = 2,
+               CYHAL_SYSPM_BEFORE_TRANSITION = 4, CYHAL_SYSPM_AFTER_TRANSITION = 8 } cyhal_syspm_callback_mode_t;
+typedef bool (*cyhal_syspm_callback_t)(cyhal_syspm_callback_state_t, cyhal_syspm_callback_mode_t, void *);
+typedef struct cyhal_syspm_callback_data
+{
+    cyhal_syspm_callback_t            callback;
+    cyhal_syspm_callback_state_t      states;
+    cyhal_syspm_callback_mode_t       ignore_modes;
+    void                             *args;
+    struct cyhal_syspm_callback_data *next;
+} cyhal_syspm_callback_data_t;
+void      cyhal_syspm_register_callback(cyhal_syspm_callback_data_t *);
+cy_rslt_t cyhal_syspm_tickless_deepsleep(cyhal_lptimer_t *, uint32_t, uint32_t *);
+cy_rslt_t cyhal_syspm_tickless_sleep(cyhal_lptimer_t *, uint32_t, uint32_t *);
+uint32_t  cyhal_system_critical_section_enter(void);
+void      cyhal_system_critical_section_exit(uint32_t);
+typedef struct { int unused; } cyhal_adc_t;
+typedef struct { int unused; } cyhal_adc_channel_t;
+typedef struct { bool enable_averaging; uint32_t min_acquisition_ns; bool enabled; } cyhal_adc_channel_config_t;
+typedef enum { CYHAL_ADC_EOS = 1, CYHAL_ADC_ASYNC_READ_COMPLETE = 2 } cyhal_adc_event_t;
+typedef void (*cyhal_adc_event_callback_t)(void *, cyhal_adc_event_t);
+typedef enum { CYHAL_ASYNC_SW, CYHAL_ASYNC_DMA } cyhal_async_mode_t;
+#define CYHAL_ADC_VNEG                   (-2)
+#define CYHAL_DMA_PRIORITY_DEFAULT       3
+#define CYHAL_ISR_PRIORITY_DEFAULT       7
+cy_rslt_t cyhal_adc_init(cyhal_adc_t *, cyhal_gpio_t, const void *);
+cy_rslt_t cyhal_adc_channel_init_diff(cyhal_adc_channel_t *, cyhal_adc_t *, cyhal_gpio_t, cyhal_gpio_t,
+                                      const cyhal_adc_channel_config_t *);
+cy_rslt_t cyhal_adc_set_async_mode(cyhal_adc_t *, cyhal_async_mode_t, uint8_t);
+void      cyhal_adc_register_callback(cyhal_adc_t *, cyhal_adc_event_callback_t, void *);
+void      cyhal_adc_enable_event(cyhal_adc_t *, cyhal_adc_event_t, uint8_t, bool);
+cy_rslt_t cyhal_adc_read_async_uv(cyhal_adc_t *, size_t, int32_t *);
+cy_rslt_t cyhal_adc_read_async_abort(cyhal_adc_t *);
+""",
+    "cybsp.h": r"""
+#pragma once
+#include "cyhal.h"
+extern uint32_t SystemCoreClock;
+typedef struct { volatile uint32_t DEMCR; } CoreDebug_Type;
+typedef struct { volatile uint32_t CTRL; volatile uint32_t CYCCNT; } DWT_Type;
+extern CoreDebug_Type *CoreDebug;
+extern DWT_Type       *DWT;
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+#define DWT_CTRL_CYCCNTENA_Msk     1u
+#define __CLZ(x)                   ((uint32_t)__builtin_clz(x))
+""",
+    "reent.h": r"""
+#pragma once
+struct _reent;
+#define _REENT ((struct _reent *)0)
+""",
+    "cybsp_bt_config.h": r"""
+#pragma once
+#include "cyhal.h"
+typedef enum { CYBT_WAKE_ACTIVE_LOW, CYBT_WAKE_ACTIVE_HIGH } cybt_wake_polarity_t;
+typedef struct
+{
+    bool                 sleep_mode_enabled;
+    cyhal_gpio_t         device_wakeup_pin;
+    cyhal_gpio_t         host_wakeup_pin;
+    cybt_wake_polarity_t device_wake_polarity;
+    cybt_wake_polarity_t host_wake_polarity;
+} cybt_controller_sleep_config_t;
+typedef struct { cybt_controller_sleep_config_t sleep_mode; } cybt_controller_config_t;
+typedef struct { cybt_controller_config_t controller_config; } cybt_platform_config_t;
+extern const cybt_platform_config_t cybsp_bt_platform_cfg;
+""",
+    "wiced_bt_dev.h": r"""
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#define BD_ADDR_LEN        6
+typedef uint8_t wiced_bt_device_address_t[BD_ADDR_LEN];
+typedef uint8_t wiced_bool_t;
+typedef int     wiced_result_t;
+#define WICED_TRUE         1
+#define WICED_FALSE        0
+#define WICED_BT_SUCCESS   0
+#define WICED_BT_PENDING   0x0101
+#define WICED_BT_BADARG    0x0105
+#define WICED_BT_ERROR     0x0108
+""",
+    "wiced_bt_uuid.h": r"""
+#pragma once
+#define UUID_SERVICE_BATTERY               0x180F
+#define UUID_CHARACTERISTIC_BATTERY_LEVEL  0x2A19
+""",
+    "wiced_bt_gatt.h": r"""
+#pragma once
+#include "wiced_bt_dev.h"
+typedef int     wiced_bt_gatt_status_t;
+enum
+{
+    WICED_BT_GATT_SUCCESS          = 0x00,
+    WICED_BT_GATT_INVALID_HANDLE   = 0x01,
+    WICED_BT_GATT_WRITE_NOT_PERMIT = 0x03,
+    WICED_BT_GATT_REQ_NOT_SUPPORTED = 0x06,
+    WICED_BT_GATT_INVALID_OFFSET   = 0x07,
+    WICED_BT_GATT_PREPARE_Q_FULL   = 0x09,
+    WICED_BT_GATT_INVALID_ATTR_LEN = 0x0D,
+    WICED_BT_GATT_ERR_UNLIKELY     = 0x0E,
+    WICED_BT_GATT_INSUF_RESOURCE   = 0x11,
+    WICED_BT_GATT_VALUE_NOT_ALLOWED = 0x13,
+    WICED_BT_GATT_NO_RESOURCES     = 0x80,
+    WICED_BT_GATT_WRONG_STATE      = 0x82,
+    WICED_BT_GATT_BUSY             = 0x84,
+    WICED_BT_GATT_ERROR            = 0x85,
+    WICED_BT_GATT_ILLEGAL_PARAMETER = 0x87,
+    WICED_BT_GATT_CONGESTED        = 0x8F,
+    WICED_BT_GATT_CCC_CFG_ERR      = 0xFD,
+    WICED_BT_GATT_PRC_IN_PROGRESS  = 0xFE,
+};
+typedef uint8_t wiced_bt_gatt_opcode_t;
+enum
+{
+    GATT_REQ_MTU                   = 0x02,
+    GATT_REQ_READ_BY_TYPE          = 0x08,
+    GATT_REQ_READ                  = 0x0A,
+    GATT_REQ_READ_BLOB             = 0x0C,
+    GATT_REQ_READ_MULTI            = 0x0E,
+    GATT_REQ_WRITE                 = 0x12,
+    GATT_REQ_PREPARE_WRITE         = 0x16,
+    GATT_REQ_EXECUTE_WRITE         = 0x18,
+    GATT_HANDLE_VALUE_NOTIF        = 0x1B,
+    GATT_HANDLE_VALUE_IND          = 0x1D,
+    GATT_HANDLE_VALUE_CONF         = 0x1E,
+    GATT_REQ_READ_MULTI_VAR_LENGTH = 0x20,
+    GATT_HANDLE_VALUE_MULTI_NOTIF  = 0x23,
+    GATT_CMD_WRITE                 = 0x52,
+    GATT_CMD_SIGNED_WRITE          = 0xD2,
+};
+#define GATT_CLIENT_CONFIG_NOTIFICATION 0x0001
+#define GATT_CLIENT_CONFIG_INDICATION   0x0002
+#define GATT_PREP_WRITE_CANCEL          0x00
+#define GATT_PREP_WRITE_EXEC            0x01
+#define LEN_UUID_16                     2
+#define LEN_UUID_32                     4
+#define LEN_UUID_128                    16
+typedef struct
+{
+    uint16_t len;
+    union { uint16_t uuid16; uint32_t uuid32; uint8_t uuid128[LEN_UUID_128]; } uu;
+} wiced_bt_uuid_t;
+typedef uint8_t wiced_bt_gatt_exec_flag_t;
+typedef struct { uint16_t handle; uint16_t offset; uint16_t val_len; uint8_t *p_val; } wiced_bt_gatt_write_req_t;
+typedef struct { uint16_t handle; uint16_t offset; } wiced_bt_gatt_read_t;
+typedef struct { uint16_t s_handle; uint16_t e_handle; wiced_bt_uuid_t uuid; } wiced_bt_gatt_read_by_type_t;
+typedef struct { int num_handles; uint8_t *p_handle_stream; } wiced_bt_gatt_read_multiple_req_t;
+typedef struct
+{
+    uint16_t               conn_id;
+    wiced_bt_gatt_opcode_t opcode;
+    union
+    {
+        wiced_bt_gatt_read_t              read_req;
+        wiced_bt_gatt_write_req_t         write_req;
+        wiced_bt_gatt_exec_flag_t         exec_write_req;
+        uint16_t                          remote_mtu;
+        wiced_bt_gatt_read_multiple_req_t read_multiple_req;
+        wiced_bt_gatt_read_by_type_t      read_by_type;
+        uint16_t                          confirm;
+        uint16_t                          handle;
+    } data;
+    uint16_t               len_requested;
+} wiced_bt_gatt_attribute_request_t;
+typedef struct { uint8_t *p_app_data; uint16_t len; void *p_app_ctxt; } wiced_bt_gatt_buffer_transmitted_t;
+typedef struct { int connected; uint16_t conn_id; uint8_t *bd_addr; int reason; } wiced_bt_gatt_connection_status_t;
+typedef struct { uint16_t conn_id; uint8_t congested; } wiced_bt_gatt_congestion_event_t;
+typedef union
+{
+    wiced_bt_gatt_attribute_request_t  attribute_request;
+    wiced_bt_gatt_buffer_transmitted_t buffer_xmitted;
+    wiced_bt_gatt_connection_status_t  connection_status;
+    wiced_bt_gatt_congestion_event_t   congestion;
+} wiced_bt_gatt_event_data_t;
+uint16_t wiced_bt_gatt_find_handle_by_type(uint16_t s_handle, uint16_t e_handle, wiced_bt_uuid_t *p_uuid);
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t conn_id, uint16_t handle,
+                                                              uint16_t len, uint8_t *p_val, void *p_ctx);
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_indication(uint16_t conn_id, uint16_t handle,
+                                                            uint16_t len, uint8_t *p_val, void *p_ctx);
+wiced_bt_gatt_status_t wiced_bt_gatt_server_send_multiple_notifications(uint16_t conn_id, uint16_t len,
+                                                                        uint8_t *p_val, void *p_ctx);
+int      wiced_bt_gatt_put_read_by_type_rsp_in_stream(uint8_t *p_stream, int stream_len, uint8_t *p_pair_len,
+                                                      uint16_t handle, uint16_t len, uint8_t *p_val);
+int      wiced_bt_gatt_put_read_multi_rsp_in_stream(wiced_bt_gatt_opcode_t opcode, uint8_t *p_stream,
+                                                    int stream_len, uint16_t handle, uint16_t len,
+                                                    uint8_t *p_val);
+uint16_t wiced_bt_gatt_get_handle_from_stream(uint8_t *p_stream, int index);
+""",
+    "wiced_bt_ble.h": r"""
+#pragma once
+#include "wiced_bt_dev.h"
+typedef struct { uint8_t role; uint16_t conn_interval; uint16_t conn_latency; uint16_t supervision_timeout; } wiced_bt_ble_conn_params_t;
+wiced_result_t wiced_bt_ble_get_connection_parameters(wiced_bt_device_address_t bda, wiced_bt_ble_conn_params_t *p);
+typedef uint8_t  wiced_bt_ble_advert_type_t;
+#define BTM_BLE_ADVERT_TYPE_FLAG              0x01
+#define BTM_BLE_ADVERT_TYPE_128SRV_COMPLETE   0x07
+#define BTM_BLE_ADVERT_TYPE_NAME_SHORT        0x08
+#define BTM_BLE_ADVERT_TYPE_NAME_COMPLETE     0x09
+#define BTM_BLE_ADVERT_TYPE_SERVICE_DATA      0x16
+#define BTM_BLE_ADVERT_TYPE_APPEARANCE        0x19
+typedef struct { wiced_bt_ble_advert_type_t advert_type; uint16_t len; uint8_t *p_data; } wiced_bt_ble_advert_elem_t;
+wiced_result_t wiced_bt_ble_set_raw_advertisement_data(uint8_t num_elem, wiced_bt_ble_advert_elem_t *p_data);
+wiced_result_t wiced_bt_ble_set_raw_scan_response_data(uint8_t num_elem, wiced_bt_ble_advert_elem_t *p_data);
+typedef uint16_t wiced_bt_ble_ext_adv_event_property_t;
+typedef uint8_t  wiced_bt_ble_ext_adv_phy_t;
+typedef uint8_t  wiced_bt_ble_ext_adv_phy_options_t;
+typedef uint8_t  wiced_bt_ble_ext_adv_handle_t;
+typedef uint16_t wiced_bt_ble_periodic_adv_prop_t;
+#define WICED_BT_BLE_EXT_ADV_PHY_1M                     1
+#define WICED_BT_BLE_EXT_ADV_PHY_2M                     2
+#define WICED_BT_BLE_EXT_ADV_SCAN_REQ_NOTIFY_DISABLE    0
+#define WICED_BT_BLE_EXT_ADV_PHY_OPTIONS_NO_PREFERENCE  0
+#define BTM_BLE_DEFAULT_ADVERT_CHNL_MAP                 7
+#define BLE_ADDR_PUBLIC                                 0
+#define BTM_BLE_ADV_POLICY_ACCEPT_CONN_AND_SCAN         0
+typedef struct { wiced_bt_ble_ext_adv_handle_t adv_handle; uint16_t adv_duration; uint8_t max_ext_adv_events; } wiced_bt_ble_ext_adv_duration_config_t;
+wiced_result_t wiced_bt_ble_set_ext_adv_parameters_v2(wiced_bt_ble_ext_adv_handle_t, wiced_bt_ble_ext_adv_event_property_t,
+                                                      uint32_t, uint32_t, uint8_t, uint8_t, uint8_t,
+                                                      wiced_bt_device_address_t, uint8_t, int8_t,
+                                                      wiced_bt_ble_ext_adv_phy_t, uint8_t, wiced_bt_ble_ext_adv_phy_t,
+                                                      uint8_t, uint8_t, wiced_bt_ble_ext_adv_phy_options_t,
+                                                      wiced_bt_ble_ext_adv_phy_options_t);
+wiced_result_t wiced_bt_ble_set_ext_adv_data(wiced_bt_ble_ext_adv_handle_t, uint16_t, uint8_t *);
+wiced_result_t wiced_bt_ble_set_periodic_adv_params(wiced_bt_ble_ext_adv_handle_t, uint16_t, uint16_t,
+                                                    wiced_bt_ble_periodic_adv_prop_t);
+wiced_result_t wiced_bt_ble_set_periodic_adv_data(wiced_bt_ble_ext_adv_handle_t, uint16_t, uint8_t *);
+wiced_result_t wiced_bt_ble_start_periodic_adv(wiced_bt_ble_ext_adv_handle_t, uint8_t);
+wiced_result_t wiced_bt_ble_start_ext_adv(uint8_t, uint8_t, wiced_bt_ble_ext_adv_duration_config_t *);
+""",
+    "cycfg_gatt_db.h": r"""
+#pragma once
+#include <stdint.h>
+typedef struct { uint16_t handle; uint16_t max_len; uint16_t cur_len; uint8_t *p_data; } gatt_db_lookup_table_t;
+extern gatt_db_lookup_table_t app_gatt_db_ext_attr_tbl[];
+extern const uint16_t         app_gatt_db_ext_attr_tbl_size;
+""",
+}
+
+# Weak defaults for every SDK function the modules call
+SUPPORT = r"""
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "semphr.h"
+#include "cybsp.h"
+#include "cybsp_bt_config.h"
+#include "wiced_bt_ble.h"
+#include "wiced_bt_gatt.h"
+#include <string.h>
+
+#define WEAK __attribute__((weak))
+
+TickType_t app_host_tick;
+
+static CoreDebug_Type app_host_core_debug;
+static DWT_Type       app_host_dwt;
+static int            app_host_handle;
+uint32_t              SystemCoreClock = 100000000u;
+CoreDebug_Type       *CoreDebug = &app_host_core_debug;
+DWT_Type             *DWT = &app_host_dwt;
+WEAK const cybt_platform_config_t cybsp_bt_platform_cfg;
+
+WEAK void vTaskSuspendAll(void) {}
+WEAK BaseType_t xTaskResumeAll(void) { return pdFALSE; }
+WEAK TickType_t xTaskGetTickCount(void) { return app_host_tick; }
+WEAK void vTaskDelay(TickType_t ticks) { app_host_tick += ticks; }
+WEAK BaseType_t xTaskGetSchedulerState(void) { return taskSCHEDULER_RUNNING; }
+WEAK BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint16_t depth, void *arg,
+                            UBaseType_t prio, TaskHandle_t *p_handle)
+{
+    (void)fn; (void)name; (void)depth; (void)arg; (void)prio;
+    if (NULL != p_handle) { *p_handle = &app_host_handle; }
+    return pdPASS;
+}
+WEAK TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t depth, void *arg,
+                                    UBaseType_t prio, StackType_t *p_stack, StaticTask_t *p_tcb)
+{
+    (void)fn; (void)name; (void)depth; (void)arg; (void)prio; (void)p_stack;
+    return p_tcb;
+}
+WEAK void *pvTaskGetThreadLocalStoragePointer(TaskHandle_t t, BaseType_t i) { (void)t; (void)i; return NULL; }
+WEAK void vTaskSetThreadLocalStoragePointer(TaskHandle_t t, BaseType_t i, void *p) { (void)t; (void)i; (void)p; }
+WEAK UBaseType_t uxTaskGetSystemState(TaskStatus_t *p, UBaseType_t n, uint32_t *p_total)
+{
+    (void)p; (void)n;
+    if (NULL != p_total) { *p_total = 0; }
+    return 0;
+}
+WEAK BaseType_t xTaskNotifyGive(TaskHandle_t t) { (void)t; return pdPASS; }
+WEAK eSleepModeStatus eTaskConfirmSleepModeStatus(void) { return eStandardSleep; }
+WEAK void vTaskStepTick(TickType_t ticks) { app_host_tick += ticks; }
+WEAK void vApplicationMallocFailedHook(void) {}
+
+WEAK TimerHandle_t xTimerCreate(const char *n, TickType_t p, UBaseType_t r, void *id, TimerCallbackFunction_t cb)
+{
+    (void)n; (void)p; (void)r; (void)id; (void)cb;
+    return &app_host_handle;
+}
+WEAK TimerHandle_t xTimerCreateStatic(const char *n, TickType_t p, UBaseType_t r, void *id,
+                                      TimerCallbackFunction_t cb, StaticTimer_t *p_timer)
+{
+    (void)n; (void)p; (void)r; (void)id; (void)cb;
+    return p_timer;
+}
+WEAK BaseType_t xTimerStart(TimerHandle_t t, TickType_t w) { (void)t; (void)w; return pdPASS; }
+WEAK BaseType_t xTimerStop(TimerHandle_t t, TickType_t w) { (void)t; (void)w; return pdPASS; }
+WEAK BaseType_t xTimerChangePeriod(TimerHandle_t t, TickType_t p, TickType_t w) { (void)t; (void)p; (void)w; return pdPASS; }
+WEAK TickType_t xTimerGetPeriod(TimerHandle_t t) { (void)t; return 0; }
+WEAK void *pvTimerGetTimerID(TimerHandle_t t) { (void)t; return NULL; }
+
+WEAK SemaphoreHandle_t xSemaphoreCreateBinary(void) { return &app_host_handle; }
+WEAK SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *p) { return p; }
+WEAK BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t w) { (void)s; (void)w; return pdTRUE; }
+WEAK BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *p) { (void)s; if (NULL != p) { *p = pdFALSE; } return pdTRUE; }
+
+WEAK bool cyhal_gpio_read(cyhal_gpio_t pin) { (void)pin; return false; }
+WEAK cy_rslt_t cyhal_lptimer_init(cyhal_lptimer_t *p) { (void)p; return CY_RSLT_SUCCESS; }
+WEAK void cyhal_syspm_register_callback(cyhal_syspm_callback_data_t *p) { (void)p; }
+WEAK cy_rslt_t cyhal_syspm_tickless_deepsleep(cyhal_lptimer_t *p, uint32_t ms, uint32_t *p_slept)
+{
+    (void)p;
+    *p_slept = ms;
+    return CY_RSLT_SUCCESS;
+}
+WEAK cy_rslt_t cyhal_syspm_tickless_sleep(cyhal_lptimer_t *p, uint32_t ms, uint32_t *p_slept)
+{
+    (void)p;
+    *p_slept = ms;
+    return CY_RSLT_SUCCESS;
+}
+WEAK uint32_t cyhal_system_critical_section_enter(void) { return 0; }
+WEAK void cyhal_system_critical_section_exit(uint32_t s) { (void)s; }
+WEAK cy_rslt_t cyhal_adc_init(cyhal_adc_t *p, cyhal_gpio_t pin, const void *c) { (void)p; (void)pin; (void)c; return CY_RSLT_SUCCESS; }
+WEAK cy_rslt_t cyhal_adc_channel_init_diff(cyhal_adc_channel_t *p, cyhal_adc_t *a, cyhal_gpio_t vp, cyhal_gpio_t vm,
+                                           const cyhal_adc_channel_config_t *c)
+{
+    (void)p; (void)a; (void)vp; (void)vm; (void)c;
+    return CY_RSLT_SUCCESS;
+}
+WEAK cy_rslt_t cyhal_adc_set_async_mode(cyhal_adc_t *p, cyhal_async_mode_t m, uint8_t prio) { (void)p; (void)m; (void)prio; return CY_RSLT_SUCCESS; }
+WEAK void cyhal_adc_register_callback(cyhal_adc_t *p, cyhal_adc_event_callback_t cb, void *arg) { (void)p; (void)cb; (void)arg; }
+WEAK void cyhal_adc_enable_event(cyhal_adc_t *p, cyhal_adc_event_t e, uint8_t prio, bool en) { (void)p; (void)e; (void)prio; (void)en; }
+WEAK cy_rslt_t cyhal_adc_read_async_uv(cyhal_adc_t *p, size_t n, int32_t *p_buf) { (void)p; (void)n; (void)p_buf; return CY_RSLT_SUCCESS; }
+WEAK cy_rslt_t cyhal_adc_read_async_abort(cyhal_adc_t *p) { (void)p; return CY_RSLT_SUCCESS; }
+
+WEAK uint16_t wiced_bt_gatt_find_handle_by_type(uint16_t s, uint16_t e, wiced_bt_uuid_t *p_uuid)
+{
+    (void)s; (void)e; (void)p_uuid;
+    return 0;
+}
+WEAK wiced_bt_gatt_status_t wiced_bt_gatt_server_send_notification(uint16_t c, uint16_t h, uint16_t l,
+                                                                   uint8_t *p, void *x)
+{
+    (void)c; (void)h; (void)l; (void)p; (void)x;
+    return WICED_BT_GATT_SUCCESS;
+}
+WEAK wiced_bt_gatt_status_t wiced_bt_gatt_server_send_indication(uint16_t c, uint16_t h, uint16_t l,
+                                                                 uint8_t *p, void *x)
+{
+    (void)c; (void)h; (void)l; (void)p; (void)x;
+    return WICED_BT_GATT_SUCCESS;
+}
+WEAK wiced_bt_gatt_status_t wiced_bt_gatt_server_send_multiple_notifications(uint16_t c, uint16_t l,
+                                                                             uint8_t *p, void *x)
+{
+    (void)c; (void)l; (void)p; (void)x;
+    return WICED_BT_GATT_SUCCESS;
+}
+
+/* Handle and value pairs of a Read By Type Response; 0 once the pair length
+ * changes or the stream is full, as the stack does */
+WEAK int wiced_bt_gatt_put_read_by_type_rsp_in_stream(uint8_t *p_stream, int stream_len, uint8_t *p_pair_len,
+                                                      uint16_t handle, uint16_t len, uint8_t *p_val)
+{
+    if (0 == *p_pair_len)
+    {
+        *p_pair_len = (uint8_t)(len + 2);
+    }
+    if ((len + 2 != *p_pair_len) || (stream_len < len + 2))
+    {
+        return 0;
+    }
+    p_stream[0] = (uint8_t)handle;
+    p_stream[1] = (uint8_t)(handle >> 8);
+    memcpy(&p_stream[2], p_val, len);
+    return len + 2;
+}
+WEAK int wiced_bt_gatt_put_read_multi_rsp_in_stream(wiced_bt_gatt_opcode_t opcode, uint8_t *p_stream,
+                                                    int stream_len, uint16_t handle, uint16_t len,
+                                                    uint8_t *p_val)
+{
+    int hdr = (GATT_REQ_READ_MULTI_VAR_LENGTH == opcode) ? 2 : 0;
+
+    (void)handle;
+    if (stream_len < hdr + len)
+    {
+        len = (uint16_t)((stream_len > hdr) ? stream_len - hdr : 0);
+    }
+    if (0 != hdr)
+    {
+        p_stream[0] = (uint8_t)len;
+        p_stream[1] = (uint8_t)(len >> 8);
+    }
+    memcpy(&p_stream[hdr], p_val, len);
+    return hdr + len;
+}
+WEAK uint16_t wiced_bt_gatt_get_handle_from_stream(uint8_t *p_stream, int index)
+{
+    return (uint16_t)(p_stream[2 * index] | (p_stream[2 * index + 1] << 8));
+}
+
+WEAK wiced_result_t wiced_bt_ble_get_connection_parameters(wiced_bt_device_address_t bda, wiced_bt_ble_conn_params_t *p)
+{
+    (void)bda;
+    memset(p, 0, sizeof(*p));
+    return WICED_BT_ERROR;
+}
+WEAK wiced_result_t wiced_bt_ble_set_raw_advertisement_data(uint8_t n, wiced_bt_ble_advert_elem_t *p) { (void)n; (void)p; return WICED_BT_SUCCESS; }
+WEAK wiced_result_t wiced_bt_ble_set_raw_scan_response_data(uint8_t n, wiced_bt_ble_advert_elem_t *p) { (void)n; (void)p; return WICED_BT_SUCCESS; }
+WEAK wiced_result_t wiced_bt_ble_set_ext_adv_parameters_v2(wiced_bt_ble_ext_adv_handle_t h, wiced_bt_ble_ext_adv_event_property_t prop,
+                                                           uint32_t imin, uint32_t imax, uint8_t chnl, uint8_t own, uint8_t peer_type,
+                                                           wiced_bt_device_address_t peer, uint8_t policy, int8_t tx,
+                                                           wiced_bt_ble_ext_adv_phy_t phy1, uint8_t skip, wiced_bt_ble_ext_adv_phy_t phy2,
+                                                           uint8_t sid, uint8_t notify, wiced_bt_ble_ext_adv_phy_options_t o1,
+                                                           wiced_bt_ble_ext_adv_phy_options_t o2)
+{
+    (void)h; (void)prop; (void)imin; (void)imax; (void)chnl; (void)own; (void)peer_type; (void)peer;
+    (void)policy; (void)tx; (void)phy1; (void)skip; (void)phy2; (void)sid; (void)notify; (void)o1; (void)o2;
+    return WICED_BT_SUCCESS;
+}
+WEAK wiced_result_t wiced_bt_ble_set_ext_adv_data(wiced_bt_ble_ext_adv_handle_t h, uint16_t l, uint8_t *p) { (void)h; (void)l; (void)p; return WICED_BT_SUCCESS; }
+WEAK wiced_result_t wiced_bt_ble_set_periodic_adv_params(wiced_bt_ble_ext_adv_handle_t h, uint16_t imin, uint16_t imax,
+                                                         wiced_bt_ble_periodic_adv_prop_t prop)
+{
+    (void)h; (void)imin; (void)imax; (void)prop;
+    return WICED_BT_SUCCESS;
+}
+WEAK wiced_result_t wiced_bt_ble_set_periodic_adv_data(wiced_bt_ble_ext_adv_handle_t h, uint16_t l, uint8_t *p) { (void)h; (void)l; (void)p; return WICED_BT_SUCCESS; }
+WEAK wiced_result_t wiced_bt_ble_start_periodic_adv(wiced_bt_ble_ext_adv_handle_t h, uint8_t en) { (void)h; (void)en; return WICED_BT_SUCCESS; }
+WEAK wiced_result_t wiced_bt_ble_start_ext_adv(uint8_t en, uint8_t n, wiced_bt_ble_ext_adv_duration_config_t *p) { (void)en; (void)n; (void)p; return WICED_BT_SUCCESS; }
+"""
+
+
+def add_build_args(parser, cflags="-O2 -std=gnu11"):
+    """Adds the --cc, --cflags and -D options every host build takes."""
+    parser.add_argument("-D", "--define", action="append", default=[],
+                        help="module option, e.g. APP_BT_GATT_DB_MAX_HANDLE=0x3FF")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"))
+    parser.add_argument("--cflags", default=cflags)
+
+
+def build(args, tmp, sources, driver, defines=(), name="driver"):
+    """Compiles the driver with the listed modules into tmp, returns the executable."""
+    stubs = os.path.join(tmp, "stubs")
+    os.makedirs(stubs, exist_ok=True)
+    for header, text in STUBS.items():
+        with open(os.path.join(stubs, header), "w") as f:
+            f.write(text.lstrip())
+    support = os.path.join(tmp, "app_host_support.c")
+    with open(support, "w") as f:
+        f.write(SUPPORT.lstrip())
+    path = os.path.join(tmp, name + ".c")
+    with open(path, "w") as f:
+        f.write(driver.lstrip())
+    exe = os.path.join(tmp, name)
+    cmd = ([args.cc] + args.cflags.split() + ["-I", stubs, "-I", REPO] +
+           ["-D" + d for d in list(defines) + args.define] +
+           ["-o", exe, path, support] + [os.path.join(REPO, s) for s in sources])
+    subprocess.run(cmd, check=True)
+    return exe
+
+
+def run(exe, *argv):
+    """Runs a host build and returns its standard output."""
+    return subprocess.run([exe] + [str(a) for a in argv], check=True, capture_output=True,
+                          text=True).stdout
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""
+Host model of the average current of the battery server.
+
+A profile is a sequence of an advertising phase and a connected phase:
+
+    advertising  --adv-s seconds, one advertising event every --adv-interval-ms
+    connected    --conn-s seconds at --conn-interval-ms and --latency, one
+                 battery level notification every --notify-ms
+
+The host wakes every --update-ms for a battery level update in both phases
+and, while connected, once more --hci-ms after each notification for its
+completion report. Advertising and empty connection events are handled by
+the controller alone. Between wakeups the host idles in the power mode of
+the build:
+
+    sleep      Device Configurator idle mode CPU Sleep, APP_LOW_POWER=0
+    deepsleep  System Deep Sleep from tickless idle, APP_LOW_POWER=1
+
+Idle times shorter than --ds-min-ms are spent in CPU Sleep in either mode.
+Every Deep Sleep exit costs --wake-uc and keeps the CPU active for
+--wake-us, the mean "wakeup to ready" latency the Power diagnostics
+characteristic reports (app_bt_lpm.c).
+
+    python3 scripts/app_power_model.py
+    python3 scripts/app_power_model.py --adv-s 0 --conn-s 3600 --conn-interval-ms 100 --latency 4
+    python3 scripts/app_power_model.py --notify-ms 0 --wake-us 450
+
+Currents and charges default to rough PSoC 6 and CYW43xxx figures, the same
+as scripts/app_bas_sched_sim.py; pass the numbers of the actual board for a
+meaningful absolute result.
+"""
+
+import argparse
+import sys
+
+MODES = ("sleep", "deepsleep")
+
+
+def host_bursts(args, duration_s, notify):
+    """CPU active bursts (start, length in s) of one phase, sorted."""
+    bursts = []
+    if args.update_ms > 0:
+        t = args.update_ms / 1000.0
+        while t < duration_s:
+            bursts.append((t, args.update_cpu_ms / 1000.0))
+            t += args.update_ms / 1000.0
+    if notify and args.notify_ms > 0:
+        t = args.notify_ms / 1000.0
+        while t < duration_s:
+            # Sent at the next connection event, reported back --hci-ms later
+            bursts.append((t + args.conn_interval_ms / 2000.0 + args.hci_ms / 1000.0,
+                           args.hci_irq_ms / 1000.0))
+            t += args.notify_ms / 1000.0
+    bursts.sort()
+    return bursts
+
+
+def host_charge(mode, args, duration_s, bursts):
+    """Charge (uC) and counters of the host CPU over one phase."""
+    active = 0.0
+    cpu_sleep = 0.0
+    deep_sleep = 0.0
+    ds_exits = 0
+    t = 0.0
+    for start, length in bursts + [(duration_s, None)]:
+        if start > t:
+            gap = start - t
+            if mode == "deepsleep" and gap >= args.ds_min_ms / 1000.0:
+                deep_sleep += gap
+                if length is None:
+                    break
+                ds_exits += 1
+                # The wakeup runs at active current before the task is ready
+                wake = min(gap, args.wake_us * 1e-6)
+                deep_sleep -= wake
+                active += wake
+            else:
+                cpu_sleep += gap
+        if length is None:
+            break
+        active += length
+        t = max(t, start + length)
+    charge = (active * args.active_ma + cpu_sleep * args.sleep_ma +
+              deep_sleep * args.deep_sleep_ua / 1000.0) * 1000.0 + ds_exits * args.wake_uc
+    return charge, {"active": active, "cpu_sleep": cpu_sleep, "deep_sleep": deep_sleep,
+                    "ds_exits": ds_exits}
+
+
+def radio_charge(args):
+    """Charge (uC) of the controller over the whole profile."""
+    adv_events = int(args.adv_s * 1000.0 / args.adv_interval_ms) if args.adv_interval_ms else 0
+    conn_events = 0
+    notifications = 0
+    if args.conn_s > 0:
+        conn_events = int(args.conn_s * 1000.0 / (args.conn_interval_ms * (args.latency + 1)))
+        if args.notify_ms > 0:
+            notifications = int(args.conn_s * 1000.0 / args.notify_ms)
+            # With latency a notification usually wakes a skipped event
+            if args.latency:
+                conn_events += notifications * args.latency // (args.latency + 1)
+    charge = (adv_events * args.adv_uc + conn_events * args.event_uc +
+              notifications * args.tx_uc + (args.adv_s + args.conn_s) * args.bt_idle_ua)
+    return charge, {"adv_events": adv_events, "conn_events": conn_events,
+                    "notifications": notifications}
+
+
+def model(mode, args):
+    charge = 0.0
+    totals = {"active": 0.0, "cpu_sleep": 0.0, "deep_sleep": 0.0, "ds_exits": 0}
+    for duration_s, notify in ((args.adv_s, False), (args.conn_s, True)):
+        if duration_s <= 0:
+            continue
+        phase, counts = host_charge(mode, args, duration_s, host_bursts(args, duration_s, notify))
+        charge += phase
+        for key in totals:
+            totals[key] += counts[key]
+    radio, radio_counts = radio_charge(args)
+    led = 0.0
+    if args.led_ma > 0:
+        # LED on while connected; the PWM build also blinks it while advertising
+        led = args.led_ma * 1000.0 * (args.conn_s + (args.adv_s * 0.5 if mode == "sleep" else 0.0))
+    duration = args.adv_s + args.conn_s
+    avg_ua = (charge + radio + led) / duration
+    result = {"mode": mode, "host_uc": charge, "radio_uc": radio, "led_uc": led,
+              "avg_ua": avg_ua,
+              "life_days": args.capacity_mah * 1000.0 / avg_ua / 24.0 if avg_ua else 0.0}
+    result.update(totals)
+    result.update(radio_counts)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--adv-s", type=float, default=60.0, help="advertising phase")
+    parser.add_argument("--adv-interval-ms", type=float, default=100.0)
+    parser.add_argument("--conn-s", type=float, default=540.0, help="connected phase")
+    parser.add_argument("--conn-interval-ms", type=float, default=30.0)
+    parser.add_argument("--latency", type=int, default=0, help="peripheral latency, events")
+    parser.add_argument("--notify-ms", type=float, default=1000.0,
+                        help="notification period, 0 for none")
+    parser.add_argument("--update-ms", type=float, default=1000.0,
+                        help="battery level update period, 0 for none")
+    parser.add_argument("--update-cpu-ms", type=float, default=0.4, help="CPU time of one update")
+    parser.add_argument("--hci-ms", type=float, default=1.0,
+                        help="connection event to completion report on the host")
+    parser.add_argument("--hci-irq-ms", type=float, default=0.2,
+                        help="CPU time handling the completion report")
+    parser.add_argument("--ds-min-ms", type=float, default=2.0,
+                        help="shortest idle time spent in Deep Sleep")
+    parser.add_argument("--wake-us", type=float, default=300.0,
+                        help="Deep Sleep wakeup to ready, from the Power characteristic")
+    parser.add_argument("--active-ma", type=float, default=2.5)
+    parser.add_argument("--sleep-ma", type=float, default=1.0, help="CPU Sleep")
+    parser.add_argument("--deep-sleep-ua", type=float, default=8.0)
+    parser.add_argument("--wake-uc", type=float, default=0.1, help="charge of a Deep Sleep exit")
+    parser.add_argument("--adv-uc", type=float, default=8.0,
+                        help="charge of an advertising event on three channels")
+    parser.add_argument("--event-uc", type=float, default=3.0, help="charge of a connection event")
+    parser.add_argument("--tx-uc", type=float, default=1.0, help="extra charge of a notification")
+    parser.add_argument("--bt-idle-ua", type=float, default=5.0,
+                        help="controller current between radio events")
+    parser.add_argument("--led-ma", type=float, default=0.0,
+                        help="advertising LED current, 0 to leave it out")
+    parser.add_argument("--capacity-mah", type=float, default=225.0, help="CR2032 by default")
+    args = parser.parse_args()
+
+    if args.adv_s + args.conn_s <= 0:
+        parser.error("empty profile")
+
+    results = [model(mode, args) for mode in MODES]
+    print("advertising %.0f s every %.1f ms, connected %.0f s at %.2f ms latency %u, notify %s"
+          % (args.adv_s, args.adv_interval_ms, args.conn_s, args.conn_interval_ms, args.latency,
+             ("every %.0f ms" % args.notify_ms) if args.notify_ms else "off"))
+    print("%-10s %9s %9s %9s %8s %10s %10s %8s %8s %10s" %
+          ("mode", "active s", "sleep s", "DS s", "DS exits", "host uC", "radio uC", "LED uC",
+           "avg uA", "life days"))
+    for r in results:
+        print("%-10s %9.2f %9.2f %9.2f %8u %10.0f %10.0f %8.0f %8.1f %10.1f" %
+              (r["mode"], r["active"], r["cpu_sleep"], r["deep_sleep"], r["ds_exits"],
+               r["host_uc"], r["radio_uc"], r["led_uc"], r["avg_ua"], r["life_days"]))
+    print("radio: %u advertising events, %u connection events, %u notifications" %
+          (results[0]["adv_events"], results[0]["conn_events"], results[0]["notifications"]))
+    base = results[0]["avg_ua"]
+    print("deepsleep %+.1f %% average current against sleep" %
+          (100.0 * (results[1]["avg_ua"] - base) / base))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
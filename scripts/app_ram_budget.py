@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""
+RAM budget of a build, from the GNU linker map file.
+
+Sums the RAM the linker placed per object file and library, and per output
+section (.data, .bss, .heap, stacks...). With --base, prints the difference
+to another build, for instance the APP_STATIC_ALLOC=1 build against the
+default one:
+
+    python3 scripts/app_ram_budget.py build/<target>/Debug/<app>.map
+    python3 scripts/app_ram_budget.py static.map --base dynamic.map
+
+Heap usage is not in the map file. In the dynamic build, add the peak from
+the "Heap: current ... peak ..." line the application prints
+(app_bt_heap_print_stats) with --heap-peak.
+"""
+
+import argparse
+import collections
+import os
+import re
+import sys
+
+MEM_RE = re.compile(r"^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)")
+OUT_RE = re.compile(r"^(\.\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+))?")
+IN_RE = re.compile(r"^ (\S+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)(?:\s+(\S.*))?$")
+ARCHIVE_RE = re.compile(r"([^/\\]+\.a)\(([^)]+)\)$")
+
+
+def owner(path):
+    """Groups input sections by object file, or by library for archives."""
+    m = ARCHIVE_RE.search(path)
+    if m:
+        return m.group(1)
+    return os.path.basename(path)
+
+
+def parse(path):
+    ram = []
+    by_owner = collections.Counter()
+    by_section = collections.Counter()
+
+    with open(path, "r", errors="replace") as f:
+        lines = f.read().splitlines()
+
+    # Memory regions whose name says RAM
+    i = 0
+    while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+        i += 1
+    while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+        m = MEM_RE.match(lines[i])
+        if m and "ram" in m.group(1).lower():
+            origin = int(m.group(2), 16)
+            ram.append((origin, origin + int(m.group(3), 16)))
+        i += 1
+    if not ram:
+        sys.exit("%s: no RAM region in the memory configuration" % path)
+
+    def in_ram(addr):
+        return any(lo <= addr < hi for lo, hi in ram)
+
+    out_name = None
+    out_size = 0
+    out_inputs = 0
+    pending = None
+
+    def close_output():
+        # Output sections without input sections (.heap, stacks) count as a whole
+        if out_name and out_inputs == 0 and out_size and out_addr is not None and in_ram(out_addr):
+            by_owner["<%s>" % out_name] += out_size
+            by_section[out_name] += out_size
+
+    out_addr = None
+    for line in lines[i:]:
+        if line.startswith("."):
+            close_output()
+            m = OUT_RE.match(line)
+            out_name, out_inputs, out_size, out_addr = m.group(1), 0, 0, None
+            if m.group(2):
+                out_addr, out_size = int(m.group(2), 16), int(m.group(3), 16)
+            else:
+                pending = ("out", out_name)
+            continue
+
+        if pending:
+            m = CONT_RE.match(line)
+            kind = pending[0]
+            pending = None
+            if m:
+                addr, size = int(m.group(1), 16), int(m.group(2), 16)
+                if kind == "out":
+                    out_addr, out_size = addr, size
+                    continue
+                if m.group(3) and size and in_ram(addr):
+                    by_owner[owner(m.group(3))] += size
+                    by_section[out_name] += size
+                    out_inputs += 1
+                continue
+
+        m = IN_RE.match(line)
+        if not m or out_name is None:
+            continue
+        if m.group(1).startswith("*") and m.group(1) != "*fill*":
+            continue
+        if m.group(2) is None:
+            pending = ("in", m.group(1))
+            continue
+        addr, size = int(m.group(2), 16), int(m.group(3), 16)
+        if size and in_ram(addr):
+            who = "*fill*" if m.group(1) == "*fill*" else owner(m.group(4))
+            by_owner[who] += size
+            by_section[out_name] += size
+            out_inputs += 1
+    close_output()
+
+    return by_owner, by_section
+
+
+def print_budget(by_owner, by_section, heap_peak, top):
+    total = sum(by_section.values())
+    print("RAM by output section")
+    for name, size in sorted(by_section.items(), key=lambda x: -x[1]):
+        print("  %-28s %8u" % (name, size))
+    print("  %-28s %8u" % ("total placed", total))
+    if heap_peak:
+        print("  %-28s %8u" % ("heap peak (runtime)", heap_peak))
+        print("  %-28s %8u" % ("total in use", total - by_section.get(".heap", 0) + heap_peak))
+    print("")
+    print("RAM by object / library (top %u)" % top)
+    for name, size in by_owner.most_common(top):
+        print("  %-40s %8u" % (name, size))
+
+
+def print_diff(cur, base):
+    names = sorted(set(cur) | set(base), key=lambda n: -abs(cur.get(n, 0) - base.get(n, 0)))
+    print("RAM difference to base (bytes)")
+    for name in names:
+        delta = cur.get(name, 0) - base.get(name, 0)
+        if delta:
+            print("  %-40s %8u -> %8u  %+d" % (name, base.get(name, 0), cur.get(name, 0), delta))
+    print("  %-40s %+d" % ("total", sum(cur.values()) - sum(base.values())))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("map", help="linker map file of the build")
+    parser.add_argument("--base", help="map file of the build to compare with")
+    parser.add_argument("--heap-peak", type=int, default=0,
+                        help="peak heap usage reported at run time, in bytes")
+    parser.add_argument("--top", type=int, default=25, help="number of objects listed")
+    args = parser.parse_args()
+
+    by_owner, by_section = parse(args.map)
+    print_budget(by_owner, by_section, args.heap_peak, args.top)
+    if args.base:
+        base_owner, base_section = parse(args.base)
+        print("")
+        print_diff(by_section, base_section)
+        print("")
+        print_diff(by_owner, base_owner)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())